@@ -3,10 +3,24 @@
 ##############################################################################
 -include app_makefiles/app_options.mk
 
+#-----------------------------------------------------------------------------
+# Board selection
+#-----------------------------------------------------------------------------
+
+ifeq ($(BOARD),DRAGINO_RPI)
+-include app_makefiles/board_drag_rpi.mk
+BOARD_TARGET=drpi
+endif
+
+ifeq ($(BOARD),SIM)
+-include app_makefiles/board_sim.mk
+BOARD_TARGET=sim
+endif
+
 #-----------------------------------------------------------------------------
 # Build system binaries
 #-----------------------------------------------------------------------------
-PREFIX = aarch64-linux-gnu-
+# PREFIX is set by the board
 # The gcc compiler bin path can be either defined in make command via GCC_PATH variable (> make GCC_PATH=xxx)
 # either it can be added to the PATH environment variable.
 ifdef GCC_PATH
@@ -25,21 +39,24 @@ endif
 HEX = $(CP) -O ihex
 BIN = $(CP) -O binary -S
 
-#-----------------------------------------------------------------------------
-# Board selection
-#-----------------------------------------------------------------------------
-
-ifeq ($(BOARD),DRAGINO_RPI)
--include app_makefiles/board_drag_rpi.mk
-BOARD_TARGET=drpi
-endif
-
 #-----------------------------------------------------------------------------
 # Define target build directory
 #-----------------------------------------------------------------------------
 BUILD_TARGET = $(APPTARGET_ROOT)_$(TARGET)
 BUILD_DIR = $(APPBUILD_ROOT)_$(TARGET)_$(BOARD_TARGET)
 
+# Instrumented and optimised objects must not mix with the default ones. Both PGO steps share
+# a directory, as the profile of each object is found from its path
+ifeq ($(LTO),yes)
+BUILD_DIR := $(BUILD_DIR)_lto
+endif
+ifneq ($(PGO),no)
+BUILD_DIR := $(BUILD_DIR)_pgo
+endif
+
+# Outside of BUILD_DIR, so that clean_target keeps it between the PGO steps
+PGO_DIR = $(CURDIR)/$(APPBUILD_ROOT)-pgo_$(TARGET)_$(BOARD_TARGET)
+
 BASIC_MODEM_BUILD = $(LORA_BASICS_MODEM)/build
 BASIC_MODEM_LIB = $(BASIC_MODEM_BUILD)/basic_modem.a
 
@@ -126,7 +143,23 @@ WFLAG += \
 WFLAG += -fstack-usage
 
 #Link-time optimization
-#WFLAG += --lto
+ifeq ($(LTO),yes)
+WFLAG += -flto=auto
+# lbm_lib is archived without the LTO plugin, fat objects link either way
+LBM_FLAGS += -flto=auto -ffat-lto-objects
+LDFLAGS += -flto=auto $(OPT)
+endif
+
+# Profile-guided optimization, the engine and IRQ threads share counters
+ifeq ($(PGO),gen)
+PGO_FLAGS = -fprofile-generate -fprofile-update=atomic -fprofile-dir=$(PGO_DIR)
+endif
+ifeq ($(PGO),use)
+PGO_FLAGS = -fprofile-use -fprofile-partial-training -fprofile-dir=$(PGO_DIR) -Wno-missing-profile
+endif
+WFLAG += $(PGO_FLAGS)
+LBM_FLAGS += $(PGO_FLAGS)
+LDFLAGS += $(PGO_FLAGS)
 
 # AS defines
 AS_DEFS =
@@ -162,6 +195,16 @@ COMMON_C_DEFS += \
 	-DPERF_TEST_ENABLED
 endif
 
+ifeq ($(TEST_TX_POWER_CAL),yes)
+COMMON_C_DEFS += \
+	-DENABLE_TEST_TX_POWER_CAL=1
+endif
+
+ifeq ($(TEST_BOARD_DELAY_STORE),yes)
+COMMON_C_DEFS += \
+	-DENABLE_TEST_BOARD_DELAY_STORE=1
+endif
+
 ifeq ($(USE_FUOTA),yes)
 COMMON_C_DEFS += \
 	-DUSE_FLASH_READ_MODIFY_WRITE\
@@ -221,9 +264,9 @@ CFLAGS += -std=c17
 # Link flags
 #-----------------------------------------------------------------------------
 # libraries
-LIBS += -lm -lc -lpigpio
+LIBS += -lm -lc -lrt $(BOARD_LIBS) -lpthread
 
-LIBDIR = -L/usr/aarch64-linux-gnu/usr/local/lib
+LIBDIR = $(BOARD_LIBDIR)
 
 LDFLAGS += $(MCU_FLAGS)
 # LDFLAGS += --specs=nano.specs
@@ -238,21 +281,56 @@ LDFLAGS += -Wl,--gc-sections # Garbage collect unused sections
 # User application sources
 #-----------------------------------------------------------------------------
 APP_C_SOURCES += \
-	main.c
+	main.c \
+	supervisor.c \
+	main_examples/csv_log.c
 
 ifeq ($(MODEM_APP),nc)
 APP_C_SOURCES += \
-	main_examples/main_periodical_uplink.c
+	main_examples/main_periodical_uplink.c \
+	main_examples/bench_stats.c \
+	main_examples/lorawan_session.c \
+	main_examples/stats_shm.c
 endif
 
 ifeq ($(MODEM_APP),PERIODICAL_UPLINK)
 APP_C_SOURCES += \
-	main_examples/main_periodical_uplink.c
+	main_examples/main_periodical_uplink.c \
+	main_examples/bench_stats.c \
+	main_examples/lorawan_session.c \
+	main_examples/stats_shm.c
 endif
 
 ifeq ($(MODEM_APP),PORTING_TESTS)
 APP_C_SOURCES += \
-	main_examples/main_porting_tests.c
+	main_examples/main_porting_tests.c \
+	main_examples/bench_stats.c
+endif
+
+ifeq ($(MODEM_APP),CHANNEL_MONITOR)
+APP_C_SOURCES += \
+	main_examples/main_channel_monitor.c
+endif
+
+ifeq ($(MODEM_APP),SNIFFER)
+APP_C_SOURCES += \
+	main_examples/main_sniffer.c
+endif
+
+ifeq ($(MODEM_APP),SPI_BENCH)
+APP_C_SOURCES += \
+	main_examples/main_spi_bench.c
+endif
+
+ifeq ($(MODEM_APP),SIM_GATEWAY)
+APP_C_SOURCES += \
+	main_examples/main_sim_gateway.c
+endif
+
+ifeq ($(MODEM_APP),PER_TESTER)
+APP_C_SOURCES += \
+	main_examples/main_per_tester.c \
+	main_examples/bench_stats.c
 endif
 
 COMMON_C_INCLUDES += \
@@ -264,6 +342,11 @@ MODEM_C_INCLUDES += \
 	-I$(LORA_BASICS_MODEM)/smtc_modem_core/smtc_ralf/src
 endif
 
+ifneq ($(filter $(MODEM_APP),CHANNEL_MONITOR SNIFFER PER_TESTER),)
+MODEM_C_INCLUDES += \
+	-I$(LORA_BASICS_MODEM)/smtc_modem_core/smtc_ralf/src
+endif
+
 #-----------------------------------------------------------------------------
 # Common sources
 #-----------------------------------------------------------------------------
@@ -271,9 +354,18 @@ endif
 RADIO_HAL_C_SOURCES += \
 	radio_hal/radio_utilities.c
 
+SIM_C_SOURCES += \
+	sim/sim_crypto.c\
+	sim/sim_radio.c\
+	sim/sim_ns.c\
+	sim/sim_link.c\
+	sim/sim_channel.c\
+	sim/sim_gateway.c
+
 COMMON_C_INCLUDES +=  \
 	-I.\
 	-Iradio_hal\
+	-Isim\
 	-Ismtc_modem_hal\
 	-I$(LORA_BASICS_MODEM)/smtc_modem_api\
 	-I$(LORA_BASICS_MODEM)/smtc_modem_hal
@@ -289,7 +381,8 @@ C_SOURCES = \
 	$(BOARD_C_SOURCES) \
 	$(RADIO_DRIVER_C_SOURCES) \
 	$(LITTLEFS_C_SOURCES) \
-	$(RADIO_HAL_C_SOURCES)
+	$(RADIO_HAL_C_SOURCES) \
+	$(SIM_C_SOURCES)
 
 ASM_SOURCES = $(BOARD_ASM_SOURCES)
 
@@ -354,3 +447,16 @@ clean_target:
 
 clean_modem:
 	$(MAKE) -C $(LORA_BASICS_MODEM) clean_$(TARGET_RADIO) CRYPTO=$(CRYPTO) MODEM_TRACE=$(LBM_TRACE)
+
+#-----------------------------------------------------------------------------
+# Engine benchmark, also the PGO training workload
+#-----------------------------------------------------------------------------
+bench_run: | $(PGO_DIR)
+	$(call build,'BENCH',$(PGO_DIR)/$(BENCH_NAME).json)
+	$(SILENT)printf 'spi.backend = sim\nbench.duration_s = %s\nbench.results_path = %s\n%b' $(BENCH_S) \
+		$(PGO_DIR)/$(BENCH_NAME).json "$(if $(BENCH_BASELINE),bench.baseline_path = $(BENCH_BASELINE)\n)" \
+		> $(PGO_DIR)/$(BENCH_NAME).conf
+	$(BOARD_LAUNCHER) env LBM_BOARD_PROFILE=$(PGO_DIR)/$(BENCH_NAME).conf $(BUILD_DIR)/$(BUILD_TARGET).elf $(BENCH_ARGS)
+
+$(PGO_DIR):
+	$(SILENT)mkdir -p $@
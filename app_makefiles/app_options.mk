@@ -11,16 +11,22 @@ APPBUILD_ROOT = build
 # Prefix for all binaries names
 APPTARGET_ROOT = app
 
-# Target board (only DRAGINO_RPI for now)
+# Target board (DRAGINO_RPI, or SIM for a host build with the simulated radio)
 BOARD ?= DRAGINO_RPI
 
 # Target radio
 TARGET_RADIO ?= nc
 
-# Application (only PERIODICAL_UPLINK or PORTING_TESTS for now)
+# Application (PERIODICAL_UPLINK, PORTING_TESTS, CHANNEL_MONITOR, SNIFFER, SPI_BENCH, SIM_GATEWAY or PER_TESTER)
 # Default: PERIODICAL_UPLINK
 MODEM_APP ?= nc
 
+# Porting tests: run the interactive per-frequency TX power calibration after the tests
+TEST_TX_POWER_CAL ?= no
+
+# Porting tests: store the measured board delay in the board profile overlay
+TEST_BOARD_DELAY_STORE ?= no
+
 # Application region for periodical uplink and lctt certif example (values can be found in smtc_modem_api.h)
 # Default in code: SMTC_MODEM_REGION_EU_868
 MODEM_APP_REGION ?= nc
@@ -70,6 +76,26 @@ APP_OPT = -Os
 # Lora Basics Modem build optimization
 LBM_OPT = -Os
 
+# Link-time optimization of the app, HAL and lbm_lib
+LTO ?= no
+
+# Profile-guided optimization: no, gen (instrumented build) or use (build with the profile)
+PGO ?= no
+
+#-----------------------------------------------------------------------------
+# Engine benchmark (make bench_<TARGET>), also the PGO training workload
+#-----------------------------------------------------------------------------
+
+# Duration in seconds
+BENCH_S ?= 300
+
+# Periodical uplink arguments
+BENCH_ARGS ?= 5 51 var
+
+# Results name, and results to compare to
+BENCH_NAME ?= bench
+BENCH_BASELINE ?=
+
 #-----------------------------------------------------------------------------
 # Debug
 #-----------------------------------------------------------------------------
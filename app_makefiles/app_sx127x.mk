@@ -13,7 +13,12 @@ endif
 
 RADIO_HAL_C_SOURCES += \
 	radio_hal/sx127x_hal.c \
-	radio_hal/ral_sx127x_bsp.c
+	radio_hal/ral_sx127x_bsp.c \
+	radio_hal/radio_energy.c \
+	radio_hal/radio_state_time.c \
+	radio_hal/radio_snapshot.c \
+	radio_hal/radio_pkt_status.c \
+	radio_hal/radio_temperature.c
 
 #-----------------------------------------------------------------------------
 # Includes
@@ -2,6 +2,13 @@
 # Definitions for the Dragino GPS HAT on a Raspberry Pi 3B+ board 
 ##############################################################################
 
+#-----------------------------------------------------------------------------
+# Build system binaries
+#-----------------------------------------------------------------------------
+
+# Cross toolchain for the Pi
+PREFIX = aarch64-linux-gnu-
+
 #-----------------------------------------------------------------------------
 # Compilation flags
 #-----------------------------------------------------------------------------
@@ -11,6 +18,17 @@ MCU_FLAGS ?= -mcpu=cortex-a53 -mtune=cortex-a53
 
 BOARD_C_DEFS = -D_POSIX_C_SOURCE=199309L -D_XOPEN_SOURCE=600
 
+#-----------------------------------------------------------------------------
+# Link flags
+#-----------------------------------------------------------------------------
+
+BOARD_LIBS = -lpigpio
+
+BOARD_LIBDIR = -L/usr/aarch64-linux-gnu/usr/local/lib
+
+# pigpio needs root
+BOARD_LAUNCHER = sudo
+
 #-----------------------------------------------------------------------------
 # Hardware-specific sources
 #-----------------------------------------------------------------------------
@@ -19,11 +37,20 @@ BOARD_C_SOURCES = \
 	smtc_hal_drag_rpi/smtc_hal_nvm.c\
 	smtc_hal_drag_rpi/smtc_hal_gpio.c\
 	smtc_hal_drag_rpi/smtc_hal_mcu.c\
+	smtc_hal_drag_rpi/smtc_hal_board_pigpio.c\
 	smtc_hal_drag_rpi/smtc_hal_rtc.c\
 	smtc_hal_drag_rpi/smtc_hal_rng.c\
 	smtc_hal_drag_rpi/smtc_hal_spi.c\
 	smtc_hal_drag_rpi/smtc_hal_lp_timer.c\
-	smtc_hal_drag_rpi/smtc_hal_trace.c
+	smtc_hal_drag_rpi/smtc_hal_trace.c\
+	smtc_hal_drag_rpi/smtc_hal_latency.c\
+	smtc_hal_drag_rpi/smtc_hal_irq_queue.c\
+	smtc_hal_drag_rpi/smtc_hal_board_profile.c\
+	smtc_hal_drag_rpi/smtc_hal_clock_drift.c\
+	smtc_hal_drag_rpi/smtc_hal_env.c\
+	smtc_hal_drag_rpi/smtc_hal_startup.c\
+	smtc_hal_drag_rpi/smtc_hal_reset_cause.c\
+	smtc_hal_drag_rpi/smtc_hal_spi_sim.c
 
 BOARD_ASM_SOURCES = 
 
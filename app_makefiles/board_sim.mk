@@ -0,0 +1,61 @@
+##############################################################################
+# Definitions for the host simulation board: simulated SX1276, no hardware
+##############################################################################
+
+#-----------------------------------------------------------------------------
+# Build system binaries
+#-----------------------------------------------------------------------------
+
+# Native toolchain
+PREFIX =
+
+#-----------------------------------------------------------------------------
+# Compilation flags
+#-----------------------------------------------------------------------------
+
+#MCU compilation flags
+MCU_FLAGS ?=
+
+BOARD_C_DEFS = -D_POSIX_C_SOURCE=199309L -D_XOPEN_SOURCE=600
+
+#-----------------------------------------------------------------------------
+# Link flags
+#-----------------------------------------------------------------------------
+
+BOARD_LIBS =
+
+BOARD_LIBDIR =
+
+BOARD_LAUNCHER =
+
+#-----------------------------------------------------------------------------
+# Hardware-specific sources
+#-----------------------------------------------------------------------------
+# Only GPIO, SPI and the MCU board hooks touch the hardware, the rest is shared with the Pi HAL
+BOARD_C_SOURCES = \
+	smtc_modem_hal/smtc_modem_hal.c\
+	smtc_hal_sim/smtc_hal_gpio.c\
+	smtc_hal_sim/smtc_hal_board_sim.c\
+	smtc_hal_drag_rpi/smtc_hal_mcu.c\
+	smtc_hal_sim/smtc_hal_spi.c\
+	smtc_hal_drag_rpi/smtc_hal_nvm.c\
+	smtc_hal_drag_rpi/smtc_hal_rtc.c\
+	smtc_hal_drag_rpi/smtc_hal_rng.c\
+	smtc_hal_drag_rpi/smtc_hal_lp_timer.c\
+	smtc_hal_drag_rpi/smtc_hal_trace.c\
+	smtc_hal_drag_rpi/smtc_hal_latency.c\
+	smtc_hal_drag_rpi/smtc_hal_irq_queue.c\
+	smtc_hal_drag_rpi/smtc_hal_board_profile.c\
+	smtc_hal_drag_rpi/smtc_hal_clock_drift.c\
+	smtc_hal_drag_rpi/smtc_hal_env.c\
+	smtc_hal_drag_rpi/smtc_hal_startup.c\
+	smtc_hal_drag_rpi/smtc_hal_reset_cause.c\
+	smtc_hal_drag_rpi/smtc_hal_spi_sim.c
+
+BOARD_ASM_SOURCES = 
+
+BOARD_C_INCLUDES =  \
+	-I.\
+	-Ismtc_modem_hal\
+	-Ismtc_hal_sim\
+	-Ismtc_hal_drag_rpi
@@ -38,13 +38,12 @@
  */
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
-#include <unistd.h>   // fork
-#include <sys/wait.h> // waitpid
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>   // strcmp
 
 #include "main.h"
+#include "supervisor.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -54,10 +53,25 @@ uint32_t g_uplink_period_s   = 60;
 uint8_t  g_packet_size       = 12;
 bool     g_packet_size_fixed = true;
 
+uint32_t    g_bench_iterations    = 10;
+const char* g_bench_results_path  = NULL;
+const char* g_bench_baseline_path = NULL;
+bool        g_bench_compare_only  = false;
+
 /*
  * -----------------------------------------------------------------------------
  * --- APPLICATION SELECTION ---------------------------------------------------
  */
+
+/* Numeric ids so MAKEFILE_APP can be compared in #if */
+#define PERIODICAL_UPLINK 1
+#define PORTING_TESTS 2
+#define CHANNEL_MONITOR 3
+#define SNIFFER 4
+#define SPI_BENCH 5
+#define SIM_GATEWAY 6
+#define PER_TESTER 7
+
 #ifndef MAKEFILE_APP
 #pragma GCC warning "Using default application PERIODICAL_UPLINK"
 #define MAKEFILE_APP PERIODICAL_UPLINK
@@ -70,6 +84,34 @@ bool     g_packet_size_fixed = true;
 
 int main( int argc, char* argv[] )
 {
+#if MAKEFILE_APP == PORTING_TESTS
+    /* --- Parse command-line arguments ---
+     *  porting_tests [iterations] [results.json] [baseline.json]
+     *  porting_tests compare <baseline.json> <results.json>
+     */
+    if( ( argc >= 4 ) && ( strcmp( argv[1], "compare" ) == 0 ) )
+    {
+        g_bench_compare_only  = true;
+        g_bench_baseline_path = argv[2];
+        g_bench_results_path  = argv[3];
+    }
+    else
+    {
+        if( argc >= 2 )
+        {
+            int n = atoi( argv[1] );
+            g_bench_iterations = ( n < 1 ) ? 1 : ( uint32_t ) n;
+        }
+        if( argc >= 3 )
+        {
+            g_bench_results_path = argv[2];
+        }
+        if( argc >= 4 )
+        {
+            g_bench_baseline_path = argv[3];
+        }
+    }
+#else
     /* --- Parse command-line arguments ---
      *  argv[1] = period_s
      *  argv[2] = packet_size (max size if variable mode, 1-222)
@@ -112,31 +154,34 @@ int main( int argc, char* argv[] )
             g_packet_size_fixed = true;
         }
     }
+#endif
 
+#if MAKEFILE_APP == PERIODICAL_UPLINK
     printf( "=== LoRaWAN Periodical Uplink ===\n" );
     printf( "  Period:      %u s\n", ( unsigned ) g_uplink_period_s );
     printf( "  Packet size: %u bytes (%s)\n", ( unsigned ) g_packet_size,
             g_packet_size_fixed ? "FIXED" : "VARIABLE 1..max" );
     printf( "=================================\n" );
+#endif
 
-    /* --- Fork-loop: restarts the app on mcu_panic (exit code 3) --- */
-    pid_t cpid;
-    int   wstatus = 0;
-
-    do
-    {
-        if( ( cpid = fork( ) ) == 0 )
-        {
+    /* --- Supervisor: restarts the app on mcu_panic (exit code 3) or crash, with backoff ---
+     * Its exit code forwards the application verdict, e.g. porting tests regressions
+     */
 #if MAKEFILE_APP == PERIODICAL_UPLINK
-            main_periodical_uplink( );
+    return supervisor_run( main_periodical_uplink );
 #elif MAKEFILE_APP == PORTING_TESTS
-            main_porting_tests( );
+    return supervisor_run( main_porting_tests );
+#elif MAKEFILE_APP == CHANNEL_MONITOR
+    return supervisor_run( main_channel_monitor );
+#elif MAKEFILE_APP == SNIFFER
+    return supervisor_run( main_sniffer );
+#elif MAKEFILE_APP == SPI_BENCH
+    return supervisor_run( main_spi_bench );
+#elif MAKEFILE_APP == SIM_GATEWAY
+    return supervisor_run( main_sim_gateway );
+#elif MAKEFILE_APP == PER_TESTER
+    return supervisor_run( main_per_tester );
 #else
 #error "Unknown application"
 #endif
-        }
-        waitpid( cpid, &wstatus, 0 );
-    } while( WIFEXITED( wstatus ) && WEXITSTATUS( wstatus ) == 3 );
-
-    return 0;
 }
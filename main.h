@@ -18,9 +18,20 @@ extern uint32_t g_uplink_period_s;
 extern uint8_t  g_packet_size;
 extern bool     g_packet_size_fixed;
 
+/* --- Porting tests benchmark (set in main.c from command line) --- */
+extern uint32_t    g_bench_iterations;
+extern const char* g_bench_results_path;   /* NULL: porting-tests-<date>.json */
+extern const char* g_bench_baseline_path;  /* NULL: no comparison */
+extern bool        g_bench_compare_only;   /* Compare the two files, no test run */
+
 /* --- Application entry points --- */
 void main_periodical_uplink( void );
 void main_porting_tests( void );
+void main_channel_monitor( void );
+void main_sniffer( void );
+void main_spi_bench( void );
+void main_sim_gateway( void );
+void main_per_tester( void );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,341 @@
+/*!
+ * \file      bench_stats.c
+ *
+ * \brief     Timing statistics, JSON results and result comparison implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>  // gethostname
+
+#include "bench_stats.h"
+#include "csv_log.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define BENCH_STATS_JSON_VERSION 1
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bench_stats_t results[BENCH_STATS_MAX_RESULTS];
+static uint32_t      nb_results = 0;
+
+static bench_stats_cpu_t run_cpu;
+static bool              run_cpu_set = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static int bench_stats_cmp_double( const void* a, const void* b );
+
+static double bench_stats_percentile( const double* sorted, const uint32_t nb_samples, const uint32_t percent );
+
+static bool bench_stats_is_worse( const double baseline, const double current, const double tolerance_pct,
+                                  const double tolerance_us );
+
+static const bench_stats_t* bench_stats_find( const bench_stats_t* table, const int nb, const char* name );
+
+static bool bench_stats_read_cpu( const char* path, bench_stats_cpu_t* cpu );
+
+static double bench_stats_gain_pct( const double baseline, const double current );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bench_stats_compute( double* samples, const uint32_t nb_samples, bench_stats_t* stats )
+{
+    double sum = 0.0;
+
+    stats->nb_samples = nb_samples;
+    if( nb_samples == 0 )
+    {
+        stats->min_us = stats->mean_us = stats->p50_us = stats->p99_us = stats->max_us = 0.0;
+        return;
+    }
+
+    qsort( samples, nb_samples, sizeof( samples[0] ), bench_stats_cmp_double );
+    for( uint32_t i = 0; i < nb_samples; i++ )
+    {
+        sum += samples[i];
+    }
+
+    stats->min_us  = samples[0];
+    stats->max_us  = samples[nb_samples - 1];
+    stats->mean_us = sum / nb_samples;
+    stats->p50_us  = bench_stats_percentile( samples, nb_samples, 50 );
+    stats->p99_us  = bench_stats_percentile( samples, nb_samples, 99 );
+}
+
+bool bench_stats_add( const char* name, double* samples, const uint32_t nb_samples, const uint32_t nb_failed )
+{
+    if( ( nb_samples == 0 ) || ( nb_results >= BENCH_STATS_MAX_RESULTS ) )
+    {
+        return false;
+    }
+
+    bench_stats_t* stats = &results[nb_results++];
+
+    snprintf( stats->name, sizeof( stats->name ), "%s", name );
+    stats->nb_failed = nb_failed;
+    bench_stats_compute( samples, nb_samples, stats );
+
+    SMTC_HAL_TRACE_PRINTF( " %s: n %u, min %.1f, mean %.1f, p50 %.1f, p99 %.1f, max %.1f us\n", stats->name,
+                           ( unsigned ) stats->nb_samples, stats->min_us, stats->mean_us, stats->p50_us,
+                           stats->p99_us, stats->max_us );
+    return true;
+}
+
+void bench_stats_set_cpu( const bench_stats_cpu_t* cpu )
+{
+    run_cpu     = *cpu;
+    run_cpu_set = ( cpu->wall_s > 0.0 );
+}
+
+bool bench_stats_write_json( const char* path, const uint32_t iterations )
+{
+    char host[64] = "";
+    char timestr[32];
+
+    FILE* fp = fopen( path, "w" );
+    if( fp == NULL )
+    {
+        SMTC_HAL_TRACE_ERROR( "Failed to open %s: %s\n", path, strerror( errno ) );
+        return false;
+    }
+
+    gethostname( host, sizeof( host ) - 1 );
+    csv_log_timestr( timestr, sizeof( timestr ) );
+
+    fprintf( fp, "{\n  \"version\": %d,\n  \"host\": \"%s\",\n  \"timestamp\": \"%s\",\n  \"iterations\": %u,\n",
+             BENCH_STATS_JSON_VERSION, host, timestr, ( unsigned ) iterations );
+    if( run_cpu_set == true )
+    {
+        fprintf( fp, "  \"cpu\": { \"wall_s\": %.3f, \"user_s\": %.3f, \"sys_s\": %.3f },\n", run_cpu.wall_s,
+                 run_cpu.user_s, run_cpu.sys_s );
+    }
+    fprintf( fp, "  \"tests\": [\n" );
+    for( uint32_t i = 0; i < nb_results; i++ )
+    {
+        const bench_stats_t* stats = &results[i];
+        fprintf( fp,
+                 "    { \"name\": \"%s\", \"n\": %u, \"failed\": %u, \"min_us\": %.1f, \"mean_us\": %.1f, "
+                 "\"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f }%s\n",
+                 stats->name, ( unsigned ) stats->nb_samples, ( unsigned ) stats->nb_failed, stats->min_us,
+                 stats->mean_us, stats->p50_us, stats->p99_us, stats->max_us, ( i + 1 < nb_results ) ? "," : "" );
+    }
+    fprintf( fp, "  ]\n}\n" );
+
+    const bool ok = ( ferror( fp ) == 0 );
+    return ( fclose( fp ) == 0 ) && ok;
+}
+
+int bench_stats_read_json( const char* path, bench_stats_t* table, const uint32_t nb_table )
+{
+    char line[512];
+    int  nb = 0;
+
+    FILE* fp = fopen( path, "r" );
+    if( fp == NULL )
+    {
+        SMTC_HAL_TRACE_ERROR( "Failed to open %s: %s\n", path, strerror( errno ) );
+        return -1;
+    }
+
+    // One test object per line, as written by bench_stats_write_json
+    while( ( ( uint32_t ) nb < nb_table ) && ( fgets( line, sizeof( line ), fp ) != NULL ) )
+    {
+        bench_stats_t* stats = &table[nb];
+        unsigned       n, failed;
+
+        if( sscanf( line,
+                    " { \"name\": \"%31[^\"]\", \"n\": %u, \"failed\": %u, \"min_us\": %lf, \"mean_us\": %lf, "
+                    "\"p50_us\": %lf, \"p99_us\": %lf, \"max_us\": %lf",
+                    stats->name, &n, &failed, &stats->min_us, &stats->mean_us, &stats->p50_us, &stats->p99_us,
+                    &stats->max_us ) == 8 )
+        {
+            stats->nb_samples = n;
+            stats->nb_failed  = failed;
+            nb++;
+        }
+    }
+
+    fclose( fp );
+    return nb;
+}
+
+int bench_stats_compare( const char* baseline_path, const char* current_path, const double tolerance_pct,
+                         const double tolerance_us )
+{
+    static bench_stats_t baseline[BENCH_STATS_MAX_RESULTS];
+    static bench_stats_t current[BENCH_STATS_MAX_RESULTS];
+    int                  nb_regressed = 0;
+    bench_stats_cpu_t    baseline_cpu;
+    bench_stats_cpu_t    current_cpu;
+
+    const int nb_baseline = bench_stats_read_json( baseline_path, baseline, BENCH_STATS_MAX_RESULTS );
+    const int nb_current  = bench_stats_read_json( current_path, current, BENCH_STATS_MAX_RESULTS );
+    if( ( nb_baseline < 0 ) || ( nb_current < 0 ) )
+    {
+        return -1;
+    }
+
+    SMTC_HAL_TRACE_PRINTF( "Comparing %s to %s (tolerance %.0f%% / %.0f us)\n", current_path, baseline_path,
+                           tolerance_pct, tolerance_us );
+    SMTC_HAL_TRACE_PRINTF( " %-24s %10s %10s %10s %10s %10s  %s\n", "test", "p50 base", "p50", "p99 base", "p99",
+                           "mean gain", "verdict" );
+
+    for( int i = 0; i < nb_current; i++ )
+    {
+        const bench_stats_t* cur  = &current[i];
+        const bench_stats_t* base = bench_stats_find( baseline, nb_baseline, cur->name );
+        const char*          verdict;
+
+        if( base == NULL )
+        {
+            SMTC_HAL_TRACE_PRINTF( " %-24s %10s %10.1f %10s %10.1f %10s  NEW\n", cur->name, "-", cur->p50_us, "-",
+                                   cur->p99_us, "-" );
+            continue;
+        }
+
+        if( ( cur->nb_failed > base->nb_failed ) ||
+            bench_stats_is_worse( base->p50_us, cur->p50_us, tolerance_pct, tolerance_us ) ||
+            bench_stats_is_worse( base->p99_us, cur->p99_us, tolerance_pct, tolerance_us ) )
+        {
+            verdict = "REGRESS";
+            nb_regressed++;
+        }
+        else if( bench_stats_is_worse( cur->p50_us, base->p50_us, tolerance_pct, tolerance_us ) ||
+                 bench_stats_is_worse( cur->p99_us, base->p99_us, tolerance_pct, tolerance_us ) )
+        {
+            verdict = "IMPROVED";
+        }
+        else
+        {
+            verdict = "PASS";
+        }
+
+        SMTC_HAL_TRACE_PRINTF( " %-24s %10.1f %10.1f %10.1f %10.1f %9.1f%%  %s\n", cur->name, base->p50_us,
+                               cur->p50_us, base->p99_us, cur->p99_us,
+                               bench_stats_gain_pct( base->mean_us, cur->mean_us ), verdict );
+    }
+
+    for( int i = 0; i < nb_baseline; i++ )
+    {
+        // A test that stopped running is as bad as a slower one
+        if( bench_stats_find( current, nb_current, baseline[i].name ) == NULL )
+        {
+            nb_regressed++;
+            SMTC_HAL_TRACE_PRINTF( " %-24s %10.1f %10s %10.1f %10s %10s  MISSING\n", baseline[i].name,
+                                   baseline[i].p50_us, "-", baseline[i].p99_us, "-", "-" );
+        }
+    }
+
+    if( ( bench_stats_read_cpu( baseline_path, &baseline_cpu ) == true ) &&
+        ( bench_stats_read_cpu( current_path, &current_cpu ) == true ) )
+    {
+        // Share of one core, user and system time
+        const double baseline_pct = ( baseline_cpu.user_s + baseline_cpu.sys_s ) * 100.0 / baseline_cpu.wall_s;
+        const double current_pct  = ( current_cpu.user_s + current_cpu.sys_s ) * 100.0 / current_cpu.wall_s;
+
+        SMTC_HAL_TRACE_PRINTF( " CPU use %.2f %% -> %.2f %% of a core, gain %.1f %%\n", baseline_pct, current_pct,
+                               bench_stats_gain_pct( baseline_pct, current_pct ) );
+    }
+
+    SMTC_HAL_TRACE_PRINTF( "%d regressed test(s)\n", nb_regressed );
+    return nb_regressed;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static int bench_stats_cmp_double( const void* a, const void* b )
+{
+    const double x = *( const double* ) a;
+    const double y = *( const double* ) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/* Nearest rank */
+static double bench_stats_percentile( const double* sorted, const uint32_t nb_samples, const uint32_t percent )
+{
+    uint32_t rank = ( nb_samples * percent + 99 ) / 100;
+
+    if( rank == 0 )
+    {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static bool bench_stats_is_worse( const double baseline, const double current, const double tolerance_pct,
+                                  const double tolerance_us )
+{
+    const double delta = current - baseline;
+
+    return ( delta > tolerance_us ) && ( delta > baseline * tolerance_pct / 100.0 );
+}
+
+static const bench_stats_t* bench_stats_find( const bench_stats_t* table, const int nb, const char* name )
+{
+    for( int i = 0; i < nb; i++ )
+    {
+        if( strcmp( table[i].name, name ) == 0 )
+        {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static bool bench_stats_read_cpu( const char* path, bench_stats_cpu_t* cpu )
+{
+    char line[512];
+    bool found = false;
+
+    FILE* fp = fopen( path, "r" );
+    if( fp == NULL )
+    {
+        return false;
+    }
+
+    while( ( found == false ) && ( fgets( line, sizeof( line ), fp ) != NULL ) )
+    {
+        found = ( sscanf( line, " \"cpu\": { \"wall_s\": %lf, \"user_s\": %lf, \"sys_s\": %lf", &cpu->wall_s,
+                          &cpu->user_s, &cpu->sys_s ) == 3 ) &&
+                ( cpu->wall_s > 0.0 );
+    }
+
+    fclose( fp );
+    return found;
+}
+
+/* Positive when the current run is faster */
+static double bench_stats_gain_pct( const double baseline, const double current )
+{
+    return ( baseline > 0.0 ) ? ( baseline - current ) * 100.0 / baseline : 0.0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
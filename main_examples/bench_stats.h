@@ -0,0 +1,158 @@
+/*!
+ * \file      bench_stats.h
+ *
+ * \brief     Timing statistics, JSON results and result comparison for the porting tests
+ *            and the engine benchmark
+ *
+ * Each timing test hands its samples, in microseconds and lower is better, to
+ * bench_stats_add which keeps min/mean/p50/p99/max. The results file holds one
+ * test object per line:
+ *
+ *   { "name": "spi", "n": 10, "failed": 0, "min_us": 41.0, "mean_us": 44.2,
+ *     "p50_us": 43.0, "p99_us": 58.0, "max_us": 58.0 },
+ *
+ * bench_stats_compare reads two such files back and flags a test as regressed
+ * when its p50 or p99 grew by more than both the relative and the absolute
+ * tolerance, which keeps scheduler jitter on fast tests from flapping. More
+ * failed iterations, or a baseline test missing from the current results, is
+ * a regression too.
+ *
+ * A run may also record the CPU time of the process, on a line of its own:
+ *
+ *   "cpu": { "wall_s": 300.0, "user_s": 1.92, "sys_s": 0.71 },
+ *
+ * The comparison then reports the CPU use of both runs. It is informative
+ * only, as it follows the traffic as much as the code.
+ */
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define BENCH_STATS_MAX_SAMPLES 1000
+#define BENCH_STATS_MAX_RESULTS 16
+#define BENCH_STATS_NAME_LEN 32
+
+#define BENCH_STATS_DEFAULT_TOLERANCE_PCT 10.0
+#define BENCH_STATS_DEFAULT_TOLERANCE_US 20.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Statistics of one test
+ */
+typedef struct bench_stats_s
+{
+    char     name[BENCH_STATS_NAME_LEN];
+    uint32_t nb_samples;
+    uint32_t nb_failed;  //!< Iterations outside of the test margin
+    double   min_us;
+    double   mean_us;
+    double   p50_us;
+    double   p99_us;
+    double   max_us;
+} bench_stats_t;
+
+/*!
+ * CPU time of the process over a run
+ */
+typedef struct bench_stats_cpu_s
+{
+    double wall_s;
+    double user_s;
+    double sys_s;
+} bench_stats_cpu_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Computes the statistics of a sample set
+ *
+ * \param [in,out] samples    Samples in us, sorted on return
+ * \param [in]     nb_samples Number of samples
+ * \param [out]    stats      Statistics, name and nb_failed are left untouched
+ */
+void bench_stats_compute( double* samples, const uint32_t nb_samples, bench_stats_t* stats );
+
+/*!
+ * Computes, traces and records the statistics of a test
+ *
+ * \param [in]     name       Test name, also the key used by the comparison
+ * \param [in,out] samples    Samples in us, sorted on return
+ * \param [in]     nb_samples Number of samples
+ * \param [in]     nb_failed  Iterations outside of the test margin
+ *
+ * \retval false if there are no samples or the result table is full
+ */
+bool bench_stats_add( const char* name, double* samples, const uint32_t nb_samples, const uint32_t nb_failed );
+
+/*!
+ * Records the CPU time of the run, written with the results
+ *
+ * \param [in] cpu CPU time, wall_s above 0
+ */
+void bench_stats_set_cpu( const bench_stats_cpu_t* cpu );
+
+/*!
+ * Writes the recorded results
+ *
+ * \param [in] path       Results file
+ * \param [in] iterations Requested iterations per test
+ *
+ * \retval true if written
+ */
+bool bench_stats_write_json( const char* path, const uint32_t iterations );
+
+/*!
+ * Reads a results file written by bench_stats_write_json
+ *
+ * \param [in]  path       Results file
+ * \param [out] results    Results
+ * \param [in]  nb_results Size of results
+ *
+ * \retval number of results read, -1 if the file cannot be opened
+ */
+int bench_stats_read_json( const char* path, bench_stats_t* results, const uint32_t nb_results );
+
+/*!
+ * Compares two results files and traces a verdict and the mean time gain per test, then the
+ * CPU use of both runs when recorded
+ *
+ * \param [in] baseline_path Reference results
+ * \param [in] current_path  Results to check
+ * \param [in] tolerance_pct Allowed relative growth of p50 and p99
+ * \param [in] tolerance_us  Allowed absolute growth of p50 and p99
+ *
+ * \retval number of regressed tests, -1 if a file cannot be read
+ */
+int bench_stats_compare( const char* baseline_path, const char* current_path, const double tolerance_pct,
+                         const double tolerance_us );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BENCH_STATS_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,137 @@
+/*!
+ * \file      csv_log.c
+ *
+ * \brief     CSV event log implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>  // C99 types
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "csv_log.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static FILE* csv_fp = NULL;
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void csv_write_hex_field( FILE* fp, const uint8_t* data, size_t datalen );
+static void csv_write_escaped_field( FILE* fp, const char* str );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int csv_log_init( const char* prefix )
+{
+    char timestr[32];
+    csv_log_timestr( timestr, sizeof( timestr ) );
+
+    char filename[128];
+    snprintf( filename, sizeof( filename ), "%s-%s.csv", prefix, timestr );
+
+    csv_fp = fopen( filename, "a" );
+    if( !csv_fp )
+    {
+        SMTC_HAL_TRACE_ERROR( "Failed to open CSV file %s: %s\n", filename, strerror( errno ) );
+        return -1;
+    }
+
+    fprintf( csv_fp, "TIMESTAMP,DEVEUI,EVENT,DATA,SF,EXTRA\n" );
+    fflush( csv_fp );
+    return 0;
+}
+
+void csv_log_write_row( const uint8_t deveui[8], const char* event, const uint8_t* data, size_t datalen,
+                        const char* sf, const char* extra )
+{
+    if( !csv_fp )
+    {
+        return;
+    }
+
+    char timestr[32];
+    csv_log_timestr( timestr, sizeof( timestr ) );
+
+    fprintf( csv_fp, "\"%s\",", timestr );
+    csv_write_hex_field( csv_fp, deveui, ( deveui != NULL ) ? 8 : 0 );
+    fprintf( csv_fp, ",\"%s\",", event ? event : "" );
+    csv_write_hex_field( csv_fp, data, datalen );
+    fprintf( csv_fp, ",\"%s\",", sf ? sf : "" );
+    csv_write_escaped_field( csv_fp, extra );
+    fputc( '\n', csv_fp );
+
+    fflush( csv_fp );
+}
+
+void csv_log_close( void )
+{
+    if( csv_fp )
+    {
+        fclose( csv_fp );
+        csv_fp = NULL;
+    }
+}
+
+void csv_log_timestr( char* buf, size_t buflen )
+{
+    time_t    t = time( NULL );
+    struct tm tm;
+    localtime_r( &t, &tm );
+    strftime( buf, buflen, "%Y-%m-%d--%H-%M-%S", &tm );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void csv_write_hex_field( FILE* fp, const uint8_t* data, size_t datalen )
+{
+    fputc( '"', fp );
+    for( size_t i = 0; ( data != NULL ) && ( i < datalen ); i++ )
+    {
+        fputc( hex_digits[data[i] >> 4], fp );
+        fputc( hex_digits[data[i] & 0x0F], fp );
+    }
+    fputc( '"', fp );
+}
+
+/* RFC 4180: the field is quoted and inner quotes are doubled */
+static void csv_write_escaped_field( FILE* fp, const char* str )
+{
+    fputc( '"', fp );
+    if( str != NULL )
+    {
+        while( *str )
+        {
+            if( *str == '"' )
+            {
+                fputc( '"', fp );
+            }
+            fputc( *str, fp );
+            str++;
+        }
+    }
+    fputc( '"', fp );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
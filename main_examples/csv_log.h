@@ -0,0 +1,72 @@
+/*!
+ * \file      csv_log.h
+ *
+ * \brief     CSV event log shared by the example applications
+ *
+ * One file per run, named <prefix>-<date>.csv, with the columns
+ * TIMESTAMP,DEVEUI,EVENT,DATA,SF,EXTRA. DATA is written in hex and EXTRA is
+ * escaped per RFC 4180. Rows are written without heap allocation, so the
+ * logger can be used from receive paths.
+ */
+#ifndef CSV_LOG_H
+#define CSV_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>  // C99 types
+#include <stddef.h>  // size_t
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Opens a new CSV file and writes the header
+ *
+ * \param [in] prefix File name prefix
+ *
+ * \retval 0 on success, -1 if the file cannot be opened
+ */
+int csv_log_init( const char* prefix );
+
+/*!
+ * Writes one row, does nothing if the file is not open
+ *
+ * \param [in] deveui  Device EUI, NULL for an empty field
+ * \param [in] event   Event name
+ * \param [in] data    Bytes for the DATA column
+ * \param [in] datalen Number of bytes
+ * \param [in] sf      Spreading factor text
+ * \param [in] extra   EXTRA column, usually a JSON object
+ */
+void csv_log_write_row( const uint8_t deveui[8], const char* event, const uint8_t* data, size_t datalen,
+                        const char* sf, const char* extra );
+
+/*!
+ * Closes the CSV file
+ */
+void csv_log_close( void );
+
+/*!
+ * Formats the local time as used in the TIMESTAMP column
+ *
+ * \param [out] buf    Output buffer
+ * \param [in]  buflen Size of buf
+ */
+void csv_log_timestr( char* buf, size_t buflen );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CSV_LOG_H
+
+/* --- EOF ------------------------------------------------------------------ */
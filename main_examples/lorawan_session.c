@@ -0,0 +1,183 @@
+/*!
+ * \file      lorawan_session.c
+ *
+ * \brief     LoRaWAN session record kept in NVM implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // offsetof
+#include <string.h>
+#include <time.h>
+
+#include "lorawan_session.h"
+#include "smtc_hal_nvm.h"
+#include "smtc_hal_board_profile.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define LORAWAN_SESSION_MAGIC 0x4C535331  // "LSS1"
+#define LORAWAN_SESSION_VERSION 1
+
+#define LORAWAN_SESSION_DEFAULT_MAX_AGE_S ( 7 * 24 * 3600 )
+#define LORAWAN_SESSION_DEFAULT_MAX_FCNT_UP 2000000000u
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Record as laid out in NVM, CRC over everything before it
+ */
+typedef struct lorawan_session_record_s
+{
+    uint32_t          magic;
+    uint16_t          version;
+    uint16_t          size;
+    lorawan_session_t session;
+    uint32_t          crc;
+} lorawan_session_record_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static uint32_t lorawan_session_crc32( const uint8_t* data, const size_t size );
+
+static void lorawan_session_load_uint( const char* key, uint32_t* value );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void lorawan_session_policy_load( lorawan_session_policy_t* policy )
+{
+    uint32_t resume = 1;
+
+    policy->max_age_s   = LORAWAN_SESSION_DEFAULT_MAX_AGE_S;
+    policy->max_fcnt_up = LORAWAN_SESSION_DEFAULT_MAX_FCNT_UP;
+    policy->save_every  = 1;
+
+    lorawan_session_load_uint( "session.resume", &resume );
+    lorawan_session_load_uint( "session.max_age_s", &policy->max_age_s );
+    lorawan_session_load_uint( "session.max_fcnt_up", &policy->max_fcnt_up );
+    lorawan_session_load_uint( "session.save_every", &policy->save_every );
+
+    policy->resume = ( resume != 0 );
+    if( policy->save_every == 0 )
+    {
+        policy->save_every = 1;
+    }
+}
+
+bool lorawan_session_load( const uint8_t dev_eui[8], lorawan_session_t* session )
+{
+    lorawan_session_record_t record;
+
+    // A short or missing file leaves zeros, which fail the magic check
+    memset( &record, 0, sizeof( record ) );
+    hal_nvm_read_buffer( LORAWAN_SESSION_NVM_ADDR, ( uint8_t* ) &record, sizeof( record ) );
+    const uint32_t crc = lorawan_session_crc32( ( const uint8_t* ) &record, offsetof( lorawan_session_record_t, crc ) );
+
+    if( ( record.magic != LORAWAN_SESSION_MAGIC ) || ( record.version != LORAWAN_SESSION_VERSION ) ||
+        ( record.size != sizeof( record ) ) || ( record.crc != crc ) ||
+        ( memcmp( record.session.dev_eui, dev_eui, sizeof( record.session.dev_eui ) ) != 0 ) )
+    {
+        return false;
+    }
+
+    *session = record.session;
+    return true;
+}
+
+const char* lorawan_session_check( const lorawan_session_policy_t* policy, const lorawan_session_t* session )
+{
+    const int64_t now_s = ( int64_t ) time( NULL );
+
+    if( policy->resume == false )
+    {
+        return "resume disabled";
+    }
+    if( session->fcnt_up + policy->save_every + LORAWAN_SESSION_FCNT_MARGIN >= policy->max_fcnt_up )
+    {
+        return "FCntUp limit";
+    }
+    if( policy->max_age_s != 0 )
+    {
+        // A clock behind the join time cannot tell the age
+        if( now_s < session->joined_at_s )
+        {
+            return "clock before the join";
+        }
+        if( ( now_s - session->joined_at_s ) >= ( int64_t ) policy->max_age_s )
+        {
+            return "session age";
+        }
+    }
+    return NULL;
+}
+
+void lorawan_session_save( const lorawan_session_t* session )
+{
+    lorawan_session_record_t record;
+
+    memset( &record, 0, sizeof( record ) );
+    record.magic   = LORAWAN_SESSION_MAGIC;
+    record.version = LORAWAN_SESSION_VERSION;
+    record.size    = sizeof( record );
+    record.session = *session;
+    record.crc     = lorawan_session_crc32( ( const uint8_t* ) &record, offsetof( lorawan_session_record_t, crc ) );
+
+    hal_nvm_write_buffer( LORAWAN_SESSION_NVM_ADDR, ( const uint8_t* ) &record, sizeof( record ) );
+}
+
+void lorawan_session_invalidate( void )
+{
+    const uint32_t magic = 0;
+
+    hal_nvm_write_buffer( LORAWAN_SESSION_NVM_ADDR, ( const uint8_t* ) &magic, sizeof( magic ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* CRC-32, reflected, polynomial 0xEDB88320 */
+static uint32_t lorawan_session_crc32( const uint8_t* data, const size_t size )
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for( size_t i = 0; i < size; i++ )
+    {
+        crc ^= data[i];
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & ( 0u - ( crc & 1 ) ) );
+        }
+    }
+    return ~crc;
+}
+
+static void lorawan_session_load_uint( const char* key, uint32_t* value )
+{
+    int32_t read;
+
+    if( ( hal_board_profile_get_int( key, &read ) == true ) && ( read >= 0 ) )
+    {
+        *value = ( uint32_t ) read;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
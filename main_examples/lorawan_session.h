@@ -0,0 +1,137 @@
+/*!
+ * \file      lorawan_session.h
+ *
+ * \brief     LoRaWAN session record kept in NVM, so that a restart resumes without a join
+ *
+ * The record holds what the MAC needs to go on sending: DevAddr, frame
+ * counters, RX window settings, data rate and power, and the time of the
+ * join. The session keys are not part of it: lbm_lib keeps them in its
+ * secure element context. A record is used again only if it belongs to the
+ * same DevEUI and passes the rejoin policy, read from the board profile:
+ *
+ *   session.resume      = 1
+ *   session.max_age_s   = 604800      # rejoin once the session is older, 0 never
+ *   session.max_fcnt_up = 2000000000  # rejoin once FCntUp reaches this value
+ *   session.save_every  = 1           # uplinks between two saves
+ *
+ * Uplinks sent after the last save may have used the next counters, so a
+ * resumed session skips save_every counters, plus LORAWAN_SESSION_FCNT_MARGIN
+ * for an uplink cut by a crash before its TX done and the uplinks the stack
+ * sends on its own, which are not captured.
+ */
+#ifndef LORAWAN_SESSION_H
+#define LORAWAN_SESSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * NVM address of the record, past the modem contexts of smtc_modem_hal.c
+ */
+#define LORAWAN_SESSION_NVM_ADDR 1024
+
+/*!
+ * Counters skipped on resume on top of save_every, well below the 16384 gap a network server accepts
+ */
+#define LORAWAN_SESSION_FCNT_MARGIN 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Session state of one device
+ */
+typedef struct lorawan_session_s
+{
+    uint8_t  dev_eui[8];
+    uint32_t dev_addr;
+    uint32_t fcnt_up;
+    uint32_t nfcnt_dwn;
+    uint32_t afcnt_dwn;
+    uint32_t rx2_frequency;
+    uint8_t  rx1_dr_offset;
+    uint8_t  rx2_data_rate;
+    uint8_t  rx1_delay_s;
+    uint8_t  tx_data_rate_adr;
+    int8_t   tx_power;
+    int64_t  joined_at_s;  //!< Wall clock time of the join
+} lorawan_session_t;
+
+/*!
+ * Rejoin policy
+ */
+typedef struct lorawan_session_policy_s
+{
+    bool     resume;
+    uint32_t max_age_s;
+    uint32_t max_fcnt_up;
+    uint32_t save_every;
+} lorawan_session_policy_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the rejoin policy from the board profile
+ *
+ * \param [out] policy Policy, defaults for missing keys
+ */
+void lorawan_session_policy_load( lorawan_session_policy_t* policy );
+
+/*!
+ * Reads the stored session of a device
+ *
+ * \param [in]  dev_eui DevEUI, MSB first
+ * \param [out] session Stored session
+ *
+ * \retval false if there is no intact record for this DevEUI
+ */
+bool lorawan_session_load( const uint8_t dev_eui[8], lorawan_session_t* session );
+
+/*!
+ * Checks a stored session against the rejoin policy
+ *
+ * \param [in] policy  Rejoin policy
+ * \param [in] session Stored session
+ *
+ * \retval NULL if the session can be resumed, else the reason to rejoin
+ */
+const char* lorawan_session_check( const lorawan_session_policy_t* policy, const lorawan_session_t* session );
+
+/*!
+ * Stores a session
+ *
+ * \param [in] session Session
+ */
+void lorawan_session_save( const lorawan_session_t* session );
+
+/*!
+ * Erases the stored session, the next start joins
+ */
+void lorawan_session_invalidate( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LORAWAN_SESSION_H
+
+/* --- EOF ------------------------------------------------------------------ */
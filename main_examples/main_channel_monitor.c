@@ -0,0 +1,414 @@
+/*!
+ * \file      main_channel_monitor.c
+ *
+ * \brief     Channel occupancy monitor, a spectrum survey before gateway installation
+ *
+ * The radio is put in continuous LoRa RX on each channel in turn and
+ * RegRssiValue is sampled as fast as the SPI allows. Every report period, one
+ * CSV row per channel gives the number of samples, the occupancy (share of
+ * samples at or above the busy threshold), the noise floor (10th percentile),
+ * the median and the maximum RSSI, and a 5 dB histogram.
+ *
+ * Settings are read from the board profile:
+ *
+ *   monitor.channels_hz        = 868100000, 868300000, ...
+ *   monitor.report_period_s    = 60
+ *   monitor.dwell_ms           = 100
+ *   monitor.sample_interval_us = 0
+ *   monitor.busy_threshold_dbm = -90
+ *   monitor.bw_khz             = 125
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "main.h"
+
+#include "smtc_modem_api.h"
+#include "smtc_modem_hal.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_board_profile.h"
+
+#if defined( SX127X )
+#include "ralf_sx127x.h"
+#include "sx127x.h"
+#include "sx127x_hal.h"
+#endif
+
+#include "csv_log.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define MONITOR_MAX_CHANNELS 16
+
+#define MONITOR_DEFAULT_CHANNELS_HZ \
+    { 868100000, 868300000, 868500000, 867100000, 867300000, 867500000, 867700000, 867900000 }
+#define MONITOR_DEFAULT_REPORT_PERIOD_S 60
+#define MONITOR_DEFAULT_DWELL_MS 100
+#define MONITOR_DEFAULT_SAMPLE_INTERVAL_US 0
+#define MONITOR_DEFAULT_BUSY_THRESHOLD_DBM ( -90 )
+
+/*!
+ * RSSI is not valid right after RX is entered on a new frequency
+ */
+#define MONITOR_RSSI_SETTLE_US 1000
+
+#define MONITOR_NOISE_FLOOR_PERCENTILE 10
+
+/*!
+ * CSV histogram bins
+ */
+#define MONITOR_HISTO_MIN_DBM ( -140 )
+#define MONITOR_HISTO_BIN_DB 5
+#define MONITOR_HISTO_NB_BINS 24
+
+#define REG_LR_RSSI_VALUE 0x1B
+
+/*!
+ * RegRssiValue offsets, LoRa mode
+ */
+#if defined( SX1272 )
+#define RSSI_OFFSET_HF ( -139 )
+#define RSSI_OFFSET_LF ( -139 )
+#else
+#define RSSI_OFFSET_HF ( -157 )
+#define RSSI_OFFSET_LF ( -164 )
+#endif
+#define RSSI_HF_PORT_MIN_HZ 525000000
+
+#if defined( SX127X )
+static ralf_t modem_radio = RALF_SX127X_INSTANTIATE( NULL );  // this MUST stay static!
+#else
+#error "Please select radio board.."
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Per-channel RSSI statistics over one report period, one bin per RegRssiValue value
+ */
+typedef struct monitor_channel_s
+{
+    uint32_t freq_hz;
+    uint32_t nb_samples;
+    uint32_t nb_busy;
+    uint32_t histogram[256];
+} monitor_channel_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static monitor_channel_t channels[MONITOR_MAX_CHANNELS];
+static uint8_t           nb_channels = 0;
+
+static uint32_t report_period_s    = MONITOR_DEFAULT_REPORT_PERIOD_S;
+static uint32_t dwell_ms           = MONITOR_DEFAULT_DWELL_MS;
+static uint32_t sample_interval_us = MONITOR_DEFAULT_SAMPLE_INTERVAL_US;
+static int16_t  busy_threshold_dbm = MONITOR_DEFAULT_BUSY_THRESHOLD_DBM;
+static ral_lora_bw_t bw            = RAL_LORA_BW_125_KHZ;
+
+static ralf_params_lora_t rx_lora_param = { .sync_word                       = 0x34,
+                                            .symb_nb_timeout                 = 0,
+                                            .mod_params.cr                   = RAL_LORA_CR_4_5,
+                                            .mod_params.sf                   = RAL_LORA_SF7,
+                                            .mod_params.ldro                 = 0,
+                                            .pkt_params.header_type          = RAL_LORA_PKT_EXPLICIT,
+                                            .pkt_params.pld_len_in_bytes     = 255,
+                                            .pkt_params.crc_is_on            = false,
+                                            .pkt_params.invert_iq_is_on      = false,
+                                            .pkt_params.preamble_len_in_symb = 8 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void monitor_load_settings( void );
+static bool monitor_start_rx( const uint32_t freq_hz );
+static void monitor_dwell( sx127x_t* radio, monitor_channel_t* channel );
+static void monitor_report( void );
+static int16_t monitor_raw_to_dbm( const uint32_t freq_hz, const uint8_t raw );
+static uint8_t monitor_percentile_raw( const monitor_channel_t* channel, const uint8_t percentile );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Channel occupancy survey, runs until the process is stopped
+ */
+void main_channel_monitor( void )
+{
+    hal_mcu_init( );
+
+#if defined( SX127X )
+    // Get modem radio context, do not change!
+    modem_radio.ral.context = smtc_modem_get_radio_context( );
+#endif
+    sx127x_t* radio = ( sx127x_t* ) modem_radio.ral.context;
+
+    monitor_load_settings( );
+
+    SMTC_HAL_TRACE_MSG( "\n\n\nCHANNEL_MONITOR example is starting \n\n" );
+    SMTC_HAL_TRACE_INFO( "  Channels:      %u\n", nb_channels );
+    SMTC_HAL_TRACE_INFO( "  Report period: %lu s, dwell %lu ms, sample interval %lu us\n",
+                         ( unsigned long ) report_period_s, ( unsigned long ) dwell_ms,
+                         ( unsigned long ) sample_interval_us );
+    SMTC_HAL_TRACE_INFO( "  Busy at:       %d dBm\n", busy_threshold_dbm );
+
+    ral_reset( &( modem_radio.ral ) );
+    if( ral_init( &( modem_radio.ral ) ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_init() failed\n" );
+        return;
+    }
+
+    if( csv_log_init( "channel-monitor" ) != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "CSV init failed, continuing without CSV logging\n" );
+    }
+    atexit( csv_log_close );
+
+    uint32_t report_start_ms = hal_rtc_get_time_ms( );
+    uint8_t  index           = 0;
+
+    while( 1 )
+    {
+        if( monitor_start_rx( channels[index].freq_hz ) == true )
+        {
+            monitor_dwell( radio, &channels[index] );
+        }
+        index = ( index + 1 ) % nb_channels;
+
+        if( ( index == 0 ) && ( ( hal_rtc_get_time_ms( ) - report_start_ms ) >= ( report_period_s * 1000 ) ) )
+        {
+            monitor_report( );
+            report_start_ms = hal_rtc_get_time_ms( );
+        }
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void monitor_load_settings( void )
+{
+    static const uint32_t default_channels_hz[] = MONITOR_DEFAULT_CHANNELS_HZ;
+    const char*           list;
+    int32_t               value;
+
+    nb_channels = 0;
+    if( hal_board_profile_get_str( "monitor.channels_hz", &list ) == true )
+    {
+        const char* p = list;
+        while( ( *p != '\0' ) && ( nb_channels < MONITOR_MAX_CHANNELS ) )
+        {
+            char*               end;
+            const unsigned long freq_hz = strtoul( p, &end, 10 );
+            if( end == p )
+            {
+                p++;
+                continue;
+            }
+            channels[nb_channels++].freq_hz = ( uint32_t ) freq_hz;
+            p                               = end;
+        }
+    }
+    if( nb_channels == 0 )
+    {
+        for( uint8_t i = 0; i < ( sizeof( default_channels_hz ) / sizeof( default_channels_hz[0] ) ); i++ )
+        {
+            channels[nb_channels++].freq_hz = default_channels_hz[i];
+        }
+    }
+
+    if( ( hal_board_profile_get_int( "monitor.report_period_s", &value ) == true ) && ( value > 0 ) )
+    {
+        report_period_s = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "monitor.dwell_ms", &value ) == true ) && ( value > 0 ) )
+    {
+        dwell_ms = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "monitor.sample_interval_us", &value ) == true ) && ( value >= 0 ) )
+    {
+        sample_interval_us = ( uint32_t ) value;
+    }
+    if( hal_board_profile_get_int( "monitor.busy_threshold_dbm", &value ) == true )
+    {
+        busy_threshold_dbm = ( int16_t ) value;
+    }
+    if( hal_board_profile_get_int( "monitor.bw_khz", &value ) == true )
+    {
+        switch( value )
+        {
+        case 125:
+            bw = RAL_LORA_BW_125_KHZ;
+            break;
+        case 250:
+            bw = RAL_LORA_BW_250_KHZ;
+            break;
+        case 500:
+            bw = RAL_LORA_BW_500_KHZ;
+            break;
+        default:
+            SMTC_HAL_TRACE_WARNING( "monitor.bw_khz %ld not supported, using 125\n", ( long ) value );
+            break;
+        }
+    }
+}
+
+static bool monitor_start_rx( const uint32_t freq_hz )
+{
+    rx_lora_param.rf_freq_in_hz = freq_hz;
+    rx_lora_param.mod_params.bw = bw;
+
+    if( ralf_setup_lora( &modem_radio, &rx_lora_param ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ralf_setup_lora() failed on %lu Hz\n", ( unsigned long ) freq_hz );
+        return false;
+    }
+    smtc_modem_hal_set_ant_switch( false );
+    if( ral_set_rx( &( modem_radio.ral ), RAL_RX_TIMEOUT_CONTINUOUS_MODE ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_set_rx() failed on %lu Hz\n", ( unsigned long ) freq_hz );
+        return false;
+    }
+    hal_mcu_wait_us( MONITOR_RSSI_SETTLE_US );
+    return true;
+}
+
+static void monitor_dwell( sx127x_t* radio, monitor_channel_t* channel )
+{
+    const uint32_t start_ms = hal_rtc_get_time_ms( );
+    uint8_t        raw;
+
+    // One 2-byte SPI transaction per sample, nothing else runs during the dwell
+    while( ( hal_rtc_get_time_ms( ) - start_ms ) < dwell_ms )
+    {
+        sx127x_hal_read( radio, REG_LR_RSSI_VALUE, &raw, 1 );
+
+        channel->histogram[raw]++;
+        channel->nb_samples++;
+        if( monitor_raw_to_dbm( channel->freq_hz, raw ) >= busy_threshold_dbm )
+        {
+            channel->nb_busy++;
+        }
+
+        if( sample_interval_us > 0 )
+        {
+            hal_mcu_wait_us( ( int32_t ) sample_interval_us );
+        }
+    }
+}
+
+static void monitor_report( void )
+{
+    for( uint8_t i = 0; i < nb_channels; i++ )
+    {
+        monitor_channel_t* channel = &channels[i];
+
+        if( channel->nb_samples == 0 )
+        {
+            continue;
+        }
+
+        const float   occupancy_pct = ( float ) channel->nb_busy * 100.0f / ( float ) channel->nb_samples;
+        const int16_t noise_floor =
+            monitor_raw_to_dbm( channel->freq_hz, monitor_percentile_raw( channel, MONITOR_NOISE_FLOOR_PERCENTILE ) );
+        const int16_t median = monitor_raw_to_dbm( channel->freq_hz, monitor_percentile_raw( channel, 50 ) );
+        const int16_t max    = monitor_raw_to_dbm( channel->freq_hz, monitor_percentile_raw( channel, 100 ) );
+
+        SMTC_HAL_TRACE_INFO( "%lu Hz: %lu samples, occupancy %.2f %%, noise floor %d dBm, median %d dBm, "
+                             "max %d dBm\n",
+                             ( unsigned long ) channel->freq_hz, ( unsigned long ) channel->nb_samples,
+                             ( double ) occupancy_pct, noise_floor, median, max );
+
+        uint32_t bins[MONITOR_HISTO_NB_BINS] = { 0 };
+        for( uint16_t raw = 0; raw < 256; raw++ )
+        {
+            int32_t bin = ( monitor_raw_to_dbm( channel->freq_hz, ( uint8_t ) raw ) - MONITOR_HISTO_MIN_DBM ) /
+                          MONITOR_HISTO_BIN_DB;
+            if( bin < 0 )
+            {
+                bin = 0;
+            }
+            if( bin >= MONITOR_HISTO_NB_BINS )
+            {
+                bin = MONITOR_HISTO_NB_BINS - 1;
+            }
+            bins[bin] += channel->histogram[raw];
+        }
+
+        char   extra[512];
+        size_t len = ( size_t ) snprintf( extra, sizeof( extra ),
+                                          "{\"freq\" : \"%lu\", \"samples\" : \"%lu\", \"occupancy_pct\" : \"%.2f\", "
+                                          "\"noise_floor\" : \"%d\", \"median\" : \"%d\", \"max\" : \"%d\", "
+                                          "\"histogram\" : \"",
+                                          ( unsigned long ) channel->freq_hz, ( unsigned long ) channel->nb_samples,
+                                          ( double ) occupancy_pct, noise_floor, median, max );
+        for( uint8_t bin = 0; ( bin < MONITOR_HISTO_NB_BINS ) && ( len < sizeof( extra ) ); bin++ )
+        {
+            len += ( size_t ) snprintf( &extra[len], sizeof( extra ) - len, ( bin == 0 ) ? "%lu" : " %lu",
+                                        ( unsigned long ) bins[bin] );
+        }
+        if( len < sizeof( extra ) )
+        {
+            snprintf( &extra[len], sizeof( extra ) - len, "\"}" );
+        }
+        csv_log_write_row( NULL, "CHANNEL", NULL, 0, "", extra );
+
+        memset( channel->histogram, 0, sizeof( channel->histogram ) );
+        channel->nb_samples = 0;
+        channel->nb_busy    = 0;
+    }
+}
+
+static int16_t monitor_raw_to_dbm( const uint32_t freq_hz, const uint8_t raw )
+{
+    return ( ( freq_hz > RSSI_HF_PORT_MIN_HZ ) ? RSSI_OFFSET_HF : RSSI_OFFSET_LF ) + raw;
+}
+
+static uint8_t monitor_percentile_raw( const monitor_channel_t* channel, const uint8_t percentile )
+{
+    const uint64_t rank = ( ( uint64_t ) channel->nb_samples * percentile + 99 ) / 100;
+    uint64_t       count = 0;
+
+    for( uint16_t raw = 0; raw < 256; raw++ )
+    {
+        count += channel->histogram[raw];
+        if( ( count >= rank ) && ( count > 0 ) )
+        {
+            return ( uint8_t ) raw;
+        }
+    }
+    return 255;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,746 @@
+/*!
+ * \file      main_per_tester.c
+ *
+ * \brief     Packet error rate tester, radio to radio
+ *
+ * The TX side sends numbered LoRa packets on one channel, per.packets per
+ * step, one step per power of per.tx_power_dbm. The RX side stays in
+ * continuous RX, correlates the packets by run, step and sequence number and
+ * closes a step at its last packet, at the first packet of the next step, or
+ * after per.step_timeout_ms without packets. Each step gives the PER and the
+ * RSSI and SNR distributions; the steps of a run, from the highest power
+ * down, are the sensitivity curve, PER against RSSI. The RX side must be
+ * started first. RSSI and SNR come from the status latched by the radio HAL
+ * at the FIFO readout.
+ *
+ * Packet, little endian: 'P' 'E', run id (16 bits), step, number of steps,
+ * TX power (dBm, signed), reserved, packets per step (16 bits), sequence
+ * number (16 bits), then a pattern derived from the sequence number that the
+ * receiver checks.
+ *
+ * Settings are read from the board profile, both sides use the same radio ones:
+ *
+ *   per.role            = rx          # tx | rx
+ *   per.freq_hz         = 868100000
+ *   per.sf              = 7
+ *   per.bw_khz          = 125
+ *   per.sync_word       = 18          (0x12, private networks, keeps LoRaWAN traffic out)
+ *   per.size            = 16          # tx: payload bytes, 12 to 255
+ *   per.packets         = 100         # tx: packets per step
+ *   per.interval_ms     = 100         # tx: from TX done to the next packet
+ *   per.tx_power_dbm    = 14, 8, 2    # tx: one step per power
+ *   per.runs            = 1           # tx: 0 runs forever
+ *   per.step_timeout_ms = 10000       # rx
+ *   per.target_pct      = 10          # rx: PER of the sensitivity point
+ *
+ * With spi.backend = sim, the sides are two processes linked with sim.link = peer.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // offsetof
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "main.h"
+
+#include "smtc_modem_api.h"
+#include "smtc_modem_hal.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_spi.h"
+#include "smtc_hal_board_profile.h"
+#include "modem_pinout.h"
+
+#if defined( SX127X )
+#include "ralf_sx127x.h"
+#include "sx127x.h"
+#endif
+
+#include "radio_pkt_status.h"
+#include "bench_stats.h"
+#include "csv_log.h"
+#include "sim_link.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+#define MIN( a, b ) ( ( ( a ) < ( b ) ) ? ( a ) : ( b ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define PER_MAX_STEPS 32
+#define PER_HEADER_SIZE 12
+#define PER_MAX_SEQ 65536
+
+#define PER_DEFAULT_FREQ_HZ 868100000
+#define PER_DEFAULT_SYNC_WORD 0x12
+#define PER_DEFAULT_SIZE 16
+#define PER_DEFAULT_PACKETS 100
+#define PER_DEFAULT_INTERVAL_MS 100
+#define PER_DEFAULT_TX_POWER_DBM 14
+#define PER_DEFAULT_STEP_TIMEOUT_MS 10000
+#define PER_DEFAULT_TARGET_PCT 10
+
+/*!
+ * Longest time on air, SF12 BW125 255 bytes, plus margin
+ */
+#define PER_TX_DONE_TIMEOUT_MS 12000
+
+#if defined( SX127X )
+static ralf_t modem_radio = RALF_SX127X_INSTANTIATE( NULL );  // this MUST stay static!
+#else
+#error "Please select radio board.."
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Packet header fields
+ */
+typedef struct per_header_s
+{
+    uint16_t run_id;
+    uint8_t  step;
+    uint8_t  nb_steps;
+    int8_t   tx_power_dbm;
+    uint16_t packets;
+    uint16_t seq;
+} per_header_t;
+
+/*!
+ * Step being received
+ */
+typedef struct per_rx_step_s
+{
+    bool         active;
+    per_header_t header;  //!< First packet of the step, seq aside
+    uint32_t     received;
+    uint32_t     duplicates;
+    uint32_t     corrupted;   //!< Valid CRC, wrong pattern
+    uint32_t     crc_errors;  //!< RX done with a CRC error, counted in the step that was open
+    uint32_t     last_rx_ms;
+    uint8_t      seen[PER_MAX_SEQ / 8];
+    double       rssi_dbm[BENCH_STATS_MAX_SAMPLES];
+    double       snr_db[BENCH_STATS_MAX_SAMPLES];
+} per_rx_step_t;
+
+/*!
+ * Distribution of the RSSI or SNR of a step
+ */
+typedef struct per_dist_s
+{
+    double min;
+    double mean;
+    double p50;
+    double max;
+} per_dist_t;
+
+/*!
+ * Point of the sensitivity curve
+ */
+typedef struct per_point_s
+{
+    int8_t tx_power_dbm;
+    float  per_pct;
+    float  rssi_dbm;  //!< Mean, 0 when nothing was received
+    float  snr_db;
+    bool   valid;
+} per_point_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bool     role_tx         = false;
+static uint32_t bw_hz           = 125000;
+static uint8_t  packet_size     = PER_DEFAULT_SIZE;
+static uint16_t packets         = PER_DEFAULT_PACKETS;
+static uint32_t interval_ms     = PER_DEFAULT_INTERVAL_MS;
+static int8_t   tx_powers_dbm[PER_MAX_STEPS];
+static uint8_t  nb_steps        = 0;
+static uint32_t runs            = 1;
+static uint32_t step_timeout_ms = PER_DEFAULT_STEP_TIMEOUT_MS;
+static float    target_pct      = PER_DEFAULT_TARGET_PCT;
+
+static volatile bool radio_irq_raised = false;
+
+static uint8_t       payload[256];
+static per_rx_step_t rx_step;
+static per_point_t   curve[PER_MAX_STEPS];
+static uint32_t      nb_foreign = 0;
+
+static ralf_params_lora_t lora_param = { .sync_word                       = PER_DEFAULT_SYNC_WORD,
+                                         .symb_nb_timeout                 = 0,
+                                         .rf_freq_in_hz                   = PER_DEFAULT_FREQ_HZ,
+                                         .output_pwr_in_dbm               = PER_DEFAULT_TX_POWER_DBM,
+                                         .mod_params.cr                   = RAL_LORA_CR_4_5,
+                                         .mod_params.sf                   = RAL_LORA_SF7,
+                                         .mod_params.bw                   = RAL_LORA_BW_125_KHZ,
+                                         .mod_params.ldro                 = 0,
+                                         .pkt_params.header_type          = RAL_LORA_PKT_EXPLICIT,
+                                         .pkt_params.pld_len_in_bytes     = 255,
+                                         .pkt_params.crc_is_on            = true,
+                                         .pkt_params.invert_iq_is_on      = false,
+                                         .pkt_params.preamble_len_in_symb = 8 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void per_radio_irq_callback( void* obj );
+static void per_load_settings( void );
+static uint8_t per_pattern( const per_header_t* header, const uint8_t index );
+static void per_build_packet( const per_header_t* header );
+static bool per_parse_packet( const uint16_t size, per_header_t* header );
+static void per_tx_run( const uint16_t run_id );
+static bool per_tx_send( void );
+static bool per_rx_start( void );
+static void per_rx_process_irq( void );
+static void per_rx_close_step( const char* end );
+static void per_dist_compute( double* samples, const uint32_t nb_samples, per_dist_t* dist );
+static void per_rx_report_curve( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief PER tester, the TX side returns after per.runs runs, the RX side runs until the process is stopped
+ */
+void main_per_tester( void )
+{
+    static const uint8_t no_key[16] = { 0 };
+
+    hal_mcu_init( );
+
+#if defined( SX127X )
+    // Get modem radio context, do not change!
+    modem_radio.ral.context = smtc_modem_get_radio_context( );
+#endif
+
+    per_load_settings( );
+
+    // Without a radio, the other side is another process with a simulated radio
+    if( hal_spi_get_backend( RADIO_SPI_ID ) == HAL_SPI_BACKEND_SIM )
+    {
+        sim_link_start( no_key, no_key, no_key );
+    }
+
+    SMTC_HAL_TRACE_MSG( "\n\n\nPER_TESTER example is starting \n\n" );
+    SMTC_HAL_TRACE_INFO( "  Role:      %s, %lu Hz, SF%u BW%lu, sync word 0x%02x\n", role_tx ? "TX" : "RX",
+                         ( unsigned long ) lora_param.rf_freq_in_hz, lora_param.mod_params.sf,
+                         ( unsigned long ) bw_hz, lora_param.sync_word );
+    if( role_tx )
+    {
+        SMTC_HAL_TRACE_INFO( "  Steps:     %u of %u packets of %u bytes, every %lu ms\n", nb_steps, packets,
+                             packet_size, ( unsigned long ) interval_ms );
+    }
+
+    ral_reset( &( modem_radio.ral ) );
+    if( ral_init( &( modem_radio.ral ) ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_init() failed\n" );
+        return;
+    }
+
+    if( csv_log_init( "per" ) != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "CSV init failed, continuing without CSV logging\n" );
+    }
+    atexit( csv_log_close );
+
+    smtc_modem_hal_irq_config_radio_irq( per_radio_irq_callback, NULL );
+
+    if( role_tx )
+    {
+        srand( ( unsigned int ) time( NULL ) );
+        for( uint32_t run = 0; ( runs == 0 ) || ( run < runs ); run++ )
+        {
+            per_tx_run( ( uint16_t ) rand( ) );
+        }
+        return;
+    }
+
+    if( per_rx_start( ) == false )
+    {
+        return;
+    }
+    while( 1 )
+    {
+        if( radio_irq_raised == true )
+        {
+            radio_irq_raised = false;
+            per_rx_process_irq( );
+            continue;
+        }
+
+        uint32_t sleep_ms = step_timeout_ms;
+        if( rx_step.active )
+        {
+            const uint32_t idle_ms = hal_rtc_get_time_ms( ) - rx_step.last_rx_ms;
+            if( idle_ms >= step_timeout_ms )
+            {
+                per_rx_close_step( "timeout" );
+                continue;
+            }
+            sleep_ms = step_timeout_ms - idle_ms;
+        }
+        hal_mcu_set_sleep_for_ms( ( int32_t ) sleep_ms );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void per_radio_irq_callback( void* obj )
+{
+    ( void ) obj;
+
+    radio_irq_raised = true;
+    hal_mcu_wakeup( );
+}
+
+static void per_load_settings( void )
+{
+    const char* text;
+    int32_t     value;
+
+    if( hal_board_profile_get_str( "per.role", &text ) == true )
+    {
+        role_tx = ( strcmp( text, "tx" ) == 0 );
+    }
+    if( ( hal_board_profile_get_int( "per.freq_hz", &value ) == true ) && ( value > 0 ) )
+    {
+        lora_param.rf_freq_in_hz = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.sf", &value ) == true ) && ( value >= 6 ) && ( value <= 12 ) )
+    {
+        lora_param.mod_params.sf = ( ral_lora_sf_t ) value;
+    }
+    if( hal_board_profile_get_int( "per.bw_khz", &value ) == true )
+    {
+        switch( value )
+        {
+        case 125:
+            lora_param.mod_params.bw = RAL_LORA_BW_125_KHZ;
+            break;
+        case 250:
+            lora_param.mod_params.bw = RAL_LORA_BW_250_KHZ;
+            break;
+        case 500:
+            lora_param.mod_params.bw = RAL_LORA_BW_500_KHZ;
+            break;
+        default:
+            SMTC_HAL_TRACE_WARNING( "per.bw_khz %ld not supported, using 125\n", ( long ) value );
+            value = 125;
+            break;
+        }
+        bw_hz = ( uint32_t ) value * 1000;
+    }
+    if( ( hal_board_profile_get_int( "per.sync_word", &value ) == true ) && ( value >= 0 ) && ( value <= 0xFF ) )
+    {
+        lora_param.sync_word = ( uint8_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.size", &value ) == true ) && ( value >= PER_HEADER_SIZE ) &&
+        ( value <= 255 ) )
+    {
+        packet_size = ( uint8_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.packets", &value ) == true ) && ( value > 0 ) && ( value < PER_MAX_SEQ ) )
+    {
+        packets = ( uint16_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.interval_ms", &value ) == true ) && ( value >= 0 ) )
+    {
+        interval_ms = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.runs", &value ) == true ) && ( value >= 0 ) )
+    {
+        runs = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.step_timeout_ms", &value ) == true ) && ( value > 0 ) )
+    {
+        step_timeout_ms = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "per.target_pct", &value ) == true ) && ( value > 0 ) && ( value < 100 ) )
+    {
+        target_pct = ( float ) value;
+    }
+
+    nb_steps = 0;
+    if( hal_board_profile_get_str( "per.tx_power_dbm", &text ) == true )
+    {
+        const char* p = text;
+        while( ( *p != '\0' ) && ( nb_steps < PER_MAX_STEPS ) )
+        {
+            char*      end;
+            const long power_dbm = strtol( p, &end, 10 );
+            if( end == p )
+            {
+                p++;
+                continue;
+            }
+            tx_powers_dbm[nb_steps++] = ( int8_t ) power_dbm;
+            p                         = end;
+        }
+    }
+    if( nb_steps == 0 )
+    {
+        tx_powers_dbm[nb_steps++] = PER_DEFAULT_TX_POWER_DBM;
+    }
+
+    // Low data rate optimization is mandated above 16 ms symbols
+    lora_param.mod_params.ldro = ral_compute_lora_ldro( lora_param.mod_params.sf, lora_param.mod_params.bw );
+}
+
+static uint8_t per_pattern( const per_header_t* header, const uint8_t index )
+{
+    return ( uint8_t ) ( header->run_id + header->seq * 7u + index * 13u );
+}
+
+static void per_build_packet( const per_header_t* header )
+{
+    payload[0]  = 'P';
+    payload[1]  = 'E';
+    payload[2]  = ( uint8_t ) header->run_id;
+    payload[3]  = ( uint8_t ) ( header->run_id >> 8 );
+    payload[4]  = header->step;
+    payload[5]  = header->nb_steps;
+    payload[6]  = ( uint8_t ) header->tx_power_dbm;
+    payload[7]  = 0;
+    payload[8]  = ( uint8_t ) header->packets;
+    payload[9]  = ( uint8_t ) ( header->packets >> 8 );
+    payload[10] = ( uint8_t ) header->seq;
+    payload[11] = ( uint8_t ) ( header->seq >> 8 );
+    for( uint16_t i = PER_HEADER_SIZE; i < packet_size; i++ )
+    {
+        payload[i] = per_pattern( header, ( uint8_t ) i );
+    }
+}
+
+static bool per_parse_packet( const uint16_t size, per_header_t* header )
+{
+    if( ( size < PER_HEADER_SIZE ) || ( payload[0] != 'P' ) || ( payload[1] != 'E' ) )
+    {
+        return false;
+    }
+    header->run_id       = ( uint16_t ) ( payload[2] | ( payload[3] << 8 ) );
+    header->step         = payload[4];
+    header->nb_steps     = payload[5];
+    header->tx_power_dbm = ( int8_t ) payload[6];
+    header->packets      = ( uint16_t ) ( payload[8] | ( payload[9] << 8 ) );
+    header->seq          = ( uint16_t ) ( payload[10] | ( payload[11] << 8 ) );
+    return ( header->packets > 0 ) && ( header->seq < header->packets ) && ( header->step < header->nb_steps );
+}
+
+static void per_tx_run( const uint16_t run_id )
+{
+    per_header_t header = { .run_id = run_id, .nb_steps = nb_steps, .packets = packets };
+    char         sf_txt[8];
+    char         extra[192];
+
+    snprintf( sf_txt, sizeof( sf_txt ), "SF%u", lora_param.mod_params.sf );
+
+    for( uint8_t step = 0; step < nb_steps; step++ )
+    {
+        uint32_t       sent     = 0;
+        const uint32_t start_ms = hal_rtc_get_time_ms( );
+
+        header.step                  = step;
+        header.tx_power_dbm          = tx_powers_dbm[step];
+        lora_param.output_pwr_in_dbm = tx_powers_dbm[step];
+
+        for( uint16_t seq = 0; seq < packets; seq++ )
+        {
+            header.seq = seq;
+            per_build_packet( &header );
+            if( per_tx_send( ) == true )
+            {
+                sent++;
+            }
+            if( interval_ms > 0 )
+            {
+                hal_mcu_set_sleep_for_ms( ( int32_t ) interval_ms );
+            }
+        }
+
+        const uint32_t duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+        SMTC_HAL_TRACE_INFO( "Run %04x step %u/%u: %lu/%u packets sent at %d dBm in %lu ms\n", run_id, step + 1,
+                             nb_steps, ( unsigned long ) sent, packets, tx_powers_dbm[step],
+                             ( unsigned long ) duration_ms );
+        snprintf( extra, sizeof( extra ),
+                  "{\"run\" : \"%04x\", \"step\" : \"%u\", \"tx_power\" : \"%d\", \"packets\" : \"%u\", "
+                  "\"sent\" : \"%lu\", \"size\" : \"%u\", \"freq\" : \"%lu\", \"duration_ms\" : \"%lu\"}",
+                  run_id, step, tx_powers_dbm[step], packets, ( unsigned long ) sent, packet_size,
+                  ( unsigned long ) lora_param.rf_freq_in_hz, ( unsigned long ) duration_ms );
+        csv_log_write_row( NULL, "PER_TX", NULL, 0, sf_txt, extra );
+    }
+}
+
+static bool per_tx_send( void )
+{
+    ral_irq_t irq = RAL_IRQ_NONE;
+
+    lora_param.pkt_params.pld_len_in_bytes = packet_size;
+    radio_irq_raised                       = false;
+
+    smtc_modem_hal_set_ant_switch( true );
+    if( ( ralf_setup_lora( &modem_radio, &lora_param ) != RAL_STATUS_OK ) ||
+        ( ral_set_dio_irq_params( &( modem_radio.ral ), RAL_IRQ_TX_DONE ) != RAL_STATUS_OK ) ||
+        ( ral_set_pkt_payload( &( modem_radio.ral ), payload, packet_size ) != RAL_STATUS_OK ) ||
+        ( ral_set_tx( &( modem_radio.ral ) ) != RAL_STATUS_OK ) )
+    {
+        SMTC_HAL_TRACE_ERROR( "TX setup failed\n" );
+        return false;
+    }
+
+    const uint32_t start_ms = hal_rtc_get_time_ms( );
+    uint32_t       elapsed_ms;
+    while( ( radio_irq_raised == false ) && ( ( elapsed_ms = hal_rtc_get_time_ms( ) - start_ms ) <
+                                              PER_TX_DONE_TIMEOUT_MS ) )
+    {
+        hal_mcu_set_sleep_for_ms( ( int32_t ) ( PER_TX_DONE_TIMEOUT_MS - elapsed_ms ) );
+    }
+    radio_irq_raised = false;
+
+    ral_get_and_clear_irq_status( &( modem_radio.ral ), &irq );
+    ral_set_sleep( &( modem_radio.ral ), true );
+    smtc_modem_hal_set_ant_switch( false );
+    if( ( irq & RAL_IRQ_TX_DONE ) == 0 )
+    {
+        SMTC_HAL_TRACE_WARNING( "No TX done after %u ms\n", PER_TX_DONE_TIMEOUT_MS );
+        return false;
+    }
+    return true;
+}
+
+static bool per_rx_start( void )
+{
+    if( ralf_setup_lora( &modem_radio, &lora_param ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ralf_setup_lora() failed\n" );
+        return false;
+    }
+    if( ral_set_dio_irq_params( &( modem_radio.ral ),
+                                RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_set_dio_irq_params() failed\n" );
+        return false;
+    }
+    smtc_modem_hal_set_ant_switch( false );
+    if( ral_set_rx( &( modem_radio.ral ), RAL_RX_TIMEOUT_CONTINUOUS_MODE ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_set_rx() failed\n" );
+        return false;
+    }
+    return true;
+}
+
+static void per_rx_process_irq( void )
+{
+    ral_irq_t          irq  = RAL_IRQ_NONE;
+    uint16_t           size = 0;
+    per_header_t       header;
+    radio_pkt_status_t status;
+
+    ral_get_and_clear_irq_status( &( modem_radio.ral ), &irq );
+
+    // Header errors are not wired to a DIO, only RX done raises the interrupt
+    if( ( irq & RAL_IRQ_RX_DONE ) == 0 )
+    {
+        return;
+    }
+    if( ( irq & RAL_IRQ_RX_CRC_ERROR ) != 0 )
+    {
+        rx_step.crc_errors += rx_step.active ? 1 : 0;
+        return;
+    }
+
+    ral_get_pkt_payload( &( modem_radio.ral ), sizeof( payload ), payload, &size );
+    radio_pkt_status_get( &status );
+
+    if( per_parse_packet( size, &header ) == false )
+    {
+        nb_foreign++;
+        return;
+    }
+
+    if( rx_step.active &&
+        ( ( header.run_id != rx_step.header.run_id ) || ( header.step != rx_step.header.step ) ) )
+    {
+        per_rx_close_step( "next step" );
+    }
+    if( rx_step.active == false )
+    {
+        memset( &rx_step, 0, offsetof( per_rx_step_t, rssi_dbm ) );
+        rx_step.active = true;
+        rx_step.header = header;
+    }
+    rx_step.last_rx_ms = hal_rtc_get_time_ms( );
+
+    for( uint16_t i = PER_HEADER_SIZE; i < size; i++ )
+    {
+        if( payload[i] != per_pattern( &header, ( uint8_t ) i ) )
+        {
+            rx_step.corrupted++;
+            return;
+        }
+    }
+
+    uint8_t* seen = &rx_step.seen[header.seq / 8];
+    if( ( *seen & ( 1u << ( header.seq % 8 ) ) ) != 0 )
+    {
+        rx_step.duplicates++;
+        return;
+    }
+    *seen |= ( uint8_t ) ( 1u << ( header.seq % 8 ) );
+
+    // Keeps the latest samples past the table size
+    rx_step.rssi_dbm[rx_step.received % BENCH_STATS_MAX_SAMPLES] = status.rssi_pkt_dbm;
+    rx_step.snr_db[rx_step.received % BENCH_STATS_MAX_SAMPLES]   = status.snr_db;
+    rx_step.received++;
+
+    if( header.seq == ( header.packets - 1 ) )
+    {
+        per_rx_close_step( "complete" );
+    }
+}
+
+static void per_rx_close_step( const char* end )
+{
+    const per_header_t* header     = &rx_step.header;
+    const uint32_t      nb_samples = MIN( rx_step.received, BENCH_STATS_MAX_SAMPLES );
+    const uint32_t      lost       = ( rx_step.received < header->packets ) ? header->packets - rx_step.received : 0;
+    const float         per_pct    = 100.0f * ( float ) lost / ( float ) header->packets;
+    per_dist_t          rssi       = { 0 };
+    per_dist_t          snr        = { 0 };
+    char                sf_txt[8];
+    char                extra[640];
+
+    rx_step.active = false;
+    if( nb_samples > 0 )
+    {
+        per_dist_compute( rx_step.rssi_dbm, nb_samples, &rssi );
+        per_dist_compute( rx_step.snr_db, nb_samples, &snr );
+    }
+
+    SMTC_HAL_TRACE_INFO( "Run %04x step %u/%u at %d dBm (%s): PER %.1f%% (%lu/%u), rssi %.1f dBm "
+                         "[%.0f..%.0f], snr %.1f dB [%.1f..%.1f]\n",
+                         header->run_id, header->step + 1, header->nb_steps, header->tx_power_dbm, end,
+                         ( double ) per_pct, ( unsigned long ) rx_step.received, header->packets, rssi.mean,
+                         rssi.min, rssi.max, snr.mean, snr.min, snr.max );
+
+    snprintf( sf_txt, sizeof( sf_txt ), "SF%u", lora_param.mod_params.sf );
+    snprintf( extra, sizeof( extra ),
+              "{\"run\" : \"%04x\", \"step\" : \"%u\", \"tx_power\" : \"%d\", \"end\" : \"%s\", "
+              "\"packets\" : \"%u\", \"received\" : \"%lu\", \"per_pct\" : \"%.2f\", \"duplicates\" : \"%lu\", "
+              "\"corrupted\" : \"%lu\", \"crc_errors\" : \"%lu\", \"foreign\" : \"%lu\", "
+              "\"rssi_min\" : \"%.0f\", \"rssi_mean\" : \"%.1f\", \"rssi_p50\" : \"%.0f\", \"rssi_max\" : \"%.0f\", "
+              "\"snr_min\" : \"%.2f\", \"snr_mean\" : \"%.2f\", \"snr_p50\" : \"%.2f\", \"snr_max\" : \"%.2f\"}",
+              header->run_id, header->step, header->tx_power_dbm, end, header->packets,
+              ( unsigned long ) rx_step.received, ( double ) per_pct, ( unsigned long ) rx_step.duplicates,
+              ( unsigned long ) rx_step.corrupted, ( unsigned long ) rx_step.crc_errors, ( unsigned long ) nb_foreign,
+              rssi.min, rssi.mean, rssi.p50, rssi.max, snr.min, snr.mean, snr.p50, snr.max );
+    csv_log_write_row( NULL, "PER_STEP", NULL, 0, sf_txt, extra );
+
+    // The first step of a run starts a new curve
+    if( header->step == 0 )
+    {
+        memset( curve, 0, sizeof( curve ) );
+    }
+    if( header->step < PER_MAX_STEPS )
+    {
+        curve[header->step] = ( per_point_t ){ .tx_power_dbm = header->tx_power_dbm,
+                                               .per_pct      = per_pct,
+                                               .rssi_dbm     = ( float ) rssi.mean,
+                                               .snr_db       = ( float ) snr.mean,
+                                               .valid        = true };
+    }
+    if( header->step == ( header->nb_steps - 1 ) )
+    {
+        per_rx_report_curve( );
+    }
+}
+
+static void per_dist_compute( double* samples, const uint32_t nb_samples, per_dist_t* dist )
+{
+    bench_stats_t stats = { 0 };
+
+    // The timing statistics apply as is, only the unit differs
+    bench_stats_compute( samples, nb_samples, &stats );
+    dist->min  = stats.min_us;
+    dist->mean = stats.mean_us;
+    dist->p50  = stats.p50_us;
+    dist->max  = stats.max_us;
+}
+
+static void per_rx_report_curve( void )
+{
+    const per_point_t* sensitivity = NULL;
+    char               sf_txt[8];
+    char               extra[192];
+
+    SMTC_HAL_TRACE_INFO( "Sensitivity curve, run %04x:\n", rx_step.header.run_id );
+    SMTC_HAL_TRACE_INFO( "  tx dBm   rssi dBm   snr dB    PER %%\n" );
+    for( uint8_t i = 0; i < PER_MAX_STEPS; i++ )
+    {
+        const per_point_t* point = &curve[i];
+        if( point->valid == false )
+        {
+            continue;
+        }
+        SMTC_HAL_TRACE_INFO( "  %6d   %8.1f   %6.1f   %6.1f\n", point->tx_power_dbm, ( double ) point->rssi_dbm,
+                             ( double ) point->snr_db, ( double ) point->per_pct );
+
+        // Weakest signal still received at the target PER
+        if( ( point->per_pct <= target_pct ) && ( point->per_pct < 100.0f ) &&
+            ( ( sensitivity == NULL ) || ( point->rssi_dbm < sensitivity->rssi_dbm ) ) )
+        {
+            sensitivity = point;
+        }
+    }
+
+    snprintf( sf_txt, sizeof( sf_txt ), "SF%u", lora_param.mod_params.sf );
+    if( sensitivity == NULL )
+    {
+        SMTC_HAL_TRACE_WARNING( "No step reached a PER of %.0f%% or less\n", ( double ) target_pct );
+        snprintf( extra, sizeof( extra ), "{\"run\" : \"%04x\", \"target_pct\" : \"%.0f\"}", rx_step.header.run_id,
+                  ( double ) target_pct );
+    }
+    else
+    {
+        SMTC_HAL_TRACE_INFO( "Sensitivity at %.0f%% PER: %.1f dBm (snr %.1f dB, tx %d dBm)\n", ( double ) target_pct,
+                             ( double ) sensitivity->rssi_dbm, ( double ) sensitivity->snr_db,
+                             sensitivity->tx_power_dbm );
+        snprintf( extra, sizeof( extra ),
+                  "{\"run\" : \"%04x\", \"target_pct\" : \"%.0f\", \"sensitivity_dbm\" : \"%.1f\", "
+                  "\"snr\" : \"%.1f\", \"tx_power\" : \"%d\"}",
+                  rx_step.header.run_id, ( double ) target_pct, ( double ) sensitivity->rssi_dbm,
+                  ( double ) sensitivity->snr_db, sensitivity->tx_power_dbm );
+    }
+    csv_log_write_row( NULL, "PER_RUN", NULL, 0, sf_txt, extra );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
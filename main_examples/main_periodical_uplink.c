@@ -41,6 +41,18 @@
  * - Configurable uplink period, packet size and size mode via command line
  * - Random payload generation
  * - EXTRA field in JSON format for easy post-processing
+ * - DIO edge to DOWNDATA latency per stage in the DOWNDATA EXTRA field
+ * - Per-uplink and cumulative radio energy estimate on TXDONE
+ * - Per-uplink radio state times and RX window usage on TXDONE
+ * - Clock drift estimate from DeviceTimeAns/ALCSync, used as crystal error
+ * - DIAG event with a compressed radio register snapshot on JOINFAIL and
+ *   implausible downlink RSSI
+ * - Engine benchmark: run time of smtc_modem_run_engine and CPU use over
+ *   bench.duration_s, written as JSON and compared to a baseline
+ * - Fast boot: a session stored in NVM is resumed without a join, unless
+ *   the rejoin policy asks for one
+ * - STARTUP event with the time of each startup phase, from process start
+ *   to the end of the first uplink, and the restart counters
  *
  * Usage: app_sx1276.elf [period_s] [packet_size] [fixed|var]
  *   period_s    : uplink period in seconds (default: 60, min: 1)
@@ -64,7 +76,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
-#include <errno.h>
+#include <sys/resource.h>
 
 #include "main.h"
 
@@ -79,11 +91,29 @@
 
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_gpio.h"
+#include "smtc_hal_latency.h"
+#include "smtc_hal_spi.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_startup.h"
 
 #include "modem_pinout.h"
 #include "smtc_modem_relay_api.h"
 
 #include "sx127x.h"
+#include "radio_energy.h"
+#include "radio_state_time.h"
+#include "smtc_hal_clock_drift.h"
+#include "radio_snapshot.h"
+#include "radio_pkt_status.h"
+#include "radio_temperature.h"
+#include "smtc_hal_env.h"
+#include "csv_log.h"
+#include "bench_stats.h"
+#include "lorawan_session.h"
+#include "stats_shm.h"
+#include "supervisor.h"
+#include "sim_link.h"
 
 /* --- Defines nécessaires pour les headers internes LBM --- */
 #ifndef RP2_103
@@ -99,6 +129,7 @@
 
 #include "lr1_stack_mac_layer.h"
 #include "lorawan_api.h"
+#include "smtc_secure_element.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -111,94 +142,20 @@
  */
 #define PACKET_SIZE_MIN_VARIABLE 1
 
-/*
- * -----------------------------------------------------------------------------
- * --- FILE-SCOPE VARIABLES ----------------------------------------------------
- */
-
-/* CSV file handle */
-static FILE *csv_fp = NULL;
-
-/*
- * -----------------------------------------------------------------------------
- * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+/**
+ * @brief Period of the DeviceTimeReq piggybacked on uplinks, one drift measurement each
  */
+#define CLOCK_DRIFT_REQUEST_PERIOD_S HAL_CLOCK_DRIFT_MIN_INTERVAL_S
 
-static int  csv_init( void );
-static void csv_write_row( const uint8_t deveui[8], const char *event,
-                           const uint8_t *data, size_t datalen,
-                           const char *sf, const char *extra );
-static void csv_close( void );
-
-/*
- * -----------------------------------------------------------------------------
- * --- CSV HELPER FUNCTIONS ----------------------------------------------------
+/**
+ * @brief DeviceTimeAns fractional second unit is 1/256 s
  */
+#define DEVICE_TIME_RESOLUTION_MS 4
 
-static void current_timestr( char *buf, size_t buflen )
-{
-    time_t t = time( NULL );
-    struct tm tm;
-    localtime_r( &t, &tm );
-    strftime( buf, buflen, "%Y-%m-%d--%H-%M-%S", &tm );
-}
-
-static char *hex_to_str( const uint8_t *buf, size_t len )
-{
-    if( len == 0 )
-    {
-        return strdup( "" );
-    }
-    size_t outlen = len * 2 + 1;
-    char *out = malloc( outlen );
-    if( !out )
-    {
-        return NULL;
-    }
-    for( size_t i = 0; i < len; i++ )
-    {
-        snprintf( out + i * 2, 3, "%02X", buf[i] );
-    }
-    out[outlen - 1] = '\0';
-    return out;
-}
-
-static void deveui_to_str( char *dst, size_t dstlen, const uint8_t deveui[8] )
-{
-    char tmp[17];
-    for( int i = 0; i < 8; i++ )
-    {
-        snprintf( tmp + i * 2, 3, "%02X", deveui[i] );
-    }
-    tmp[16] = '\0';
-    if( dstlen > 0 )
-    {
-        strncpy( dst, tmp, dstlen - 1 );
-        dst[dstlen - 1] = '\0';
-    }
-}
-
-/*
- * -----------------------------------------------------------------------------
- * --- CSV FIELD ESCAPING (RFC 4180) -------------------------------------------
+/**
+ * @brief Shortest modem idle time used to refresh the environment sensors
  */
-static void csv_write_escaped_field( FILE *fp, const char *str )
-{
-    fputc( '"', fp );
-    if( str != NULL )
-    {
-        while( *str )
-        {
-            if( *str == '"' )
-            {
-                fputc( '"', fp );
-            }
-            fputc( *str, fp );
-            str++;
-        }
-    }
-    fputc( '"', fp );
-}
+#define ENV_REFRESH_MIN_IDLE_MS 100
 
 /*
  * -----------------------------------------------------------------------------
@@ -290,75 +247,6 @@ static uint8_t compute_payload_size( void )
     }
 }
 
-/*
- * -----------------------------------------------------------------------------
- * --- CSV FILE OPERATIONS -----------------------------------------------------
- */
-
-static int csv_init( void )
-{
-    char timestr[32];
-    current_timestr( timestr, sizeof( timestr ) );
-
-    char filename[128];
-    snprintf( filename, sizeof( filename ), "lorawan-%s.csv", timestr );
-
-    csv_fp = fopen( filename, "a" );
-    if( !csv_fp )
-    {
-        SMTC_HAL_TRACE_ERROR( "Failed to open CSV file %s: %s\n", filename, strerror( errno ) );
-        return -1;
-    }
-
-    fprintf( csv_fp, "TIMESTAMP,DEVEUI,EVENT,DATA,SF,EXTRA\n" );
-    fflush( csv_fp );
-    return 0;
-}
-
-static void csv_write_row( const uint8_t deveui[8], const char *event,
-                           const uint8_t *data, size_t datalen,
-                           const char *sf, const char *extra )
-{
-    if( !csv_fp )
-    {
-        return;
-    }
-
-    char timestr[32];
-    current_timestr( timestr, sizeof( timestr ) );
-
-    char devstr[32];
-    deveui_to_str( devstr, sizeof( devstr ), deveui );
-
-    char *datas = hex_to_str( data, datalen );
-    if( !datas )
-    {
-        datas = strdup( "" );
-    }
-
-    fprintf( csv_fp, "\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",",
-             timestr,
-             devstr,
-             event ? event : "",
-             datas,
-             sf ? sf : "" );
-
-    csv_write_escaped_field( csv_fp, extra );
-    fprintf( csv_fp, "\n" );
-
-    fflush( csv_fp );
-    free( datas );
-}
-
-static void csv_close( void )
-{
-    if( csv_fp )
-    {
-        fclose( csv_fp );
-        csv_fp = NULL;
-    }
-}
-
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
@@ -419,7 +307,7 @@ static void csv_close( void )
 
 #define STACK_ID 0
 
-static const uint8_t user_dev_eui[8]      = USER_LORAWAN_DEVICE_EUI;
+static uint8_t       user_dev_eui[8]      = USER_LORAWAN_DEVICE_EUI;
 static const uint8_t user_join_eui[8]     = USER_LORAWAN_JOIN_EUI;
 static const uint8_t user_gen_app_key[16] = USER_LORAWAN_GEN_APP_KEY;
 static const uint8_t user_app_key[16]     = USER_LORAWAN_APP_KEY;
@@ -445,6 +333,30 @@ static int16_t last_rssi              = 0;
 static int16_t last_snr               = 0;
 static uint8_t last_rx_payload_length = 0;
 
+static bool     clock_drift_requested     = false;
+static uint32_t clock_drift_last_req_time = 0;
+
+static uint32_t      bench_duration_s    = 0;  // 0 when not benchmarking
+static const char*   bench_results_path  = NULL;
+static const char*   bench_baseline_path = NULL;
+static uint64_t      bench_start_us      = 0;
+static struct rusage bench_start_usage;
+static double        bench_samples[BENCH_STATS_MAX_SAMPLES];
+static uint32_t      bench_nb_runs   = 0;
+static uint32_t      bench_nb_joins  = 0;
+static uint32_t      bench_nb_txdone = 0;
+
+static lorawan_session_policy_t session_policy;
+static lorawan_session_t        session;
+static bool                     session_valid         = false;
+static bool                     session_resumed       = false;  // until the LinkCheckAns confirms it
+static uint32_t                 session_unsaved       = 0;
+static const char*              session_start         = "joined";
+static bool                     first_uplink_reported = false;
+
+static bool     stats_enabled     = false;  // stats page mapped
+static uint32_t stats_tx_start_ms = 0;      // uplink request time, for the TX cycle histogram
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -452,6 +364,21 @@ static uint8_t last_rx_payload_length = 0;
 
 static void modem_event_callback( void );
 static void send_uplink_counter_on_port( uint8_t port );
+static void clock_drift_request_time( void );
+static void clock_drift_on_network_time( uint64_t network_time_ms, uint32_t resolution_ms );
+static void diag_write_snapshot( const char *reason );
+static void env_refresh( void );
+static void load_dev_eui( void );
+static uint64_t engine_now_us( void );
+static void bench_init( void );
+static void bench_engine_sample( const uint64_t start_us );
+static void stats_init( void );
+static void stats_engine_sample( const uint64_t start_us );
+static void bench_report( void );
+static bool session_resume( void );
+static void session_capture( const bool joined );
+static void session_rejoin( const char* reason );
+static void session_report_first_uplink( void );
 
 /*
  * -----------------------------------------------------------------------------
@@ -462,18 +389,34 @@ void main_periodical_uplink( void )
 {
     uint32_t sleep_time_ms = 0;
 
+    hal_startup_mark( HAL_STARTUP_PHASE_MAIN );
+
     hal_mcu_init( );
 
+    load_dev_eui( );
+    bench_init( );
+    lorawan_session_policy_load( &session_policy );
+
+    /* Without a radio, a model and a network server stand in for the air and the network */
+    if( hal_spi_get_backend( RADIO_SPI_ID ) == HAL_SPI_BACKEND_SIM )
+    {
+        sim_link_start( user_dev_eui, user_join_eui, user_app_key );
+    }
+
     /* Seed random number generator for random payloads */
     srand( ( unsigned int ) time( NULL ) );
 
     smtc_modem_init( &modem_event_callback );
+    hal_startup_mark( HAL_STARTUP_PHASE_MODEM_INIT );
 
-    if( csv_init( ) != 0 )
+    if( csv_log_init( "lorawan" ) != 0 )
     {
         SMTC_HAL_TRACE_ERROR( "CSV init failed, continuing without CSV logging\n" );
     }
-    atexit( csv_close );
+    atexit( csv_log_close );
+    hal_startup_mark( HAL_STARTUP_PHASE_CSV_INIT );
+
+    stats_init( );
 
     SMTC_HAL_TRACE_INFO( "Periodical uplink example is starting\n" );
     SMTC_HAL_TRACE_INFO( "  Period:      %d s\n", g_uplink_period_s );
@@ -487,7 +430,16 @@ void main_periodical_uplink( void )
 
     while( 1 )
     {
-        sleep_time_ms = smtc_modem_run_engine( );
+        hal_latency_mark( HAL_LATENCY_STAGE_ENGINE );
+        const uint64_t engine_start_us = engine_now_us( );
+        sleep_time_ms                  = smtc_modem_run_engine( );
+        bench_engine_sample( engine_start_us );
+        stats_engine_sample( engine_start_us );
+
+        if( ( smtc_modem_is_irq_flag_pending( ) == false ) && ( sleep_time_ms >= ENV_REFRESH_MIN_IDLE_MS ) )
+        {
+            env_refresh( );
+        }
 
         if( smtc_modem_is_irq_flag_pending( ) == false )
         {
@@ -517,6 +469,7 @@ static void modem_event_callback( void )
         {
         case SMTC_MODEM_EVENT_RESET:
             SMTC_HAL_TRACE_INFO( "Event received: RESET\n" );
+            hal_startup_mark( HAL_STARTUP_PHASE_RESET_EVENT );
 
             ASSERT_SMTC_MODEM_RC( smtc_modem_set_deveui( stack_id, user_dev_eui ) );
             ASSERT_SMTC_MODEM_RC( smtc_modem_set_joineui( stack_id, user_join_eui ) );
@@ -535,19 +488,41 @@ static void modem_event_callback( void )
             ASSERT_SMTC_MODEM_RC( smtc_modem_relay_tx_enable( stack_id, &relay_config ) );
 #endif
 
-            ASSERT_SMTC_MODEM_RC( smtc_modem_join_network( stack_id ) );
+            if( session_resume( ) == false )
+            {
+                hal_startup_mark( HAL_STARTUP_PHASE_JOIN_REQUEST );
+                ASSERT_SMTC_MODEM_RC( smtc_modem_join_network( stack_id ) );
+            }
             break;
 
         case SMTC_MODEM_EVENT_ALARM:
             SMTC_HAL_TRACE_INFO( "Event received: ALARM\n" );
+            clock_drift_request_time( );
             send_uplink_counter_on_port( 101 );
             ASSERT_SMTC_MODEM_RC( smtc_modem_alarm_start_timer( g_uplink_period_s ) );
             break;
 
         case SMTC_MODEM_EVENT_JOINED:
             SMTC_HAL_TRACE_INFO( "Event received: JOINED\n" );
+            hal_startup_mark( HAL_STARTUP_PHASE_JOINED );
             SMTC_HAL_TRACE_INFO( "Modem is now joined \n" );
 
+            session_capture( true );
+            bench_nb_joins++;
+
+            {
+                stats_shm_t*     stats = stats_shm_begin( );
+                lr1_stack_mac_t* mac   = lorawan_api_stack_mac_get( STACK_ID );
+                if( stats != NULL )
+                {
+                    stats->joins++;
+                    stats->joined   = 1;
+                    stats->dev_addr = ( mac != NULL ) ? mac->dev_addr : 0;
+                    stats_shm_end( );
+                }
+            }
+
+            clock_drift_request_time( );
             send_uplink_counter_on_port( 101 );
             ASSERT_SMTC_MODEM_RC( smtc_modem_alarm_start_timer( g_uplink_period_s ) );
 
@@ -563,7 +538,7 @@ static void modem_event_callback( void )
                     sf_txt = sx127x_sf_to_str( radio->lora_mod_params.sf );
                 }
 
-                csv_write_row( user_dev_eui, "JOINED", NULL, 0, sf_txt, extra );
+                csv_log_write_row( user_dev_eui, "JOINED", NULL, 0, sf_txt, extra );
             }
             break;
 
@@ -571,6 +546,20 @@ static void modem_event_callback( void )
             SMTC_HAL_TRACE_INFO( "Event received: TXDONE\n" );
             SMTC_HAL_TRACE_INFO( "Transmission done \n" );
 
+            session_capture( false );
+            session_report_first_uplink( );
+            bench_nb_txdone++;
+
+            {
+                stats_shm_t* stats = stats_shm_begin( );
+                if( stats != NULL )
+                {
+                    stats->txdone++;
+                    stats_shm_hist_add( &stats->tx_cycle_ms, smtc_modem_hal_get_time_in_ms( ) - stats_tx_start_ms );
+                    stats_shm_end( );
+                }
+            }
+
             {
                 const char *sf_txt = "";
                 sx127x_t* radio = ( sx127x_t* ) smtc_modem_get_radio_context( );
@@ -578,12 +567,46 @@ static void modem_event_callback( void )
                 {
                     sf_txt = sx127x_sf_to_str( radio->lora_mod_params.sf );
                 }
-                csv_write_row( user_dev_eui, "TXDONE", NULL, 0, sf_txt,
-                               "{\"status\" : \"OK\"}" );
+
+                /* Radio energy of this uplink cycle (TX, RX windows, idle) and since startup */
+                radio_energy_report_t energy;
+                radio_energy_get_report( &energy );
+                radio_energy_reset_uplink( );
+
+                SMTC_HAL_TRACE_INFO( "Uplink radio energy: %.3f uAh (%.2f mJ), total %.4f mAh (%.1f mJ)\n",
+                                     energy.uplink_charge_uas / 3600.0, energy.uplink_energy_mj,
+                                     energy.total_charge_uas / 3600000.0, energy.total_energy_mj );
+
+                /* Radio state times of this uplink cycle, RX on-time vs RX time of windows with a packet */
+                radio_state_time_report_t times;
+                radio_state_time_get_report( &times );
+                radio_state_time_reset_uplink( );
+
+                const radio_state_time_t* up = &times.uplink;
+                SMTC_HAL_TRACE_INFO( "Uplink radio time: tx %.1f ms, rx %.1f ms (useful %.1f ms, %lu/%lu windows), "
+                                     "standby %.1f ms, synth %.1f ms\n",
+                                     up->state_us[RADIO_STATE_TX] / 1000.0, up->state_us[RADIO_STATE_RX] / 1000.0,
+                                     up->rx_useful_us / 1000.0, ( unsigned long ) up->rx_packets,
+                                     ( unsigned long ) up->rx_windows, up->state_us[RADIO_STATE_STANDBY] / 1000.0,
+                                     up->state_us[RADIO_STATE_SYNTH] / 1000.0 );
+
+                char extra[384];
+                snprintf( extra, sizeof( extra ),
+                          "{\"status\" : \"OK\", \"charge_uah\" : \"%.3f\", \"energy_mj\" : \"%.2f\", "
+                          "\"total_charge_mah\" : \"%.4f\", \"total_energy_mj\" : \"%.1f\", "
+                          "\"tx_ms\" : \"%.1f\", \"rx_ms\" : \"%.1f\", \"rx_useful_ms\" : \"%.1f\", "
+                          "\"rx_windows\" : \"%lu\", \"standby_ms\" : \"%.1f\"}",
+                          energy.uplink_charge_uas / 3600.0, energy.uplink_energy_mj,
+                          energy.total_charge_uas / 3600000.0, energy.total_energy_mj,
+                          up->state_us[RADIO_STATE_TX] / 1000.0, up->state_us[RADIO_STATE_RX] / 1000.0,
+                          up->rx_useful_us / 1000.0, ( unsigned long ) up->rx_windows,
+                          up->state_us[RADIO_STATE_STANDBY] / 1000.0 );
+                csv_log_write_row( user_dev_eui, "TXDONE", NULL, 0, sf_txt, extra );
             }
             break;
 
         case SMTC_MODEM_EVENT_DOWNDATA:
+            hal_latency_mark( HAL_LATENCY_STAGE_EVENT );
             SMTC_HAL_TRACE_INFO( "Event received: DOWNDATA\n" );
             ASSERT_SMTC_MODEM_RC(
                 smtc_modem_get_downlink_data( rx_payload, &rx_payload_size, &rx_metadata, &rx_remaining ) );
@@ -620,87 +643,103 @@ static void modem_event_callback( void )
                     SMTC_HAL_TRACE_WARNING( "rx_metadata.snr implausible: %d (raw)\n", ( int ) rx_metadata.snr );
                 }
 
+                /* Fall back to the status the radio HAL latched when the packet was read out, no SPI access */
                 if( !has_rssi && !has_snr )
                 {
-                    sx127x_t* radio = ( sx127x_t* ) smtc_modem_get_radio_context( );
-                    if( radio != NULL )
+                    radio_pkt_status_t pkt_status;
+                    if( radio_pkt_status_get( &pkt_status ) )
                     {
-                        if( radio->pkt_type == SX127X_PKT_TYPE_LORA )
+                        SMTC_HAL_TRACE_PRINTF( "Latched packet status: rssi %d dBm, snr %.2f dB, fei %ld Hz, "
+                                               "%lu ms old\n",
+                                               ( int ) pkt_status.rssi_pkt_dbm, ( double ) pkt_status.snr_db,
+                                               ( long ) pkt_status.fei_hz,
+                                               ( unsigned long ) ( hal_rtc_get_time_ms( ) - pkt_status.timestamp_ms ) );
+                        if( ( pkt_status.rssi_pkt_dbm >= -140 ) && ( pkt_status.rssi_pkt_dbm <= 10 ) )
                         {
-                            sx127x_lora_pkt_status_t lora_status = { 0 };
-                            sx127x_status_t st = sx127x_get_lora_pkt_status( radio, &lora_status );
-                            SMTC_HAL_TRACE_PRINTF( "sx127x_get_lora_pkt_status() -> %d\n", ( int ) st );
-                            if( st == SX127X_STATUS_OK )
-                            {
-                                int32_t rssi_alt = ( int32_t ) lora_status.rssi_pkt_in_dbm;
-                                int32_t snr_alt  = ( int32_t ) lora_status.snr_pkt_in_db;
-                                if( ( rssi_alt >= -140 ) && ( rssi_alt <= 10 ) )
-                                {
-                                    rssi_dbm = rssi_alt;
-                                    has_rssi = true;
-                                }
-                                if( ( snr_alt >= -50 ) && ( snr_alt <= 50 ) )
-                                {
-                                    snr_db = ( float ) snr_alt;
-                                    has_snr = true;
-                                }
-                            }
+                            rssi_dbm = pkt_status.rssi_pkt_dbm;
+                            has_rssi = true;
                         }
-                        else
+                        if( pkt_status.is_lora && ( pkt_status.snr_db >= -50.0f ) && ( pkt_status.snr_db <= 50.0f ) )
                         {
-                            sx127x_gfsk_pkt_status_t gfsk_status = { 0 };
-                            sx127x_status_t st = sx127x_get_gfsk_pkt_status( radio, &gfsk_status );
-                            SMTC_HAL_TRACE_PRINTF( "sx127x_get_gfsk_pkt_status() -> %d\n", ( int ) st );
-                            if( st == SX127X_STATUS_OK )
-                            {
-                                int32_t rssi_alt = ( int32_t ) gfsk_status.rssi_sync;
-                                if( ( rssi_alt >= -140 ) && ( rssi_alt <= 10 ) )
-                                {
-                                    rssi_dbm = rssi_alt;
-                                    has_rssi = true;
-                                }
-                            }
+                            snr_db  = pkt_status.snr_db;
+                            has_snr = true;
                         }
                     }
                     else
                     {
-                        SMTC_HAL_TRACE_WARNING( "radio context is NULL in DOWNDATA fallback\n" );
+                        SMTC_HAL_TRACE_WARNING( "no packet status latched in DOWNDATA fallback\n" );
                     }
                 }
 
+                if( !has_rssi )
+                {
+                    diag_write_snapshot( "DOWNDATA_IMPLAUSIBLE_RSSI" );
+                }
+
                 sx127x_t* radio_for_sf = ( sx127x_t* ) smtc_modem_get_radio_context( );
                 if( radio_for_sf != NULL && radio_for_sf->pkt_type == SX127X_PKT_TYPE_LORA )
                 {
                     sf_txt = sx127x_sf_to_str( radio_for_sf->lora_mod_params.sf );
                 }
 
+                /* Per-stage latency from the DIO edge to this event, -1 if a stage was missed */
+                char latency[96] = "";
+                hal_latency_record_t record;
+                const bool           has_latency = hal_latency_get_last( &record );
+                if( has_latency )
+                {
+                    snprintf( latency, sizeof( latency ), ", \"latency_us\" : \"%ld/%ld/%ld/%ld\"",
+                              ( long ) hal_latency_get_stage_us( &record, HAL_LATENCY_STAGE_GPIO_ISR ),
+                              ( long ) hal_latency_get_stage_us( &record, HAL_LATENCY_STAGE_RADIO_IRQ ),
+                              ( long ) hal_latency_get_stage_us( &record, HAL_LATENCY_STAGE_ENGINE ),
+                              ( long ) hal_latency_get_stage_us( &record, HAL_LATENCY_STAGE_EVENT ) );
+                    hal_latency_print_stats( );
+                }
+
+                stats_shm_t* stats = stats_shm_begin( );
+                if( stats != NULL )
+                {
+                    stats->downlinks++;
+                    stats->rx_rssi_dbm     = has_rssi ? ( int16_t ) rssi_dbm : INT16_MIN;
+                    stats->rx_snr_cdb      = has_snr ? ( int16_t ) ( snr_db * 100.0f ) : INT16_MIN;
+                    stats->rx_frequency_hz = freq_hz;
+                    stats->rx_time_s       = ( int64_t ) time( NULL );
+                    const int32_t edge_to_event_us =
+                        has_latency ? hal_latency_get_stage_us( &record, HAL_LATENCY_STAGE_EVENT ) : -1;
+                    if( edge_to_event_us >= 0 )
+                    {
+                        stats_shm_hist_add( &stats->irq_latency_us, ( uint32_t ) edge_to_event_us );
+                    }
+                    stats_shm_end( );
+                }
+
                 if( has_rssi && has_snr )
                 {
                     snprintf( extra, sizeof( extra ),
                               "{\"port\" : \"%u\", \"freq\" : \"%luHz(%.3fMHz)\", "
-                              "\"rssi\" : \"%d dBm\", \"snr\" : \"%.2f dB\"}",
+                              "\"rssi\" : \"%d dBm\", \"snr\" : \"%.2f dB\"%s}",
                               ( unsigned ) rx_metadata.fport,
                               ( unsigned long ) freq_hz, ( double ) freq_hz / 1e6,
-                              ( int ) rssi_dbm, snr_db );
+                              ( int ) rssi_dbm, snr_db, latency );
                 }
                 else if( has_rssi )
                 {
                     snprintf( extra, sizeof( extra ),
                               "{\"port\" : \"%u\", \"freq\" : \"%luHz(%.3fMHz)\", "
-                              "\"rssi\" : \"%d dBm\"}",
+                              "\"rssi\" : \"%d dBm\"%s}",
                               ( unsigned ) rx_metadata.fport,
                               ( unsigned long ) freq_hz, ( double ) freq_hz / 1e6,
-                              ( int ) rssi_dbm );
+                              ( int ) rssi_dbm, latency );
                 }
                 else
                 {
                     snprintf( extra, sizeof( extra ),
-                              "{\"port\" : \"%u\", \"freq\" : \"%luHz(%.3fMHz)\"}",
+                              "{\"port\" : \"%u\", \"freq\" : \"%luHz(%.3fMHz)\"%s}",
                               ( unsigned ) rx_metadata.fport,
-                              ( unsigned long ) freq_hz, ( double ) freq_hz / 1e6 );
+                              ( unsigned long ) freq_hz, ( double ) freq_hz / 1e6, latency );
                 }
 
-                csv_write_row( user_dev_eui, "DOWNDATA", rx_payload, rx_payload_size, sf_txt, extra );
+                csv_log_write_row( user_dev_eui, "DOWNDATA", rx_payload, rx_payload_size, sf_txt, extra );
             }
             break;
 
@@ -719,16 +758,47 @@ static void modem_event_callback( void )
                     sf_txt = sx127x_sf_to_str( radio->lora_mod_params.sf );
                 }
 
-                csv_write_row( user_dev_eui, "JOINFAIL", NULL, 0, sf_txt, extra );
+                csv_log_write_row( user_dev_eui, "JOINFAIL", NULL, 0, sf_txt, extra );
+                diag_write_snapshot( "JOINFAIL" );
+
+                stats_shm_t* stats = stats_shm_begin( );
+                if( stats != NULL )
+                {
+                    stats->join_fails++;
+                    stats_shm_end( );
+                }
             }
             break;
 
         case SMTC_MODEM_EVENT_ALCSYNC_TIME:
             SMTC_HAL_TRACE_INFO( "Event received: ALCSync service TIME\n" );
+#if defined( ADD_SMTC_ALC_SYNC )
+            if( current_event.event_data.alcsync_time.status == SMTC_MODEM_EVENT_TIME_VALID )
+            {
+                uint32_t gps_time_s;
+                if( smtc_modem_get_alcsync_time( stack_id, &gps_time_s ) == SMTC_MODEM_RC_OK )
+                {
+                    clock_drift_on_network_time( ( uint64_t ) gps_time_s * 1000, 1000 );
+                }
+            }
+#endif
             break;
 
         case SMTC_MODEM_EVENT_LINK_CHECK:
             SMTC_HAL_TRACE_INFO( "Event received: LINK_CHECK\n" );
+            if( session_resumed == true )
+            {
+                session_resumed = false;
+                if( current_event.event_data.link_check.status != SMTC_MODEM_EVENT_LINK_CHECK_RECEIVED )
+                {
+                    // The network no longer knows the session
+                    session_rejoin( "no LinkCheckAns" );
+                }
+                else
+                {
+                    SMTC_HAL_TRACE_INFO( "Resumed session confirmed by the network\n" );
+                }
+            }
             break;
 
         case SMTC_MODEM_EVENT_CLASS_B_PING_SLOT_INFO:
@@ -741,6 +811,16 @@ static void modem_event_callback( void )
 
         case SMTC_MODEM_EVENT_LORAWAN_MAC_TIME:
             SMTC_HAL_TRACE_WARNING( "Event received: LORAWAN MAC TIME\n" );
+            if( current_event.event_data.lorawan_mac_time.status == SMTC_MODEM_EVENT_MAC_REQUEST_ANSWERED )
+            {
+                uint32_t gps_time_s;
+                uint32_t gps_fractional_s;
+                if( smtc_modem_get_lorawan_mac_time( stack_id, &gps_time_s, &gps_fractional_s ) == SMTC_MODEM_RC_OK )
+                {
+                    clock_drift_on_network_time( ( uint64_t ) gps_time_s * 1000 + gps_fractional_s * 1000 / 256,
+                                                 DEVICE_TIME_RESOLUTION_MS );
+                }
+            }
             break;
 
         case SMTC_MODEM_EVENT_LORAWAN_FUOTA_DONE:
@@ -777,7 +857,8 @@ static void modem_event_callback( void )
             SMTC_HAL_TRACE_INFO( "Event received: FIRMWARE_MANAGEMENT\n" );
             if( current_event.event_data.fmp.status == SMTC_MODEM_EVENT_FMP_REBOOT_IMMEDIATELY )
             {
-                csv_close( );
+                csv_log_close( );
+                hal_reset_cause_set( true, "firmware management reboot" );
                 smtc_modem_hal_reset_mcu( );
             }
             break;
@@ -839,9 +920,7 @@ static void modem_event_callback( void )
             SMTC_HAL_TRACE_INFO( "Event received: NO_DOWNLINK_THRESHOLD\n" );
             if( current_event.event_data.no_downlink.status != 0 )
             {
-                smtc_modem_alarm_clear_timer( );
-                ASSERT_SMTC_MODEM_RC( smtc_modem_leave_network( stack_id ) );
-                ASSERT_SMTC_MODEM_RC( smtc_modem_join_network( stack_id ) );
+                session_rejoin( "no downlink threshold" );
                 SMTC_HAL_TRACE_INFO(
                     "Event received: %s-%s\n",
                     current_event.event_data.no_downlink.status & SMTC_MODEM_EVENT_NO_RX_THRESHOLD_ADR_BACKOFF_END
@@ -923,7 +1002,7 @@ static void send_uplink_counter_on_port( uint8_t port )
     /* --- CSV logging (TX) --- */
     {
         char extra[384]  = "";
-        char extra2[768] = "";
+        char extra2[896] = "";
 
         const char *sf_txt = "SF?";
         const char *bw_txt = "BW?";
@@ -942,6 +1021,9 @@ static void send_uplink_counter_on_port( uint8_t port )
         uint32_t max_duty_cycle_index      = 0;
         uint8_t  rx1_delay_s               = 0;
 
+        hal_env_values_t env;
+        hal_env_get_values( &env );
+
         lr1_stack_mac_t* mac = lorawan_api_stack_mac_get( STACK_ID );
         if( mac != NULL )
         {
@@ -995,7 +1077,10 @@ static void send_uplink_counter_on_port( uint8_t port )
                   "\"nb_available_tx_channel\" : \"%u\", "
                   "\"tx_duty_cycle_timestamp_ms\" : \"%u\", "
                   "\"max_duty_cycle_index\" : \"%u\", "
-                  "\"rx1_delay_s\" : \"%u\"}",
+                  "\"rx1_delay_s\" : \"%u\", "
+                  "\"temperature\" : \"%d\", \"soc_temperature\" : \"%d\", "
+                  "\"radio_temperature\" : \"%d\", \"voltage_mv\" : \"%u\", "
+                  "\"battery\" : \"%u\"}",
                   extra,
                   ( unsigned ) tx_data_rate,
                   ( unsigned ) tx_data_rate_adr,
@@ -1005,9 +1090,34 @@ static void send_uplink_counter_on_port( uint8_t port )
                   ( unsigned ) nb_available_tx_channel,
                   ( unsigned ) tx_duty_cycle_timestamp_ms,
                   ( unsigned ) max_duty_cycle_index,
-                  ( unsigned ) rx1_delay_s );
+                  ( unsigned ) rx1_delay_s,
+                  ( int ) env.temperature_c,
+                  ( int ) env.soc_temperature_c,
+                  ( int ) env.radio_temperature_c,
+                  ( unsigned ) env.voltage_mv,
+                  ( unsigned ) env.battery_level );
+
+        csv_log_write_row( user_dev_eui, "TX", payload, payload_size, sf_txt, extra2 );
 
-        csv_write_row( user_dev_eui, "TX", payload, payload_size, sf_txt, extra2 );
+        stats_shm_t* stats = stats_shm_begin( );
+        if( stats != NULL )
+        {
+            stats->uplinks++;
+            stats->fcnt_up         = ( mac != NULL ) ? mac->fcnt_up : 0;
+            stats->tx_frequency_hz = freq_hz;
+            stats->tx_power_dbm    = tx_power;
+            stats->tx_sf           = 0;
+            stats->tx_bw           = 0;
+            if( radio != NULL && radio->pkt_type == SX127X_PKT_TYPE_LORA )
+            {
+                stats->tx_sf = ( uint8_t ) radio->lora_mod_params.sf;
+                stats->tx_bw = ( uint8_t ) radio->lora_mod_params.bw;
+            }
+            stats->tx_data_rate = tx_data_rate;
+            stats->tx_size      = payload_size;
+            stats_shm_end( );
+        }
+        stats_tx_start_ms = smtc_modem_hal_get_time_in_ms( );
     }
     /* --- fin CSV logging --- */
 
@@ -1016,4 +1126,475 @@ static void send_uplink_counter_on_port( uint8_t port )
     uplink_counter++;
 }
 
+static void clock_drift_request_time( void )
+{
+    const uint32_t now_s = smtc_modem_hal_get_time_in_s( );
+
+    if( clock_drift_requested && ( ( now_s - clock_drift_last_req_time ) < CLOCK_DRIFT_REQUEST_PERIOD_S ) )
+    {
+        return;
+    }
+
+    /* DeviceTimeReq is piggybacked on the next uplink, the answer raises LORAWAN_MAC_TIME */
+    if( smtc_modem_trig_lorawan_mac_request( STACK_ID, SMTC_MODEM_LORAWAN_MAC_REQ_DEVICE_TIME ) ==
+        SMTC_MODEM_RC_OK )
+    {
+        clock_drift_requested     = true;
+        clock_drift_last_req_time = now_s;
+    }
+}
+
+static void clock_drift_on_network_time( uint64_t network_time_ms, uint32_t resolution_ms )
+{
+    hal_clock_drift_estimate_t estimate;
+
+    if( !hal_clock_drift_add_sample( network_time_ms, smtc_modem_hal_get_time_in_ms( ), resolution_ms ) )
+    {
+        return;
+    }
+
+    hal_clock_drift_get_estimate( &estimate );
+    ASSERT_SMTC_MODEM_RC( smtc_modem_set_crystal_error_ppm( estimate.crystal_error_ppm ) );
+
+    /* --- CSV logging (CLOCK_DRIFT) --- */
+    {
+        char extra[256] = "";
+
+        snprintf( extra, sizeof( extra ),
+                  "{\"drift_ppm\" : \"%.2f\", \"last_ppm\" : \"%.2f\", "
+                  "\"jitter_ppm\" : \"%.2f\", \"measurements\" : \"%lu\", "
+                  "\"crystal_error_ppm\" : \"%lu\"}",
+                  ( double ) estimate.drift_ppm, ( double ) estimate.last_ppm,
+                  ( double ) estimate.jitter_ppm, ( unsigned long ) estimate.nb_measurements,
+                  ( unsigned long ) estimate.crystal_error_ppm );
+        csv_log_write_row( user_dev_eui, "CLOCK_DRIFT", NULL, 0, "", extra );
+    }
+}
+
+static void diag_write_snapshot( const char *reason )
+{
+    sx127x_t* radio = ( sx127x_t* ) smtc_modem_get_radio_context( );
+    if( radio == NULL )
+    {
+        return;
+    }
+
+    /* Leave an ongoing TX/RX/CAD alone, the burst read would hold off its DIO handling */
+    const radio_state_t state = radio_state_time_get_state( );
+    if( ( state == RADIO_STATE_TX ) || ( state == RADIO_STATE_RX ) || ( state == RADIO_STATE_CAD ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "DIAG %s: radio busy (%s), no snapshot\n", reason,
+                                radio_state_time_get_name( state ) );
+        return;
+    }
+
+    radio_snapshot_t        snapshot;
+    radio_snapshot_fields_t fields;
+    uint8_t                 packed[RADIO_SNAPSHOT_COMPRESSED_MAX_SIZE];
+
+    radio_snapshot_capture( radio, &snapshot );
+    radio_snapshot_decode( &snapshot, &fields );
+    radio_snapshot_print( &fields );
+    const size_t packed_size = radio_snapshot_compress( &snapshot, packed, sizeof( packed ) );
+
+    /* --- CSV logging (DIAG), DATA holds the PackBits register map from RegOpMode --- */
+    {
+        char extra[384] = "";
+
+        snprintf( extra, sizeof( extra ),
+                  "{\"reason\" : \"%s\", \"encoding\" : \"packbits\", "
+                  "\"first_reg\" : \"0x%02x\", \"nb_regs\" : \"%u\", "
+                  "\"snapshot_ms\" : \"%lu\", \"version\" : \"0x%02x\", "
+                  "\"op_mode\" : \"0x%02x\", \"freq\" : \"%luHz\", "
+                  "\"irq_flags\" : \"0x%02x\", \"modem_stat\" : \"0x%02x\", "
+                  "\"pkt_rssi\" : \"%d\", \"pkt_snr\" : \"%.2f\", \"rssi\" : \"%d\"}",
+                  reason, RADIO_SNAPSHOT_FIRST_REG, ( unsigned ) RADIO_SNAPSHOT_NB_REGS,
+                  ( unsigned long ) snapshot.timestamp_ms, fields.version,
+                  radio_snapshot_get_reg( &snapshot, 0x01 ), ( unsigned long ) fields.frf_hz,
+                  fields.irq_flags, fields.modem_status, ( int ) fields.pkt_rssi_dbm,
+                  ( double ) fields.pkt_snr_db, ( int ) fields.rssi_dbm );
+
+        const char *sf_txt = ( radio->pkt_type == SX127X_PKT_TYPE_LORA )
+                                 ? sx127x_sf_to_str( radio->lora_mod_params.sf )
+                                 : "";
+        csv_log_write_row( user_dev_eui, "DIAG", packed, packed_size, sf_txt, extra );
+    }
+}
+
+static void env_refresh( void )
+{
+    if( hal_env_refresh( ) == false )
+    {
+        return;
+    }
+
+    /* The radio temperature is due, only read it while the radio sleeps */
+    sx127x_t* radio = ( sx127x_t* ) smtc_modem_get_radio_context( );
+    int8_t    temperature_c;
+    if( ( radio != NULL ) && ( radio_temperature_read( radio, &temperature_c ) == true ) )
+    {
+        hal_env_set_radio_temperature( temperature_c );
+        SMTC_HAL_TRACE_PRINTF( "Radio temperature: %d C\n", temperature_c );
+    }
+}
+
+/* lorawan.dev_eui in the board profile overrides USER_LORAWAN_DEVICE_EUI, e.g. one per simulated device */
+static void load_dev_eui( void )
+{
+    const char* hex;
+    uint8_t     dev_eui[8];
+
+    if( hal_board_profile_get_str( "lorawan.dev_eui", &hex ) == false )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        if( ( strlen( hex ) != 16 ) || ( sscanf( &hex[2 * i], "%2hhx", &dev_eui[i] ) != 1 ) )
+        {
+            SMTC_HAL_TRACE_ERROR( "Invalid lorawan.dev_eui %s, keeping the built-in DevEUI\n", hex );
+            return;
+        }
+    }
+    memcpy( user_dev_eui, dev_eui, sizeof( user_dev_eui ) );
+}
+
+/**
+ * @brief Monotonic time in us, 0 when neither the benchmark nor the stats page time the engine
+ */
+static uint64_t engine_now_us( void )
+{
+    struct timespec now;
+
+    if( ( bench_duration_s == 0 ) && ( stats_enabled == false ) )
+    {
+        return 0;
+    }
+    clock_gettime( RT_CLOCK, &now );
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+/**
+ * @brief Reads the bench.* keys, a bench.duration_s above 0 turns the engine benchmark on
+ */
+static void bench_init( void )
+{
+    int32_t duration_s;
+
+    if( ( hal_board_profile_get_int( "bench.duration_s", &duration_s ) == false ) || ( duration_s <= 0 ) )
+    {
+        return;
+    }
+    hal_board_profile_get_str( "bench.results_path", &bench_results_path );
+    hal_board_profile_get_str( "bench.baseline_path", &bench_baseline_path );
+
+    bench_duration_s = ( uint32_t ) duration_s;
+    bench_start_us   = engine_now_us( );
+    getrusage( RUSAGE_SELF, &bench_start_usage );
+    SMTC_HAL_TRACE_INFO( "Engine benchmark for %u s\n", ( unsigned ) bench_duration_s );
+}
+
+/**
+ * @brief Records the run time of one engine call, reports and exits once bench.duration_s is over
+ */
+static void bench_engine_sample( const uint64_t start_us )
+{
+    if( bench_duration_s == 0 )
+    {
+        return;
+    }
+
+    const uint64_t now_us = engine_now_us( );
+
+    // Keeps the latest runs, the modem settles after the join
+    bench_samples[bench_nb_runs % BENCH_STATS_MAX_SAMPLES] = ( double ) ( now_us - start_us );
+    bench_nb_runs++;
+
+    if( ( now_us - bench_start_us ) >= ( uint64_t ) bench_duration_s * 1000000u )
+    {
+        bench_report( );
+    }
+}
+
+/**
+ * @brief Writes the engine run time and CPU use, compares them to the baseline, if any, and exits
+ *
+ * @remark The process exits with EXIT_FAILURE when the engine regressed, or when no uplink went out, as the
+ *         runs then only time the join retries and the results say nothing of the engine
+ */
+static void bench_report( void )
+{
+    char              default_path[64];
+    const char*       path = bench_results_path;
+    struct rusage     usage;
+    bench_stats_cpu_t cpu;
+    int               nb_regressed = 0;
+
+    getrusage( RUSAGE_SELF, &usage );
+    cpu.wall_s = ( double ) ( engine_now_us( ) - bench_start_us ) / 1e6;
+    cpu.user_s = ( double ) ( usage.ru_utime.tv_sec - bench_start_usage.ru_utime.tv_sec ) +
+                 ( double ) ( usage.ru_utime.tv_usec - bench_start_usage.ru_utime.tv_usec ) / 1e6;
+    cpu.sys_s = ( double ) ( usage.ru_stime.tv_sec - bench_start_usage.ru_stime.tv_sec ) +
+                ( double ) ( usage.ru_stime.tv_usec - bench_start_usage.ru_stime.tv_usec ) / 1e6;
+
+    if( path == NULL )
+    {
+        char timestr[32];
+        csv_log_timestr( timestr, sizeof( timestr ) );
+        snprintf( default_path, sizeof( default_path ), "engine-bench-%s.json", timestr );
+        path = default_path;
+    }
+
+    SMTC_HAL_TRACE_PRINTF( "Engine benchmark over %.0f s, %u engine runs, CPU %.2f s user, %.2f s system\n",
+                           cpu.wall_s, ( unsigned ) bench_nb_runs, cpu.user_s, cpu.sys_s );
+    SMTC_HAL_TRACE_PRINTF( "Engine benchmark saw %u joins and %u uplinks\n", ( unsigned ) bench_nb_joins,
+                           ( unsigned ) bench_nb_txdone );
+    bench_stats_add( "engine_run", bench_samples, MIN( bench_nb_runs, BENCH_STATS_MAX_SAMPLES ), 0 );
+    bench_stats_set_cpu( &cpu );
+    if( bench_stats_write_json( path, bench_nb_runs ) == false )
+    {
+        exit( EXIT_FAILURE );
+    }
+    SMTC_HAL_TRACE_PRINTF( "Engine benchmark results written to %s\n", path );
+
+    if( bench_baseline_path != NULL )
+    {
+        nb_regressed = bench_stats_compare( bench_baseline_path, path, BENCH_STATS_DEFAULT_TOLERANCE_PCT,
+                                            BENCH_STATS_DEFAULT_TOLERANCE_US );
+    }
+    if( bench_nb_txdone == 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "Engine benchmark: no uplink sent, the device never joined the network server\n" );
+        exit( EXIT_FAILURE );
+    }
+    exit( ( nb_regressed == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+/**
+ * @brief Resumes the session stored in NVM instead of joining, when the rejoin policy allows it
+ *
+ * @remark The first uplink carries a LinkCheckReq, without an answer the session is dropped for a join
+ *
+ * @return true if the session was resumed
+ */
+static bool session_resume( void )
+{
+    lorawan_session_t stored;
+    const char*       reason;
+
+    if( lorawan_session_load( user_dev_eui, &stored ) == false )
+    {
+        SMTC_HAL_TRACE_INFO( "No stored session, joining\n" );
+        return false;
+    }
+    reason = lorawan_session_check( &session_policy, &stored );
+    if( reason != NULL )
+    {
+        SMTC_HAL_TRACE_INFO( "Stored session not resumed (%s), joining\n", reason );
+        lorawan_session_invalidate( );
+        return false;
+    }
+
+    lr1_stack_mac_t* mac = lorawan_api_stack_mac_get( STACK_ID );
+    if( mac == NULL )
+    {
+        return false;
+    }
+
+    // Uplinks sent after the last save, or cut before their TX done, may have used the next counters
+    stored.fcnt_up += session_policy.save_every + LORAWAN_SESSION_FCNT_MARGIN;
+
+    mac->dev_addr         = stored.dev_addr;
+    mac->fcnt_up          = stored.fcnt_up;
+    mac->nfcnt_dwn        = stored.nfcnt_dwn;
+    mac->afcnt_dwn        = stored.afcnt_dwn;
+    mac->rx1_dr_offset    = stored.rx1_dr_offset;
+    mac->rx2_data_rate    = stored.rx2_data_rate;
+    mac->rx2_frequency    = stored.rx2_frequency;
+    mac->rx1_delay_s      = stored.rx1_delay_s;
+    mac->tx_data_rate_adr = stored.tx_data_rate_adr;
+    mac->tx_power         = stored.tx_power;
+    mac->join_status      = JOINED;
+
+    session         = stored;
+    session_valid   = true;
+    session_unsaved = 0;
+    session_resumed = true;
+    session_start   = "resumed";
+    lorawan_session_save( &session );
+    hal_startup_mark( HAL_STARTUP_PHASE_RESUMED );
+
+    stats_shm_t* stats = stats_shm_begin( );
+    if( stats != NULL )
+    {
+        stats->joined   = 1;
+        stats->dev_addr = stored.dev_addr;
+        stats_shm_end( );
+    }
+
+    SMTC_HAL_TRACE_INFO( "Session resumed: DevAddr %08lX, FCntUp %lu, joined %lld s ago\n",
+                         ( unsigned long ) stored.dev_addr, ( unsigned long ) stored.fcnt_up,
+                         ( long long ) ( ( int64_t ) time( NULL ) - stored.joined_at_s ) );
+    {
+        char extra[128];
+        snprintf( extra, sizeof( extra ), "{\"dev_addr\" : \"%08lX\", \"fcnt_up\" : \"%lu\"}",
+                  ( unsigned long ) stored.dev_addr, ( unsigned long ) stored.fcnt_up );
+        csv_log_write_row( user_dev_eui, "RESUMED", NULL, 0, "", extra );
+    }
+
+    // Same start as after a join
+    ASSERT_SMTC_MODEM_RC( smtc_modem_lorawan_request_link_check( STACK_ID ) );
+    clock_drift_request_time( );
+    send_uplink_counter_on_port( 101 );
+    ASSERT_SMTC_MODEM_RC( smtc_modem_alarm_start_timer( g_uplink_period_s ) );
+    return true;
+}
+
+/**
+ * @brief Copies the MAC session state and stores it every session.save_every uplinks, or at once after a join
+ *
+ * @param [in] joined true when called for a new join
+ */
+static void session_capture( const bool joined )
+{
+    const char* reason;
+
+    if( session_policy.resume == false )
+    {
+        return;
+    }
+
+    lr1_stack_mac_t* mac = lorawan_api_stack_mac_get( STACK_ID );
+    if( mac == NULL )
+    {
+        return;
+    }
+
+    if( joined == true )
+    {
+        memcpy( session.dev_eui, user_dev_eui, sizeof( session.dev_eui ) );
+        session.joined_at_s = ( int64_t ) time( NULL );
+        session_valid       = true;
+        session_resumed     = false;
+
+        // The session keys are derived into the secure element, which must outlive a restart too
+        smtc_secure_element_store_context( STACK_ID );
+    }
+    else if( session_valid == false )
+    {
+        return;
+    }
+
+    session.dev_addr         = mac->dev_addr;
+    session.fcnt_up          = mac->fcnt_up;
+    session.nfcnt_dwn        = mac->nfcnt_dwn;
+    session.afcnt_dwn        = mac->afcnt_dwn;
+    session.rx1_dr_offset    = mac->rx1_dr_offset;
+    session.rx2_data_rate    = mac->rx2_data_rate;
+    session.rx2_frequency    = mac->rx2_frequency;
+    session.rx1_delay_s      = mac->rx1_delay_s;
+    session.tx_data_rate_adr = mac->tx_data_rate_adr;
+    session.tx_power         = mac->tx_power;
+
+    reason = lorawan_session_check( &session_policy, &session );
+    if( reason != NULL )
+    {
+        session_rejoin( reason );
+        return;
+    }
+
+    if( ( joined == true ) || ( ++session_unsaved >= session_policy.save_every ) )
+    {
+        lorawan_session_save( &session );
+        session_unsaved = 0;
+    }
+}
+
+/**
+ * @brief Drops the current session, stored one included, and joins again
+ *
+ * @param [in] reason Rejoin reason, traced
+ */
+static void session_rejoin( const char* reason )
+{
+    SMTC_HAL_TRACE_WARNING( "Rejoining: %s\n", reason );
+
+    session_valid   = false;
+    session_resumed = false;
+    lorawan_session_invalidate( );
+
+    smtc_modem_alarm_clear_timer( );
+    ASSERT_SMTC_MODEM_RC( smtc_modem_leave_network( STACK_ID ) );
+    ASSERT_SMTC_MODEM_RC( smtc_modem_join_network( STACK_ID ) );
+}
+
+/**
+ * @brief Logs, once, the startup phases up to the end of the first uplink
+ */
+static void session_report_first_uplink( void )
+{
+    char               extra[768];
+    supervisor_stats_t restarts;
+
+    if( first_uplink_reported == true )
+    {
+        return;
+    }
+    first_uplink_reported = true;
+
+    hal_startup_mark( HAL_STARTUP_PHASE_FIRST_TXDONE );
+    SMTC_HAL_TRACE_INFO( "Startup to first uplink: %.0f ms (session %s)\n",
+                         hal_startup_get_us( HAL_STARTUP_PHASE_FIRST_TXDONE ) / 1000.0, session_start );
+    hal_startup_print( );
+
+    // Phase times object, with the session start and the restart counters appended
+    supervisor_get_stats( &restarts );
+    const int len = hal_startup_format_json( extra, sizeof( extra ) );
+    if( ( len >= 2 ) && ( ( size_t ) len < sizeof( extra ) ) )
+    {
+        snprintf( extra + len - 1, sizeof( extra ) - ( len - 1 ),
+                  ", \"session\" : \"%s\", \"restarts\" : \"%lu\", \"faults_per_h\" : \"%.1f\", "
+                  "\"safe_mode\" : \"%d\", \"last_cause\" : \"%s\"}",
+                  session_start, ( unsigned long ) restarts.restarts_total, restarts.faults_per_h,
+                  restarts.safe_mode ? 1 : 0, restarts.last_cause );
+    }
+    csv_log_write_row( user_dev_eui, "STARTUP", NULL, 0, "", extra );
+}
+
+/**
+ * @brief Maps the stats page and publishes the restart counters of the supervisor
+ */
+static void stats_init( void )
+{
+    supervisor_stats_t restarts;
+    stats_shm_t*       stats;
+
+    stats_enabled = ( stats_shm_init( ) == 0 );
+    stats         = stats_shm_begin( );
+    if( stats == NULL )
+    {
+        return;
+    }
+    supervisor_get_stats( &restarts );
+    stats->restarts  = restarts.restarts_total;
+    stats->safe_mode = restarts.safe_mode ? 1 : 0;
+    stats_shm_end( );
+}
+
+/**
+ * @brief Publishes the run time of one engine call and the radio state it left
+ */
+static void stats_engine_sample( const uint64_t start_us )
+{
+    stats_shm_t* stats = stats_shm_begin( );
+
+    if( stats == NULL )
+    {
+        return;
+    }
+    stats_shm_hist_add( &stats->engine_run_us, ( uint32_t ) ( engine_now_us( ) - start_us ) );
+    stats->radio_state = ( uint8_t ) radio_state_time_get_state( );
+    stats_shm_end( );
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -40,8 +40,12 @@
 #include <stdbool.h>  // bool type
 #include <string.h>
 #include <stdlib.h>  // abs function
+#include <stdio.h>
+#include <time.h>
 
 #include "main.h"
+#include "bench_stats.h"
+#include "csv_log.h"
 
 #include "smtc_modem_api.h"
 #include "smtc_modem_utilities.h"
@@ -53,12 +57,17 @@
 
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_gpio.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_board_profile.h"
 
 #if defined( SX127X )
 #include "ralf_sx127x.h"
 #include "sx127x.h"
+#include "ral_sx127x_bsp.h"
 #endif
 
+#include "radio_utilities.h"
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -66,9 +75,15 @@
 
 // !! SHOULD BE DEFINED BY USER !!
 #define ENABLE_TEST_FLASH 0  // Enable flash porting test BUT disable other porting tests
+#ifndef ENABLE_TEST_TX_POWER_CAL
+#define ENABLE_TEST_TX_POWER_CAL 0  // Run the interactive TX power calibration after the porting tests
+#endif
+#ifndef ENABLE_TEST_BOARD_DELAY_STORE
+#define ENABLE_TEST_BOARD_DELAY_STORE 0  // Store the measured board delay in the board profile overlay
+#endif
 
-#define NB_LOOP_TEST_SPI 2
-#define NB_LOOP_TEST_CONFIG_RADIO 2
+// Timing tests run g_bench_iterations times, see bench_stats.h
+#define NB_LOOP_TEST_BOARD_DELAY 20
 
 #if defined( SX1276 )
 #define SX127X_VERSION 0x12
@@ -81,6 +96,14 @@
 #define MARGIN_TIMER_IRQ_IN_MS 2
 #define MARGIN_TIME_CONFIG_RADIO_IN_MS 8
 #define MARGIN_SLEEP_IN_MS 2
+#define MARGIN_DEFERRED_IRQ_IN_MS 10
+
+#define BOARD_DELAY_TIMER_IN_MS 50
+#define BOARD_DELAY_TIMEOUT_IN_MS 200
+
+#define TX_POWER_CAL_TARGET_DBM 14
+#define TX_POWER_CAL_FREQS_IN_HZ \
+    { 863100000, 864100000, 865100000, 866100000, 867100000, 868100000, 868500000, 869525000, 869900000 }
 
 #define PORTING_TEST_MSG_OK( )                                \
     do                                                        \
@@ -138,6 +161,12 @@ static volatile bool     timer_irq_raised      = false;
 static volatile uint32_t radio_irq_time_ms     = 0;
 static volatile uint32_t radio_irq_time_s      = 0;
 static volatile uint32_t timer_irq_time_ms     = 0;
+static volatile uint64_t board_delay_rx_time_us = 0;
+static volatile uint64_t radio_irq_time_us      = 0;
+static volatile uint64_t timer_irq_time_us      = 0;
+
+static uint32_t bench_iterations = 1;
+static double   bench_samples[BENCH_STATS_MAX_SAMPLES];
 
 // LoRa configurations TO NOT receive or transmit
 static ralf_params_lora_t rx_lora_param = { .sync_word                       = SYNC_WORD_NO_RADIO,
@@ -179,10 +208,13 @@ static void radio_tx_irq_callback( void* obj );
 static void radio_rx_irq_callback( void* obj );
 static void radio_irq_callback_get_time_in_s( void* obj );
 static void timer_irq_callback( void* obj );
+static void board_delay_timer_callback( void* obj );
+static uint64_t porting_test_get_time_in_us( void );
+static void     porting_test_bench_report( void );
 
 static bool               reset_init_radio( void );
 static return_code_test_t test_get_time_in_s( void );
-static return_code_test_t test_get_time_in_ms( void );
+static return_code_test_t test_get_time_in_ms( uint32_t* time_ms, uint32_t* expected_ms );
 
 static bool porting_test_spi( void );
 static bool porting_test_radio_irq( void );
@@ -193,8 +225,12 @@ static bool porting_test_disable_enable_irq( void );
 static bool porting_test_random( void );
 static bool porting_test_config_rx_radio( void );
 static bool porting_test_config_tx_radio( void );
+static bool porting_test_board_delay( void );
 static bool porting_test_sleep_ms( void );
 static bool porting_test_timer_irq_low_power( void );
+#if ( ENABLE_TEST_TX_POWER_CAL != 0 )
+static bool porting_test_tx_power_cal( void );
+#endif
 #if ( ENABLE_TEST_FLASH != 0 )
 static bool test_context_store_restore( modem_context_type_t context_type );
 static bool porting_test_flash( void );
@@ -212,6 +248,16 @@ void main_porting_tests( void )
 {
     bool ret = true;
 
+    if( g_bench_compare_only == true )
+    {
+        const int nb_regressed = bench_stats_compare( g_bench_baseline_path, g_bench_results_path,
+                                                      BENCH_STATS_DEFAULT_TOLERANCE_PCT,
+                                                      BENCH_STATS_DEFAULT_TOLERANCE_US );
+        exit( ( nb_regressed == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE );
+    }
+
+    bench_iterations = ( g_bench_iterations > BENCH_STATS_MAX_SAMPLES ) ? BENCH_STATS_MAX_SAMPLES : g_bench_iterations;
+
     // Configure all the µC periph (clock, gpio, timer, ...)
     hal_mcu_init( );
 
@@ -225,19 +271,30 @@ void main_porting_tests( void )
 
 #if ( ENABLE_TEST_FLASH == 0 )
 
+    SMTC_HAL_TRACE_PRINTF( "Timing tests run %u times\n", ( unsigned ) bench_iterations );
+
     ret = porting_test_spi( );
     if( ret == false )
+    {
+        porting_test_bench_report( );
         return;
+    }
 
     ret = porting_test_radio_irq( );
     if( ret == false )
+    {
+        porting_test_bench_report( );
         return;
+    }
 
     ret = porting_test_get_time( );
 
     ret = porting_test_timer_irq( );
     if( ret == false )
+    {
+        porting_test_bench_report( );
         return;
+    }
 
     porting_test_stop_timer( );
 
@@ -249,10 +306,18 @@ void main_porting_tests( void )
 
     porting_test_config_tx_radio( );
 
+    porting_test_board_delay( );
+
     porting_test_sleep_ms( );
 
     porting_test_timer_irq_low_power( );
 
+#if ( ENABLE_TEST_TX_POWER_CAL != 0 )
+    porting_test_tx_power_cal( );
+#endif
+
+    porting_test_bench_report( );
+
 #else
 
     ret = porting_test_flash( );
@@ -307,13 +372,15 @@ static bool porting_test_spi( void )
     // Reset radio (prerequisite)
     ral_reset( &( modem_radio.ral ) );
 
-    for( uint16_t i = 0; i < NB_LOOP_TEST_SPI; i++ )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
 #if defined( SX127X )
         uint8_t         chip_version;
         sx127x_status_t status;
 
-        status = sx127x_read_register( NULL, SX127X_REG_COMMON_VERSION, &chip_version, 1 );
+        const uint64_t start_us = porting_test_get_time_in_us( );
+        status                  = sx127x_read_register( NULL, SX127X_REG_COMMON_VERSION, &chip_version, 1 );
+        bench_samples[i]        = ( double ) ( porting_test_get_time_in_us( ) - start_us );
 
         if( status == SX127X_STATUS_OK )
         {
@@ -338,10 +405,12 @@ static bool porting_test_spi( void )
     if( counter_nok == 0 )
     {
         PORTING_TEST_MSG_OK( );
+        SMTC_HAL_TRACE_PRINTF( " Radio ready %u us after reset\n", radio_utilities_get_reset_ready_time_us( ) );
     }
-    else
+    bench_stats_add( "spi_read", bench_samples, bench_iterations, counter_nok );
+    if( counter_nok != 0 )
     {
-        PORTING_TEST_MSG_WARN( " Failed test = %u / %u \n", counter_nok, NB_LOOP_TEST_SPI );
+        PORTING_TEST_MSG_WARN( " Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
         return false;
     }
 
@@ -461,25 +530,41 @@ static bool porting_test_radio_irq( void )
         return false;
     }
 
-    // Configure radio in reception mode
-    if( ral_set_rx( &( modem_radio.ral ), rx_timeout_in_ms ) != RAL_STATUS_OK )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
-        PORTING_TEST_MSG_NOK( " ral_set_rx() function failed \n" );
-        return false;
-    }
+        radio_irq_raised = false;
 
-    // Wait 2 * timeout
-    hal_mcu_wait_us( ( rx_timeout_in_ms * 2 ) * 1000 );
+        // The irq callback stops the TCXO
+        smtc_modem_hal_start_radio_tcxo( );
 
-    if( radio_irq_raised == true )
-    {
-        PORTING_TEST_MSG_OK( );
-    }
-    else
-    {
-        PORTING_TEST_MSG_NOK( " Timeout, radio irq not received \n" );
-        return false;
+        // Configure radio in reception mode
+        const uint64_t start_us = porting_test_get_time_in_us( );
+        if( ral_set_rx( &( modem_radio.ral ), rx_timeout_in_ms ) != RAL_STATUS_OK )
+        {
+            PORTING_TEST_MSG_NOK( " ral_set_rx() function failed \n" );
+            return false;
+        }
+
+        // Wait up to 2 * timeout
+        const uint64_t expiry_us = start_us + rx_timeout_in_ms * 1000;
+        while( ( radio_irq_raised == false ) &&
+               ( porting_test_get_time_in_us( ) < expiry_us + rx_timeout_in_ms * 1000 ) )
+        {
+            hal_mcu_wait_us( 100 );
+        }
+
+        if( radio_irq_raised == false )
+        {
+            PORTING_TEST_MSG_NOK( " Timeout, radio irq not received \n" );
+            return false;
+        }
+
+        // Latency from the programmed RX timeout to the irq callback
+        bench_samples[i] = ( radio_irq_time_us > expiry_us ) ? ( double ) ( radio_irq_time_us - expiry_us ) : 0.0;
     }
+
+    PORTING_TEST_MSG_OK( );
+    bench_stats_add( "radio_irq", bench_samples, bench_iterations, 0 );
     return true;
 }
 
@@ -583,21 +668,22 @@ static return_code_test_t test_get_time_in_s( void )
  * - Get start time
  * - Configure radio in reception mode
  * - Wait radio irq (get stop time in irq callback)
- * - Check if time is coherent with the configured timeout symbol number
+ * - Return the measured time, the caller checks it against the configured timeout symbol number
  * Note: if radio irq received different of rx timeout irq -> relaunch test
  *
  * Ported functions:
  * smtc_modem_hal_get_time_in_ms
  *      hal_rtc_get_time_ms
  *
+ * @param [out] time_ms     Time measured between RX start and the RX timeout irq
+ * @param [out] expected_ms Configured timeout
+ *
  * @return return_code_test_t   RC_PORTING_TEST_OK
  *                              RC_PORTING_TEST_NOK
  *                              RC_PORTING_TEST_RELAUNCH
  */
-static return_code_test_t test_get_time_in_ms( void )
+static return_code_test_t test_get_time_in_ms( uint32_t* time_ms, uint32_t* expected_ms )
 {
-    SMTC_HAL_TRACE_MSG( " * Get time in millisecond: " );
-
     bool ret              = true;
     radio_irq_raised      = false;
     irq_rx_timeout_raised = false;
@@ -660,19 +746,8 @@ static return_code_test_t test_get_time_in_ms( void )
         return RC_PORTING_TEST_RELAUNCH;
     }
 
-    uint32_t time = radio_irq_time_ms - start_time_ms - smtc_modem_hal_get_radio_tcxo_startup_delay_ms( );
-    if( abs( time - symb_time_ms ) <= MARGIN_GET_TIME_IN_MS )
-    {
-        PORTING_TEST_MSG_OK( );
-        SMTC_HAL_TRACE_PRINTF( " Time expected %ums / get %ums (margin +/-%ums) \n", ( uint32_t ) symb_time_ms, time,
-                               MARGIN_GET_TIME_IN_MS );
-    }
-    else
-    {
-        PORTING_TEST_MSG_NOK( " Time is not coherent with radio irq : expected %ums / get %ums (margin +/-%ums) \n",
-                              ( uint32_t ) symb_time_ms, time, MARGIN_GET_TIME_IN_MS );
-        return RC_PORTING_TEST_NOK;
-    }
+    *time_ms     = radio_irq_time_ms - start_time_ms - smtc_modem_hal_get_radio_tcxo_startup_delay_ms( );
+    *expected_ms = symb_time_ms;
 
     return RC_PORTING_TEST_OK;
 }
@@ -697,14 +772,46 @@ static bool porting_test_get_time( void )
             return false;
     } while( ret == RC_PORTING_TEST_RELAUNCH );
 
-    do
+    SMTC_HAL_TRACE_MSG( " * Get time in millisecond: " );
+
+    uint16_t counter_nok = 0;
+    uint32_t time        = 0;
+    uint32_t expected    = 0;
+
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
-        ret = test_get_time_in_ms( );
-        if( ret == RC_PORTING_TEST_NOK )
-            return false;
-    } while( ret == RC_PORTING_TEST_RELAUNCH );
+        do
+        {
+            ret = test_get_time_in_ms( &time, &expected );
+            if( ret == RC_PORTING_TEST_NOK )
+                return false;
+        } while( ret == RC_PORTING_TEST_RELAUNCH );
+
+        const uint32_t error_ms = ( uint32_t ) abs( ( int32_t ) ( time - expected ) );
+        bench_samples[i]        = error_ms * 1000.0;
+        if( error_ms > MARGIN_GET_TIME_IN_MS )
+        {
+            PORTING_TEST_MSG_NOK( " Time is not coherent with radio irq : expected %ums / get %ums (margin +/-%ums) \n",
+                                  expected, time, MARGIN_GET_TIME_IN_MS );
+            counter_nok++;
+        }
+    }
 
-    return true;
+    if( counter_nok == 0 )
+    {
+        PORTING_TEST_MSG_OK( );
+        SMTC_HAL_TRACE_PRINTF( " Time expected %ums / get %ums (margin +/-%ums) \n", expected, time,
+                               MARGIN_GET_TIME_IN_MS );
+    }
+    else
+    {
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
+    }
+
+    // Error of the ms time base against the radio symbol timeout, 1 ms resolution
+    bench_stats_add( "get_time_ms_error", bench_samples, bench_iterations, counter_nok );
+
+    return counter_nok == 0;
 }
 
 /**
@@ -732,37 +839,54 @@ static bool porting_test_timer_irq( void )
     uint32_t timer_ms      = 3000;
     uint8_t  wait_start_ms = 5;
     uint16_t timeout_ms    = 2000;
-    timer_irq_raised       = false;
+    uint16_t counter_nok   = 0;
+    uint32_t time          = 0;
 
-    smtc_modem_hal_stop_timer( );
+    for( uint32_t i = 0; i < bench_iterations; i++ )
+    {
+        timer_irq_raised = false;
 
-    // Wait 5ms to start
-    uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
+        smtc_modem_hal_stop_timer( );
 
-    while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
-    {
-        // Do nothing
-    }
+        // Wait 5ms to start
+        uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
 
-    smtc_modem_hal_start_timer( timer_ms, timer_irq_callback,
-                                NULL );  // Warning this function takes ~3,69 ms for STM32L4
+        while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
+        {
+            // Do nothing
+        }
 
-    // Timeout if irq not raised
-    while( ( timer_irq_raised == false ) &&
-           ( ( smtc_modem_hal_get_time_in_ms( ) - start_time_ms ) < ( timer_ms + timeout_ms ) ) )
-    {
-        // Do nothing
-    }
+        const uint64_t start_us = porting_test_get_time_in_us( );
+        smtc_modem_hal_start_timer( timer_ms, timer_irq_callback,
+                                    NULL );  // Warning this function takes ~3,69 ms for STM32L4
 
-    if( timer_irq_raised == false )
-    {
-        PORTING_TEST_MSG_NOK( " Timeout: timer irq not received \n" );
-        return false;
-    }
+        // Timeout if irq not raised
+        while( ( timer_irq_raised == false ) &&
+               ( ( smtc_modem_hal_get_time_in_ms( ) - start_time_ms ) < ( timer_ms + timeout_ms ) ) )
+        {
+            // Do nothing
+        }
+
+        if( timer_irq_raised == false )
+        {
+            PORTING_TEST_MSG_NOK( " Timeout: timer irq not received \n" );
+            return false;
+        }
 
-    uint32_t time = timer_irq_time_ms - start_time_ms;
+        // Latency from the programmed expiry to the irq callback
+        const uint64_t expiry_us = start_us + timer_ms * 1000;
+        bench_samples[i] = ( timer_irq_time_us > expiry_us ) ? ( double ) ( timer_irq_time_us - expiry_us ) : 0.0;
+
+        time = timer_irq_time_ms - start_time_ms;
+        if( ( time < timer_ms ) || ( time > timer_ms + MARGIN_TIMER_IRQ_IN_MS ) )
+        {
+            PORTING_TEST_MSG_NOK( " Timer irq delay is not coherent: expected %ums / get %ums (margin +%ums) \n",
+                                  timer_ms, time, MARGIN_TIMER_IRQ_IN_MS );
+            counter_nok++;
+        }
+    }
 
-    if( ( time >= timer_ms ) && ( time <= timer_ms + MARGIN_TIMER_IRQ_IN_MS ) )
+    if( counter_nok == 0 )
     {
         PORTING_TEST_MSG_OK( );
         SMTC_HAL_TRACE_PRINTF( " Timer irq configured with %ums / get %ums (margin +%ums) \n", timer_ms, time,
@@ -770,11 +894,12 @@ static bool porting_test_timer_irq( void )
     }
     else
     {
-        PORTING_TEST_MSG_NOK( " Timer irq delay is not coherent: expected %ums / get %ums (margin +%ums) \n", timer_ms,
-                              time, MARGIN_TIMER_IRQ_IN_MS );
-        return false;
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
     }
-    return true;
+
+    bench_stats_add( "timer_irq", bench_samples, bench_iterations, counter_nok );
+
+    return counter_nok == 0;
 }
 
 /**
@@ -841,7 +966,7 @@ static bool porting_test_stop_timer( void )
  * - Wait the end of timer
  * - Check if timer irq is not raised
  * - Enable irq
- * - Check if timer irq is raised
+ * - Check if timer irq is raised (within MARGIN_DEFERRED_IRQ_IN_MS)
  *
  * Ported functions:
  * smtc_modem_hal_disable_modem_irq
@@ -875,6 +1000,14 @@ static bool porting_test_disable_enable_irq( void )
 
     smtc_modem_hal_enable_modem_irq( );
 
+    // Pending irqs are re-posted to the IRQ dispatcher on enable, give it a moment to run them
+    time = smtc_modem_hal_get_time_in_ms( );
+    while( ( timer_irq_raised == false ) &&
+           ( ( smtc_modem_hal_get_time_in_ms( ) - time ) < MARGIN_DEFERRED_IRQ_IN_MS ) )
+    {
+        // Do nothing
+    }
+
     if( timer_irq_raised == true )
     {
         PORTING_TEST_MSG_OK( );
@@ -1019,11 +1152,12 @@ static bool porting_test_config_rx_radio( void )
 
     smtc_modem_hal_irq_config_radio_irq( radio_rx_irq_callback, NULL );
 
-    for( uint16_t i = 0; i < NB_LOOP_TEST_CONFIG_RADIO; i++ )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
         radio_irq_raised = false;
 
-        uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( );
+        const uint64_t start_us      = porting_test_get_time_in_us( );
+        uint32_t       start_time_ms = smtc_modem_hal_get_time_in_ms( );
         // Setup radio and relative irq
         smtc_modem_hal_start_radio_tcxo( );
         smtc_modem_hal_set_ant_switch( false );
@@ -1047,7 +1181,8 @@ static bool porting_test_config_rx_radio( void )
         //     return false;
         // }
 
-        uint32_t time = smtc_modem_hal_get_time_in_ms( ) - start_time_ms;
+        uint32_t time    = smtc_modem_hal_get_time_in_ms( ) - start_time_ms;
+        bench_samples[i] = ( double ) ( porting_test_get_time_in_us( ) - start_us );
         if( time >= MARGIN_TIME_CONFIG_RADIO_IN_MS )
         {
             PORTING_TEST_MSG_NOK( " Configuration of rx radio is too long: %ums (margin +%ums) \n", time,
@@ -1068,9 +1203,11 @@ static bool porting_test_config_rx_radio( void )
     }
     else
     {
-        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, NB_LOOP_TEST_CONFIG_RADIO );
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
     }
 
+    bench_stats_add( "config_rx", bench_samples, bench_iterations, counter_nok );
+
     return true;
 }
 
@@ -1105,11 +1242,12 @@ static bool porting_test_config_tx_radio( void )
     // Setup radio and relative irq
     smtc_modem_hal_irq_config_radio_irq( radio_tx_irq_callback, NULL );
 
-    for( uint16_t i = 0; i < NB_LOOP_TEST_CONFIG_RADIO; i++ )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
         radio_irq_raised = false;
 
-        uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( );
+        const uint64_t start_us      = porting_test_get_time_in_us( );
+        uint32_t       start_time_ms = smtc_modem_hal_get_time_in_ms( );
 
         smtc_modem_hal_start_radio_tcxo( );
         smtc_modem_hal_set_ant_switch( true );
@@ -1136,7 +1274,8 @@ static bool porting_test_config_tx_radio( void )
         //     return false;
         // }
 
-        uint32_t time = smtc_modem_hal_get_time_in_ms( ) - start_time_ms;
+        uint32_t time    = smtc_modem_hal_get_time_in_ms( ) - start_time_ms;
+        bench_samples[i] = ( double ) ( porting_test_get_time_in_us( ) - start_us );
         if( time >= MARGIN_TIME_CONFIG_RADIO_IN_MS )
         {
             PORTING_TEST_MSG_NOK( " Configuration of tx radio is too long: %ums (margin +%ums) \n", time,
@@ -1157,9 +1296,205 @@ static bool porting_test_config_tx_radio( void )
     }
     else
     {
-        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, NB_LOOP_TEST_CONFIG_RADIO );
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
+    }
+
+    bench_stats_add( "config_tx", bench_samples, bench_iterations, counter_nok );
+
+    return true;
+}
+
+#if ( ENABLE_TEST_TX_POWER_CAL != 0 )
+/**
+ * @brief Build the per-frequency TX power calibration table
+ *
+ * @remark
+ * Test processing:
+ * - For each frequency of TX_POWER_CAL_FREQS_IN_HZ, transmit a continuous wave at TX_POWER_CAL_TARGET_DBM
+ * - Ask for the output power measured with a power meter or spectrum analyzer (empty line to skip)
+ * - Print the board profile lines, the new correction includes the one currently applied
+ *
+ * @return bool True if all frequencies were measured
+ */
+static bool porting_test_tx_power_cal( void )
+{
+    static const uint32_t freqs_in_hz[] = TX_POWER_CAL_FREQS_IN_HZ;
+    char                  table[2][512] = { "", "" };  // RFO, PA_BOOST
+    uint8_t               nb_skipped    = 0;
+
+    SMTC_HAL_TRACE_MSG( "----------------------------------------\n porting_test_tx_power_cal :\n" );
+
+    bool ret = reset_init_radio( );
+    if( ret == false )
+        return ret;
+
+    for( uint8_t i = 0; i < sizeof( freqs_in_hz ) / sizeof( freqs_in_hz[0] ); i++ )
+    {
+        // Get what the BSP configures, including the current calibration
+        ral_sx127x_bsp_tx_cfg_input_params_t  tx_cfg_in = { .freq_in_hz               = freqs_in_hz[i],
+                                                            .system_output_pwr_in_dbm = TX_POWER_CAL_TARGET_DBM };
+        ral_sx127x_bsp_tx_cfg_output_params_t tx_cfg_out;
+        ral_sx127x_bsp_get_tx_cfg( NULL, &tx_cfg_in, &tx_cfg_out );
+
+        const bool pa_boost   = tx_cfg_out.pa_cfg.pa_select == SX127X_PA_SELECT_BOOST;
+        const int  applied_db = tx_cfg_out.chip_output_pwr_in_dbm_configured - TX_POWER_CAL_TARGET_DBM -
+                               radio_utilities_get_tx_power_offset( );
+
+        ralf_params_lora_t cw_param = tx_lora_param;
+        cw_param.rf_freq_in_hz      = freqs_in_hz[i];
+        cw_param.output_pwr_in_dbm  = TX_POWER_CAL_TARGET_DBM;
+
+        smtc_modem_hal_start_radio_tcxo( );
+        smtc_modem_hal_set_ant_switch( true );
+        if( ( ralf_setup_lora( &modem_radio, &cw_param ) != RAL_STATUS_OK ) ||
+            ( ral_set_tx_cw( &( modem_radio.ral ) ) != RAL_STATUS_OK ) )
+        {
+            PORTING_TEST_MSG_NOK( " continuous wave setup failed \n" );
+            smtc_modem_hal_stop_radio_tcxo( );
+            return false;
+        }
+
+        SMTC_HAL_TRACE_PRINTF( " CW at %lu Hz, %s, %d dBm (correction %+d dB): measured dBm? ",
+                               ( unsigned long ) freqs_in_hz[i], pa_boost ? "PA_BOOST" : "RFO",
+                               TX_POWER_CAL_TARGET_DBM, applied_db );
+
+        char  line[32];
+        char* end      = line;
+        float measured = 0.0f;
+        if( fgets( line, sizeof( line ), stdin ) != NULL )
+        {
+            measured = strtof( line, &end );
+        }
+
+        ral_set_sleep( &( modem_radio.ral ), true );
+        smtc_modem_hal_set_ant_switch( false );
+        smtc_modem_hal_stop_radio_tcxo( );
+
+        if( end == line )
+        {
+            nb_skipped++;
+            continue;
+        }
+
+        char*  dst = table[pa_boost ? 1 : 0];
+        size_t len = strlen( dst );
+        snprintf( dst + len, sizeof( table[0] ) - len, "%s%lu:%.1f", ( len == 0 ) ? "" : ", ",
+                  ( unsigned long ) ( freqs_in_hz[i] / 1000 ), applied_db + TX_POWER_CAL_TARGET_DBM - measured );
+    }
+
+    SMTC_HAL_TRACE_MSG( " Board profile lines:\n" );
+    if( table[0][0] != '\0' )
+    {
+        SMTC_HAL_TRACE_PRINTF( "radio.tx_power_cal_rfo_db = %s\n", table[0] );
+    }
+    if( table[1][0] != '\0' )
+    {
+        SMTC_HAL_TRACE_PRINTF( "radio.tx_power_cal_boost_db = %s\n", table[1] );
+    }
+
+    if( nb_skipped == 0 )
+    {
+        PORTING_TEST_MSG_OK( );
+    }
+    else
+    {
+        PORTING_TEST_MSG_WARN( " => Skipped frequencies = %u / %u \n", nb_skipped,
+                               ( unsigned ) ( sizeof( freqs_in_hz ) / sizeof( freqs_in_hz[0] ) ) );
     }
 
+    return nb_skipped == 0;
+}
+#endif
+
+/**
+ * @brief Measure and, with ENABLE_TEST_BOARD_DELAY_STORE, store the board delay
+ *
+ * @remark
+ * Test processing:
+ * - Start a timer and, on its expiry, configure the radio and set it in RX as the modem does to open an RX window
+ * - Measure the time from the expected timer expiry to the radio set in RX
+ * - With ENABLE_TEST_BOARD_DELAY_STORE, store the worst case, rounded up to the ms, as radio.board_delay_ms in the
+ *   board profile overlay
+ *
+ * Ported functions:
+ * smtc_modem_hal_get_board_delay_ms
+ *
+ * @return bool True if the delay was measured, and stored when enabled
+ */
+static bool porting_test_board_delay( void )
+{
+    SMTC_HAL_TRACE_MSG( "----------------------------------------\n porting_test_board_delay :" );
+
+    uint64_t max_delay_us = 0;
+    uint64_t sum_delay_us = 0;
+
+    bool ret = reset_init_radio( );
+    if( ret == false )
+        return ret;
+
+    smtc_modem_hal_irq_config_radio_irq( radio_rx_irq_callback, NULL );
+
+    for( uint16_t i = 0; i < NB_LOOP_TEST_BOARD_DELAY; i++ )
+    {
+        board_delay_rx_time_us = 0;
+
+        const uint64_t expiry_us = porting_test_get_time_in_us( ) + BOARD_DELAY_TIMER_IN_MS * 1000;
+        smtc_modem_hal_start_timer( BOARD_DELAY_TIMER_IN_MS, board_delay_timer_callback, NULL );
+
+        // Wait for the timer and the radio configuration
+        while( ( board_delay_rx_time_us == 0 ) &&
+               ( porting_test_get_time_in_us( ) < expiry_us + BOARD_DELAY_TIMEOUT_IN_MS * 1000 ) )
+        {
+            hal_mcu_wait_us( 200 );
+        }
+
+        ral_set_sleep( &( modem_radio.ral ), true );
+        smtc_modem_hal_stop_radio_tcxo( );
+
+        if( board_delay_rx_time_us == 0 )
+        {
+            PORTING_TEST_MSG_NOK( " Radio not set in RX after timer expiry \n" );
+            return false;
+        }
+
+        const uint64_t delay_us =
+            ( board_delay_rx_time_us > expiry_us ) ? ( board_delay_rx_time_us - expiry_us ) : 0;
+        sum_delay_us += delay_us;
+        bench_samples[i] = ( double ) delay_us;
+        if( delay_us > max_delay_us )
+        {
+            max_delay_us = delay_us;
+        }
+    }
+
+    const int32_t board_delay_ms = ( int32_t ) ( ( max_delay_us + 999 ) / 1000 );
+    bench_stats_add( "board_delay", bench_samples, NB_LOOP_TEST_BOARD_DELAY, 0 );
+
+#if ( ENABLE_TEST_BOARD_DELAY_STORE != 0 )
+    char value[12];
+    snprintf( value, sizeof( value ), "%ld", ( long ) board_delay_ms );
+
+    if( hal_board_profile_store( "radio.board_delay_ms", value ) == false )
+    {
+        PORTING_TEST_MSG_WARN( " Timer to RX delay: mean %lu us, max %lu us, board delay %ld ms NOT stored \n",
+                               ( unsigned long ) ( sum_delay_us / NB_LOOP_TEST_BOARD_DELAY ),
+                               ( unsigned long ) max_delay_us, ( long ) board_delay_ms );
+        return false;
+    }
+
+    PORTING_TEST_MSG_OK( );
+    SMTC_HAL_TRACE_PRINTF( " Timer to RX delay: mean %lu us, max %lu us, board delay %d ms stored in %s\n",
+                           ( unsigned long ) ( sum_delay_us / NB_LOOP_TEST_BOARD_DELAY ),
+                           ( unsigned long ) max_delay_us, smtc_modem_hal_get_board_delay_ms( ),
+                           hal_board_profile_get_overlay_path( ) );
+#else
+    PORTING_TEST_MSG_OK( );
+    SMTC_HAL_TRACE_PRINTF( " Timer to RX delay: mean %lu us, max %lu us, board delay %ld ms, current %d ms\n",
+                           ( unsigned long ) ( sum_delay_us / NB_LOOP_TEST_BOARD_DELAY ),
+                           ( unsigned long ) max_delay_us, ( long ) board_delay_ms,
+                           smtc_modem_hal_get_board_delay_ms( ) );
+#endif
+
     return true;
 }
 
@@ -1186,23 +1521,41 @@ static bool porting_test_sleep_ms( void )
 {
     SMTC_HAL_TRACE_MSG( "----------------------------------------\n porting_test_sleep_ms :" );
 
-    bool    ret           = true;
-    int32_t sleep_ms      = 2000;
-    uint8_t wait_start_ms = 5;
+    bool     ret           = true;
+    int32_t  sleep_ms      = 2000;
+    uint8_t  wait_start_ms = 5;
+    uint16_t counter_nok   = 0;
+    uint32_t time          = 0;
 
-    // Wait 5ms to start
-    uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
-    while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
-        // Do nothing
-    }
+        // Wait 5ms to start
+        uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
+        while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
+        {
+            // Do nothing
+        }
+
+        const uint64_t start_us = porting_test_get_time_in_us( );
+        hal_mcu_set_sleep_for_ms( sleep_ms );
+        const uint64_t slept_us = porting_test_get_time_in_us( ) - start_us;
 
-    hal_mcu_set_sleep_for_ms( sleep_ms );
+        uint32_t stop_time_ms = smtc_modem_hal_get_time_in_ms( );
+        time                  = stop_time_ms - start_time_ms;
 
-    uint32_t stop_time_ms = smtc_modem_hal_get_time_in_ms( );
-    uint32_t time         = stop_time_ms - start_time_ms;
+        // Absolute sleep error
+        const int64_t error_us = ( int64_t ) slept_us - ( int64_t ) sleep_ms * 1000;
+        bench_samples[i]       = ( double ) ( ( error_us < 0 ) ? -error_us : error_us );
 
-    if( abs( time - sleep_ms ) <= MARGIN_SLEEP_IN_MS )
+        if( abs( time - sleep_ms ) > MARGIN_SLEEP_IN_MS )
+        {
+            PORTING_TEST_MSG_WARN( "\n => Sleep time is not coherent: expected %ums / get %ums (margin +/-%ums) \n",
+                                   sleep_ms, time, MARGIN_SLEEP_IN_MS );
+            counter_nok++;
+        }
+    }
+
+    if( counter_nok == 0 )
     {
         PORTING_TEST_MSG_OK( );
         SMTC_HAL_TRACE_PRINTF( " Sleep time expected %ums / get %ums (margin +/-%ums) \n", sleep_ms, time,
@@ -1210,9 +1563,11 @@ static bool porting_test_sleep_ms( void )
     }
     else
     {
-        PORTING_TEST_MSG_WARN( "\n => Sleep time is not coherent: expected %ums / get %ums (margin +/-%ums) \n",
-                               sleep_ms, time, MARGIN_SLEEP_IN_MS );
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
     }
+
+    bench_stats_add( "sleep_error", bench_samples, bench_iterations, counter_nok );
+
     return ret;
 }
 
@@ -1242,30 +1597,47 @@ static bool porting_test_timer_irq_low_power( void )
     uint32_t timer_ms      = 3000;
     int32_t  sleep_ms      = timer_ms + 5000;
     uint8_t  wait_start_ms = 5;
-    timer_irq_raised       = false;
+    uint16_t counter_nok   = 0;
+    uint32_t time          = 0;
 
-    smtc_modem_hal_stop_timer( );
-
-    // Wait 5ms to start
-    uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
-    while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
+    for( uint32_t i = 0; i < bench_iterations; i++ )
     {
-        // Do nothing
-    }
+        timer_irq_raised = false;
 
-    smtc_modem_hal_start_timer( timer_ms, timer_irq_callback,
-                                NULL );  // Warning this function takes ~3,69 ms for STM32L4
+        smtc_modem_hal_stop_timer( );
 
-    hal_mcu_set_sleep_for_ms( sleep_ms );
+        // Wait 5ms to start
+        uint32_t start_time_ms = smtc_modem_hal_get_time_in_ms( ) + wait_start_ms;
+        while( smtc_modem_hal_get_time_in_ms( ) < start_time_ms )
+        {
+            // Do nothing
+        }
 
-    if( timer_irq_raised == false )
-    {
-        PORTING_TEST_MSG_NOK( " Timeout: timer irq not received \n" );
-        return false;
+        const uint64_t start_us = porting_test_get_time_in_us( );
+        smtc_modem_hal_start_timer( timer_ms, timer_irq_callback,
+                                    NULL );  // Warning this function takes ~3,69 ms for STM32L4
+
+        hal_mcu_set_sleep_for_ms( sleep_ms );
+
+        if( timer_irq_raised == false )
+        {
+            PORTING_TEST_MSG_NOK( " Timeout: timer irq not received \n" );
+            return false;
+        }
+
+        const uint64_t expiry_us = start_us + timer_ms * 1000;
+        bench_samples[i] = ( timer_irq_time_us > expiry_us ) ? ( double ) ( timer_irq_time_us - expiry_us ) : 0.0;
+
+        time = timer_irq_time_ms - start_time_ms;
+        if( ( time < timer_ms ) || ( time > timer_ms + MARGIN_TIMER_IRQ_IN_MS ) )
+        {
+            PORTING_TEST_MSG_NOK( " Timer irq delay is not coherent: expected %ums / get %ums (margin +%ums) \n",
+                                  timer_ms, time, MARGIN_TIMER_IRQ_IN_MS );
+            counter_nok++;
+        }
     }
 
-    uint32_t time = timer_irq_time_ms - start_time_ms;
-    if( ( time >= timer_ms ) && ( time <= timer_ms + MARGIN_TIMER_IRQ_IN_MS ) )
+    if( counter_nok == 0 )
     {
         PORTING_TEST_MSG_OK( );
         SMTC_HAL_TRACE_PRINTF( " Timer irq configured with %ums / get %ums (margin +%ums) \n", timer_ms, time,
@@ -1273,11 +1645,12 @@ static bool porting_test_timer_irq_low_power( void )
     }
     else
     {
-        PORTING_TEST_MSG_NOK( " Timer irq delay is not coherent: expected %ums / get %ums (margin +%ums) \n", timer_ms,
-                              time, MARGIN_TIMER_IRQ_IN_MS );
-        return false;
+        PORTING_TEST_MSG_WARN( " => Failed test = %u / %u \n", counter_nok, ( unsigned ) bench_iterations );
     }
-    return true;
+
+    bench_stats_add( "timer_irq_low_power", bench_samples, bench_iterations, counter_nok );
+
+    return counter_nok == 0;
 }
 
 /*
@@ -1456,6 +1829,7 @@ static void radio_rx_irq_callback( void* obj )
     UNUSED( obj );
 
     ral_irq_t radio_irq = 0;
+    radio_irq_time_us   = porting_test_get_time_in_us( );
     radio_irq_time_ms   = smtc_modem_hal_get_time_in_ms( );
     radio_irq_raised    = true;
 
@@ -1514,8 +1888,69 @@ static void radio_irq_callback_get_time_in_s( void* obj )
 static void timer_irq_callback( void* obj )
 {
     UNUSED( obj );
+    timer_irq_time_us = porting_test_get_time_in_us( );
     timer_irq_time_ms = smtc_modem_hal_get_time_in_ms( );
     timer_irq_raised  = true;
 }
 
+static void board_delay_timer_callback( void* obj )
+{
+    UNUSED( obj );
+
+    // Same sequence as the modem opening an RX window
+    smtc_modem_hal_start_radio_tcxo( );
+    smtc_modem_hal_set_ant_switch( false );
+    if( ( ralf_setup_lora( &modem_radio, &rx_lora_param ) != RAL_STATUS_OK ) ||
+        ( ral_set_dio_irq_params( &( modem_radio.ral ), RAL_IRQ_RX_DONE | RAL_IRQ_RX_TIMEOUT | RAL_IRQ_RX_HDR_ERROR |
+                                                            RAL_IRQ_RX_CRC_ERROR ) != RAL_STATUS_OK ) ||
+        ( ral_set_rx( &( modem_radio.ral ), 100 ) != RAL_STATUS_OK ) )
+    {
+        return;
+    }
+    board_delay_rx_time_us = porting_test_get_time_in_us( );
+}
+
+static uint64_t porting_test_get_time_in_us( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+/**
+ * @brief Write the timing results and compare them to the baseline, if any
+ *
+ * @remark The process exits with EXIT_FAILURE when a test regressed
+ */
+static void porting_test_bench_report( void )
+{
+    char        default_path[64];
+    const char* path = g_bench_results_path;
+
+    if( path == NULL )
+    {
+        char timestr[32];
+        csv_log_timestr( timestr, sizeof( timestr ) );
+        snprintf( default_path, sizeof( default_path ), "porting-tests-%s.json", timestr );
+        path = default_path;
+    }
+
+    if( bench_stats_write_json( path, bench_iterations ) == false )
+    {
+        return;
+    }
+    SMTC_HAL_TRACE_PRINTF( "Timing results written to %s\n", path );
+
+    if( g_bench_baseline_path != NULL )
+    {
+        const int nb_regressed = bench_stats_compare( g_bench_baseline_path, path, BENCH_STATS_DEFAULT_TOLERANCE_PCT,
+                                                      BENCH_STATS_DEFAULT_TOLERANCE_US );
+        if( nb_regressed != 0 )
+        {
+            exit( EXIT_FAILURE );
+        }
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
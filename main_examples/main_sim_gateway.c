@@ -0,0 +1,45 @@
+/*!
+ * \file      main_sim_gateway.c
+ *
+ * \brief     Shared channel and gateway for simulated devices, capacity studies
+ *
+ * Runs no modem and needs no radio: it serves the PERIODICAL_UPLINK processes
+ * started with spi.backend = sim and sim.link = udp, see sim/sim_gateway.h.
+ * Each device process takes its own board profile (DevEUI, distance), e.g.
+ *
+ *   lorawan.dev_eui = 0016C001F0000001
+ *   sim.distance_m  = 2500
+ *
+ * pigpio is not initialised, so the gateway can share a Pi with a device.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include "main.h"
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include "sim_gateway.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Serves simulated devices, runs until the process is stopped
+ */
+void main_sim_gateway( void )
+{
+    hal_board_profile_load( );
+
+    SMTC_HAL_TRACE_MSG( "\n\n\nSIM_GATEWAY example is starting \n\n" );
+
+    sim_gateway_run( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,338 @@
+/*!
+ * \file      main_sniffer.c
+ *
+ * \brief     Passive LoRa packet sniffer
+ *
+ * The radio stays in continuous LoRa RX on one channel, or cycles through a
+ * channel list with a fixed dwell time. Every frame, including the ones with
+ * a CRC error, is logged to sniffer-<date>.csv with its RX time, RSSI, SNR,
+ * frequency error and raw payload. The receive path only uses static and
+ * stack buffers.
+ *
+ * Settings are read from the board profile:
+ *
+ *   sniffer.channels_hz = 868100000, 868300000, 868500000
+ *   sniffer.dwell_ms    = 5000
+ *   sniffer.sf          = 7
+ *   sniffer.bw_khz      = 125
+ *   sniffer.sync_word   = 52       (0x34, public LoRaWAN networks)
+ *   sniffer.invert_iq   = 0        (0 for uplinks, 1 for downlinks)
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "main.h"
+
+#include "smtc_modem_api.h"
+#include "smtc_modem_hal.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_board_profile.h"
+
+#if defined( SX127X )
+#include "ralf_sx127x.h"
+#include "sx127x.h"
+#include "sx127x_hal.h"
+#endif
+
+#include "radio_snapshot.h"
+#include "csv_log.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SNIFFER_MAX_CHANNELS 16
+
+#define SNIFFER_DEFAULT_CHANNEL_HZ 868100000
+#define SNIFFER_DEFAULT_DWELL_MS 5000
+#define SNIFFER_DEFAULT_SYNC_WORD 0x34
+
+#define REG_LR_FEI_MSB 0x28
+
+#if defined( SX127X )
+static ralf_t modem_radio = RALF_SX127X_INSTANTIATE( NULL );  // this MUST stay static!
+#else
+#error "Please select radio board.."
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint32_t channels_hz[SNIFFER_MAX_CHANNELS];
+static uint8_t  nb_channels = 0;
+static uint32_t dwell_ms    = SNIFFER_DEFAULT_DWELL_MS;
+static uint32_t bw_hz       = 125000;
+
+static volatile bool            radio_irq_raised = false;
+static volatile struct timespec radio_irq_time;
+
+static uint8_t  rx_payload[256];
+static uint32_t nb_frames = 0;
+
+static ralf_params_lora_t rx_lora_param = { .sync_word                       = SNIFFER_DEFAULT_SYNC_WORD,
+                                            .symb_nb_timeout                 = 0,
+                                            .mod_params.cr                   = RAL_LORA_CR_4_5,
+                                            .mod_params.sf                   = RAL_LORA_SF7,
+                                            .mod_params.bw                   = RAL_LORA_BW_125_KHZ,
+                                            .mod_params.ldro                 = 0,
+                                            .pkt_params.header_type          = RAL_LORA_PKT_EXPLICIT,
+                                            .pkt_params.pld_len_in_bytes     = 255,
+                                            .pkt_params.crc_is_on            = true,
+                                            .pkt_params.invert_iq_is_on      = false,
+                                            .pkt_params.preamble_len_in_symb = 8 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void sniffer_radio_irq_callback( void* obj );
+static void sniffer_load_settings( void );
+static bool sniffer_start_rx( const uint32_t freq_hz );
+static void sniffer_process_irq( sx127x_t* radio, const uint32_t freq_hz );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Passive sniffer, runs until the process is stopped
+ */
+void main_sniffer( void )
+{
+    hal_mcu_init( );
+
+#if defined( SX127X )
+    // Get modem radio context, do not change!
+    modem_radio.ral.context = smtc_modem_get_radio_context( );
+#endif
+    sx127x_t* radio = ( sx127x_t* ) modem_radio.ral.context;
+
+    sniffer_load_settings( );
+
+    SMTC_HAL_TRACE_MSG( "\n\n\nSNIFFER example is starting \n\n" );
+    SMTC_HAL_TRACE_INFO( "  Channels:  %u, dwell %lu ms\n", nb_channels, ( unsigned long ) dwell_ms );
+    SMTC_HAL_TRACE_INFO( "  SF%u BW%lu, sync word 0x%02x, IQ %s\n", rx_lora_param.mod_params.sf,
+                         ( unsigned long ) bw_hz, rx_lora_param.sync_word,
+                         rx_lora_param.pkt_params.invert_iq_is_on ? "inverted" : "normal" );
+
+    ral_reset( &( modem_radio.ral ) );
+    if( ral_init( &( modem_radio.ral ) ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_init() failed\n" );
+        return;
+    }
+
+    if( csv_log_init( "sniffer" ) != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "CSV init failed, continuing without CSV logging\n" );
+    }
+    atexit( csv_log_close );
+
+    smtc_modem_hal_irq_config_radio_irq( sniffer_radio_irq_callback, NULL );
+
+    uint8_t index = 0;
+
+    while( 1 )
+    {
+        if( sniffer_start_rx( channels_hz[index] ) == false )
+        {
+            return;
+        }
+
+        const uint32_t start_ms = hal_rtc_get_time_ms( );
+        uint32_t       elapsed_ms = 0;
+
+        // A single channel is never left, several are visited for dwell_ms each
+        while( ( nb_channels == 1 ) || ( ( elapsed_ms = hal_rtc_get_time_ms( ) - start_ms ) < dwell_ms ) )
+        {
+            if( radio_irq_raised == true )
+            {
+                radio_irq_raised = false;
+                sniffer_process_irq( radio, channels_hz[index] );
+                continue;
+            }
+            hal_mcu_set_sleep_for_ms( ( nb_channels == 1 ) ? dwell_ms : ( dwell_ms - elapsed_ms ) );
+        }
+
+        index = ( index + 1 ) % nb_channels;
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void sniffer_radio_irq_callback( void* obj )
+{
+    ( void ) obj;
+
+    clock_gettime( CLOCK_REALTIME, ( struct timespec* ) &radio_irq_time );
+    radio_irq_raised = true;
+    hal_mcu_wakeup( );
+}
+
+static void sniffer_load_settings( void )
+{
+    const char* list;
+    int32_t     value;
+
+    nb_channels = 0;
+    if( hal_board_profile_get_str( "sniffer.channels_hz", &list ) == true )
+    {
+        const char* p = list;
+        while( ( *p != '\0' ) && ( nb_channels < SNIFFER_MAX_CHANNELS ) )
+        {
+            char*               end;
+            const unsigned long freq_hz = strtoul( p, &end, 10 );
+            if( end == p )
+            {
+                p++;
+                continue;
+            }
+            channels_hz[nb_channels++] = ( uint32_t ) freq_hz;
+            p                          = end;
+        }
+    }
+    if( nb_channels == 0 )
+    {
+        channels_hz[nb_channels++] = SNIFFER_DEFAULT_CHANNEL_HZ;
+    }
+
+    if( ( hal_board_profile_get_int( "sniffer.dwell_ms", &value ) == true ) && ( value > 0 ) )
+    {
+        dwell_ms = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "sniffer.sf", &value ) == true ) && ( value >= 6 ) && ( value <= 12 ) )
+    {
+        rx_lora_param.mod_params.sf = ( ral_lora_sf_t ) value;
+    }
+    if( hal_board_profile_get_int( "sniffer.bw_khz", &value ) == true )
+    {
+        switch( value )
+        {
+        case 125:
+            rx_lora_param.mod_params.bw = RAL_LORA_BW_125_KHZ;
+            break;
+        case 250:
+            rx_lora_param.mod_params.bw = RAL_LORA_BW_250_KHZ;
+            break;
+        case 500:
+            rx_lora_param.mod_params.bw = RAL_LORA_BW_500_KHZ;
+            break;
+        default:
+            SMTC_HAL_TRACE_WARNING( "sniffer.bw_khz %ld not supported, using 125\n", ( long ) value );
+            value = 125;
+            break;
+        }
+        bw_hz = ( uint32_t ) value * 1000;
+    }
+    if( ( hal_board_profile_get_int( "sniffer.sync_word", &value ) == true ) && ( value >= 0 ) && ( value <= 0xFF ) )
+    {
+        rx_lora_param.sync_word = ( uint8_t ) value;
+    }
+    if( hal_board_profile_get_int( "sniffer.invert_iq", &value ) == true )
+    {
+        rx_lora_param.pkt_params.invert_iq_is_on = ( value != 0 );
+    }
+
+    // Low data rate optimization is mandated above 16 ms symbols
+    rx_lora_param.mod_params.ldro = ral_compute_lora_ldro( rx_lora_param.mod_params.sf, rx_lora_param.mod_params.bw );
+}
+
+static bool sniffer_start_rx( const uint32_t freq_hz )
+{
+    rx_lora_param.rf_freq_in_hz = freq_hz;
+
+    if( ralf_setup_lora( &modem_radio, &rx_lora_param ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ralf_setup_lora() failed on %lu Hz\n", ( unsigned long ) freq_hz );
+        return false;
+    }
+    if( ral_set_dio_irq_params( &( modem_radio.ral ),
+                                RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_set_dio_irq_params() failed\n" );
+        return false;
+    }
+    smtc_modem_hal_set_ant_switch( false );
+    if( ral_set_rx( &( modem_radio.ral ), RAL_RX_TIMEOUT_CONTINUOUS_MODE ) != RAL_STATUS_OK )
+    {
+        SMTC_HAL_TRACE_ERROR( "ral_set_rx() failed on %lu Hz\n", ( unsigned long ) freq_hz );
+        return false;
+    }
+    return true;
+}
+
+static void sniffer_process_irq( sx127x_t* radio, const uint32_t freq_hz )
+{
+    ral_irq_t                irq       = RAL_IRQ_NONE;
+    ral_lora_rx_pkt_status_t pkt       = { 0 };
+    uint16_t                 size      = 0;
+    uint8_t                  fei[3]    = { 0 };
+    const char*              event     = "SNIFF";
+    char                     sf_txt[8] = "";
+    char                     extra[256];
+
+    ral_get_and_clear_irq_status( &( modem_radio.ral ), &irq );
+
+    // Header errors are not wired to a DIO, only RX done raises the interrupt
+    if( ( irq & RAL_IRQ_RX_DONE ) == 0 )
+    {
+        return;
+    }
+    if( ( irq & RAL_IRQ_RX_CRC_ERROR ) != 0 )
+    {
+        event = "SNIFF_CRC_ERROR";
+    }
+    ral_get_pkt_payload( &( modem_radio.ral ), sizeof( rx_payload ), rx_payload, &size );
+
+    ral_get_lora_rx_pkt_status( &( modem_radio.ral ), &pkt );
+    sx127x_hal_read( radio, REG_LR_FEI_MSB, fei, sizeof( fei ) );
+    const int32_t fei_hz = radio_snapshot_fei_to_hz( fei, bw_hz );
+
+    nb_frames++;
+    SMTC_HAL_TRACE_INFO( "%s #%lu on %lu Hz: %u bytes, rssi %d dBm, snr %d dB, freq error %ld Hz\n", event,
+                         ( unsigned long ) nb_frames, ( unsigned long ) freq_hz, size, pkt.rssi_pkt_in_dbm,
+                         pkt.snr_pkt_in_db, ( long ) fei_hz );
+
+    snprintf( sf_txt, sizeof( sf_txt ), "SF%u", rx_lora_param.mod_params.sf );
+    snprintf( extra, sizeof( extra ),
+              "{\"rx_time\" : \"%lld.%06ld\", \"freq\" : \"%luHz(%.3fMHz)\", \"bw\" : \"%lu\", "
+              "\"rssi\" : \"%d dBm\", \"signal_rssi\" : \"%d dBm\", \"snr\" : \"%d dB\", "
+              "\"freq_error\" : \"%ld Hz\", \"size\" : \"%u\"}",
+              ( long long ) radio_irq_time.tv_sec, ( long ) ( radio_irq_time.tv_nsec / 1000 ),
+              ( unsigned long ) freq_hz, ( double ) freq_hz / 1e6, ( unsigned long ) bw_hz,
+              pkt.rssi_pkt_in_dbm, pkt.signal_rssi_pkt_in_dbm, pkt.snr_pkt_in_db, ( long ) fei_hz, size );
+
+    csv_log_write_row( NULL, event, rx_payload, size, sf_txt, extra );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
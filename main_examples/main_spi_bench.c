@@ -0,0 +1,406 @@
+/*!
+ * \file      main_spi_bench.c
+ *
+ * \brief     SPI throughput benchmark across backends, clocks and transfer sizes
+ *
+ * Each point runs one operation back to back for a fixed duration through
+ * sx127x_hal_read / sx127x_hal_write, so a transaction includes the NSS GPIO
+ * toggles and the critical section the modem pays for too:
+ *
+ *   REG_READ   RegVersion, an error if it does not read SX127X_VERSION
+ *   REG_WRITE  RegFifoAddrPtr
+ *   FIFO_WRITE burst of SIZE bytes into RegFifo
+ *   FIFO_READ  burst of SIZE bytes from RegFifo
+ *
+ * After the FIFO points of a size, patterns are written at FIFO address 0 and
+ * read back, ERRORS counts the mismatching bytes. The radio is kept in LoRa
+ * standby so the 256-byte FIFO is accessible and nothing is transmitted.
+ *
+ * Settings are read from the board profile:
+ *
+ *   spi_bench.backends    = pigpio, spidev, sim
+ *   spi_bench.speeds_hz   = 125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000
+ *   spi_bench.duration_ms = 500
+ *
+ * The sim backend has no clock and runs once. A backend that cannot be
+ * opened is skipped. Results go to the trace and to spi-bench-<date>.csv.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "main.h"
+#include "csv_log.h"
+
+#include "smtc_modem_api.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_spi.h"
+#include "smtc_hal_board_profile.h"
+#include "modem_pinout.h"
+
+#if defined( SX127X )
+#include "sx127x.h"
+#include "sx127x_hal.h"
+#else
+#error "Please select radio board.."
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SPI_BENCH_MAX_SPEEDS 16
+
+#define SPI_BENCH_DEFAULT_SPEEDS_HZ { 125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000 }
+#define SPI_BENCH_DEFAULT_DURATION_MS 500
+
+#define SPI_BENCH_MAX_SIZE 256
+
+/*!
+ * Write / readback rounds per FIFO size
+ */
+#define SPI_BENCH_VERIFY_ROUNDS 16
+
+#define REG_FIFO 0x00
+#define REG_OP_MODE 0x01
+#define REG_FIFO_ADDR_PTR 0x0D
+#define REG_VERSION 0x42
+
+#define OP_MODE_LORA_SLEEP 0x80
+#define OP_MODE_LORA_STANDBY 0x81
+
+#define SX127X_VERSION 0x12
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef enum spi_bench_op_e
+{
+    SPI_BENCH_REG_READ,
+    SPI_BENCH_REG_WRITE,
+    SPI_BENCH_FIFO_WRITE,
+    SPI_BENCH_FIFO_READ,
+} spi_bench_op_t;
+
+/*!
+ * Result of one backend / speed / operation / size point
+ */
+typedef struct spi_bench_result_s
+{
+    uint32_t transactions;
+    uint64_t elapsed_us;
+    uint32_t errors;
+} spi_bench_result_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const char* op_names[] = { "REG_READ", "REG_WRITE", "FIFO_WRITE", "FIFO_READ" };
+
+static bool     backends[HAL_SPI_BACKEND_NB];
+static uint32_t speeds_hz[SPI_BENCH_MAX_SPEEDS];
+static uint8_t  nb_speeds   = 0;
+static uint32_t duration_ms = SPI_BENCH_DEFAULT_DURATION_MS;
+
+static const sx127x_t* radio = NULL;
+
+static uint8_t tx_buffer[SPI_BENCH_MAX_SIZE];
+static uint8_t rx_buffer[SPI_BENCH_MAX_SIZE];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void     spi_bench_load_settings( void );
+static void     spi_bench_sweep( const hal_spi_backend_t backend, const uint32_t speed_hz );
+static void     spi_bench_run( const spi_bench_op_t op, const uint16_t size, spi_bench_result_t* result );
+static uint32_t spi_bench_verify_fifo( const uint16_t size );
+static void     spi_bench_report( const hal_spi_backend_t backend, const uint32_t speed_hz, const spi_bench_op_t op,
+                                  const uint16_t size, const spi_bench_result_t* result );
+static void     spi_bench_radio_standby( void );
+static uint64_t spi_bench_now_us( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief SPI throughput sweep, returns when all points are measured
+ */
+void main_spi_bench( void )
+{
+    hal_mcu_init( );
+
+    // Get modem radio context, do not change!
+    radio = ( const sx127x_t* ) smtc_modem_get_radio_context( );
+
+    spi_bench_load_settings( );
+
+    const hal_spi_backend_t initial_backend  = hal_spi_get_backend( RADIO_SPI_ID );
+    const uint32_t          initial_speed_hz = hal_spi_get_speed_hz( RADIO_SPI_ID );
+
+    SMTC_HAL_TRACE_MSG( "\n\n\nSPI_BENCH example is starting \n\n" );
+    SMTC_HAL_TRACE_INFO( "  Speeds:   %u, %lu ms per point\n", nb_speeds, ( unsigned long ) duration_ms );
+
+    sx127x_hal_reset( radio );
+    spi_bench_radio_standby( );
+
+    if( csv_log_init( "spi-bench" ) != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "CSV init failed, continuing without CSV logging\n" );
+    }
+    atexit( csv_log_close );
+
+    SMTC_HAL_TRACE_PRINTF( " %-7s %9s %-10s %4s %9s %12s %12s %7s\n", "backend", "speed_hz", "op", "size", "trans",
+                           "trans/s", "bytes/s", "errors" );
+
+    for( uint8_t b = 0; b < HAL_SPI_BACKEND_NB; b++ )
+    {
+        const hal_spi_backend_t backend = ( hal_spi_backend_t ) b;
+
+        if( backends[b] == false )
+        {
+            continue;
+        }
+
+        for( uint8_t s = 0; s < nb_speeds; s++ )
+        {
+            const uint32_t speed_hz = ( backend == HAL_SPI_BACKEND_SIM ) ? 0 : speeds_hz[s];
+
+            if( hal_spi_configure( RADIO_SPI_ID, backend, ( speed_hz > 0 ) ? speed_hz : initial_speed_hz ) == false )
+            {
+                SMTC_HAL_TRACE_WARNING( "%s backend cannot be opened, skipped\n", hal_spi_backend_name( backend ) );
+                break;
+            }
+            spi_bench_radio_standby( );
+            spi_bench_sweep( backend, speed_hz );
+
+            if( backend == HAL_SPI_BACKEND_SIM )
+            {
+                break;
+            }
+        }
+    }
+
+    hal_spi_configure( RADIO_SPI_ID, initial_backend, initial_speed_hz );
+    sx127x_hal_write( radio, REG_OP_MODE, &( uint8_t ){ OP_MODE_LORA_SLEEP }, 1 );
+
+    SMTC_HAL_TRACE_MSG( "\nSPI_BENCH done\n" );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void spi_bench_load_settings( void )
+{
+    static const uint32_t default_speeds_hz[] = SPI_BENCH_DEFAULT_SPEEDS_HZ;
+    const char*           list;
+    int32_t               value;
+
+    if( hal_board_profile_get_str( "spi_bench.backends", &list ) == true )
+    {
+        for( uint8_t b = 0; b < HAL_SPI_BACKEND_NB; b++ )
+        {
+            backends[b] = ( strstr( list, hal_spi_backend_name( ( hal_spi_backend_t ) b ) ) != NULL );
+        }
+    }
+    else
+    {
+        for( uint8_t b = 0; b < HAL_SPI_BACKEND_NB; b++ )
+        {
+            backends[b] = true;
+        }
+    }
+
+    nb_speeds = 0;
+    if( hal_board_profile_get_str( "spi_bench.speeds_hz", &list ) == true )
+    {
+        const char* p = list;
+        while( ( *p != '\0' ) && ( nb_speeds < SPI_BENCH_MAX_SPEEDS ) )
+        {
+            char*               end;
+            const unsigned long speed_hz = strtoul( p, &end, 10 );
+            if( end == p )
+            {
+                p++;
+                continue;
+            }
+            if( speed_hz > 0 )
+            {
+                speeds_hz[nb_speeds++] = ( uint32_t ) speed_hz;
+            }
+            p = end;
+        }
+    }
+    if( nb_speeds == 0 )
+    {
+        for( uint8_t i = 0; i < ( sizeof( default_speeds_hz ) / sizeof( default_speeds_hz[0] ) ); i++ )
+        {
+            speeds_hz[nb_speeds++] = default_speeds_hz[i];
+        }
+    }
+
+    if( ( hal_board_profile_get_int( "spi_bench.duration_ms", &value ) == true ) && ( value > 0 ) )
+    {
+        duration_ms = ( uint32_t ) value;
+    }
+}
+
+static void spi_bench_sweep( const hal_spi_backend_t backend, const uint32_t speed_hz )
+{
+    spi_bench_result_t result;
+
+    spi_bench_run( SPI_BENCH_REG_READ, 1, &result );
+    spi_bench_report( backend, speed_hz, SPI_BENCH_REG_READ, 1, &result );
+
+    spi_bench_run( SPI_BENCH_REG_WRITE, 1, &result );
+    spi_bench_report( backend, speed_hz, SPI_BENCH_REG_WRITE, 1, &result );
+
+    for( uint16_t size = 1; size <= SPI_BENCH_MAX_SIZE; size *= 2 )
+    {
+        const uint32_t errors = spi_bench_verify_fifo( size );
+
+        spi_bench_run( SPI_BENCH_FIFO_WRITE, size, &result );
+        result.errors = errors;
+        spi_bench_report( backend, speed_hz, SPI_BENCH_FIFO_WRITE, size, &result );
+
+        spi_bench_run( SPI_BENCH_FIFO_READ, size, &result );
+        result.errors = errors;
+        spi_bench_report( backend, speed_hz, SPI_BENCH_FIFO_READ, size, &result );
+    }
+}
+
+static void spi_bench_run( const spi_bench_op_t op, const uint16_t size, spi_bench_result_t* result )
+{
+    const uint64_t duration_us = ( uint64_t ) duration_ms * 1000;
+    const uint64_t start_us    = spi_bench_now_us( );
+    uint64_t       now_us      = start_us;
+    uint8_t        version;
+
+    memset( result, 0, sizeof( *result ) );
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        tx_buffer[i] = ( uint8_t ) i;
+    }
+
+    // The FIFO pointer wraps at 256, bursts need no rewind
+    while( ( now_us - start_us ) < duration_us )
+    {
+        switch( op )
+        {
+        case SPI_BENCH_REG_READ:
+            sx127x_hal_read( radio, REG_VERSION, &version, 1 );
+            if( version != SX127X_VERSION )
+            {
+                result->errors++;
+            }
+            break;
+        case SPI_BENCH_REG_WRITE:
+            sx127x_hal_write( radio, REG_FIFO_ADDR_PTR, &( uint8_t ){ ( uint8_t ) result->transactions }, 1 );
+            break;
+        case SPI_BENCH_FIFO_WRITE:
+            sx127x_hal_write( radio, REG_FIFO, tx_buffer, size );
+            break;
+        case SPI_BENCH_FIFO_READ:
+            sx127x_hal_read( radio, REG_FIFO, rx_buffer, size );
+            break;
+        }
+        result->transactions++;
+        now_us = spi_bench_now_us( );
+    }
+    result->elapsed_us = now_us - start_us;
+}
+
+static uint32_t spi_bench_verify_fifo( const uint16_t size )
+{
+    uint32_t errors = 0;
+
+    for( uint8_t round = 0; round < SPI_BENCH_VERIFY_ROUNDS; round++ )
+    {
+        // Alternate walking and inverted patterns so stuck bits show either way
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            const uint8_t pattern = ( uint8_t ) ( i * 7 + round * 31 );
+            tx_buffer[i]          = ( round & 1 ) ? ( uint8_t ) ~pattern : pattern;
+        }
+        memset( rx_buffer, 0, size );
+
+        sx127x_hal_write( radio, REG_FIFO_ADDR_PTR, &( uint8_t ){ 0 }, 1 );
+        sx127x_hal_write( radio, REG_FIFO, tx_buffer, size );
+        sx127x_hal_write( radio, REG_FIFO_ADDR_PTR, &( uint8_t ){ 0 }, 1 );
+        sx127x_hal_read( radio, REG_FIFO, rx_buffer, size );
+
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            if( rx_buffer[i] != tx_buffer[i] )
+            {
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+static void spi_bench_report( const hal_spi_backend_t backend, const uint32_t speed_hz, const spi_bench_op_t op,
+                              const uint16_t size, const spi_bench_result_t* result )
+{
+    char         extra[256];
+    const double elapsed_s       = ( double ) result->elapsed_us / 1e6;
+    const double transactions_ps = ( elapsed_s > 0 ) ? result->transactions / elapsed_s : 0;
+    const double bytes_ps        = transactions_ps * size;
+
+    SMTC_HAL_TRACE_PRINTF( " %-7s %9lu %-10s %4u %9lu %12.0f %12.0f %7lu\n", hal_spi_backend_name( backend ),
+                           ( unsigned long ) speed_hz, op_names[op], size, ( unsigned long ) result->transactions,
+                           transactions_ps, bytes_ps, ( unsigned long ) result->errors );
+
+    snprintf( extra, sizeof( extra ),
+              "{\"backend\" : \"%s\", \"speed_hz\" : \"%lu\", \"op\" : \"%s\", \"size\" : \"%u\", "
+              "\"transactions\" : \"%lu\", \"elapsed_us\" : \"%llu\", \"transactions_per_s\" : \"%.0f\", "
+              "\"bytes_per_s\" : \"%.0f\", \"errors\" : \"%lu\"}",
+              hal_spi_backend_name( backend ), ( unsigned long ) speed_hz, op_names[op], size,
+              ( unsigned long ) result->transactions, ( unsigned long long ) result->elapsed_us, transactions_ps,
+              bytes_ps, ( unsigned long ) result->errors );
+    csv_log_write_row( NULL, "SPI_BENCH", NULL, 0, "", extra );
+}
+
+static void spi_bench_radio_standby( void )
+{
+    // LongRangeMode can only be changed in sleep
+    sx127x_hal_write( radio, REG_OP_MODE, &( uint8_t ){ OP_MODE_LORA_SLEEP }, 1 );
+    sx127x_hal_write( radio, REG_OP_MODE, &( uint8_t ){ OP_MODE_LORA_STANDBY }, 1 );
+}
+
+static uint64_t spi_bench_now_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( RT_CLOCK, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000 + ( uint64_t ) ts.tv_nsec / 1000;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,168 @@
+/*!
+ * \file      stats_shm.c
+ *
+ * \brief     Live statistics page in POSIX shared memory, implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // offsetof
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stats_shm.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+// Layout checks, the page is read by tools built apart from the app
+_Static_assert( sizeof( _Atomic uint32_t ) == sizeof( uint32_t ), "seq must be a plain 32-bit word" );
+_Static_assert( ( offsetof( stats_shm_t, engine_run_us ) % 8 ) == 0, "histograms must be 8-byte aligned" );
+_Static_assert( ( sizeof( stats_shm_t ) % 8 ) == 0, "page size must be a multiple of 8" );
+_Static_assert( sizeof( stats_shm_t ) <= UINT16_MAX, "page size must fit the size field" );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static stats_shm_t* page = NULL;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int stats_shm_init( void )
+{
+    int32_t     enabled = 1;
+    const char* name    = STATS_SHM_DEFAULT_NAME;
+
+    hal_board_profile_get_int( "stats.shm", &enabled );
+    hal_board_profile_get_str( "stats.shm_name", &name );
+    if( enabled == 0 )
+    {
+        return -1;
+    }
+
+    // Readable by monitors that do not run as root
+    const int fd = shm_open( name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+    if( fd < 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "Stats page %s: %s\n", name, strerror( errno ) );
+        return -1;
+    }
+    if( ftruncate( fd, sizeof( stats_shm_t ) ) != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "Stats page %s: %s\n", name, strerror( errno ) );
+        close( fd );
+        return -1;
+    }
+    void* map = mmap( NULL, sizeof( stats_shm_t ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED )
+    {
+        SMTC_HAL_TRACE_ERROR( "Stats page %s: %s\n", name, strerror( errno ) );
+        return -1;
+    }
+    page = ( stats_shm_t* ) map;
+
+    // A page left by a previous run is reset, readers see an update in progress meanwhile
+    const uint32_t seq = atomic_load_explicit( &page->seq, memory_order_relaxed );
+    atomic_store_explicit( &page->seq, ( seq | 1u ) + 2u, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+
+    memset( ( uint8_t* ) page + offsetof( stats_shm_t, pid ), 0, sizeof( stats_shm_t ) - offsetof( stats_shm_t, pid ) );
+    page->magic         = STATS_SHM_MAGIC;
+    page->version       = STATS_SHM_VERSION;
+    page->size          = sizeof( stats_shm_t );
+    page->pid           = ( uint32_t ) getpid( );
+    page->start_time_s  = ( int64_t ) time( NULL );
+    page->update_time_s = page->start_time_s;
+
+    atomic_thread_fence( memory_order_release );
+    atomic_store_explicit( &page->seq, ( seq | 1u ) + 3u, memory_order_relaxed );
+
+    SMTC_HAL_TRACE_INFO( "Stats page: /dev/shm%s, %u bytes\n", name, ( unsigned ) sizeof( stats_shm_t ) );
+    return 0;
+}
+
+stats_shm_t* stats_shm_begin( void )
+{
+    if( page == NULL )
+    {
+        return NULL;
+    }
+
+    // Odd: readers retry; the fence keeps the data stores after this one
+    atomic_store_explicit( &page->seq, atomic_load_explicit( &page->seq, memory_order_relaxed ) + 1u,
+                           memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    return page;
+}
+
+void stats_shm_end( void )
+{
+    page->update_time_s = ( int64_t ) time( NULL );
+
+    atomic_thread_fence( memory_order_release );
+    atomic_store_explicit( &page->seq, atomic_load_explicit( &page->seq, memory_order_relaxed ) + 1u,
+                           memory_order_relaxed );
+}
+
+void stats_shm_hist_add( stats_shm_hist_t* hist, const uint32_t value )
+{
+    uint32_t bin = 0;
+
+    while( ( bin < ( STATS_SHM_HIST_BINS - 1 ) ) && ( ( value >> ( bin + 1 ) ) != 0 ) )
+    {
+        bin++;
+    }
+    hist->bins[bin]++;
+    hist->count++;
+    hist->sum += value;
+    if( value > hist->max )
+    {
+        hist->max = value;
+    }
+}
+
+bool stats_shm_snapshot( const stats_shm_t* shm, stats_shm_t* snapshot, const uint32_t max_tries )
+{
+    stats_shm_t* writable = ( stats_shm_t* ) shm;
+
+    for( uint32_t i = 0; i < max_tries; i++ )
+    {
+        const uint32_t before = atomic_load_explicit( &writable->seq, memory_order_relaxed );
+        atomic_thread_fence( memory_order_acquire );
+        if( ( before & 1u ) != 0 )
+        {
+            continue;
+        }
+
+        memcpy( snapshot, shm, sizeof( *snapshot ) );
+
+        atomic_thread_fence( memory_order_acquire );
+        if( atomic_load_explicit( &writable->seq, memory_order_relaxed ) == before )
+        {
+            return ( snapshot->magic == STATS_SHM_MAGIC ) && ( snapshot->version == STATS_SHM_VERSION );
+        }
+    }
+    return false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
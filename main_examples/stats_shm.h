@@ -0,0 +1,162 @@
+/*!
+ * \file      stats_shm.h
+ *
+ * \brief     Live statistics page in POSIX shared memory, for external monitors
+ *
+ * The page has a fixed layout, stats_shm_t, published under stats.shm_name
+ * (default STATS_SHM_DEFAULT_NAME, /dev/shm/lbm_drag_rpi) unless stats.shm = 0.
+ * It is updated by a single writer, the main loop, under a sequence lock:
+ * the writer never waits, readers copy the page and retry while seq is odd
+ * or changed during the copy (see stats_shm_snapshot). The page outlives
+ * the process, pid and update_time_s tell whether it is still fed.
+ *
+ * All fields are little endian, naturally aligned, without implicit padding.
+ */
+#ifndef STATS_SHM_H
+#define STATS_SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdatomic.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define STATS_SHM_DEFAULT_NAME "/lbm_drag_rpi"
+
+#define STATS_SHM_MAGIC 0x534D424Cu  // "LBMS"
+#define STATS_SHM_VERSION 1
+
+/*!
+ * Histogram bins: bin 0 counts values 0 and 1, bin i values in [2^i, 2^(i+1)), the last bin the rest
+ */
+#define STATS_SHM_HIST_BINS 24
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Log2 histogram
+ */
+typedef struct stats_shm_hist_s
+{
+    uint32_t bins[STATS_SHM_HIST_BINS];
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+} stats_shm_hist_t;
+
+/*!
+ * Statistics page
+ */
+typedef struct stats_shm_s
+{
+    /* Header, set once */
+    uint32_t         magic;    //!< STATS_SHM_MAGIC
+    uint16_t         version;  //!< STATS_SHM_VERSION
+    uint16_t         size;     //!< sizeof( stats_shm_t )
+    _Atomic uint32_t seq;      //!< Odd while the writer updates the page
+    uint32_t         pid;      //!< Writer process
+    int64_t          start_time_s;   //!< Writer start, Unix time
+    int64_t          update_time_s;  //!< Last update, Unix time
+
+    /* State */
+    uint8_t  joined;       //!< 1 once joined or resumed
+    uint8_t  radio_state;  //!< radio_state_t of radio_state_time.h
+    uint8_t  safe_mode;    //!< Supervisor in safe mode
+    uint8_t  reserved0;
+    uint32_t dev_addr;
+
+    /* Counters */
+    uint32_t uplinks;     //!< Uplinks requested
+    uint32_t txdone;      //!< Uplinks done
+    uint32_t downlinks;   //!< Downlinks received
+    uint32_t joins;       //!< JOINED events
+    uint32_t join_fails;  //!< JOINFAIL events
+    uint32_t restarts;    //!< Supervisor restarts, all runs
+    uint32_t fcnt_up;     //!< Uplink frame counter of the last uplink
+
+    /* Last uplink */
+    uint32_t tx_frequency_hz;
+    int8_t   tx_power_dbm;
+    uint8_t  tx_sf;         //!< sx127x_lora_sf_t, 0 if not LoRa
+    uint8_t  tx_bw;         //!< sx127x_lora_bw_t
+    uint8_t  tx_data_rate;  //!< LoRaWAN data rate
+    uint8_t  tx_size;       //!< Payload bytes
+    uint8_t  reserved1[3];
+
+    /* Last downlink */
+    int16_t  rx_rssi_dbm;
+    int16_t  rx_snr_cdb;  //!< SNR in 0.01 dB
+    uint32_t rx_frequency_hz;
+    int64_t  rx_time_s;   //!< Unix time, 0 if none yet
+
+    /* Timing histograms */
+    stats_shm_hist_t engine_run_us;   //!< smtc_modem_run_engine run time
+    stats_shm_hist_t irq_latency_us;  //!< DIO edge to DOWNDATA event
+    stats_shm_hist_t tx_cycle_ms;     //!< Uplink request to TXDONE, RX windows included
+} stats_shm_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Creates, or takes over, the statistics page
+ *
+ * \retval 0 on success, -1 if disabled or on error (statistics are then dropped)
+ */
+int stats_shm_init( void );
+
+/*!
+ * Starts an update of the page
+ *
+ * \retval page to update, NULL if there is none; stats_shm_end must follow a non-NULL page
+ */
+stats_shm_t* stats_shm_begin( void );
+
+/*!
+ * Ends an update of the page
+ */
+void stats_shm_end( void );
+
+/*!
+ * Adds a value to a histogram, to be called between stats_shm_begin and stats_shm_end
+ *
+ * \param [in] hist  Histogram
+ * \param [in] value Value
+ */
+void stats_shm_hist_add( stats_shm_hist_t* hist, const uint32_t value );
+
+/*!
+ * Copies a consistent snapshot of a page, reader side
+ *
+ * \param [in]  page      Mapped page
+ * \param [out] snapshot  Copy
+ * \param [in]  max_tries Copies attempted while the writer updates the page
+ *
+ * \retval true if the copy is consistent
+ */
+bool stats_shm_snapshot( const stats_shm_t* page, stats_shm_t* snapshot, const uint32_t max_tries );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_SHM_H */
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -50,6 +50,20 @@ extern "C" {
  * --- PUBLIC MACROS -----------------------------------------------------------
  */
 
+/*!
+ * Radio pins, the defaults below can be overridden by the board profile
+ * (pin.nrst, pin.nss, pin.dio0, pin.dio1, pin.dio2, BCM GPIO numbers). The SPI
+ * pins are fixed by the SPI controller, selected with spi.device.
+ */
+#define RADIO_NRST ( modem_pinout_get( )->nrst )
+#define RADIO_SPI_MOSI ( modem_pinout_get( )->spi_mosi )
+#define RADIO_SPI_MISO ( modem_pinout_get( )->spi_miso )
+#define RADIO_SPI_SCLK ( modem_pinout_get( )->spi_sclk )
+#define RADIO_NSS ( modem_pinout_get( )->nss )
+#define RADIO_DIO_0 ( modem_pinout_get( )->dio_0 )
+#define RADIO_DIO_1 ( modem_pinout_get( )->dio_1 )
+#define RADIO_DIO_2 ( modem_pinout_get( )->dio_2 )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC CONSTANTS --------------------------------------------------------
@@ -61,14 +75,14 @@ extern "C" {
 // clang-format off
 
 //Radio specific pinout and peripherals
-#define RADIO_NRST P_17
-#define RADIO_SPI_MOSI P_10
-#define RADIO_SPI_MISO P_9
-#define RADIO_SPI_SCLK P_11
-#define RADIO_NSS P_25
-#define RADIO_DIO_0 P_4
-#define RADIO_DIO_1 P_23
-#define RADIO_DIO_2 P_24
+#define RADIO_NRST_DEFAULT P_17
+#define RADIO_SPI_MOSI_DEFAULT P_10
+#define RADIO_SPI_MISO_DEFAULT P_9
+#define RADIO_SPI_SCLK_DEFAULT P_11
+#define RADIO_NSS_DEFAULT P_25
+#define RADIO_DIO_0_DEFAULT P_4
+#define RADIO_DIO_1_DEFAULT P_23
+#define RADIO_DIO_2_DEFAULT P_24
 
 #define RADIO_SPI_ID 0
 
@@ -79,10 +93,38 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * Radio pinout
+ */
+typedef struct modem_pinout_s
+{
+    hal_gpio_pin_names_t nrst;
+    hal_gpio_pin_names_t spi_mosi;
+    hal_gpio_pin_names_t spi_miso;
+    hal_gpio_pin_names_t spi_sclk;
+    hal_gpio_pin_names_t nss;
+    hal_gpio_pin_names_t dio_0;
+    hal_gpio_pin_names_t dio_1;
+    hal_gpio_pin_names_t dio_2;
+} modem_pinout_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
  */
+
+/*!
+ * Applies the board profile pin settings, called by hal_mcu_init
+ */
+void modem_pinout_load( void );
+
+/*!
+ * Gets the radio pinout
+ *
+ * \retval pinout in use
+ */
+const modem_pinout_t* modem_pinout_get( void );
+
 #ifdef __cplusplus
 }
 #endif
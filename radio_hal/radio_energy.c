@@ -0,0 +1,302 @@
+/*!
+ * \file      radio_energy.c
+ *
+ * \brief     SX1276 power consumption model and energy accounting implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <time.h>
+
+#include "radio_energy.h"
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+#define ARRAY_SIZE( a ) ( sizeof( a ) / sizeof( ( a )[0] ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define REG_OP_MODE 0x01
+#define REG_LNA 0x0C
+
+#define OP_MODE_LONG_RANGE_MODE 0x80
+#define OP_MODE_MASK 0x07
+#define OP_MODE_SLEEP 0x00
+#define OP_MODE_STDBY 0x01
+#define OP_MODE_FSTX 0x02
+#define OP_MODE_TX 0x03
+#define OP_MODE_FSRX 0x04
+
+#define LNA_BOOST_HF_MASK 0x03
+
+#define ENERGY_TABLE_MAX_POINTS 16
+
+/*!
+ * Default model, SX1276 datasheet typical values at 3.3 V in the 868 MHz band
+ * (IDDT, IDDR, IDDSL, IDDST, IDDFS), intermediate TX points are interpolated.
+ */
+static const hal_board_profile_point_t default_tx_rfo_ua[] = {
+    { -4, 12000.0f }, { 7, 20000.0f }, { 13, 29000.0f }, { 15, 33000.0f },
+};
+static const hal_board_profile_point_t default_tx_pa_boost_ua[] = {
+    { 2, 24000.0f }, { 7, 32000.0f }, { 13, 45000.0f }, { 17, 87000.0f }, { 20, 120000.0f },
+};
+
+#define DEFAULT_SUPPLY_MV 3300
+#define DEFAULT_RX_LORA_UA 10800
+#define DEFAULT_RX_LORA_BOOSTED_UA 11500
+#define DEFAULT_RX_GFSK_UA 10800
+#define DEFAULT_RX_GFSK_BOOSTED_UA 11500
+#define DEFAULT_SLEEP_UA 1
+#define DEFAULT_STANDBY_UA 1600
+#define DEFAULT_SYNTH_UA 5800
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct energy_table_s
+{
+    hal_board_profile_point_t points[ENERGY_TABLE_MAX_POINTS];
+    uint8_t                   nb;
+} energy_table_t;
+
+typedef struct energy_model_s
+{
+    int32_t        supply_mv;
+    energy_table_t tx_rfo_ua;
+    energy_table_t tx_pa_boost_ua;
+    int32_t        rx_lora_ua;
+    int32_t        rx_lora_boosted_ua;
+    int32_t        rx_gfsk_ua;
+    int32_t        rx_gfsk_boosted_ua;
+    int32_t        sleep_ua;
+    int32_t        standby_ua;
+    int32_t        synth_ua;
+} energy_model_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static energy_model_t model;
+static bool           model_loaded = false;
+
+/*!
+ * Current accounting segment
+ */
+static uint8_t  op_mode        = OP_MODE_SLEEP;
+static bool     rx_boosted     = false;
+static bool     tx_pa_boost    = false;
+static int8_t   tx_power_dbm   = 14;
+static uint64_t segment_start  = 0;
+
+static double uplink_charge_uas = 0;
+static double total_charge_uas  = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void energy_model_load( void );
+
+static void energy_table_load( energy_table_t* table, const char* key, const hal_board_profile_point_t* defaults,
+                               const uint8_t defaults_nb );
+
+static uint32_t energy_current_ua( void );
+
+static void energy_close_segment( void );
+
+static uint64_t energy_now_us( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint32_t radio_energy_get_tx_consumption_ua( const bool pa_boost, const int8_t power_dbm )
+{
+    energy_model_load( );
+
+    const energy_table_t* table = pa_boost ? &model.tx_pa_boost_ua : &model.tx_rfo_ua;
+    return ( uint32_t ) ( hal_board_profile_interpolate( table->points, table->nb, power_dbm ) + 0.5f );
+}
+
+uint32_t radio_energy_get_rx_consumption_ua( const bool is_lora, const bool boosted )
+{
+    energy_model_load( );
+
+    if( is_lora )
+    {
+        return boosted ? model.rx_lora_boosted_ua : model.rx_lora_ua;
+    }
+    return boosted ? model.rx_gfsk_boosted_ua : model.rx_gfsk_ua;
+}
+
+void radio_energy_set_tx_cfg( const bool pa_boost, const int8_t power_dbm )
+{
+    CRITICAL_SECTION_BEGIN( );
+    tx_pa_boost  = pa_boost;
+    tx_power_dbm = power_dbm;
+    CRITICAL_SECTION_END( );
+}
+
+void radio_energy_on_register_write( const uint16_t address, const uint8_t* data, const uint16_t data_len )
+{
+    // Address 0 is the FIFO, burst accesses do not increment the address
+    if( ( address == 0 ) || ( data_len == 0 ) )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+
+    if( ( address <= REG_LNA ) && ( address + data_len > REG_LNA ) )
+    {
+        energy_close_segment( );
+        rx_boosted = ( data[REG_LNA - address] & LNA_BOOST_HF_MASK ) == LNA_BOOST_HF_MASK;
+    }
+
+    if( ( address <= REG_OP_MODE ) && ( address + data_len > REG_OP_MODE ) )
+    {
+        energy_close_segment( );
+        op_mode = data[REG_OP_MODE - address];
+    }
+
+    CRITICAL_SECTION_END( );
+}
+
+void radio_energy_get_report( radio_energy_report_t* report )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    energy_close_segment( );
+    report->uplink_charge_uas = uplink_charge_uas;
+    report->total_charge_uas  = total_charge_uas;
+
+    CRITICAL_SECTION_END( );
+
+    // uA.s * mV = nJ
+    report->uplink_energy_mj = report->uplink_charge_uas * model.supply_mv / 1e6;
+    report->total_energy_mj  = report->total_charge_uas * model.supply_mv / 1e6;
+}
+
+void radio_energy_reset_uplink( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    energy_close_segment( );
+    uplink_charge_uas = 0;
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void energy_model_load( void )
+{
+    if( model_loaded )
+    {
+        return;
+    }
+    model_loaded = true;
+
+    hal_board_profile_load( );
+
+    model.supply_mv          = DEFAULT_SUPPLY_MV;
+    model.rx_lora_ua         = DEFAULT_RX_LORA_UA;
+    model.rx_lora_boosted_ua = DEFAULT_RX_LORA_BOOSTED_UA;
+    model.rx_gfsk_ua         = DEFAULT_RX_GFSK_UA;
+    model.rx_gfsk_boosted_ua = DEFAULT_RX_GFSK_BOOSTED_UA;
+    model.sleep_ua           = DEFAULT_SLEEP_UA;
+    model.standby_ua         = DEFAULT_STANDBY_UA;
+    model.synth_ua           = DEFAULT_SYNTH_UA;
+
+    hal_board_profile_get_int( "power.supply_mv", &model.supply_mv );
+    hal_board_profile_get_int( "power.rx_lora_ua", &model.rx_lora_ua );
+    hal_board_profile_get_int( "power.rx_lora_boosted_ua", &model.rx_lora_boosted_ua );
+    hal_board_profile_get_int( "power.rx_gfsk_ua", &model.rx_gfsk_ua );
+    hal_board_profile_get_int( "power.rx_gfsk_boosted_ua", &model.rx_gfsk_boosted_ua );
+    hal_board_profile_get_int( "power.sleep_ua", &model.sleep_ua );
+    hal_board_profile_get_int( "power.standby_ua", &model.standby_ua );
+    hal_board_profile_get_int( "power.synth_ua", &model.synth_ua );
+
+    energy_table_load( &model.tx_rfo_ua, "power.tx_rfo_ua", default_tx_rfo_ua, ARRAY_SIZE( default_tx_rfo_ua ) );
+    energy_table_load( &model.tx_pa_boost_ua, "power.tx_pa_boost_ua", default_tx_pa_boost_ua,
+                       ARRAY_SIZE( default_tx_pa_boost_ua ) );
+}
+
+static void energy_table_load( energy_table_t* table, const char* key, const hal_board_profile_point_t* defaults,
+                               const uint8_t defaults_nb )
+{
+    table->nb = hal_board_profile_get_table( key, table->points, ENERGY_TABLE_MAX_POINTS );
+    if( table->nb == 0 )
+    {
+        for( uint8_t i = 0; i < defaults_nb; i++ )
+        {
+            table->points[i] = defaults[i];
+        }
+        table->nb = defaults_nb;
+    }
+}
+
+static uint32_t energy_current_ua( void )
+{
+    switch( op_mode & OP_MODE_MASK )
+    {
+    case OP_MODE_SLEEP:
+        return model.sleep_ua;
+    case OP_MODE_STDBY:
+        return model.standby_ua;
+    case OP_MODE_FSTX:
+    case OP_MODE_FSRX:
+        return model.synth_ua;
+    case OP_MODE_TX:
+        return radio_energy_get_tx_consumption_ua( tx_pa_boost, tx_power_dbm );
+    default:  // RX continuous, RX single, CAD
+        return radio_energy_get_rx_consumption_ua( ( op_mode & OP_MODE_LONG_RANGE_MODE ) != 0, rx_boosted );
+    }
+}
+
+static void energy_close_segment( void )
+{
+    energy_model_load( );
+
+    uint64_t now = energy_now_us( );
+    if( segment_start != 0 )
+    {
+        double charge = ( double ) energy_current_ua( ) * ( now - segment_start ) / 1e6;
+        uplink_charge_uas += charge;
+        total_charge_uas += charge;
+    }
+    segment_start = now;
+}
+
+static uint64_t energy_now_us( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
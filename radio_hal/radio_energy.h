@@ -0,0 +1,127 @@
+/*!
+ * \file      radio_energy.h
+ *
+ * \brief     SX1276 power consumption model and energy accounting
+ *
+ * The consumption model gives the supply current of the radio for each
+ * operating mode. TX current depends on the PA path and output power, RX
+ * current on the modem (LoRa/GFSK) and LNA boost. Default values are the
+ * SX1276 datasheet typical figures; each table can be replaced by measured
+ * values of the board through the board profile:
+ *
+ *   power.supply_mv           = 3300
+ *   power.tx_rfo_ua           = <dBm>:<uA>, ...
+ *   power.tx_pa_boost_ua      = <dBm>:<uA>, ...
+ *   power.rx_lora_ua          = <uA>
+ *   power.rx_lora_boosted_ua  = <uA>
+ *   power.rx_gfsk_ua          = <uA>
+ *   power.rx_gfsk_boosted_ua  = <uA>
+ *   power.sleep_ua            = <uA>
+ *   power.standby_ua          = <uA>
+ *   power.synth_ua            = <uA>
+ *
+ * Energy accounting follows the operating mode written to the radio and
+ * integrates the model current over time.
+ */
+#ifndef RADIO_ENERGY_H
+#define RADIO_ENERGY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Radio charge and energy consumed since the last reset
+ */
+typedef struct radio_energy_report_s
+{
+    double uplink_charge_uas;  //!< Charge since radio_energy_reset_uplink, in uA.s
+    double total_charge_uas;   //!< Charge since startup, in uA.s
+    double uplink_energy_mj;   //!< Energy since radio_energy_reset_uplink, in mJ
+    double total_energy_mj;    //!< Energy since startup, in mJ
+} radio_energy_report_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Gets the modelled TX supply current
+ *
+ * \param [in] pa_boost  true for the PA_BOOST path, false for RFO
+ * \param [in] power_dbm Chip output power
+ *
+ * \retval current in uA
+ */
+uint32_t radio_energy_get_tx_consumption_ua( const bool pa_boost, const int8_t power_dbm );
+
+/*!
+ * Gets the modelled RX supply current
+ *
+ * \param [in] is_lora    true for LoRa, false for GFSK
+ * \param [in] rx_boosted true if the LNA boost is on
+ *
+ * \retval current in uA
+ */
+uint32_t radio_energy_get_rx_consumption_ua( const bool is_lora, const bool rx_boosted );
+
+/*!
+ * Records the PA configuration of the next transmission
+ *
+ * \param [in] pa_boost  true for the PA_BOOST path, false for RFO
+ * \param [in] power_dbm Chip output power
+ */
+void radio_energy_set_tx_cfg( const bool pa_boost, const int8_t power_dbm );
+
+/*!
+ * Notifies a register write, to be called by the radio HAL
+ *
+ * \param [in] address  First register address
+ * \param [in] data     Written values
+ * \param [in] data_len Number of registers written
+ */
+void radio_energy_on_register_write( const uint16_t address, const uint8_t* data, const uint16_t data_len );
+
+/*!
+ * Gets the charge and energy consumed so far
+ *
+ * \param [out] report Accounting report
+ */
+void radio_energy_get_report( radio_energy_report_t* report );
+
+/*!
+ * Starts a new per-uplink accounting period
+ */
+void radio_energy_reset_uplink( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_ENERGY_H
+
+/* --- EOF ------------------------------------------------------------------ */
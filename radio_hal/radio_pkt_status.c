@@ -0,0 +1,195 @@
+/*!
+ * \file      radio_pkt_status.c
+ *
+ * \brief     SX127x packet status latched at the FIFO readout, implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_pkt_status.h"
+#include "radio_snapshot.h"
+#include "sx127x_hal.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * LoRa burst: RegPktSnrValue to RegFeiLsb
+ */
+#define LORA_FIRST_REG 0x19
+#define LORA_NB_REGS ( 0x2A - LORA_FIRST_REG + 1 )
+#define LORA_PKT_SNR_VALUE ( 0x19 - LORA_FIRST_REG )
+#define LORA_PKT_RSSI_VALUE ( 0x1A - LORA_FIRST_REG )
+#define LORA_RSSI_VALUE ( 0x1B - LORA_FIRST_REG )
+#define LORA_MODEM_CONFIG_1 ( 0x1D - LORA_FIRST_REG )
+#define LORA_FEI_MSB ( 0x28 - LORA_FIRST_REG )
+
+/*!
+ * GFSK burst: RegRssiValue to RegFeiLsb
+ */
+#define GFSK_FIRST_REG 0x11
+#define GFSK_NB_REGS ( 0x1E - GFSK_FIRST_REG + 1 )
+#define GFSK_RSSI_VALUE ( 0x11 - GFSK_FIRST_REG )
+#define GFSK_FEI_MSB ( 0x1D - GFSK_FIRST_REG )
+
+/*!
+ * RSSI offsets of the HF (above 525 MHz) and LF ports, LoRa, the SX1272 has a single port
+ */
+#if defined( SX1272 )
+#define RSSI_OFFSET_HF ( -139 )
+#define RSSI_OFFSET_LF ( -139 )
+#else
+#define RSSI_OFFSET_HF ( -157 )
+#define RSSI_OFFSET_LF ( -164 )
+#endif
+#define RSSI_HF_PORT_MIN_HZ 525000000
+
+/*!
+ * GFSK frequency step, Fxtal / 2^19, in mHz
+ */
+#define GFSK_FSTEP_MHZ 61035
+
+/*!
+ * Registers telling a packet is in the FIFO
+ */
+#define REG_FIFO 0x00
+#define LORA_REG_IRQ_FLAGS 0x12
+#define LORA_IRQ_RX_DONE 0x40
+#define GFSK_REG_IRQ_FLAGS_2 0x3F
+#define GFSK_IRQ_PAYLOAD_READY 0x04
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+#if defined( SX1272 )
+static const uint32_t lora_bw_hz[] = { 125000, 250000, 500000 };
+#else
+static const uint32_t lora_bw_hz[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+#endif
+
+static radio_pkt_status_t latched = { 0 };
+
+/*!
+ * RX done seen in the IRQ flags, the next FIFO readout is a received packet
+ */
+static bool rx_done_seen = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void radio_pkt_status_latch( const sx127x_t* radio, const uint16_t size );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void radio_pkt_status_on_register_read( const sx127x_t* radio, const uint16_t address, const uint8_t* data,
+                                        const uint16_t data_len )
+{
+    if( data_len == 0 )
+    {
+        return;
+    }
+
+    if( address == REG_FIFO )
+    {
+        if( rx_done_seen )
+        {
+            rx_done_seen = false;
+            radio_pkt_status_latch( radio, data_len );
+        }
+        return;
+    }
+
+    // Flags cleared by the driver afterwards, so they are caught on the read
+    const bool     is_lora = radio->pkt_type == SX127X_PKT_TYPE_LORA;
+    const uint16_t reg     = is_lora ? LORA_REG_IRQ_FLAGS : GFSK_REG_IRQ_FLAGS_2;
+    const uint8_t  mask    = is_lora ? LORA_IRQ_RX_DONE : GFSK_IRQ_PAYLOAD_READY;
+    if( ( address <= reg ) && ( reg < ( address + data_len ) ) && ( ( data[reg - address] & mask ) != 0 ) )
+    {
+        rx_done_seen = true;
+    }
+}
+
+bool radio_pkt_status_get( radio_pkt_status_t* status )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *status = latched;
+    CRITICAL_SECTION_END( );
+
+    return status->count != 0;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void radio_pkt_status_latch( const sx127x_t* radio, const uint16_t size )
+{
+    radio_pkt_status_t status = { 0 };
+
+    status.timestamp_ms = hal_rtc_get_time_ms( );
+    status.count        = latched.count + 1;
+    status.is_lora      = radio->pkt_type == SX127X_PKT_TYPE_LORA;
+    status.size         = ( size > UINT8_MAX ) ? UINT8_MAX : ( uint8_t ) size;
+    status.frequency_hz = radio->rf_freq_in_hz;
+
+    if( status.is_lora )
+    {
+        uint8_t regs[LORA_NB_REGS];
+        sx127x_hal_read( radio, LORA_FIRST_REG, regs, LORA_NB_REGS );
+
+        const int16_t rssi_offset = ( radio->rf_freq_in_hz > RSSI_HF_PORT_MIN_HZ ) ? RSSI_OFFSET_HF : RSSI_OFFSET_LF;
+        const int8_t  snr_raw     = ( int8_t ) regs[LORA_PKT_SNR_VALUE];
+        status.snr_db             = ( float ) snr_raw / 4.0f;
+        status.rssi_pkt_dbm       = rssi_offset + regs[LORA_PKT_RSSI_VALUE];
+        if( snr_raw < 0 )
+        {
+            status.rssi_pkt_dbm += snr_raw / 4;
+        }
+        status.rssi_dbm = rssi_offset + regs[LORA_RSSI_VALUE];
+
+#if defined( SX1272 )
+        const uint8_t bw_index = regs[LORA_MODEM_CONFIG_1] >> 6;
+#else
+        const uint8_t bw_index = regs[LORA_MODEM_CONFIG_1] >> 4;
+#endif
+        if( bw_index < ( sizeof( lora_bw_hz ) / sizeof( lora_bw_hz[0] ) ) )
+        {
+            status.fei_hz = radio_snapshot_fei_to_hz( &regs[LORA_FEI_MSB], lora_bw_hz[bw_index] );
+        }
+    }
+    else
+    {
+        uint8_t regs[GFSK_NB_REGS];
+        sx127x_hal_read( radio, GFSK_FIRST_REG, regs, GFSK_NB_REGS );
+
+        status.rssi_dbm     = -( int16_t ) ( regs[GFSK_RSSI_VALUE] / 2 );
+        status.rssi_pkt_dbm = status.rssi_dbm;
+
+        const int16_t fei = ( int16_t ) ( ( ( uint16_t ) regs[GFSK_FEI_MSB] << 8 ) | regs[GFSK_FEI_MSB + 1] );
+        status.fei_hz     = ( int32_t ) ( ( int64_t ) fei * GFSK_FSTEP_MHZ / 1000 );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    latched = status;
+    CRITICAL_SECTION_END( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
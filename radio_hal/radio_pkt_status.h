@@ -0,0 +1,88 @@
+/*!
+ * \file      radio_pkt_status.h
+ *
+ * \brief     SX127x packet status latched at the FIFO readout
+ *
+ * The radio HAL reads the packet status registers right after the driver
+ * reads a received packet out of the FIFO, in the same critical section, so
+ * the values belong to that packet and not to a later radio operation. The
+ * application reads the latched copy without any SPI transfer.
+ *
+ * Only a FIFO readout that follows a read of the IRQ flags showing RX done
+ * (LoRa RegIrqFlags RxDone, GFSK RegIrqFlags2 PayloadReady) is latched, once:
+ * other FIFO reads, e.g. the SPI benchmark ones, cost nothing more.
+ *
+ * LoRa: packet RSSI and SNR, RSSI and frequency error. GFSK: the chip keeps
+ * no per-packet RSSI, the RSSI is the one at the readout, the frequency error
+ * is the last FEI measurement.
+ */
+#ifndef RADIO_PKT_STATUS_H
+#define RADIO_PKT_STATUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "sx127x.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Latched packet status
+ */
+typedef struct radio_pkt_status_s
+{
+    uint32_t timestamp_ms;  //!< Modem time of the FIFO readout
+    uint32_t count;         //!< Readouts since startup
+    bool     is_lora;
+    uint8_t  size;          //!< Bytes read out of the FIFO
+    int16_t  rssi_pkt_dbm;  //!< Packet RSSI, LoRa; RSSI at the readout, GFSK
+    int16_t  rssi_dbm;      //!< RSSI at the readout
+    float    snr_db;        //!< Packet SNR, LoRa only
+    int32_t  fei_hz;        //!< Frequency error
+    uint32_t frequency_hz;  //!< RF frequency of the reception
+} radio_pkt_status_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Follows register reads, called by the radio HAL after each one, in its critical section
+ *
+ * \param [in] radio    Radio context
+ * \param [in] address  First register read
+ * \param [in] data     Values read
+ * \param [in] data_len Number of registers, or bytes read out of the FIFO
+ */
+void radio_pkt_status_on_register_read( const sx127x_t* radio, const uint16_t address, const uint8_t* data,
+                                        const uint16_t data_len );
+
+/*!
+ * Gets the status latched at the last FIFO readout
+ *
+ * \param [out] status Latched status
+ *
+ * \retval true if a packet was read out since startup
+ */
+bool radio_pkt_status_get( radio_pkt_status_t* status );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_PKT_STATUS_H
+
+/* --- EOF ------------------------------------------------------------------ */
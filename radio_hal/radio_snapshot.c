@@ -0,0 +1,321 @@
+/*!
+ * \file      radio_snapshot.c
+ *
+ * \brief     SX127x register map snapshot and decoder implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // size_t
+
+#include "radio_snapshot.h"
+#include "sx127x_hal.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+#define REG( snapshot, address ) ( ( snapshot )->regs[( address ) - RADIO_SNAPSHOT_FIRST_REG] )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define REG_OP_MODE 0x01
+#define REG_FRF_MSB 0x06
+#define REG_FRF_MID 0x07
+#define REG_FRF_LSB 0x08
+#define REG_PA_CONFIG 0x09
+#define REG_OCP 0x0B
+#define REG_LNA 0x0C
+#define REG_IRQ_FLAGS_MASK 0x11
+#define REG_IRQ_FLAGS 0x12
+#define REG_RX_NB_BYTES 0x13
+#define REG_MODEM_STAT 0x18
+#define REG_PKT_SNR_VALUE 0x19
+#define REG_PKT_RSSI_VALUE 0x1A
+#define REG_RSSI_VALUE 0x1B
+#define REG_MODEM_CONFIG_1 0x1D
+#define REG_MODEM_CONFIG_2 0x1E
+#define REG_SYMB_TIMEOUT_LSB 0x1F
+#define REG_PREAMBLE_MSB 0x20
+#define REG_PREAMBLE_LSB 0x21
+#define REG_PAYLOAD_LENGTH 0x22
+#define REG_MODEM_CONFIG_3 0x26
+#define REG_FEI_MSB 0x28
+#define REG_FEI_MID 0x29
+#define REG_FEI_LSB 0x2A
+#define REG_INVERT_IQ 0x33
+#define REG_SYNC_WORD 0x39
+#define REG_DIO_MAPPING_1 0x40
+#define REG_DIO_MAPPING_2 0x41
+#define REG_VERSION 0x42
+#define REG_PA_DAC 0x4D
+
+#define XTAL_FREQ_HZ 32000000
+
+/*!
+ * RSSI offsets of the HF (above 525 MHz) and LF ports
+ */
+#define RSSI_OFFSET_HF ( -157 )
+#define RSSI_OFFSET_LF ( -164 )
+#define RSSI_HF_PORT_MIN_HZ 525000000
+
+/*!
+ * PackBits run and literal limits
+ */
+#define PACKBITS_MAX_COUNT 128
+#define PACKBITS_MIN_RUN 3
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const uint32_t lora_bw_hz[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+
+static const char* mode_names[8] = { "sleep", "stdby", "fstx", "tx", "fsrx", "rxcont", "rxsingle", "cad" };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static size_t snapshot_run_length( const uint8_t* data, const size_t size, const size_t start );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void radio_snapshot_capture( const sx127x_t* radio, radio_snapshot_t* snapshot )
+{
+    snapshot->timestamp_ms = hal_rtc_get_time_ms( );
+    sx127x_hal_read( radio, RADIO_SNAPSHOT_FIRST_REG, snapshot->regs, RADIO_SNAPSHOT_NB_REGS );
+}
+
+uint8_t radio_snapshot_get_reg( const radio_snapshot_t* snapshot, const uint8_t address )
+{
+    if( ( address < RADIO_SNAPSHOT_FIRST_REG ) || ( address > RADIO_SNAPSHOT_LAST_REG ) )
+    {
+        return 0;
+    }
+    return REG( snapshot, address );
+}
+
+void radio_snapshot_decode( const radio_snapshot_t* snapshot, radio_snapshot_fields_t* fields )
+{
+    const uint8_t op_mode   = REG( snapshot, REG_OP_MODE );
+    const uint8_t pa_config = REG( snapshot, REG_PA_CONFIG );
+    const uint8_t ocp       = REG( snapshot, REG_OCP );
+    const uint8_t lna       = REG( snapshot, REG_LNA );
+    const uint8_t config_1  = REG( snapshot, REG_MODEM_CONFIG_1 );
+    const uint8_t config_2  = REG( snapshot, REG_MODEM_CONFIG_2 );
+    const uint8_t config_3  = REG( snapshot, REG_MODEM_CONFIG_3 );
+
+    fields->is_lora = ( op_mode & 0x80 ) != 0;
+    fields->mode    = op_mode & 0x07;
+
+    const uint32_t frf = ( ( uint32_t ) REG( snapshot, REG_FRF_MSB ) << 16 ) |
+                         ( ( uint32_t ) REG( snapshot, REG_FRF_MID ) << 8 ) | REG( snapshot, REG_FRF_LSB );
+    fields->frf_hz = ( uint32_t ) ( ( ( uint64_t ) frf * XTAL_FREQ_HZ ) >> 19 );
+
+    fields->pa_boost     = ( pa_config & 0x80 ) != 0;
+    fields->max_power    = ( pa_config >> 4 ) & 0x07;
+    fields->output_power = pa_config & 0x0F;
+    fields->pa_dac_20dbm = ( REG( snapshot, REG_PA_DAC ) & 0x07 ) == 0x07;
+    fields->ocp_on       = ( ocp & 0x20 ) != 0;
+    fields->ocp_trim     = ocp & 0x1F;
+    fields->lna_gain     = ( lna >> 5 ) & 0x07;
+    fields->lna_boost_hf = ( lna & 0x03 ) == 0x03;
+
+    fields->irq_flags_mask = REG( snapshot, REG_IRQ_FLAGS_MASK );
+    fields->irq_flags      = REG( snapshot, REG_IRQ_FLAGS );
+    fields->rx_nb_bytes    = REG( snapshot, REG_RX_NB_BYTES );
+    fields->modem_status   = REG( snapshot, REG_MODEM_STAT );
+
+    const int16_t rssi_offset = ( fields->frf_hz > RSSI_HF_PORT_MIN_HZ ) ? RSSI_OFFSET_HF : RSSI_OFFSET_LF;
+    const int8_t  snr_raw     = ( int8_t ) REG( snapshot, REG_PKT_SNR_VALUE );
+    fields->pkt_snr_db        = ( float ) snr_raw / 4.0f;
+    fields->pkt_rssi_dbm      = rssi_offset + REG( snapshot, REG_PKT_RSSI_VALUE );
+    if( snr_raw < 0 )
+    {
+        fields->pkt_rssi_dbm += snr_raw / 4;
+    }
+    fields->rssi_dbm = rssi_offset + REG( snapshot, REG_RSSI_VALUE );
+
+    const uint8_t bw_index = config_1 >> 4;
+    fields->bw_hz = ( bw_index < ( sizeof( lora_bw_hz ) / sizeof( lora_bw_hz[0] ) ) ) ? lora_bw_hz[bw_index] : 0;
+    fields->cr    = ( ( config_1 >> 1 ) & 0x07 ) + 4;
+    fields->implicit_header = ( config_1 & 0x01 ) != 0;
+
+    fields->sf           = config_2 >> 4;
+    fields->crc_on       = ( config_2 & 0x04 ) != 0;
+    fields->symb_timeout = ( ( uint16_t ) ( config_2 & 0x03 ) << 8 ) | REG( snapshot, REG_SYMB_TIMEOUT_LSB );
+    fields->preamble_len =
+        ( ( uint16_t ) REG( snapshot, REG_PREAMBLE_MSB ) << 8 ) | REG( snapshot, REG_PREAMBLE_LSB );
+    fields->payload_len            = REG( snapshot, REG_PAYLOAD_LENGTH );
+    fields->low_data_rate_optimize = ( config_3 & 0x08 ) != 0;
+    fields->agc_auto_on            = ( config_3 & 0x04 ) != 0;
+
+    fields->fei_hz = radio_snapshot_fei_to_hz( &REG( snapshot, REG_FEI_MSB ), fields->bw_hz );
+
+    fields->invert_iq     = ( REG( snapshot, REG_INVERT_IQ ) & 0x40 ) != 0;
+    fields->sync_word     = REG( snapshot, REG_SYNC_WORD );
+    fields->dio_mapping_1 = REG( snapshot, REG_DIO_MAPPING_1 );
+    fields->dio_mapping_2 = REG( snapshot, REG_DIO_MAPPING_2 );
+    fields->version       = REG( snapshot, REG_VERSION );
+}
+
+int32_t radio_snapshot_fei_to_hz( const uint8_t fei_regs[3], const uint32_t bw_hz )
+{
+    // 20-bit two's complement, scaled by 2^24 / Fxtal * BW / 500 kHz
+    int32_t fei = ( ( int32_t ) ( fei_regs[0] & 0x0F ) << 16 ) | ( ( int32_t ) fei_regs[1] << 8 ) | fei_regs[2];
+    if( fei & 0x80000 )
+    {
+        fei -= 0x100000;
+    }
+    return ( int32_t ) ( ( int64_t ) fei * ( 1 << 24 ) * ( int64_t ) bw_hz / ( ( int64_t ) XTAL_FREQ_HZ * 500000 ) );
+}
+
+void radio_snapshot_print( const radio_snapshot_fields_t* fields )
+{
+    SMTC_HAL_TRACE_PRINTF( "Radio snapshot: version 0x%02x, %s %s, %lu Hz\n", fields->version,
+                           fields->is_lora ? "lora" : "fsk", mode_names[fields->mode & 0x07],
+                           ( unsigned long ) fields->frf_hz );
+    SMTC_HAL_TRACE_PRINTF( "  pa %s max %u out %u dac20 %u, ocp %u trim %u, lna gain %u boost %u\n",
+                           fields->pa_boost ? "boost" : "rfo", fields->max_power, fields->output_power,
+                           fields->pa_dac_20dbm, fields->ocp_on, fields->ocp_trim, fields->lna_gain,
+                           fields->lna_boost_hf );
+    if( !fields->is_lora )
+    {
+        return;
+    }
+    SMTC_HAL_TRACE_PRINTF( "  SF%u BW%lu CR4/%u, %s header, crc %u, ldro %u, agc %u, iq %s, sync 0x%02x\n",
+                           fields->sf, ( unsigned long ) fields->bw_hz, fields->cr,
+                           fields->implicit_header ? "implicit" : "explicit", fields->crc_on,
+                           fields->low_data_rate_optimize, fields->agc_auto_on,
+                           fields->invert_iq ? "inverted" : "normal", fields->sync_word );
+    SMTC_HAL_TRACE_PRINTF( "  preamble %u, payload %u, symb timeout %u, dio map 0x%02x 0x%02x\n",
+                           fields->preamble_len, fields->payload_len, fields->symb_timeout,
+                           fields->dio_mapping_1, fields->dio_mapping_2 );
+    SMTC_HAL_TRACE_PRINTF( "  irq 0x%02x mask 0x%02x, modem stat 0x%02x, rx bytes %u, "
+                           "pkt rssi %d dBm snr %.2f dB, rssi %d dBm, fei %ld Hz\n",
+                           fields->irq_flags, fields->irq_flags_mask, fields->modem_status, fields->rx_nb_bytes,
+                           fields->pkt_rssi_dbm, ( double ) fields->pkt_snr_db, fields->rssi_dbm,
+                           ( long ) fields->fei_hz );
+}
+
+size_t radio_snapshot_compress( const radio_snapshot_t* snapshot, uint8_t* out, const size_t out_size )
+{
+    const uint8_t* in      = snapshot->regs;
+    size_t         in_pos  = 0;
+    size_t         out_pos = 0;
+
+    while( in_pos < RADIO_SNAPSHOT_NB_REGS )
+    {
+        size_t run = snapshot_run_length( in, RADIO_SNAPSHOT_NB_REGS, in_pos );
+
+        if( run >= PACKBITS_MIN_RUN )
+        {
+            if( ( out_pos + 2 ) > out_size )
+            {
+                return 0;
+            }
+            out[out_pos++] = ( uint8_t ) ( 1 - ( int ) run );
+            out[out_pos++] = in[in_pos];
+            in_pos += run;
+            continue;
+        }
+
+        // Literal block up to the next run worth encoding
+        size_t literal = 0;
+        while( ( ( in_pos + literal ) < RADIO_SNAPSHOT_NB_REGS ) && ( literal < PACKBITS_MAX_COUNT ) &&
+               ( snapshot_run_length( in, RADIO_SNAPSHOT_NB_REGS, in_pos + literal ) < PACKBITS_MIN_RUN ) )
+        {
+            literal++;
+        }
+        if( ( out_pos + 1 + literal ) > out_size )
+        {
+            return 0;
+        }
+        out[out_pos++] = ( uint8_t ) ( literal - 1 );
+        for( size_t i = 0; i < literal; i++ )
+        {
+            out[out_pos++] = in[in_pos++];
+        }
+    }
+
+    return out_pos;
+}
+
+bool radio_snapshot_decompress( const uint8_t* in, const size_t in_size, radio_snapshot_t* snapshot )
+{
+    size_t in_pos  = 0;
+    size_t out_pos = 0;
+
+    while( in_pos < in_size )
+    {
+        const int8_t header = ( int8_t ) in[in_pos++];
+
+        if( header >= 0 )
+        {
+            const size_t literal = ( size_t ) header + 1;
+            if( ( ( in_pos + literal ) > in_size ) || ( ( out_pos + literal ) > RADIO_SNAPSHOT_NB_REGS ) )
+            {
+                return false;
+            }
+            for( size_t i = 0; i < literal; i++ )
+            {
+                snapshot->regs[out_pos++] = in[in_pos++];
+            }
+        }
+        else if( header != -128 )
+        {
+            const size_t run = 1 - ( int ) header;
+            if( ( in_pos >= in_size ) || ( ( out_pos + run ) > RADIO_SNAPSHOT_NB_REGS ) )
+            {
+                return false;
+            }
+            for( size_t i = 0; i < run; i++ )
+            {
+                snapshot->regs[out_pos++] = in[in_pos];
+            }
+            in_pos++;
+        }
+    }
+
+    return out_pos == RADIO_SNAPSHOT_NB_REGS;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static size_t snapshot_run_length( const uint8_t* data, const size_t size, const size_t start )
+{
+    size_t run = 1;
+
+    while( ( ( start + run ) < size ) && ( run < PACKBITS_MAX_COUNT ) && ( data[start + run] == data[start] ) )
+    {
+        run++;
+    }
+    return run;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
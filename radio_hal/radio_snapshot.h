@@ -0,0 +1,185 @@
+/*!
+ * \file      radio_snapshot.h
+ *
+ * \brief     SX127x register map snapshot and decoder
+ *
+ * The whole register map (RegOpMode to RegPllHf) is read in a single SPI burst,
+ * RegFifo is skipped since reading it moves the FIFO pointer. Reads have no
+ * effect on the radio, a snapshot can be taken in any state; the transfer holds
+ * the radio HAL critical section for about 2 ms at the 500 kHz SPI clock.
+ *
+ * The decoder follows the SX1276/77/78/79 LoRa register map. Snapshots are
+ * compressed with PackBits for logging, most of the map is zeros or defaults.
+ */
+#ifndef RADIO_SNAPSHOT_H
+#define RADIO_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // size_t
+
+#include "sx127x.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Snapshot register range
+ */
+#define RADIO_SNAPSHOT_FIRST_REG 0x01
+#define RADIO_SNAPSHOT_LAST_REG 0x70
+#define RADIO_SNAPSHOT_NB_REGS ( RADIO_SNAPSHOT_LAST_REG - RADIO_SNAPSHOT_FIRST_REG + 1 )
+
+/*!
+ * Worst case PackBits output size, one header byte per 128 literal bytes
+ */
+#define RADIO_SNAPSHOT_COMPRESSED_MAX_SIZE ( RADIO_SNAPSHOT_NB_REGS + ( RADIO_SNAPSHOT_NB_REGS + 127 ) / 128 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Raw register snapshot
+ */
+typedef struct radio_snapshot_s
+{
+    uint32_t timestamp_ms;                 //!< Modem time of the capture
+    uint8_t  regs[RADIO_SNAPSHOT_NB_REGS];  //!< regs[0] is RegOpMode
+} radio_snapshot_t;
+
+/*!
+ * Decoded snapshot, LoRa fields are only meaningful when is_lora is set
+ */
+typedef struct radio_snapshot_fields_s
+{
+    bool     is_lora;
+    uint8_t  mode;  //!< RegOpMode Mode field, 0 sleep to 7 CAD
+    uint32_t frf_hz;
+    bool     pa_boost;
+    uint8_t  max_power;
+    uint8_t  output_power;
+    bool     pa_dac_20dbm;
+    bool     ocp_on;
+    uint8_t  ocp_trim;
+    uint8_t  lna_gain;
+    bool     lna_boost_hf;
+    uint8_t  irq_flags_mask;
+    uint8_t  irq_flags;
+    uint8_t  rx_nb_bytes;
+    uint8_t  modem_status;
+    float    pkt_snr_db;
+    int16_t  pkt_rssi_dbm;
+    int16_t  rssi_dbm;
+    uint32_t bw_hz;
+    uint8_t  cr;  //!< Coding rate denominator, 5 to 8
+    bool     implicit_header;
+    uint8_t  sf;
+    bool     crc_on;
+    uint16_t symb_timeout;
+    uint16_t preamble_len;
+    uint8_t  payload_len;
+    bool     low_data_rate_optimize;
+    bool     agc_auto_on;
+    int32_t  fei_hz;
+    bool     invert_iq;
+    uint8_t  sync_word;
+    uint8_t  dio_mapping_1;
+    uint8_t  dio_mapping_2;
+    uint8_t  version;
+} radio_snapshot_fields_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the register map
+ *
+ * \param [in]  radio    Radio context
+ * \param [out] snapshot Register snapshot
+ */
+void radio_snapshot_capture( const sx127x_t* radio, radio_snapshot_t* snapshot );
+
+/*!
+ * Gets a register value from a snapshot
+ *
+ * \param [in] snapshot Register snapshot
+ * \param [in] address  Register address
+ *
+ * \retval register value, 0 outside of the snapshot range
+ */
+uint8_t radio_snapshot_get_reg( const radio_snapshot_t* snapshot, const uint8_t address );
+
+/*!
+ * Decodes a snapshot into named fields
+ *
+ * \param [in]  snapshot Register snapshot
+ * \param [out] fields   Decoded fields
+ */
+void radio_snapshot_decode( const radio_snapshot_t* snapshot, radio_snapshot_fields_t* fields );
+
+/*!
+ * Converts RegFeiMsb/Mid/Lsb to a frequency error
+ *
+ * \param [in] fei_regs RegFeiMsb, RegFeiMid and RegFeiLsb values
+ * \param [in] bw_hz    LoRa bandwidth
+ *
+ * \retval frequency error in Hz
+ */
+int32_t radio_snapshot_fei_to_hz( const uint8_t fei_regs[3], const uint32_t bw_hz );
+
+/*!
+ * Traces the decoded fields
+ *
+ * \param [in] fields Decoded fields
+ */
+void radio_snapshot_print( const radio_snapshot_fields_t* fields );
+
+/*!
+ * Compresses a snapshot register map with PackBits
+ *
+ * \param [in]  snapshot Register snapshot
+ * \param [out] out      Compressed data, RADIO_SNAPSHOT_COMPRESSED_MAX_SIZE bytes is always enough
+ * \param [in]  out_size Size of out
+ *
+ * \retval compressed size, 0 if out is too small
+ */
+size_t radio_snapshot_compress( const radio_snapshot_t* snapshot, uint8_t* out, const size_t out_size );
+
+/*!
+ * Restores a snapshot register map from PackBits data
+ *
+ * \param [in]  in       Compressed data
+ * \param [in]  in_size  Size of the compressed data
+ * \param [out] snapshot Register snapshot, timestamp is left untouched
+ *
+ * \retval true if the data expanded to exactly one register map
+ */
+bool radio_snapshot_decompress( const uint8_t* in, const size_t in_size, radio_snapshot_t* snapshot );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_SNAPSHOT_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,238 @@
+/*!
+ * \file      radio_state_time.c
+ *
+ * \brief     SX127x operating mode time accounting implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+#include <time.h>
+
+#include "radio_state_time.h"
+
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define REG_OP_MODE 0x01
+
+#define OP_MODE_MODE_MASK 0x07
+#define OP_MODE_SLEEP 0x00
+#define OP_MODE_STDBY 0x01
+#define OP_MODE_FSTX 0x02
+#define OP_MODE_TX 0x03
+#define OP_MODE_FSRX 0x04
+#define OP_MODE_RX_CONTINUOUS 0x05
+#define OP_MODE_RX_SINGLE 0x06
+#define OP_MODE_CAD 0x07
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t  op_mode         = OP_MODE_SLEEP;
+static uint64_t segment_start   = 0;
+static uint64_t rx_window_start = 0;
+
+static radio_state_time_report_t report_data;
+
+static const char* state_names[RADIO_STATE_NB] = {
+    [RADIO_STATE_SLEEP] = "sleep", [RADIO_STATE_STANDBY] = "standby", [RADIO_STATE_SYNTH] = "synth",
+    [RADIO_STATE_TX] = "tx",       [RADIO_STATE_RX] = "rx",           [RADIO_STATE_CAD] = "cad",
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static radio_state_t state_time_from_op_mode( const uint8_t mode );
+
+static void state_time_set_op_mode( const uint8_t mode, const uint64_t now );
+
+static void state_time_close_segment( const uint64_t now );
+
+static void state_time_count_rx_packet( const uint64_t now );
+
+static uint64_t state_time_now_us( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void radio_state_time_on_register_write( const uint16_t address, const uint8_t* data, const uint16_t data_len )
+{
+    // Address 0 is the FIFO, burst accesses do not increment the address
+    if( ( address == 0 ) || ( address > REG_OP_MODE ) || ( address + data_len <= REG_OP_MODE ) )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    state_time_set_op_mode( data[REG_OP_MODE - address], state_time_now_us( ) );
+    CRITICAL_SECTION_END( );
+}
+
+bool radio_state_time_on_dio_irq( const radio_state_dio_t dio, uint8_t* new_op_mode )
+{
+    bool changed = false;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    const uint64_t now  = state_time_now_us( );
+    const uint8_t  mode = op_mode & OP_MODE_MODE_MASK;
+
+    if( ( dio == RADIO_STATE_DIO_0 ) && ( ( mode == OP_MODE_RX_SINGLE ) || ( mode == OP_MODE_RX_CONTINUOUS ) ) )
+    {
+        state_time_count_rx_packet( now );
+    }
+
+    switch( mode )
+    {
+    case OP_MODE_TX:
+    case OP_MODE_CAD:
+        changed = ( dio == RADIO_STATE_DIO_0 );
+        break;
+    case OP_MODE_RX_SINGLE:
+        changed = ( dio == RADIO_STATE_DIO_0 ) || ( dio == RADIO_STATE_DIO_1 );
+        break;
+    default:
+        break;
+    }
+
+    if( changed )
+    {
+        state_time_set_op_mode( ( op_mode & ~OP_MODE_MODE_MASK ) | OP_MODE_STDBY, now );
+        *new_op_mode = op_mode;
+    }
+
+    CRITICAL_SECTION_END( );
+
+    return changed;
+}
+
+radio_state_t radio_state_time_get_state( void )
+{
+    return state_time_from_op_mode( op_mode );
+}
+
+void radio_state_time_get_report( radio_state_time_report_t* report )
+{
+    CRITICAL_SECTION_BEGIN( );
+    state_time_close_segment( state_time_now_us( ) );
+    *report = report_data;
+    CRITICAL_SECTION_END( );
+}
+
+void radio_state_time_reset_uplink( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    state_time_close_segment( state_time_now_us( ) );
+    memset( &report_data.uplink, 0, sizeof( report_data.uplink ) );
+    CRITICAL_SECTION_END( );
+}
+
+const char* radio_state_time_get_name( const radio_state_t state )
+{
+    return ( state < RADIO_STATE_NB ) ? state_names[state] : "?";
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static radio_state_t state_time_from_op_mode( const uint8_t mode )
+{
+    switch( mode & OP_MODE_MODE_MASK )
+    {
+    case OP_MODE_SLEEP:
+        return RADIO_STATE_SLEEP;
+    case OP_MODE_STDBY:
+        return RADIO_STATE_STANDBY;
+    case OP_MODE_FSTX:
+    case OP_MODE_FSRX:
+        return RADIO_STATE_SYNTH;
+    case OP_MODE_TX:
+        return RADIO_STATE_TX;
+    case OP_MODE_CAD:
+        return RADIO_STATE_CAD;
+    default:
+        return RADIO_STATE_RX;
+    }
+}
+
+static void state_time_set_op_mode( const uint8_t mode, const uint64_t now )
+{
+    const bool was_rx = state_time_from_op_mode( op_mode ) == RADIO_STATE_RX;
+    const bool is_rx  = state_time_from_op_mode( mode ) == RADIO_STATE_RX;
+
+    state_time_close_segment( now );
+    op_mode = mode;
+
+    if( is_rx && !was_rx )
+    {
+        rx_window_start = now;
+        report_data.uplink.rx_windows++;
+        report_data.total.rx_windows++;
+    }
+}
+
+static void state_time_close_segment( const uint64_t now )
+{
+    if( segment_start != 0 )
+    {
+        const radio_state_t state = state_time_from_op_mode( op_mode );
+        report_data.uplink.state_us[state] += now - segment_start;
+        report_data.total.state_us[state] += now - segment_start;
+    }
+    segment_start = now;
+}
+
+static void state_time_count_rx_packet( const uint64_t now )
+{
+    report_data.uplink.rx_useful_us += now - rx_window_start;
+    report_data.total.rx_useful_us += now - rx_window_start;
+    report_data.uplink.rx_packets++;
+    report_data.total.rx_packets++;
+
+    // In RX continuous the radio keeps listening, the next packet opens a new window
+    if( ( op_mode & OP_MODE_MODE_MASK ) == OP_MODE_RX_CONTINUOUS )
+    {
+        rx_window_start = now;
+        report_data.uplink.rx_windows++;
+        report_data.total.rx_windows++;
+    }
+}
+
+static uint64_t state_time_now_us( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
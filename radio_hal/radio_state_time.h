@@ -0,0 +1,147 @@
+/*!
+ * \file      radio_state_time.h
+ *
+ * \brief     SX127x operating mode time accounting
+ *
+ * The radio HAL reports every RegOpMode write and every DIO interrupt. Writes
+ * give the modes selected by the driver, DIO interrupts the transitions the
+ * radio makes on its own (TX done, RX done/timeout in single mode, CAD done
+ * all fall back to standby).
+ *
+ * RX time is split between the whole window on-time and the useful part, i.e.
+ * the windows that ended with a received packet. The difference is the time
+ * spent listening for nothing, which is what RX window tuning can save.
+ */
+#ifndef RADIO_STATE_TIME_H
+#define RADIO_STATE_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Radio states
+ */
+typedef enum radio_state_e
+{
+    RADIO_STATE_SLEEP,
+    RADIO_STATE_STANDBY,
+    RADIO_STATE_SYNTH,  //!< FSTX and FSRX
+    RADIO_STATE_TX,
+    RADIO_STATE_RX,  //!< RX continuous and RX single
+    RADIO_STATE_CAD,
+    RADIO_STATE_NB,
+} radio_state_t;
+
+/*!
+ * DIO lines reported by the radio HAL
+ */
+typedef enum radio_state_dio_e
+{
+    RADIO_STATE_DIO_0,  //!< TX done, RX done, CAD done
+    RADIO_STATE_DIO_1,  //!< RX timeout
+    RADIO_STATE_DIO_2,
+} radio_state_dio_t;
+
+/*!
+ * Time spent in each state
+ */
+typedef struct radio_state_time_s
+{
+    uint64_t state_us[RADIO_STATE_NB];
+    uint64_t rx_useful_us;  //!< RX time of the windows that received a packet
+    uint32_t rx_windows;    //!< Number of RX windows
+    uint32_t rx_packets;    //!< Number of RX windows that received a packet
+} radio_state_time_t;
+
+/*!
+ * Per-uplink and cumulative time report
+ */
+typedef struct radio_state_time_report_s
+{
+    radio_state_time_t uplink;  //!< Since radio_state_time_reset_uplink
+    radio_state_time_t total;   //!< Since startup
+} radio_state_time_report_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Notifies a register write, to be called by the radio HAL
+ *
+ * \param [in] address  First register address
+ * \param [in] data     Written values
+ * \param [in] data_len Number of registers written
+ */
+void radio_state_time_on_register_write( const uint16_t address, const uint8_t* data, const uint16_t data_len );
+
+/*!
+ * Notifies a DIO interrupt, to be called by the radio HAL
+ *
+ * \param [in]  dio         DIO line
+ * \param [out] new_op_mode RegOpMode value the radio switched to on its own
+ *
+ * \retval true if the interrupt ended a TX, RX single or CAD operation
+ */
+bool radio_state_time_on_dio_irq( const radio_state_dio_t dio, uint8_t* new_op_mode );
+
+/*!
+ * Gets the current radio state
+ *
+ * \retval radio state
+ */
+radio_state_t radio_state_time_get_state( void );
+
+/*!
+ * Gets the time spent in each state so far
+ *
+ * \param [out] report Time report
+ */
+void radio_state_time_get_report( radio_state_time_report_t* report );
+
+/*!
+ * Starts a new per-uplink accounting period
+ */
+void radio_state_time_reset_uplink( void );
+
+/*!
+ * Gets a state name
+ *
+ * \param [in] state Radio state
+ *
+ * \retval state name
+ */
+const char* radio_state_time_get_name( const radio_state_t state );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_STATE_TIME_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,116 @@
+/*!
+ * \file      radio_temperature.c
+ *
+ * \brief     SX127x on-chip temperature sensor implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_temperature.h"
+#include "radio_state_time.h"
+#include "sx127x_hal.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_board_profile.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define REG_OP_MODE 0x01
+#define REG_IMAGE_CAL 0x3B
+#define REG_TEMP 0x3C
+
+#define OP_MODE_LONG_RANGE 0x80
+#define OP_MODE_MODE_MASK 0x07
+#define OP_MODE_SLEEP 0x00
+#define OP_MODE_STDBY 0x01
+#define OP_MODE_FSRX 0x04
+
+#define IMAGE_CAL_TEMP_MONITOR_OFF 0x01
+
+/*!
+ * The datasheet asks for at least 140 us in FSRX
+ */
+#define TEMP_SAMPLE_US 150
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void temperature_write_reg( const sx127x_t* radio, const uint8_t address, const uint8_t value );
+
+static uint8_t temperature_read_reg( const sx127x_t* radio, const uint8_t address );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool radio_temperature_read( const sx127x_t* radio, int8_t* temperature_c )
+{
+    int32_t offset_c = 0;
+    hal_board_profile_get_int( "radio.temp_offset_c", &offset_c );
+
+    // Hold off the modem timers and DIO handling for the whole sequence
+    CRITICAL_SECTION_BEGIN( );
+
+    if( radio_state_time_get_state( ) != RADIO_STATE_SLEEP )
+    {
+        CRITICAL_SECTION_END( );
+        return false;
+    }
+
+    const uint8_t op_mode = temperature_read_reg( radio, REG_OP_MODE );
+    const uint8_t fsk     = op_mode & ~( OP_MODE_LONG_RANGE | OP_MODE_MODE_MASK );
+
+    // LongRangeMode can only be changed in sleep
+    temperature_write_reg( radio, REG_OP_MODE, fsk | OP_MODE_SLEEP );
+    temperature_write_reg( radio, REG_OP_MODE, fsk | OP_MODE_STDBY );
+
+    const uint8_t image_cal = temperature_read_reg( radio, REG_IMAGE_CAL );
+    temperature_write_reg( radio, REG_IMAGE_CAL, image_cal & ~IMAGE_CAL_TEMP_MONITOR_OFF );
+    temperature_write_reg( radio, REG_OP_MODE, fsk | OP_MODE_FSRX );
+    hal_mcu_wait_us( TEMP_SAMPLE_US );
+    temperature_write_reg( radio, REG_OP_MODE, fsk | OP_MODE_STDBY );
+    temperature_write_reg( radio, REG_IMAGE_CAL, image_cal | IMAGE_CAL_TEMP_MONITOR_OFF );
+
+    const int8_t raw = ( int8_t ) temperature_read_reg( radio, REG_TEMP );
+
+    temperature_write_reg( radio, REG_OP_MODE, fsk | OP_MODE_SLEEP );
+    temperature_write_reg( radio, REG_OP_MODE, op_mode );
+
+    CRITICAL_SECTION_END( );
+
+    // Two's complement, -1 degree per LSB
+    const int32_t value = -( int32_t ) raw + offset_c;
+    *temperature_c      = ( value < INT8_MIN ) ? INT8_MIN : ( value > INT8_MAX ) ? INT8_MAX : ( int8_t ) value;
+
+    return true;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void temperature_write_reg( const sx127x_t* radio, const uint8_t address, const uint8_t value )
+{
+    sx127x_hal_write( radio, address, &value, 1 );
+}
+
+static uint8_t temperature_read_reg( const sx127x_t* radio, const uint8_t address )
+{
+    uint8_t value = 0;
+    sx127x_hal_read( radio, address, &value, 1 );
+    return value;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,53 @@
+/*!
+ * \file      radio_temperature.h
+ *
+ * \brief     SX127x on-chip temperature sensor
+ *
+ * The sensor is only available in FSK mode: the radio is switched from LoRa
+ * sleep to FSK, the sensor is sampled during a short FSRX and the radio is put
+ * back to LoRa sleep. The read takes well under a millisecond and is refused
+ * unless the radio is asleep, the modem reconfigures the radio before each
+ * TX or RX anyway.
+ *
+ * RegTemp has a -1 degree per LSB slope and an uncalibrated offset, the
+ * radio.temp_offset_c board profile key corrects it.
+ */
+#ifndef RADIO_TEMPERATURE_H
+#define RADIO_TEMPERATURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "sx127x.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the radio temperature
+ *
+ * \param [in]  radio         Radio context
+ * \param [out] temperature_c Calibrated temperature in degrees Celsius
+ *
+ * \retval true if read, false if the radio was not asleep
+ */
+bool radio_temperature_read( const sx127x_t* radio, int8_t* temperature_c );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_TEMPERATURE_H
+
+/* --- EOF ------------------------------------------------------------------ */
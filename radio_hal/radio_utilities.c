@@ -41,6 +41,8 @@
 #include <stdbool.h>  // bool type
 
 #include "radio_utilities.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -54,23 +56,42 @@
 #ifndef DEFAULT_TX_POWER_OFFSET_DB
 #define DEFAULT_TX_POWER_OFFSET_DB ( 0 )
 #endif
+
+#define TX_POWER_CAL_MAX_POINTS 32
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+typedef struct tx_power_cal_table_s
+{
+    hal_board_profile_point_t points[TX_POWER_CAL_MAX_POINTS];
+    uint8_t                   nb;
+} tx_power_cal_table_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
 static int8_t board_tx_pwr_offset_db = DEFAULT_TX_POWER_OFFSET_DB;
+static bool   board_tx_pwr_offset_set = false;
+
+static tx_power_cal_table_t tx_pwr_cal_rfo;
+static tx_power_cal_table_t tx_pwr_cal_boost;
+static bool                 tx_pwr_cal_loaded = false;
+
+static uint32_t reset_ready_time_us = 0;
 
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+static void tx_power_cal_load( void );
+
+static void tx_power_cal_load_table( tx_power_cal_table_t* table, const char* key );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -78,17 +99,91 @@ static int8_t board_tx_pwr_offset_db = DEFAULT_TX_POWER_OFFSET_DB;
 
 void radio_utilities_set_tx_power_offset( int8_t tx_pwr_offset_db )
 {
-    board_tx_pwr_offset_db = tx_pwr_offset_db;
+    board_tx_pwr_offset_db  = tx_pwr_offset_db;
+    board_tx_pwr_offset_set = true;
 }
 
 int8_t radio_utilities_get_tx_power_offset( void )
 {
+    if( !board_tx_pwr_offset_set )
+    {
+        // Board profile value, unless the application already set one
+        int32_t offset;
+        if( hal_board_profile_get_int( "radio.tx_power_offset_db", &offset ) && ( offset >= INT8_MIN ) &&
+            ( offset <= INT8_MAX ) )
+        {
+            board_tx_pwr_offset_db = ( int8_t ) offset;
+        }
+        board_tx_pwr_offset_set = true;
+    }
     return board_tx_pwr_offset_db;
 }
 
+float radio_utilities_get_tx_power_cal_db( const uint32_t freq_in_hz, const bool pa_boost )
+{
+    tx_power_cal_load( );
+
+    const tx_power_cal_table_t* table = pa_boost ? &tx_pwr_cal_boost : &tx_pwr_cal_rfo;
+    if( table->nb == 0 )
+    {
+        return 0.0f;
+    }
+    return hal_board_profile_interpolate( table->points, table->nb, ( int32_t ) ( freq_in_hz / 1000 ) );
+}
+
+uint32_t radio_utilities_get_reset_ready_time_us( void )
+{
+    return reset_ready_time_us;
+}
+
+void radio_utilities_set_reset_ready_time_us( const uint32_t ready_time_us )
+{
+    reset_ready_time_us = ready_time_us;
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void tx_power_cal_load( void )
+{
+    if( tx_pwr_cal_loaded )
+    {
+        return;
+    }
+    tx_pwr_cal_loaded = true;
+
+    const char* path;
+    if( hal_board_profile_get_str( "radio.tx_power_cal_file", &path ) )
+    {
+        if( !hal_board_profile_load_file( path ) )
+        {
+            SMTC_HAL_TRACE_WARNING( "Cannot read TX power calibration file %s\n", path );
+        }
+    }
+
+    tx_power_cal_load_table( &tx_pwr_cal_rfo, "radio.tx_power_cal_db" );
+    tx_pwr_cal_boost = tx_pwr_cal_rfo;
+    tx_power_cal_load_table( &tx_pwr_cal_rfo, "radio.tx_power_cal_rfo_db" );
+    tx_power_cal_load_table( &tx_pwr_cal_boost, "radio.tx_power_cal_boost_db" );
+
+    if( ( tx_pwr_cal_rfo.nb != 0 ) || ( tx_pwr_cal_boost.nb != 0 ) )
+    {
+        SMTC_HAL_TRACE_INFO( "TX power calibration: %u RFO points, %u PA_BOOST points\n", tx_pwr_cal_rfo.nb,
+                             tx_pwr_cal_boost.nb );
+    }
+}
+
+static void tx_power_cal_load_table( tx_power_cal_table_t* table, const char* key )
+{
+    tx_power_cal_table_t tmp;
+
+    tmp.nb = hal_board_profile_get_table( key, tmp.points, TX_POWER_CAL_MAX_POINTS );
+    if( tmp.nb != 0 )
+    {
+        *table = tmp;
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -81,6 +81,37 @@ int8_t radio_utilities_get_tx_power_offset( void );
  */
 void radio_utilities_set_tx_power_offset( int8_t tx_pwr_offset_db );
 
+/**
+ * @brief Get the Tx power calibration at a given frequency
+ *
+ * @remark The calibration tables are read from the board profile, frequencies in kHz:
+ *   radio.tx_power_cal_db       = <kHz>:<dB>, ...   (both PA paths)
+ *   radio.tx_power_cal_rfo_db   = <kHz>:<dB>, ...   (RFO only, overrides the above)
+ *   radio.tx_power_cal_boost_db = <kHz>:<dB>, ...   (PA_BOOST only, overrides the above)
+ *   radio.tx_power_cal_file     = <path>            (profile file merged before reading the tables)
+ * Values between points are interpolated, 0 dB without table.
+ *
+ * @param [in] freq_in_hz RF frequency
+ * @param [in] pa_boost   true for the PA_BOOST path, false for RFO
+ *
+ * @return Tx power correction in dB, to be added to the requested power
+ */
+float radio_utilities_get_tx_power_cal_db( const uint32_t freq_in_hz, const bool pa_boost );
+
+/**
+ * @brief Get the time the radio took to answer after its last reset
+ *
+ * @return Time from reset release to a valid version register read in us, 0 if the radio did not answer
+ */
+uint32_t radio_utilities_get_reset_ready_time_us( void );
+
+/**
+ * @brief Record the time the radio took to answer after a reset, called by the radio HAL
+ *
+ * @param [in] ready_time_us Time from reset release to a valid version register read in us, 0 on timeout
+ */
+void radio_utilities_set_reset_ready_time_us( const uint32_t ready_time_us );
+
 #ifdef __cplusplus
 }
 #endif
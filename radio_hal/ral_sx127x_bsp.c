@@ -42,6 +42,12 @@
 
 #include "ral_sx127x_bsp.h"
 #include "radio_utilities.h"
+#include "radio_energy.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+#include <string.h>
+#include <math.h>
 
 /*
  * -----------------------------------------------------------------------------
@@ -50,7 +56,9 @@
 #define SX1276MB1LAS 0
 #define SX1276MB1MAS 1
 
+#ifndef SX1276_MBED_SHIELD
 #define SX1276_MBED_SHIELD SX1276MB1MAS
+#endif
 
 /*
  * -----------------------------------------------------------------------------
@@ -62,16 +70,43 @@
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/*!
+ * PA paths wired on the board, selected by the radio.pa board profile key
+ */
+typedef enum bsp_pa_wiring_e
+{
+    BSP_PA_WIRING_RFO,       //!< "rfo": RFO only (SX1276MB1MAS)
+    BSP_PA_WIRING_BOOST,     //!< "boost": PA_BOOST only
+    BSP_PA_WIRING_BOOST_HF,  //!< "boost_hf": PA_BOOST above the mid band, RFO below (SX1276MB1LAS)
+    BSP_PA_WIRING_AUTO,      //!< "auto": both paths, the one reaching the power at the lowest current is used
+} bsp_pa_wiring_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+#if defined( SX1276 )
+#if ( SX1276_MBED_SHIELD == SX1276MB1LAS )
+static bsp_pa_wiring_t pa_wiring = BSP_PA_WIRING_BOOST_HF;
+#else
+static bsp_pa_wiring_t pa_wiring = BSP_PA_WIRING_RFO;
+#endif
+static bool pa_wiring_loaded  = false;
+static bool pa_boost_20dbm_on = true;
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+#if defined( SX1276 )
+static void bsp_pa_wiring_load( void );
+
+static bool bsp_pa_boost_selected( const uint32_t freq_in_hz, const int16_t power );
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -90,27 +125,27 @@ void ral_sx127x_bsp_get_tx_cfg( const void* context, const ral_sx127x_bsp_tx_cfg
     output_params->pa_cfg.pa_select           = SX127X_PA_SELECT_RFO;
     output_params->pa_cfg.is_20_dbm_output_on = false;
 #elif defined( SX1276 )
-#if ( SX1276_MBED_SHIELD == SX1276MB1LAS )
-    if( input_params->freq_in_hz > RF_FREQUENCY_MID_BAND_THRESHOLD )
+#if ( SX1276_MBED_SHIELD != SX1276MB1LAS ) && ( SX1276_MBED_SHIELD != SX1276MB1MAS )
+#error "Please define the mbed shield to be used"
+#endif
+    if( bsp_pa_boost_selected( input_params->freq_in_hz, power ) )
     {
         output_params->pa_cfg.pa_select           = SX127X_PA_SELECT_BOOST;
-        output_params->pa_cfg.is_20_dbm_output_on = true;
+        output_params->pa_cfg.is_20_dbm_output_on = pa_boost_20dbm_on;
     }
     else
     {
         output_params->pa_cfg.pa_select           = SX127X_PA_SELECT_RFO;
         output_params->pa_cfg.is_20_dbm_output_on = false;
     }
-#elif ( SX1276_MBED_SHIELD == SX1276MB1MAS )
-    output_params->pa_cfg.pa_select           = SX127X_PA_SELECT_RFO;
-    output_params->pa_cfg.is_20_dbm_output_on = false;
-#else
-#error "Please define the mbed shield to be used"
-#endif
 #else
 #error "Please define the radio to be used"
 #endif
 
+    // Board output power varies over the band, the PA resolution is 1 dB
+    power += ( int16_t ) lroundf( radio_utilities_get_tx_power_cal_db(
+        input_params->freq_in_hz, output_params->pa_cfg.pa_select == SX127X_PA_SELECT_BOOST ) );
+
     output_params->chip_output_pwr_in_dbm_configured = power;
     output_params->chip_output_pwr_in_dbm_expected   = power;
 
@@ -171,6 +206,9 @@ void ral_sx127x_bsp_get_tx_cfg( const void* context, const ral_sx127x_bsp_tx_cfg
     }
 
     output_params->pa_ramp_time = SX127X_RAMP_40_US;
+
+    radio_energy_set_tx_cfg( output_params->pa_cfg.pa_select == SX127X_PA_SELECT_BOOST,
+                             output_params->chip_output_pwr_in_dbm_expected );
 }
 
 void ral_sx127x_bsp_get_ocp_value( const void* context, uint8_t* ocp_trim_value )
@@ -182,19 +220,24 @@ ral_status_t ral_sx127x_bsp_get_instantaneous_tx_power_consumption(
     const void* context, const ral_sx127x_bsp_tx_cfg_output_params_t* tx_cfg_output_params,
     uint32_t* pwr_consumption_in_ua )
 {
-    return RAL_STATUS_UNSUPPORTED_FEATURE;
+    *pwr_consumption_in_ua =
+        radio_energy_get_tx_consumption_ua( tx_cfg_output_params->pa_cfg.pa_select == SX127X_PA_SELECT_BOOST,
+                                            tx_cfg_output_params->chip_output_pwr_in_dbm_expected );
+    return RAL_STATUS_OK;
 }
 
 ral_status_t ral_sx127x_bsp_get_instantaneous_gfsk_rx_power_consumption( const void* context, bool rx_boosted,
                                                                          uint32_t* pwr_consumption_in_ua )
 {
-    return RAL_STATUS_UNSUPPORTED_FEATURE;
+    *pwr_consumption_in_ua = radio_energy_get_rx_consumption_ua( false, rx_boosted );
+    return RAL_STATUS_OK;
 }
 
 ral_status_t ral_sx127x_bsp_get_instantaneous_lora_rx_power_consumption( const void* context, bool rx_boosted,
                                                                          uint32_t* pwr_consumption_in_ua )
 {
-    return RAL_STATUS_UNSUPPORTED_FEATURE;
+    *pwr_consumption_in_ua = radio_energy_get_rx_consumption_ua( true, rx_boosted );
+    return RAL_STATUS_OK;
 }
 
 /*
@@ -202,4 +245,78 @@ ral_status_t ral_sx127x_bsp_get_instantaneous_lora_rx_power_consumption( const v
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+#if defined( SX1276 )
+static void bsp_pa_wiring_load( void )
+{
+    static const char* names[] = {
+        [BSP_PA_WIRING_RFO]      = "rfo",
+        [BSP_PA_WIRING_BOOST]    = "boost",
+        [BSP_PA_WIRING_BOOST_HF] = "boost_hf",
+        [BSP_PA_WIRING_AUTO]     = "auto",
+    };
+
+    if( pa_wiring_loaded )
+    {
+        return;
+    }
+    pa_wiring_loaded = true;
+
+    const char* value;
+    if( hal_board_profile_get_str( "radio.pa", &value ) )
+    {
+        bool found = false;
+        for( uint8_t i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+        {
+            if( strcmp( value, names[i] ) == 0 )
+            {
+                pa_wiring = ( bsp_pa_wiring_t ) i;
+                found     = true;
+            }
+        }
+        if( !found )
+        {
+            SMTC_HAL_TRACE_WARNING( "Board profile: unknown radio.pa '%s', keeping '%s'\n", value,
+                                    names[pa_wiring] );
+        }
+    }
+
+    int32_t on_20dbm;
+    if( hal_board_profile_get_int( "radio.pa_20dbm", &on_20dbm ) )
+    {
+        pa_boost_20dbm_on = ( on_20dbm != 0 );
+    }
+
+    SMTC_HAL_TRACE_INFO( "PA path: %s%s\n", names[pa_wiring],
+                         ( pa_wiring != BSP_PA_WIRING_RFO ) && pa_boost_20dbm_on ? ", +20 dBm enabled" : "" );
+}
+
+static bool bsp_pa_boost_selected( const uint32_t freq_in_hz, const int16_t power )
+{
+    bsp_pa_wiring_load( );
+
+    switch( pa_wiring )
+    {
+    case BSP_PA_WIRING_BOOST:
+        return true;
+    case BSP_PA_WIRING_BOOST_HF:
+        return freq_in_hz > RF_FREQUENCY_MID_BAND_THRESHOLD;
+    case BSP_PA_WIRING_AUTO:
+    {
+        const int16_t boost_min = pa_boost_20dbm_on ? 5 : 2;
+        if( power > 15 )
+        {
+            return true;  // beyond RFO range
+        }
+        if( power < boost_min )
+        {
+            return false;  // below PA_BOOST range
+        }
+        return radio_energy_get_tx_consumption_ua( true, power ) < radio_energy_get_tx_consumption_ua( false, power );
+    }
+    default:
+        return false;
+    }
+}
+#endif
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -39,6 +39,7 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <time.h>
 
 #include "sx127x.h"
 #include "sx127x_hal.h"
@@ -47,7 +48,14 @@
 #include "smtc_hal_spi.h"
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_lp_timer.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_startup.h"
 #include "modem_pinout.h"
+#include "radio_energy.h"
+#include "radio_pkt_status.h"
+#include "radio_state_time.h"
+#include "radio_utilities.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -59,6 +67,24 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+#define SX127X_REG_OP_MODE 0x01
+#define SX127X_REG_VERSION 0x42
+
+#if defined( SX1272 )
+#define SX127X_VERSION 0x22
+#elif defined( SX1276 )
+#define SX127X_VERSION 0x12
+#endif
+
+/*!
+ * Reset pulse, then version register polling until the chip answers. The datasheet
+ * gives 5 ms before the chip is ready, the timeout leaves margin for slow units.
+ */
+#define RESET_PULSE_US 1000
+#define RESET_READY_TIMEOUT_US 20000
+#define RESET_POLL_MIN_US 100
+#define RESET_POLL_MAX_US 1000
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -71,11 +97,28 @@
 static bool               is_timer_started = false;
 static hal_lp_timer_irq_t tmr_irq;
 
+/*!
+ * Driver DIO handlers, called by the accounting trampolines
+ */
+static void ( *dio_0_irq_handler )( void* context );
+static void ( *dio_1_irq_handler )( void* context );
+static void ( *dio_2_irq_handler )( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+static void sx127x_hal_dio_irq_account( const radio_state_dio_t dio );
+
+static uint32_t sx127x_hal_elapsed_us( const struct timespec* start );
+
+static void sx127x_hal_dio_0_irq_handler( void* context );
+
+static void sx127x_hal_dio_1_irq_handler( void* context );
+
+static void sx127x_hal_dio_2_irq_handler( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -98,19 +141,23 @@ void sx127x_hal_dio_irq_attach( const sx127x_t* radio )
     static hal_gpio_irq_t radio_dio_1_irq;
     static hal_gpio_irq_t radio_dio_2_irq;
 
+    dio_0_irq_handler = radio->dio_0_irq_handler;
+    dio_1_irq_handler = radio->dio_1_irq_handler;
+    dio_2_irq_handler = radio->dio_2_irq_handler;
+
     radio_dio_0_irq.context  = ( void* ) radio;
     radio_dio_0_irq.pin      = RADIO_DIO_0;
-    radio_dio_0_irq.callback = radio->dio_0_irq_handler;
+    radio_dio_0_irq.callback = sx127x_hal_dio_0_irq_handler;
     hal_gpio_irq_attach( &radio_dio_0_irq );
 
     radio_dio_1_irq.context  = ( void* ) radio;
     radio_dio_1_irq.pin      = RADIO_DIO_1;
-    radio_dio_1_irq.callback = radio->dio_1_irq_handler;
+    radio_dio_1_irq.callback = sx127x_hal_dio_1_irq_handler;
     hal_gpio_irq_attach( &radio_dio_1_irq );
 
     radio_dio_2_irq.context  = ( void* ) radio;
     radio_dio_2_irq.pin      = RADIO_DIO_2;
-    radio_dio_2_irq.callback = radio->dio_2_irq_handler;
+    radio_dio_2_irq.callback = sx127x_hal_dio_2_irq_handler;
     hal_gpio_irq_attach( &radio_dio_2_irq );
 }
 
@@ -122,13 +169,18 @@ sx127x_hal_status_t sx127x_hal_write( const sx127x_t* radio, const uint16_t addr
     hal_gpio_set_value( RADIO_NSS, 0 );
 
     hal_spi_in_out( RADIO_SPI_ID, address | 0x80 );
-    for( uint16_t i = 0; i < data_len; i++ )
-    {
-        hal_spi_in_out( RADIO_SPI_ID, data[i] );
-    }
+    hal_spi_in_out_buffer( RADIO_SPI_ID, data, NULL, data_len );
 
     hal_gpio_set_value( RADIO_NSS, 1 );
 
+    // Follow operating mode and LNA changes for energy and time accounting
+    radio_energy_on_register_write( address, data, data_len );
+    radio_state_time_on_register_write( address, data, data_len );
+    if( radio_state_time_get_state( ) == RADIO_STATE_TX )
+    {
+        hal_startup_on_radio_tx( );
+    }
+
     CRITICAL_SECTION_END( );
 
     return SX127X_HAL_STATUS_OK;
@@ -142,13 +194,13 @@ sx127x_hal_status_t sx127x_hal_read( const sx127x_t* radio, const uint16_t addre
     hal_gpio_set_value( RADIO_NSS, 0 );
 
     hal_spi_in_out( RADIO_SPI_ID, address & ( ~0x80 ) );
-    for( uint16_t i = 0; i < data_len; i++ )
-    {
-        data[i] = hal_spi_in_out( RADIO_SPI_ID, 0 );
-    }
+    hal_spi_in_out_buffer( RADIO_SPI_ID, NULL, data, data_len );
 
     hal_gpio_set_value( RADIO_NSS, 1 );
 
+    // Latches the packet status at the FIFO readout that follows RX done
+    radio_pkt_status_on_register_read( radio, address, data, data_len );
+
     CRITICAL_SECTION_END( );
 
     return SX127X_HAL_STATUS_OK;
@@ -167,12 +219,34 @@ void sx127x_hal_reset( const sx127x_t* radio )
 #endif
 
     // Wait 1 ms
-    hal_mcu_wait_us( 1000 );
+    hal_mcu_wait_us( RESET_PULSE_US );
 
     // Configure RESET pin as input
     hal_gpio_init_in( RADIO_NRST, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_OFF, NULL );
 
-    hal_mcu_wait_us( 6000 );
+    struct timespec start;
+    clock_gettime( RT_CLOCK, &start );
+
+    // Poll the version register with a growing delay instead of waiting for the worst case
+    uint32_t delay_us = RESET_POLL_MIN_US;
+    uint32_t ready_us;
+    uint8_t  version = 0;
+    do
+    {
+        hal_mcu_wait_us( delay_us );
+        sx127x_hal_read( radio, SX127X_REG_VERSION, &version, 1 );
+        ready_us = sx127x_hal_elapsed_us( &start );
+
+        delay_us = ( delay_us * 2 < RESET_POLL_MAX_US ) ? delay_us * 2 : RESET_POLL_MAX_US;
+    } while( ( version != SX127X_VERSION ) && ( ready_us < RESET_READY_TIMEOUT_US ) );
+
+    if( version != SX127X_VERSION )
+    {
+        SMTC_HAL_TRACE_WARNING( "Radio not ready %u us after reset (version 0x%02x)\n", ready_us, version );
+        ready_us = 0;
+    }
+    radio_utilities_set_reset_ready_time_us( ready_us );
+    hal_startup_mark( HAL_STARTUP_PHASE_RADIO_RESET );
 }
 
 uint32_t sx127x_hal_get_dio_1_pin_state( const sx127x_t* radio )
@@ -207,4 +281,52 @@ bool sx127x_hal_timer_is_started( const sx127x_t* radio )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void sx127x_hal_dio_irq_account( const radio_state_dio_t dio )
+{
+    uint8_t op_mode;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( radio_state_time_on_dio_irq( dio, &op_mode ) )
+    {
+        // The radio went back to standby on its own, no RegOpMode write will tell the energy accounting
+        radio_energy_on_register_write( SX127X_REG_OP_MODE, &op_mode, 1 );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+static uint32_t sx127x_hal_elapsed_us( const struct timespec* start )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint32_t ) ( ( now.tv_sec - start->tv_sec ) * 1000000 + ( now.tv_nsec - start->tv_nsec ) / 1000 );
+}
+
+static void sx127x_hal_dio_0_irq_handler( void* context )
+{
+    sx127x_hal_dio_irq_account( RADIO_STATE_DIO_0 );
+    if( dio_0_irq_handler != NULL )
+    {
+        dio_0_irq_handler( context );
+    }
+}
+
+static void sx127x_hal_dio_1_irq_handler( void* context )
+{
+    sx127x_hal_dio_irq_account( RADIO_STATE_DIO_1 );
+    if( dio_1_irq_handler != NULL )
+    {
+        dio_1_irq_handler( context );
+    }
+}
+
+static void sx127x_hal_dio_2_irq_handler( void* context )
+{
+    sx127x_hal_dio_irq_account( RADIO_STATE_DIO_2 );
+    if( dio_2_irq_handler != NULL )
+    {
+        dio_2_irq_handler( context );
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,239 @@
+/*!
+ * \file      sim_channel.c
+ *
+ * \brief     Shared LoRa channel model implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdlib.h>
+#include <math.h>
+
+#include "sim_channel.h"
+
+#include "smtc_hal_board_profile.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_CHANNEL_DEFAULT_PL_D0_M 1.0f
+#define SIM_CHANNEL_DEFAULT_PL_D0_DB 31.2f  // Free space at 868 MHz
+#define SIM_CHANNEL_DEFAULT_PL_EXPONENT 2.7f
+#define SIM_CHANNEL_DEFAULT_NOISE_FIGURE_DB 6.0f
+#define SIM_CHANNEL_DEFAULT_CAPTURE_DB 6.0f
+#define SIM_CHANNEL_DEFAULT_DEMODULATORS 8
+
+#define SIM_CHANNEL_SF_MIN 7
+#define SIM_CHANNEL_SF_MAX 12
+
+/*!
+ * Thermal noise density, dBm/Hz
+ */
+#define SIM_CHANNEL_KTB_DBM_HZ -174.0f
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * Demodulation floor per SF, SF7..SF12, dB
+ */
+static const float floor_snr_db[] = { -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f };
+
+/*!
+ * Minimum signal to interference ratio of a wanted SF (row) against another SF
+ * (column), SF7..SF12, dB. The diagonal is replaced by the capture threshold.
+ */
+static const int8_t rejection_db[6][6] = {
+    { 0, -8, -9, -9, -9, -9 },
+    { -11, 0, -11, -12, -13, -13 },
+    { -15, -13, 0, -13, -14, -15 },
+    { -19, -18, -17, 0, -17, -18 },
+    { -22, -22, -21, -20, 0, -20 },
+    { -25, -25, -25, -24, -23, 0 },
+};
+
+static const char* result_names[SIM_CHANNEL_RESULT_COUNT] = {
+    "received", "lost_sensitivity", "lost_collision", "lost_demodulators", "lost_gateway_tx",
+};
+
+static float    pl_d0_m         = SIM_CHANNEL_DEFAULT_PL_D0_M;
+static float    pl_d0_db        = SIM_CHANNEL_DEFAULT_PL_D0_DB;
+static float    pl_exponent     = SIM_CHANNEL_DEFAULT_PL_EXPONENT;
+static float    shadowing_db    = 0.0f;
+static float    noise_figure_db = SIM_CHANNEL_DEFAULT_NOISE_FIGURE_DB;
+static float    capture_db      = SIM_CHANNEL_DEFAULT_CAPTURE_DB;
+static uint16_t demodulators    = SIM_CHANNEL_DEFAULT_DEMODULATORS;
+static uint32_t seed            = 1;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void sim_channel_get_float( const char* key, float* value );
+
+static float sim_channel_gaussian( void );
+
+static bool sim_channel_overlap( const sim_radio_frame_t* a, const sim_radio_frame_t* b );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_channel_init( void )
+{
+    int32_t value;
+
+    sim_channel_get_float( "sim.pl_d0_m", &pl_d0_m );
+    sim_channel_get_float( "sim.pl_d0_db", &pl_d0_db );
+    sim_channel_get_float( "sim.pl_exponent", &pl_exponent );
+    sim_channel_get_float( "sim.shadowing_db", &shadowing_db );
+    sim_channel_get_float( "sim.noise_figure_db", &noise_figure_db );
+    sim_channel_get_float( "sim.capture_db", &capture_db );
+    if( ( hal_board_profile_get_int( "sim.gw_demodulators", &value ) == true ) && ( value > 0 ) )
+    {
+        demodulators = ( uint16_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "sim.seed", &value ) == true ) && ( value != 0 ) )
+    {
+        seed = ( uint32_t ) value;
+    }
+    if( pl_d0_m <= 0.0f )
+    {
+        pl_d0_m = SIM_CHANNEL_DEFAULT_PL_D0_M;
+    }
+}
+
+void sim_channel_propagate( sim_radio_frame_t* frame, const uint32_t distance_m )
+{
+    const float d_m       = ( distance_m > pl_d0_m ) ? ( float ) distance_m : pl_d0_m;
+    const float shadowing = ( shadowing_db > 0.0f ) ? shadowing_db * sim_channel_gaussian( ) : 0.0f;
+    const float path_loss = pl_d0_db + 10.0f * pl_exponent * log10f( d_m / pl_d0_m ) + shadowing;
+    const float rssi_dbm  = frame->tx_power_dbm - path_loss;
+    const float noise_dbm = SIM_CHANNEL_KTB_DBM_HZ + 10.0f * log10f( ( float ) frame->bw_hz ) + noise_figure_db;
+
+    frame->rssi_dbm = ( int16_t ) lroundf( rssi_dbm );
+    frame->snr_db   = rssi_dbm - noise_dbm;
+}
+
+bool sim_channel_above_floor( const sim_radio_frame_t* frame )
+{
+    if( ( frame->sf < SIM_CHANNEL_SF_MIN ) || ( frame->sf > SIM_CHANNEL_SF_MAX ) )
+    {
+        return false;
+    }
+    return frame->snr_db >= floor_snr_db[frame->sf - SIM_CHANNEL_SF_MIN];
+}
+
+sim_channel_result_t sim_channel_evaluate( const sim_radio_frame_t* frame, const sim_radio_frame_t* const* others,
+                                           const uint16_t nb )
+{
+    uint16_t nb_busy = 0;
+
+    if( !sim_channel_above_floor( frame ) )
+    {
+        return SIM_CHANNEL_LOST_SENSITIVITY;
+    }
+
+    for( uint16_t i = 0; i < nb; i++ )
+    {
+        if( others[i]->from_gateway && sim_channel_overlap( frame, others[i] ) )
+        {
+            return SIM_CHANNEL_LOST_GATEWAY_TX;
+        }
+    }
+
+    // Demodulators are taken at preamble detection and held to the end of the frame
+    for( uint16_t i = 0; i < nb; i++ )
+    {
+        if( !others[i]->from_gateway && ( others[i]->start_us <= frame->start_us ) &&
+            ( others[i]->end_us > frame->start_us ) && sim_channel_above_floor( others[i] ) )
+        {
+            nb_busy++;
+        }
+    }
+    if( nb_busy >= demodulators )
+    {
+        return SIM_CHANNEL_LOST_DEMODULATORS;
+    }
+
+    for( uint16_t i = 0; i < nb; i++ )
+    {
+        const sim_radio_frame_t* other = others[i];
+
+        if( other->from_gateway || !sim_channel_overlap( frame, other ) ||
+            ( labs( ( long ) other->freq_hz - ( long ) frame->freq_hz ) >= ( long ) ( frame->bw_hz / 2 ) ) ||
+            ( other->sf < SIM_CHANNEL_SF_MIN ) || ( other->sf > SIM_CHANNEL_SF_MAX ) )
+        {
+            continue;
+        }
+
+        const float sir_db       = ( float ) ( frame->rssi_dbm - other->rssi_dbm );
+        const float threshold_db = ( other->sf == frame->sf )
+                                       ? capture_db
+                                       : rejection_db[frame->sf - SIM_CHANNEL_SF_MIN][other->sf - SIM_CHANNEL_SF_MIN];
+        if( sir_db < threshold_db )
+        {
+            return SIM_CHANNEL_LOST_COLLISION;
+        }
+    }
+
+    return SIM_CHANNEL_RECEIVED;
+}
+
+const char* sim_channel_result_name( const sim_channel_result_t result )
+{
+    return ( result < SIM_CHANNEL_RESULT_COUNT ) ? result_names[result] : "unknown";
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void sim_channel_get_float( const char* key, float* value )
+{
+    const char* str;
+    char*       end;
+
+    if( hal_board_profile_get_str( key, &str ) == true )
+    {
+        const float parsed = strtof( str, &end );
+        if( end != str )
+        {
+            *value = parsed;
+        }
+    }
+}
+
+static float sim_channel_gaussian( void )
+{
+    float u[2];
+
+    // xorshift32 then Box-Muller, reproducible for a given sim.seed
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        u[i] = ( ( float ) ( seed >> 8 ) + 0.5f ) / ( float ) ( 1u << 24 );
+    }
+    return sqrtf( -2.0f * logf( u[0] ) ) * cosf( 6.2831853f * u[1] );
+}
+
+static bool sim_channel_overlap( const sim_radio_frame_t* a, const sim_radio_frame_t* b )
+{
+    return ( a->start_us < b->end_us ) && ( b->start_us < a->end_us );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,120 @@
+/*!
+ * \file      sim_channel.h
+ *
+ * \brief     Shared LoRa channel model: path loss, noise, collisions, capture
+ *
+ * Received power is the log-distance path loss model:
+ *
+ *   RSSI = P_tx - PL(d0) - 10 * n * log10(d / d0) + X,  X ~ N(0, shadowing)
+ *
+ * An uplink is lost at the gateway when:
+ *
+ *   - its SNR is below the demodulation floor of its SF
+ *   - a frame overlapping it on the same channel is too strong: same SF, it
+ *     is not captured unless `capture_db` above the interferer, other SF, it
+ *     survives unless the interferer exceeds the inter-SF rejection of the
+ *     SX127x family (co-channel rejection table, dB)
+ *   - all demodulators were busy with earlier frames when it started
+ *   - the gateway was transmitting, it is half duplex
+ *
+ * Settings are read from the board profile:
+ *
+ *   sim.pl_d0_m           = 1
+ *   sim.pl_d0_db          = 31.2    # free space at 868 MHz
+ *   sim.pl_exponent       = 2.7     # 2 free space, 2.7..3.5 suburban to urban
+ *   sim.shadowing_db      = 0       # standard deviation
+ *   sim.noise_figure_db   = 6
+ *   sim.capture_db        = 6
+ *   sim.gw_demodulators   = 8
+ *   sim.seed              = 1       # shadowing draws
+ */
+#ifndef SIM_CHANNEL_H
+#define SIM_CHANNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "sim_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Fate of an uplink at the gateway
+ */
+typedef enum sim_channel_result_e
+{
+    SIM_CHANNEL_RECEIVED,
+    SIM_CHANNEL_LOST_SENSITIVITY,
+    SIM_CHANNEL_LOST_COLLISION,
+    SIM_CHANNEL_LOST_DEMODULATORS,
+    SIM_CHANNEL_LOST_GATEWAY_TX,
+    SIM_CHANNEL_RESULT_COUNT,
+} sim_channel_result_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the settings
+ */
+void sim_channel_init( void );
+
+/*!
+ * Sets the received power and SNR of a frame
+ *
+ * \param [in,out] frame      Frame, tx_power_dbm and bw_hz set
+ * \param [in]     distance_m Distance between transmitter and receiver
+ */
+void sim_channel_propagate( sim_radio_frame_t* frame, const uint32_t distance_m );
+
+/*!
+ * Tells whether a frame can be demodulated without interference
+ *
+ * \param [in] frame Frame, snr_db and sf set
+ *
+ * \retval true if the SNR is above the demodulation floor
+ */
+bool sim_channel_above_floor( const sim_radio_frame_t* frame );
+
+/*!
+ * Decides the fate of an uplink at the gateway
+ *
+ * \param [in] frame  Uplink, propagated
+ * \param [in] others Other frames at the gateway, uplinks and downlinks (from_gateway set)
+ * \param [in] nb     Number of other frames
+ *
+ * \retval fate of the uplink
+ */
+sim_channel_result_t sim_channel_evaluate( const sim_radio_frame_t* frame, const sim_radio_frame_t* const* others,
+                                           const uint16_t nb );
+
+/*!
+ * Gets a printable name
+ *
+ * \param [in] result Fate of an uplink
+ *
+ * \retval name
+ */
+const char* sim_channel_result_name( const sim_channel_result_t result );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_CHANNEL_H
+
+/* --- EOF ------------------------------------------------------------------ */
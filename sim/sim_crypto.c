@@ -0,0 +1,294 @@
+/*!
+ * \file      sim_crypto.c
+ *
+ * \brief     AES-128 and AES-CMAC implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>  // C99 types
+#include <string.h>
+
+#include "sim_crypto.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_AES_ROUNDS 10
+#define SIM_AES_EXPANDED_KEY_SIZE ( SIM_AES_BLOCK_SIZE * ( SIM_AES_ROUNDS + 1 ) )
+
+/*!
+ * CMAC subkey constant, R_128
+ */
+#define SIM_CMAC_RB 0x87
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static const uint8_t inv_sbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void aes_expand_key( const uint8_t key[SIM_AES_BLOCK_SIZE], uint8_t round_keys[SIM_AES_EXPANDED_KEY_SIZE] );
+
+static uint8_t aes_xtime( const uint8_t x );
+
+static uint8_t aes_mul( uint8_t x, uint8_t y );
+
+static void aes_add_round_key( uint8_t state[SIM_AES_BLOCK_SIZE], const uint8_t* round_key );
+
+static void cmac_shift_left( const uint8_t in[SIM_AES_BLOCK_SIZE], uint8_t out[SIM_AES_BLOCK_SIZE] );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_aes128_encrypt( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t in[SIM_AES_BLOCK_SIZE],
+                         uint8_t out[SIM_AES_BLOCK_SIZE] )
+{
+    uint8_t round_keys[SIM_AES_EXPANDED_KEY_SIZE];
+    uint8_t state[SIM_AES_BLOCK_SIZE];
+    uint8_t tmp[SIM_AES_BLOCK_SIZE];
+
+    aes_expand_key( key, round_keys );
+    memcpy( state, in, SIM_AES_BLOCK_SIZE );
+    aes_add_round_key( state, round_keys );
+
+    for( uint8_t round = 1; round <= SIM_AES_ROUNDS; round++ )
+    {
+        // SubBytes and ShiftRows, the state is column-major
+        for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+        {
+            tmp[i] = sbox[state[( i + 4 * ( i % 4 ) ) % SIM_AES_BLOCK_SIZE]];
+        }
+
+        if( round < SIM_AES_ROUNDS )
+        {
+            for( uint8_t col = 0; col < 4; col++ )
+            {
+                const uint8_t* c = &tmp[4 * col];
+                const uint8_t  a = c[0] ^ c[1] ^ c[2] ^ c[3];
+
+                state[4 * col + 0] = c[0] ^ a ^ aes_xtime( c[0] ^ c[1] );
+                state[4 * col + 1] = c[1] ^ a ^ aes_xtime( c[1] ^ c[2] );
+                state[4 * col + 2] = c[2] ^ a ^ aes_xtime( c[2] ^ c[3] );
+                state[4 * col + 3] = c[3] ^ a ^ aes_xtime( c[3] ^ c[0] );
+            }
+        }
+        else
+        {
+            memcpy( state, tmp, SIM_AES_BLOCK_SIZE );
+        }
+        aes_add_round_key( state, &round_keys[SIM_AES_BLOCK_SIZE * round] );
+    }
+
+    memcpy( out, state, SIM_AES_BLOCK_SIZE );
+}
+
+void sim_aes128_decrypt( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t in[SIM_AES_BLOCK_SIZE],
+                         uint8_t out[SIM_AES_BLOCK_SIZE] )
+{
+    uint8_t round_keys[SIM_AES_EXPANDED_KEY_SIZE];
+    uint8_t state[SIM_AES_BLOCK_SIZE];
+    uint8_t tmp[SIM_AES_BLOCK_SIZE];
+
+    aes_expand_key( key, round_keys );
+    memcpy( state, in, SIM_AES_BLOCK_SIZE );
+    aes_add_round_key( state, &round_keys[SIM_AES_BLOCK_SIZE * SIM_AES_ROUNDS] );
+
+    for( uint8_t round = SIM_AES_ROUNDS; round > 0; round-- )
+    {
+        // InvShiftRows and InvSubBytes
+        for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+        {
+            tmp[( i + 4 * ( i % 4 ) ) % SIM_AES_BLOCK_SIZE] = inv_sbox[state[i]];
+        }
+        aes_add_round_key( tmp, &round_keys[SIM_AES_BLOCK_SIZE * ( round - 1 )] );
+
+        if( round > 1 )
+        {
+            for( uint8_t col = 0; col < 4; col++ )
+            {
+                // InvMixColumns, each row is the previous one rotated
+                for( uint8_t row = 0; row < 4; row++ )
+                {
+                    const uint8_t* c = &tmp[4 * col];
+
+                    state[4 * col + row] = aes_mul( c[row], 14 ) ^ aes_mul( c[( row + 1 ) % 4], 11 ) ^
+                                           aes_mul( c[( row + 2 ) % 4], 13 ) ^ aes_mul( c[( row + 3 ) % 4], 9 );
+                }
+            }
+        }
+        else
+        {
+            memcpy( state, tmp, SIM_AES_BLOCK_SIZE );
+        }
+    }
+
+    memcpy( out, state, SIM_AES_BLOCK_SIZE );
+}
+
+void sim_aes128_cmac( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t* data, const size_t size,
+                      uint8_t mac[SIM_AES_BLOCK_SIZE] )
+{
+    uint8_t      l[SIM_AES_BLOCK_SIZE] = { 0 };
+    uint8_t      k1[SIM_AES_BLOCK_SIZE];
+    uint8_t      k2[SIM_AES_BLOCK_SIZE];
+    uint8_t      x[SIM_AES_BLOCK_SIZE]    = { 0 };
+    uint8_t      last[SIM_AES_BLOCK_SIZE] = { 0 };
+    const size_t nb_blocks = ( size == 0 ) ? 1 : ( size + SIM_AES_BLOCK_SIZE - 1 ) / SIM_AES_BLOCK_SIZE;
+    const size_t last_size = size - ( nb_blocks - 1 ) * SIM_AES_BLOCK_SIZE;
+
+    sim_aes128_encrypt( key, l, l );
+    cmac_shift_left( l, k1 );
+    cmac_shift_left( k1, k2 );
+
+    // A complete last block is masked with K1, a padded one with K2
+    memcpy( last, &data[( nb_blocks - 1 ) * SIM_AES_BLOCK_SIZE], last_size );
+    if( last_size < SIM_AES_BLOCK_SIZE )
+    {
+        last[last_size] = 0x80;
+    }
+    for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+    {
+        last[i] ^= ( last_size == SIM_AES_BLOCK_SIZE ) ? k1[i] : k2[i];
+    }
+
+    for( size_t block = 0; block + 1 < nb_blocks; block++ )
+    {
+        for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+        {
+            x[i] ^= data[block * SIM_AES_BLOCK_SIZE + i];
+        }
+        sim_aes128_encrypt( key, x, x );
+    }
+    for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+    {
+        x[i] ^= last[i];
+    }
+    sim_aes128_encrypt( key, x, mac );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void aes_expand_key( const uint8_t key[SIM_AES_BLOCK_SIZE], uint8_t round_keys[SIM_AES_EXPANDED_KEY_SIZE] )
+{
+    uint8_t rcon = 0x01;
+
+    memcpy( round_keys, key, SIM_AES_BLOCK_SIZE );
+    for( uint8_t i = 4; i < 4 * ( SIM_AES_ROUNDS + 1 ); i++ )
+    {
+        uint8_t word[4];
+
+        memcpy( word, &round_keys[4 * ( i - 1 )], 4 );
+        if( ( i % 4 ) == 0 )
+        {
+            // RotWord, SubWord and Rcon
+            const uint8_t first = word[0];
+
+            word[0] = sbox[word[1]] ^ rcon;
+            word[1] = sbox[word[2]];
+            word[2] = sbox[word[3]];
+            word[3] = sbox[first];
+            rcon    = aes_xtime( rcon );
+        }
+        for( uint8_t j = 0; j < 4; j++ )
+        {
+            round_keys[4 * i + j] = round_keys[4 * ( i - 4 ) + j] ^ word[j];
+        }
+    }
+}
+
+static uint8_t aes_xtime( const uint8_t x )
+{
+    return ( uint8_t ) ( ( x << 1 ) ^ ( ( x & 0x80 ) ? 0x1B : 0x00 ) );
+}
+
+static uint8_t aes_mul( uint8_t x, uint8_t y )
+{
+    uint8_t result = 0;
+
+    while( y != 0 )
+    {
+        if( y & 1 )
+        {
+            result ^= x;
+        }
+        x = aes_xtime( x );
+        y >>= 1;
+    }
+    return result;
+}
+
+static void aes_add_round_key( uint8_t state[SIM_AES_BLOCK_SIZE], const uint8_t* round_key )
+{
+    for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+    {
+        state[i] ^= round_key[i];
+    }
+}
+
+static void cmac_shift_left( const uint8_t in[SIM_AES_BLOCK_SIZE], uint8_t out[SIM_AES_BLOCK_SIZE] )
+{
+    const uint8_t msb = in[0] & 0x80;
+
+    for( uint8_t i = 0; i < SIM_AES_BLOCK_SIZE; i++ )
+    {
+        out[i] = ( uint8_t ) ( in[i] << 1 );
+        if( i + 1 < SIM_AES_BLOCK_SIZE )
+        {
+            out[i] |= in[i + 1] >> 7;
+        }
+    }
+    if( msb != 0 )
+    {
+        out[SIM_AES_BLOCK_SIZE - 1] ^= SIM_CMAC_RB;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
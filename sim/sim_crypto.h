@@ -0,0 +1,73 @@
+/*!
+ * \file      sim_crypto.h
+ *
+ * \brief     AES-128 and AES-CMAC for the stand-in network server
+ *
+ * Plain byte-oriented implementation, the simulation only needs it to be
+ * correct: the device side uses the modem's own crypto.
+ */
+#ifndef SIM_CRYPTO_H
+#define SIM_CRYPTO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>  // C99 types
+#include <stddef.h>  // size_t
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define SIM_AES_BLOCK_SIZE 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Encrypts one block
+ *
+ * \param [in]  key Key
+ * \param [in]  in  Plain block
+ * \param [out] out Cipher block, can be in
+ */
+void sim_aes128_encrypt( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t in[SIM_AES_BLOCK_SIZE],
+                         uint8_t out[SIM_AES_BLOCK_SIZE] );
+
+/*!
+ * Decrypts one block
+ *
+ * \param [in]  key Key
+ * \param [in]  in  Cipher block
+ * \param [out] out Plain block, can be in
+ */
+void sim_aes128_decrypt( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t in[SIM_AES_BLOCK_SIZE],
+                         uint8_t out[SIM_AES_BLOCK_SIZE] );
+
+/*!
+ * Computes an AES-CMAC (RFC 4493)
+ *
+ * \param [in]  key  Key
+ * \param [in]  data Message
+ * \param [in]  size Message size
+ * \param [out] mac  MAC
+ */
+void sim_aes128_cmac( const uint8_t key[SIM_AES_BLOCK_SIZE], const uint8_t* data, const size_t size,
+                      uint8_t mac[SIM_AES_BLOCK_SIZE] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_CRYPTO_H
+
+/* --- EOF ------------------------------------------------------------------ */
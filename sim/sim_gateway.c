@@ -0,0 +1,452 @@
+/*!
+ * \file      sim_gateway.c
+ *
+ * \brief     Shared channel, gateway and network server for simulated devices
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "sim_gateway.h"
+#include "sim_channel.h"
+#include "sim_link.h"
+#include "sim_ns.h"
+#include "sim_radio.h"
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_GATEWAY_DEFAULT_TX_POWER_DBM 14
+#define SIM_GATEWAY_DEFAULT_REPORT_S 60
+#define SIM_GATEWAY_DEFAULT_STATS_PATH "sim-gateway.json"
+
+#define SIM_GATEWAY_AIR_SIZE 512
+
+/*!
+ * Uplinks are judged this long after their end, once every frame overlapping them has been reported
+ */
+#define SIM_GATEWAY_GRACE_US 20000
+
+/*!
+ * Frames are kept this long after their end, longer than any frame they may overlap
+ */
+#define SIM_GATEWAY_KEEP_US 10000000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct sim_gateway_device_s
+{
+    uint8_t                 dev_eui[8];
+    struct sockaddr_storage addr;
+    socklen_t               addr_len;
+    uint32_t                distance_m;
+    uint64_t                first_us;  //!< First uplink
+    uint32_t                uplinks;
+    uint64_t                airtime_us;
+    uint32_t                results[SIM_CHANNEL_RESULT_COUNT];
+    uint32_t                downlinks;          //!< Sent and heard by the device
+    uint32_t                downlinks_lost;     //!< Below the device floor
+    uint32_t                downlinks_dropped;  //!< Gateway already transmitting
+} sim_gateway_device_t;
+
+typedef struct sim_gateway_air_s
+{
+    bool              used;
+    bool              judged;
+    uint8_t           device;
+    sim_radio_frame_t frame;
+} sim_gateway_air_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static sim_gateway_device_t devices[SIM_NS_MAX_DEVICES];
+static uint8_t              nb_devices = 0;
+static sim_gateway_air_t    air[SIM_GATEWAY_AIR_SIZE];
+static int                  udp_fd = -1;
+static uint64_t             start_us;
+
+static int8_t      gw_tx_power_dbm = SIM_GATEWAY_DEFAULT_TX_POWER_DBM;
+static uint32_t    report_s        = SIM_GATEWAY_DEFAULT_REPORT_S;
+static const char* stats_path      = SIM_GATEWAY_DEFAULT_STATS_PATH;
+static const char* ns_stats_path   = NULL;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void sim_gateway_on_msg( const sim_link_msg_t* msg, const struct sockaddr_storage* addr,
+                                const socklen_t addr_len );
+
+static int sim_gateway_find( const uint8_t dev_eui[8] );
+
+static sim_gateway_air_t* sim_gateway_air_add( const sim_radio_frame_t* frame, const uint8_t device );
+
+static uint64_t sim_gateway_judge( const uint64_t now_us );
+
+static void sim_gateway_judge_uplink( sim_gateway_air_t* uplink );
+
+static void sim_gateway_report( const uint64_t now_us );
+
+static bool sim_gateway_write_stats( const uint64_t now_us );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_gateway_run( void )
+{
+    struct sockaddr_in local = { .sin_family = AF_INET, .sin_addr.s_addr = htonl( INADDR_ANY ) };
+    int32_t            port  = SIM_LINK_DEFAULT_PORT;
+    int32_t            value;
+
+    hal_board_profile_get_int( "sim.gateway_port", &port );
+    if( hal_board_profile_get_int( "sim.gw_tx_power_dbm", &value ) == true )
+    {
+        gw_tx_power_dbm = ( int8_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "sim.report_s", &value ) == true ) && ( value > 0 ) )
+    {
+        report_s = ( uint32_t ) value;
+    }
+    hal_board_profile_get_str( "sim.gateway_stats_path", &stats_path );
+    hal_board_profile_get_str( "sim.ns_stats_path", &ns_stats_path );
+
+    sim_channel_init( );
+    sim_ns_init( );
+
+    local.sin_port = htons( ( uint16_t ) port );
+    udp_fd         = socket( AF_INET, SOCK_DGRAM, 0 );
+    if( ( udp_fd < 0 ) || ( bind( udp_fd, ( struct sockaddr* ) &local, sizeof( local ) ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim gateway: port %d: %s\n", port, strerror( errno ) );
+        mcu_panic( );
+    }
+
+    SMTC_HAL_TRACE_INFO( "Simulated gateway listening on UDP port %d, stats every %u s to %s\n", port, report_s,
+                         stats_path );
+
+    start_us                = sim_radio_now_us( );
+    uint64_t next_report_us = start_us + ( uint64_t ) report_s * 1000000;
+
+    while( 1 )
+    {
+        uint64_t now_us  = sim_radio_now_us( );
+        uint64_t next_us = sim_gateway_judge( now_us );
+
+        if( now_us >= next_report_us )
+        {
+            sim_gateway_report( now_us );
+            next_report_us += ( uint64_t ) report_s * 1000000;
+        }
+        next_us = ( next_report_us < next_us ) ? next_report_us : next_us;
+
+        struct pollfd pfd        = { .fd = udp_fd, .events = POLLIN };
+        const int     timeout_ms = ( next_us > now_us ) ? ( int ) ( ( next_us - now_us ) / 1000 + 1 ) : 0;
+
+        if( ( poll( &pfd, 1, timeout_ms ) > 0 ) && ( pfd.revents & POLLIN ) )
+        {
+            sim_link_msg_t          msg;
+            struct sockaddr_storage addr;
+            socklen_t               addr_len = sizeof( addr );
+            const ssize_t size = recvfrom( udp_fd, &msg, sizeof( msg ), 0, ( struct sockaddr* ) &addr, &addr_len );
+
+            if( ( size >= ( ssize_t ) SIM_LINK_MSG_SIZE( 0 ) ) && ( msg.magic == SIM_LINK_MAGIC ) &&
+                ( size >= ( ssize_t ) SIM_LINK_MSG_SIZE( msg.frame.size ) ) )
+            {
+                sim_gateway_on_msg( &msg, &addr, addr_len );
+            }
+        }
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void sim_gateway_on_msg( const sim_link_msg_t* msg, const struct sockaddr_storage* addr,
+                                const socklen_t addr_len )
+{
+    int index = sim_gateway_find( msg->dev_eui );
+
+    if( msg->type == SIM_LINK_MSG_HELLO )
+    {
+        if( ( index < 0 ) && ( nb_devices < SIM_NS_MAX_DEVICES ) &&
+            ( sim_ns_add_device( msg->dev_eui, msg->join_eui, msg->app_key ) == true ) )
+        {
+            index = nb_devices++;
+            memset( &devices[index], 0, sizeof( devices[index] ) );
+            memcpy( devices[index].dev_eui, msg->dev_eui, 8 );
+        }
+        else if( index >= 0 )
+        {
+            sim_ns_add_device( msg->dev_eui, msg->join_eui, msg->app_key );
+        }
+        else
+        {
+            SMTC_HAL_TRACE_WARNING( "sim gateway: device table full\n" );
+            return;
+        }
+        devices[index].distance_m = msg->distance_m;
+        SMTC_HAL_TRACE_INFO( "Device %d at %u m\n", index, msg->distance_m );
+    }
+
+    if( index < 0 )
+    {
+        return;
+    }
+    sim_gateway_device_t* device = &devices[index];
+
+    // Where to send downlinks, the device may have restarted
+    memcpy( &device->addr, addr, addr_len );
+    device->addr_len = addr_len;
+
+    if( msg->type == SIM_LINK_MSG_UPLINK )
+    {
+        sim_radio_frame_t frame       = msg->frame;
+        const uint64_t    time_on_air = frame.end_us - frame.start_us;
+
+        // Sent as the transmission starts, the sender time base may not be ours
+        frame.start_us = sim_radio_now_us( );
+        frame.end_us   = frame.start_us + time_on_air;
+        sim_channel_propagate( &frame, device->distance_m );
+
+        device->first_us = ( device->uplinks == 0 ) ? frame.start_us : device->first_us;
+        device->uplinks++;
+        device->airtime_us += time_on_air;
+
+        if( sim_gateway_air_add( &frame, ( uint8_t ) index ) == NULL )
+        {
+            SMTC_HAL_TRACE_WARNING( "sim gateway: too many frames on the air\n" );
+        }
+    }
+}
+
+static int sim_gateway_find( const uint8_t dev_eui[8] )
+{
+    for( uint8_t i = 0; i < nb_devices; i++ )
+    {
+        if( memcmp( devices[i].dev_eui, dev_eui, 8 ) == 0 )
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static sim_gateway_air_t* sim_gateway_air_add( const sim_radio_frame_t* frame, const uint8_t device )
+{
+    for( uint16_t i = 0; i < SIM_GATEWAY_AIR_SIZE; i++ )
+    {
+        if( !air[i].used )
+        {
+            air[i].used   = true;
+            air[i].judged = false;
+            air[i].device = device;
+            air[i].frame  = *frame;
+            return &air[i];
+        }
+    }
+    return NULL;
+}
+
+static uint64_t sim_gateway_judge( const uint64_t now_us )
+{
+    uint64_t next_us = UINT64_MAX;
+
+    for( uint16_t i = 0; i < SIM_GATEWAY_AIR_SIZE; i++ )
+    {
+        if( !air[i].used )
+        {
+            continue;
+        }
+        if( !air[i].judged )
+        {
+            const uint64_t due_us = air[i].frame.end_us + SIM_GATEWAY_GRACE_US;
+
+            if( due_us <= now_us )
+            {
+                sim_gateway_judge_uplink( &air[i] );
+            }
+            else
+            {
+                next_us = ( due_us < next_us ) ? due_us : next_us;
+            }
+        }
+        else if( air[i].frame.end_us + SIM_GATEWAY_KEEP_US < now_us )
+        {
+            air[i].used = false;
+        }
+    }
+    return next_us;
+}
+
+static void sim_gateway_judge_uplink( sim_gateway_air_t* uplink )
+{
+    static const sim_radio_frame_t* others[SIM_GATEWAY_AIR_SIZE];
+    sim_gateway_device_t*           device = &devices[uplink->device];
+    sim_radio_frame_t               downlink;
+    uint16_t                        nb = 0;
+
+    for( uint16_t i = 0; i < SIM_GATEWAY_AIR_SIZE; i++ )
+    {
+        if( air[i].used && ( &air[i] != uplink ) )
+        {
+            others[nb++] = &air[i].frame;
+        }
+    }
+
+    const sim_channel_result_t result = sim_channel_evaluate( &uplink->frame, others, nb );
+
+    uplink->judged = true;
+    device->results[result]++;
+    if( result != SIM_CHANNEL_RECEIVED )
+    {
+        SMTC_HAL_TRACE_PRINTF( "Device %u: uplink SF%u %d dBm %s\n", uplink->device, uplink->frame.sf,
+                               uplink->frame.rssi_dbm, sim_channel_result_name( result ) );
+        return;
+    }
+
+    if( sim_ns_on_uplink( &uplink->frame, &downlink ) == false )
+    {
+        return;
+    }
+
+    // Half duplex, one downlink at a time
+    for( uint16_t i = 0; i < nb; i++ )
+    {
+        if( others[i]->from_gateway && ( others[i]->start_us < downlink.end_us ) &&
+            ( downlink.start_us < others[i]->end_us ) )
+        {
+            device->downlinks_dropped++;
+            return;
+        }
+    }
+
+    downlink.tx_power_dbm = gw_tx_power_dbm;
+    sim_channel_propagate( &downlink, device->distance_m );
+    sim_gateway_air_t* entry = sim_gateway_air_add( &downlink, uplink->device );
+    if( entry != NULL )
+    {
+        // The gateway's own frames are not judged
+        entry->judged = true;
+    }
+
+    if( !sim_channel_above_floor( &downlink ) )
+    {
+        device->downlinks_lost++;
+        return;
+    }
+
+    sim_link_msg_t msg = { .magic = SIM_LINK_MAGIC, .type = SIM_LINK_MSG_DOWNLINK, .frame = downlink };
+
+    memcpy( msg.dev_eui, device->dev_eui, 8 );
+    msg.delay_us = ( uint32_t ) ( downlink.start_us - uplink->frame.end_us );
+    if( sendto( udp_fd, &msg, SIM_LINK_MSG_SIZE( downlink.size ), 0, ( struct sockaddr* ) &device->addr,
+                device->addr_len ) < 0 )
+    {
+        SMTC_HAL_TRACE_WARNING( "sim gateway: send failed: %s\n", strerror( errno ) );
+        return;
+    }
+    device->downlinks++;
+}
+
+static void sim_gateway_report( const uint64_t now_us )
+{
+    uint32_t uplinks  = 0;
+    uint32_t received = 0;
+    uint64_t airtime  = 0;
+
+    for( uint8_t i = 0; i < nb_devices; i++ )
+    {
+        const sim_gateway_device_t* device = &devices[i];
+
+        uplinks += device->uplinks;
+        received += device->results[SIM_CHANNEL_RECEIVED];
+        airtime += device->airtime_us;
+        SMTC_HAL_TRACE_PRINTF( "  device %2u  %6u m  %5u uplinks  PDR %5.1f %%  airtime %8.1f s\n", i,
+                               device->distance_m, device->uplinks,
+                               ( device->uplinks > 0 )
+                                   ? 100.0 * device->results[SIM_CHANNEL_RECEIVED] / device->uplinks
+                                   : 0.0,
+                               device->airtime_us / 1e6 );
+    }
+    SMTC_HAL_TRACE_INFO( "Gateway: %u devices, %u uplinks, PDR %.1f %%, channel load %.3f Erlang\n", nb_devices,
+                         uplinks, ( uplinks > 0 ) ? 100.0 * received / uplinks : 0.0,
+                         ( double ) airtime / ( double ) ( now_us - start_us ) );
+
+    sim_gateway_write_stats( now_us );
+    if( ns_stats_path != NULL )
+    {
+        sim_ns_write_stats( ns_stats_path );
+    }
+}
+
+static bool sim_gateway_write_stats( const uint64_t now_us )
+{
+    const double elapsed_s = ( now_us - start_us ) / 1e6;
+
+    FILE* fp = fopen( stats_path, "w" );
+    if( fp == NULL )
+    {
+        SMTC_HAL_TRACE_ERROR( "Failed to open %s: %s\n", stats_path, strerror( errno ) );
+        return false;
+    }
+
+    fprintf( fp, "{\n  \"elapsed_s\": %.1f,\n  \"devices\": [\n", elapsed_s );
+    for( uint8_t i = 0; i < nb_devices; i++ )
+    {
+        const sim_gateway_device_t* device = &devices[i];
+        const double active_s = ( device->uplinks > 0 ) ? ( now_us - device->first_us ) / 1e6 : 0.0;
+
+        fprintf( fp, "%s    { \"dev_eui\": \"", ( i == 0 ) ? "" : ",\n" );
+        for( uint8_t j = 0; j < 8; j++ )
+        {
+            fprintf( fp, "%02x", device->dev_eui[j] );
+        }
+        fprintf( fp, "\", \"distance_m\": %u, \"uplinks\": %u, \"pdr\": %.4f, \"airtime_s\": %.3f, "
+                     "\"duty_cycle\": %.5f",
+                 device->distance_m, device->uplinks,
+                 ( device->uplinks > 0 ) ? ( double ) device->results[SIM_CHANNEL_RECEIVED] / device->uplinks : 0.0,
+                 device->airtime_us / 1e6, ( active_s > 0.0 ) ? device->airtime_us / 1e6 / active_s : 0.0 );
+        for( uint8_t r = 0; r < SIM_CHANNEL_RESULT_COUNT; r++ )
+        {
+            fprintf( fp, ", \"%s\": %u", sim_channel_result_name( ( sim_channel_result_t ) r ),
+                     device->results[r] );
+        }
+        fprintf( fp, ", \"downlinks\": %u, \"downlinks_lost\": %u, \"downlinks_dropped\": %u }",
+                 device->downlinks, device->downlinks_lost, device->downlinks_dropped );
+    }
+    fprintf( fp, "\n  ]\n}\n" );
+
+    const bool ok = ( ferror( fp ) == 0 );
+    return ( fclose( fp ) == 0 ) && ok;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,50 @@
+/*!
+ * \file      sim_gateway.h
+ *
+ * \brief     Shared channel, gateway and network server for simulated devices
+ *
+ * Devices started with sim.link = udp send each frame as its transmission
+ * starts. The gateway keeps the frames on the air, decides the fate of each
+ * uplink at its end with the channel model (sim_channel.h), hands the frames
+ * received to the stand-in network server (sim_ns.h) and sends the answers
+ * back ahead of the RX window, unless the gateway is already transmitting or
+ * the device cannot hear it. All processes share the RT_CLOCK time base when
+ * on the same host; across hosts only durations are exchanged.
+ *
+ * Per-device counters (uplinks, airtime, PDR, losses by cause, downlinks) are
+ * traced and written every sim.report_s seconds.
+ *
+ * Settings are read from the board profile:
+ *
+ *   sim.gateway_port       = 17000
+ *   sim.gw_tx_power_dbm    = 14
+ *   sim.report_s           = 60
+ *   sim.gateway_stats_path = sim-gateway.json
+ *   sim.ns_stats_path      = <network server counters, see sim_ns_write_stats>
+ *
+ * plus the sim_channel.h and sim_ns.h settings.
+ */
+#ifndef SIM_GATEWAY_H
+#define SIM_GATEWAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Serves the devices, never returns
+ */
+void sim_gateway_run( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_GATEWAY_H
+
+/* --- EOF ------------------------------------------------------------------ */
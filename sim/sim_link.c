@@ -0,0 +1,370 @@
+/*!
+ * \file      sim_link.c
+ *
+ * \brief     Connects the radio model to a network server
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "sim_link.h"
+#include "sim_radio.h"
+#include "sim_ns.h"
+#include "sim_channel.h"
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_LINK_DEFAULT_RSSI_DBM -80
+#define SIM_LINK_DEFAULT_SNR_DB 8
+#define SIM_LINK_DEFAULT_HOST "127.0.0.1"
+#define SIM_LINK_DEFAULT_DISTANCE_M 1000
+#define SIM_LINK_PATH_SIZE 256
+
+#define SIM_LINK_MHDR_TYPE_MASK 0xE0
+#define SIM_LINK_MHDR_JOIN_REQUEST 0x00
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static int16_t link_rssi_dbm = SIM_LINK_DEFAULT_RSSI_DBM;
+static float   link_snr_db   = SIM_LINK_DEFAULT_SNR_DB;
+static char    stats_path[SIM_LINK_PATH_SIZE];
+
+static int            udp_fd = -1;
+static sim_link_msg_t hello;
+static uint64_t       last_uplink_end_us = 0;
+static uint32_t       peer_distance_m    = SIM_LINK_DEFAULT_DISTANCE_M;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void sim_link_start_local( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] );
+
+static void sim_link_start_udp( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] );
+
+static void sim_link_start_peer( void );
+
+static void sim_link_on_tx_local( const sim_radio_frame_t* frame );
+
+static void sim_link_on_tx_udp( const sim_radio_frame_t* frame );
+
+static void sim_link_on_tx_peer( const sim_radio_frame_t* frame );
+
+static void sim_link_send( const sim_link_msg_t* msg );
+
+static void* sim_link_udp_thread( void* arg );
+
+static void* sim_link_peer_thread( void* arg );
+
+static void sim_link_on_exit( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_link_start( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] )
+{
+    const char* link = NULL;
+
+    sim_radio_init( );
+
+    if( ( hal_board_profile_get_str( "sim.link", &link ) == true ) && ( strcmp( link, "udp" ) == 0 ) )
+    {
+        sim_link_start_udp( dev_eui, join_eui, app_key );
+    }
+    else if( ( link != NULL ) && ( strcmp( link, "peer" ) == 0 ) )
+    {
+        sim_link_start_peer( );
+    }
+    else
+    {
+        sim_link_start_local( dev_eui, join_eui, app_key );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void sim_link_start_local( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] )
+{
+    const char* path;
+    int32_t     value;
+
+    if( hal_board_profile_get_int( "sim.rssi_dbm", &value ) == true )
+    {
+        link_rssi_dbm = ( int16_t ) value;
+    }
+    if( hal_board_profile_get_int( "sim.snr_db", &value ) == true )
+    {
+        link_snr_db = ( float ) value;
+    }
+    if( hal_board_profile_get_str( "sim.ns_stats_path", &path ) == true )
+    {
+        snprintf( stats_path, sizeof( stats_path ), "%s", path );
+    }
+
+    sim_ns_init( );
+    sim_ns_add_device( dev_eui, join_eui, app_key );
+    sim_radio_set_tx_handler( sim_link_on_tx_local );
+
+    atexit( sim_link_on_exit );
+
+    SMTC_HAL_TRACE_INFO( "Simulated radio linked to the local network server, %d dBm, %d dB SNR\n", link_rssi_dbm,
+                         ( int ) link_snr_db );
+}
+
+static void sim_link_start_udp( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] )
+{
+    const char*      host       = SIM_LINK_DEFAULT_HOST;
+    int32_t          port       = SIM_LINK_DEFAULT_PORT;
+    int32_t          distance_m = SIM_LINK_DEFAULT_DISTANCE_M;
+    char             service[8];
+    struct addrinfo  hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+    struct addrinfo* res;
+    pthread_t        thread;
+
+    hal_board_profile_get_str( "sim.server_host", &host );
+    hal_board_profile_get_int( "sim.server_port", &port );
+    hal_board_profile_get_int( "sim.distance_m", &distance_m );
+    snprintf( service, sizeof( service ), "%u", ( unsigned ) port );
+
+    const int rc = getaddrinfo( host, service, &hints, &res );
+    if( rc != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim link: %s: %s\n", host, gai_strerror( rc ) );
+        mcu_panic( );
+    }
+    udp_fd = socket( res->ai_family, res->ai_socktype, res->ai_protocol );
+    if( ( udp_fd < 0 ) || ( connect( udp_fd, res->ai_addr, res->ai_addrlen ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim link: %s:%s: %s\n", host, service, strerror( errno ) );
+        mcu_panic( );
+    }
+    freeaddrinfo( res );
+
+    hello.magic = SIM_LINK_MAGIC;
+    hello.type  = SIM_LINK_MSG_HELLO;
+    memcpy( hello.dev_eui, dev_eui, 8 );
+    memcpy( hello.join_eui, join_eui, 8 );
+    memcpy( hello.app_key, app_key, 16 );
+    hello.distance_m = ( distance_m > 0 ) ? ( uint32_t ) distance_m : 0;
+
+    if( pthread_create( &thread, NULL, sim_link_udp_thread, NULL ) != 0 )
+    {
+        mcu_panic( "sim link thread\n" );
+    }
+    pthread_detach( thread );
+
+    sim_radio_set_tx_handler( sim_link_on_tx_udp );
+    sim_link_send( &hello );
+
+    SMTC_HAL_TRACE_INFO( "Simulated radio linked to the gateway at %s:%s, %u m away\n", host, service,
+                         hello.distance_m );
+}
+
+static void sim_link_start_peer( void )
+{
+    const char*      host       = SIM_LINK_DEFAULT_HOST;
+    int32_t          port       = SIM_LINK_DEFAULT_PEER_PORT;
+    int32_t          local_port = SIM_LINK_DEFAULT_PEER_PORT;
+    int32_t          distance_m = SIM_LINK_DEFAULT_DISTANCE_M;
+    char             service[8];
+    char             local_service[8];
+    struct addrinfo  hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+    struct addrinfo* res;
+    struct addrinfo* local;
+    pthread_t        thread;
+
+    hal_board_profile_get_str( "sim.peer_host", &host );
+    hal_board_profile_get_int( "sim.peer_port", &port );
+    hal_board_profile_get_int( "sim.local_port", &local_port );
+    hal_board_profile_get_int( "sim.distance_m", &distance_m );
+    snprintf( service, sizeof( service ), "%u", ( unsigned ) port );
+    snprintf( local_service, sizeof( local_service ), "%u", ( unsigned ) local_port );
+    peer_distance_m = ( distance_m > 0 ) ? ( uint32_t ) distance_m : 0;
+
+    int rc = getaddrinfo( host, service, &hints, &res );
+    if( rc != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim link: %s: %s\n", host, gai_strerror( rc ) );
+        mcu_panic( );
+    }
+
+    // Bound to a known port, the peer sends to it
+    hints.ai_family = res->ai_family;
+    hints.ai_flags  = AI_PASSIVE;
+    rc              = getaddrinfo( NULL, local_service, &hints, &local );
+    if( rc != 0 )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim link: port %s: %s\n", local_service, gai_strerror( rc ) );
+        mcu_panic( );
+    }
+    udp_fd = socket( res->ai_family, res->ai_socktype, res->ai_protocol );
+    if( ( udp_fd < 0 ) || ( bind( udp_fd, local->ai_addr, local->ai_addrlen ) != 0 ) ||
+        ( connect( udp_fd, res->ai_addr, res->ai_addrlen ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_ERROR( "sim link: %s:%s from port %s: %s\n", host, service, local_service, strerror( errno ) );
+        mcu_panic( );
+    }
+    freeaddrinfo( local );
+    freeaddrinfo( res );
+
+    sim_channel_init( );
+
+    if( pthread_create( &thread, NULL, sim_link_peer_thread, NULL ) != 0 )
+    {
+        mcu_panic( "sim link thread\n" );
+    }
+    pthread_detach( thread );
+
+    sim_radio_set_tx_handler( sim_link_on_tx_peer );
+
+    SMTC_HAL_TRACE_INFO( "Simulated radio linked to the peer at %s:%s from port %s, %u m away\n", host, service,
+                         local_service, peer_distance_m );
+}
+
+static void sim_link_on_tx_local( const sim_radio_frame_t* frame )
+{
+    sim_radio_frame_t uplink = *frame;
+    sim_radio_frame_t downlink;
+
+    uplink.rssi_dbm = link_rssi_dbm;
+    uplink.snr_db   = link_snr_db;
+    if( sim_ns_on_uplink( &uplink, &downlink ) == true )
+    {
+        downlink.rssi_dbm = link_rssi_dbm;
+        downlink.snr_db   = link_snr_db;
+        if( sim_radio_deliver( &downlink ) == false )
+        {
+            SMTC_HAL_TRACE_WARNING( "Simulated downlink dropped, too many frames on the air\n" );
+        }
+    }
+}
+
+static void sim_link_on_tx_udp( const sim_radio_frame_t* frame )
+{
+    sim_link_msg_t msg = { .magic = SIM_LINK_MAGIC, .type = SIM_LINK_MSG_UPLINK, .frame = *frame };
+
+    // A restarted gateway learns the keys again before the next join
+    if( ( frame->size > 0 ) && ( ( frame->payload[0] & SIM_LINK_MHDR_TYPE_MASK ) == SIM_LINK_MHDR_JOIN_REQUEST ) )
+    {
+        sim_link_send( &hello );
+    }
+
+    __atomic_store_n( &last_uplink_end_us, frame->end_us, __ATOMIC_RELEASE );
+    memcpy( msg.dev_eui, hello.dev_eui, 8 );
+    sim_link_send( &msg );
+}
+
+static void sim_link_on_tx_peer( const sim_radio_frame_t* frame )
+{
+    const sim_link_msg_t msg = { .magic = SIM_LINK_MAGIC, .type = SIM_LINK_MSG_FRAME, .frame = *frame };
+
+    sim_link_send( &msg );
+}
+
+static void sim_link_send( const sim_link_msg_t* msg )
+{
+    // Only the payload bytes in use
+    if( send( udp_fd, msg, SIM_LINK_MSG_SIZE( msg->frame.size ), 0 ) < 0 )
+    {
+        SMTC_HAL_TRACE_WARNING( "sim link: send failed: %s\n", strerror( errno ) );
+    }
+}
+
+static void* sim_link_udp_thread( void* arg )
+{
+    sim_link_msg_t msg;
+
+    while( 1 )
+    {
+        const ssize_t size = recv( udp_fd, &msg, sizeof( msg ), 0 );
+
+        if( ( size < ( ssize_t ) SIM_LINK_MSG_SIZE( 0 ) ) || ( msg.magic != SIM_LINK_MAGIC ) ||
+            ( msg.type != SIM_LINK_MSG_DOWNLINK ) || ( size < ( ssize_t ) SIM_LINK_MSG_SIZE( msg.frame.size ) ) )
+        {
+            continue;
+        }
+
+        // Gateway times are meaningless here, the delay is from the end of our uplink
+        const uint32_t time_on_air_us = ( uint32_t ) ( msg.frame.end_us - msg.frame.start_us );
+        msg.frame.start_us = __atomic_load_n( &last_uplink_end_us, __ATOMIC_ACQUIRE ) + msg.delay_us;
+        msg.frame.end_us   = msg.frame.start_us + time_on_air_us;
+        if( sim_radio_deliver( &msg.frame ) == false )
+        {
+            SMTC_HAL_TRACE_WARNING( "Simulated downlink dropped, too many frames on the air\n" );
+        }
+    }
+    return NULL;
+}
+
+static void* sim_link_peer_thread( void* arg )
+{
+    sim_link_msg_t msg;
+
+    while( 1 )
+    {
+        const ssize_t size = recv( udp_fd, &msg, sizeof( msg ), 0 );
+
+        if( ( size < ( ssize_t ) SIM_LINK_MSG_SIZE( 0 ) ) || ( msg.magic != SIM_LINK_MAGIC ) ||
+            ( msg.type != SIM_LINK_MSG_FRAME ) || ( size < ( ssize_t ) SIM_LINK_MSG_SIZE( msg.frame.size ) ) )
+        {
+            continue;
+        }
+
+        // Sent as the transmission started: it starts now here, whatever the peer clock
+        const uint32_t time_on_air_us = ( uint32_t ) ( msg.frame.end_us - msg.frame.start_us );
+        msg.frame.start_us = sim_radio_now_us( );
+        msg.frame.end_us   = msg.frame.start_us + time_on_air_us;
+
+        // Below the floor the preamble is not even detected, the frame is lost without a trace
+        sim_channel_propagate( &msg.frame, peer_distance_m );
+        if( sim_channel_above_floor( &msg.frame ) == false )
+        {
+            continue;
+        }
+        if( sim_radio_deliver( &msg.frame ) == false )
+        {
+            SMTC_HAL_TRACE_WARNING( "Simulated frame dropped, too many frames on the air\n" );
+        }
+    }
+    return NULL;
+}
+
+static void sim_link_on_exit( void )
+{
+    sim_ns_print_stats( );
+    if( stats_path[0] != '\0' )
+    {
+        sim_ns_write_stats( stats_path );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,118 @@
+/*!
+ * \file      sim_link.h
+ *
+ * \brief     Connects the radio model to a network server
+ *
+ * Three links, chosen with sim.link:
+ *
+ *   local  the gateway and the stand-in network server run in the same process:
+ *          each frame the modem transmits goes to sim_ns_on_uplink, and the
+ *          answer, if any, is delivered to the radio model for its RX1 or RX2
+ *          window, with a fixed link budget
+ *   udp    frames go to a SIM_GATEWAY process shared by many devices, which
+ *          applies the channel model (see sim_channel.h) and runs the network
+ *          server. The device sends its credentials and distance first.
+ *   peer   frames go to another simulated radio over UDP, e.g. the other side
+ *          of the PER tester, no network server: the frames received are
+ *          propagated over sim.distance_m with the channel model (see
+ *          sim_channel.h) and put on the air when above the demodulation floor
+ *
+ * Settings are read from the board profile:
+ *
+ *   sim.link          = local  # local | udp
+ *   sim.rssi_dbm      = -80    # local: link budget, both directions
+ *   sim.snr_db        = 8
+ *   sim.ns_stats_path = <local: JSON file written at exit, see sim_ns_write_stats>
+ *   sim.server_host   = 127.0.0.1          # udp
+ *   sim.server_port   = 17000
+ *   sim.distance_m    = 1000               # udp, peer
+ *   sim.peer_host     = 127.0.0.1          # peer
+ *   sim.peer_port     = 17001
+ *   sim.local_port    = 17001              # two peers on one host need different ports
+ */
+#ifndef SIM_LINK_H
+#define SIM_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>  // C99 types
+#include <stddef.h>  // offsetof
+
+#include "sim_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define SIM_LINK_DEFAULT_PORT 17000
+#define SIM_LINK_DEFAULT_PEER_PORT 17001
+
+/*!
+ * First word of every datagram, "SLK1"
+ */
+#define SIM_LINK_MAGIC 0x534C4B31
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+typedef enum sim_link_msg_type_e
+{
+    SIM_LINK_MSG_HELLO = 1,  //!< Device to gateway: credentials and distance
+    SIM_LINK_MSG_UPLINK,     //!< Device to gateway, sent as the transmission starts
+    SIM_LINK_MSG_DOWNLINK,   //!< Gateway to device, sent ahead of the RX window
+    SIM_LINK_MSG_FRAME,      //!< Peer to peer, sent as the transmission starts
+} sim_link_msg_type_t;
+
+/*!
+ * Datagram of the udp link, in native layout: both ends run the same build
+ */
+typedef struct sim_link_msg_s
+{
+    uint32_t          magic;
+    uint8_t           type;
+    uint8_t           dev_eui[8];   //!< MSB first
+    uint8_t           join_eui[8];  //!< HELLO, MSB first
+    uint8_t           app_key[16];  //!< HELLO
+    uint32_t          distance_m;   //!< HELLO
+    uint32_t          delay_us;     //!< DOWNLINK: start after the end of the last uplink
+    sim_radio_frame_t frame;        //!< UPLINK and DOWNLINK, times are the sender's
+} sim_link_msg_t;
+
+/*!
+ * Bytes sent for a message whose frame holds size payload bytes
+ */
+#define SIM_LINK_MSG_SIZE( size ) ( offsetof( sim_link_msg_t, frame.payload ) + ( size ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Starts the radio model and the link chosen in the board profile
+ *
+ * \param [in] dev_eui  DevEUI, MSB first
+ * \param [in] join_eui JoinEUI, MSB first
+ * \param [in] app_key  Root key, NwkKey in the modem API
+ *
+ * \remark The credentials are not used by the peer link
+ */
+void sim_link_start( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_LINK_H
+
+/* --- EOF ------------------------------------------------------------------ */
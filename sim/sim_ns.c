@@ -0,0 +1,977 @@
+/*!
+ * \file      sim_ns.c
+ *
+ * \brief     Stand-in LoRaWAN 1.0.4 network server implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "sim_ns.h"
+#include "sim_crypto.h"
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_NS_DEFAULT_RX_WINDOW 1
+#define SIM_NS_DEFAULT_ADR_HISTORY 10
+#define SIM_NS_DEFAULT_ADR_MARGIN_DB 10
+#define SIM_NS_DEFAULT_DOWNLINK_PORT 2
+#define SIM_NS_DEFAULT_DOWNLINK_SIZE 4
+
+#define SIM_NS_MAX_ADR_HISTORY 20
+#define SIM_NS_QUEUE_SIZE 4
+#define SIM_NS_MAX_FOPTS 15
+
+#define SIM_NS_NET_ID 0x000013
+#define SIM_NS_DEV_ADDR_BASE 0x26011000
+
+/*!
+ * EU868 regional parameters
+ */
+#define SIM_NS_RECEIVE_DELAY1_US 1000000
+#define SIM_NS_JOIN_ACCEPT_DELAY1_US 5000000
+#define SIM_NS_RX2_DELAY_OFFSET_US 1000000
+#define SIM_NS_RX2_FREQ_HZ 869525000
+#define SIM_NS_RX2_SF 12
+#define SIM_NS_MAX_DR 5
+#define SIM_NS_MAX_TX_POWER_INDEX 7
+#define SIM_NS_CH_MASK 0x00FF
+#define SIM_NS_DOWNLINK_TX_POWER_DBM 14
+
+/*!
+ * Join-accept CFList, in units of 100 Hz
+ */
+#define SIM_NS_CFLIST_FREQS_HZ { 867100000, 867300000, 867500000, 867700000, 867900000 }
+
+/*!
+ * GPS epoch in Unix time, and GPS - UTC
+ */
+#define SIM_NS_GPS_EPOCH_UNIX_S 315964800
+#define SIM_NS_GPS_LEAP_S 18
+
+#define MHDR_JOIN_REQUEST 0x00
+#define MHDR_JOIN_ACCEPT 0x20
+#define MHDR_UNCONFIRMED_UP 0x40
+#define MHDR_UNCONFIRMED_DOWN 0x60
+#define MHDR_CONFIRMED_UP 0x80
+#define MHDR_CONFIRMED_DOWN 0xA0
+#define MHDR_TYPE_MASK 0xE0
+
+#define FCTRL_ADR 0x80
+#define FCTRL_ADR_ACK_REQ 0x40
+#define FCTRL_ACK 0x20
+#define FCTRL_FPENDING 0x10
+#define FCTRL_FOPTS_LEN_MASK 0x0F
+
+#define CID_LINK_CHECK 0x02
+#define CID_LINK_ADR 0x03
+#define CID_DEVICE_TIME 0x0D
+
+#define LINK_ADR_ANS_OK 0x07
+
+#define JOIN_REQUEST_SIZE 23
+#define DATA_MIN_SIZE 12
+#define MIC_SIZE 4
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct sim_ns_downlink_s
+{
+    uint8_t port;
+    bool    confirmed;
+    uint8_t size;
+    uint8_t data[SIM_RADIO_MAX_PAYLOAD];
+} sim_ns_downlink_t;
+
+typedef struct sim_ns_device_s
+{
+    uint8_t dev_eui[8];
+    uint8_t join_eui[8];
+    uint8_t app_key[16];
+
+    bool     joined;
+    uint32_t dev_addr;
+    uint8_t  nwk_skey[16];
+    uint8_t  app_skey[16];
+    bool     has_dev_nonce;
+    uint16_t last_dev_nonce;
+    bool     has_fcnt_up;
+    uint32_t fcnt_up;
+    uint32_t fcnt_down;
+
+    uint8_t tx_power_index;
+    float   snr_history[SIM_NS_MAX_ADR_HISTORY];
+    uint8_t nb_snr;
+    bool    confirmed_down_pending;
+
+    uint8_t mac[SIM_NS_MAX_FOPTS];  //!< MAC commands for the next downlink
+    uint8_t mac_size;
+
+    sim_ns_downlink_t queue[SIM_NS_QUEUE_SIZE];
+    uint8_t           queue_size;
+    uint32_t          uplinks_since_downlink;
+
+    sim_ns_stats_t stats;
+} sim_ns_device_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * Size of the uplink MAC commands, indexed by CID, -1 if unknown
+ */
+static const int8_t uplink_mac_sizes[] = { -1, -1, 0, 1, 0, 1, 2, 1, 0, 0, 1, -1, -1, 0 };
+
+/*!
+ * Demodulation floor per data rate, DR0..DR5
+ */
+static const float required_snr_db[] = { -20.0f, -17.5f, -15.0f, -12.5f, -10.0f, -7.5f };
+
+static sim_ns_device_t devices[SIM_NS_MAX_DEVICES];
+static uint8_t         nb_devices = 0;
+static uint32_t        join_nonce = 0;
+static pthread_mutex_t lock       = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t  rx_window          = SIM_NS_DEFAULT_RX_WINDOW;
+static bool     adr_enabled        = true;
+static uint8_t  adr_history        = SIM_NS_DEFAULT_ADR_HISTORY;
+static int32_t  adr_margin_db      = SIM_NS_DEFAULT_ADR_MARGIN_DB;
+static uint32_t downlink_every     = 0;
+static uint8_t  downlink_port      = SIM_NS_DEFAULT_DOWNLINK_PORT;
+static uint8_t  downlink_size      = SIM_NS_DEFAULT_DOWNLINK_SIZE;
+static bool     downlink_confirmed = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static sim_ns_device_t* sim_ns_find_by_eui( const uint8_t* dev_eui_le );
+
+static sim_ns_device_t* sim_ns_find_by_addr( const uint32_t dev_addr );
+
+static bool sim_ns_on_join_request( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink );
+
+static bool sim_ns_on_data( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink );
+
+static void sim_ns_on_mac( sim_ns_device_t* device, const sim_radio_frame_t* uplink, const uint8_t* cmds,
+                           const uint8_t size );
+
+static void sim_ns_adr( sim_ns_device_t* device, const sim_radio_frame_t* uplink );
+
+static void sim_ns_add_mac( sim_ns_device_t* device, const uint8_t* cmd, const uint8_t size );
+
+static uint8_t sim_ns_build_data( sim_ns_device_t* device, const bool ack, const bool adr, uint8_t* msg );
+
+static void sim_ns_schedule( const sim_radio_frame_t* uplink, const bool join, sim_radio_frame_t* downlink );
+
+static void sim_ns_derive_key( const uint8_t app_key[16], const uint8_t prefix, const uint32_t nonce,
+                               const uint16_t dev_nonce, uint8_t key[16] );
+
+static void sim_ns_b0( const uint8_t prefix, const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                       const uint8_t last, uint8_t block[SIM_AES_BLOCK_SIZE] );
+
+static uint32_t sim_ns_mic( const uint8_t key[16], const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                            const uint8_t* msg, const uint8_t size );
+
+static void sim_ns_crypt( const uint8_t key[16], const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                          uint8_t* data, const uint8_t size );
+
+static uint32_t sim_ns_get_le32( const uint8_t* buf );
+
+static void sim_ns_put_le32( uint8_t* buf, const uint32_t value );
+
+static void sim_ns_stats_add( sim_ns_stats_t* sum, const sim_ns_stats_t* stats );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_ns_init( void )
+{
+    int32_t value;
+
+    pthread_mutex_lock( &lock );
+
+    memset( devices, 0, sizeof( devices ) );
+    nb_devices = 0;
+
+    // 1.0.4 devices want a JoinNonce greater than the last one, also across runs
+    join_nonce = ( uint32_t ) ( time( NULL ) / 8 ) & 0xFFFFFF;
+
+    if( ( hal_board_profile_get_int( "sim.ns_rx_window", &value ) == true ) && ( ( value == 1 ) || ( value == 2 ) ) )
+    {
+        rx_window = ( uint8_t ) value;
+    }
+    if( hal_board_profile_get_int( "sim.ns_adr", &value ) == true )
+    {
+        adr_enabled = ( value != 0 );
+    }
+    if( ( hal_board_profile_get_int( "sim.ns_adr_history", &value ) == true ) && ( value > 0 ) &&
+        ( value <= SIM_NS_MAX_ADR_HISTORY ) )
+    {
+        adr_history = ( uint8_t ) value;
+    }
+    if( hal_board_profile_get_int( "sim.ns_adr_margin_db", &value ) == true )
+    {
+        adr_margin_db = value;
+    }
+    if( ( hal_board_profile_get_int( "sim.ns_downlink_every", &value ) == true ) && ( value >= 0 ) )
+    {
+        downlink_every = ( uint32_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "sim.ns_downlink_port", &value ) == true ) && ( value > 0 ) && ( value < 224 ) )
+    {
+        downlink_port = ( uint8_t ) value;
+    }
+    if( ( hal_board_profile_get_int( "sim.ns_downlink_size", &value ) == true ) && ( value >= 0 ) && ( value <= 51 ) )
+    {
+        downlink_size = ( uint8_t ) value;
+    }
+    if( hal_board_profile_get_int( "sim.ns_downlink_confirmed", &value ) == true )
+    {
+        downlink_confirmed = ( value != 0 );
+    }
+
+    pthread_mutex_unlock( &lock );
+}
+
+bool sim_ns_add_device( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] )
+{
+    bool added = false;
+
+    pthread_mutex_lock( &lock );
+    for( uint8_t i = 0; ( i < nb_devices ) && !added; i++ )
+    {
+        if( memcmp( devices[i].dev_eui, dev_eui, 8 ) == 0 )
+        {
+            // Provisioned again, e.g. the device restarted: new keys, same counters
+            memcpy( devices[i].join_eui, join_eui, 8 );
+            memcpy( devices[i].app_key, app_key, 16 );
+            added = true;
+        }
+    }
+    if( !added && ( nb_devices < SIM_NS_MAX_DEVICES ) )
+    {
+        sim_ns_device_t* device = &devices[nb_devices];
+
+        memset( device, 0, sizeof( *device ) );
+        memcpy( device->dev_eui, dev_eui, 8 );
+        memcpy( device->join_eui, join_eui, 8 );
+        memcpy( device->app_key, app_key, 16 );
+        device->dev_addr = SIM_NS_DEV_ADDR_BASE + nb_devices;
+        nb_devices++;
+        added = true;
+    }
+    pthread_mutex_unlock( &lock );
+
+    return added;
+}
+
+bool sim_ns_on_uplink( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink )
+{
+    bool send = false;
+
+    if( ( uplink->size == 0 ) || uplink->crc_error )
+    {
+        return false;
+    }
+    if( uplink->iq_inverted )
+    {
+        // A plain uplink never has inverted IQ, this is a radio model or modem configuration bug
+        static bool warned = false;
+
+        if( !warned )
+        {
+            SMTC_HAL_TRACE_WARNING( "NS: dropping uplink with inverted IQ, check the TX IQ polarity\n" );
+            warned = true;
+        }
+        return false;
+    }
+
+    pthread_mutex_lock( &lock );
+    switch( uplink->payload[0] & MHDR_TYPE_MASK )
+    {
+    case MHDR_JOIN_REQUEST:
+        send = sim_ns_on_join_request( uplink, downlink );
+        break;
+    case MHDR_UNCONFIRMED_UP:
+    case MHDR_CONFIRMED_UP:
+        send = sim_ns_on_data( uplink, downlink );
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock( &lock );
+
+    return send;
+}
+
+bool sim_ns_queue_downlink( const uint8_t dev_eui[8], const uint8_t port, const uint8_t* data, const uint8_t size,
+                            const bool confirmed )
+{
+    uint8_t dev_eui_le[8];
+    bool    queued = false;
+
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        dev_eui_le[i] = dev_eui[7 - i];
+    }
+
+    pthread_mutex_lock( &lock );
+    sim_ns_device_t* device = sim_ns_find_by_eui( dev_eui_le );
+    if( ( device != NULL ) && ( device->queue_size < SIM_NS_QUEUE_SIZE ) && ( port > 0 ) && ( port < 224 ) &&
+        ( size <= SIM_RADIO_MAX_PAYLOAD - DATA_MIN_SIZE - 1 ) )
+    {
+        sim_ns_downlink_t* entry = &device->queue[device->queue_size++];
+
+        entry->port      = port;
+        entry->confirmed = confirmed;
+        entry->size      = size;
+        memcpy( entry->data, data, size );
+        queued = true;
+    }
+    pthread_mutex_unlock( &lock );
+
+    return queued;
+}
+
+bool sim_ns_get_stats( const int index, sim_ns_stats_t* stats )
+{
+    bool found = true;
+
+    pthread_mutex_lock( &lock );
+    if( index < 0 )
+    {
+        memset( stats, 0, sizeof( *stats ) );
+        for( uint8_t i = 0; i < nb_devices; i++ )
+        {
+            sim_ns_stats_add( stats, &devices[i].stats );
+        }
+    }
+    else if( index < nb_devices )
+    {
+        *stats = devices[index].stats;
+    }
+    else
+    {
+        found = false;
+    }
+    pthread_mutex_unlock( &lock );
+
+    return found;
+}
+
+void sim_ns_print_stats( void )
+{
+    sim_ns_stats_t stats;
+
+    sim_ns_get_stats( -1, &stats );
+    SMTC_HAL_TRACE_INFO( "NS: %u joins (%u requests), %u uplinks (%u confirmed, %u duplicates, %u lost, "
+                         "%u MIC errors), %u downlinks (%u ACKs, %u/%u confirmed acked), LinkADRReq %u (ok %u, nok "
+                         "%u)\n",
+                         stats.joins, stats.join_requests, stats.uplinks, stats.confirmed_uplinks, stats.duplicates,
+                         stats.lost, stats.mic_errors, stats.downlinks, stats.acks, stats.downlinks_acked,
+                         stats.confirmed_downlinks, stats.link_adr_req, stats.link_adr_ans_ok,
+                         stats.link_adr_ans_nok );
+}
+
+bool sim_ns_write_stats( const char* path )
+{
+    sim_ns_stats_t stats;
+
+    FILE* fp = fopen( path, "w" );
+    if( fp == NULL )
+    {
+        SMTC_HAL_TRACE_ERROR( "Failed to open %s: %s\n", path, strerror( errno ) );
+        return false;
+    }
+
+    // One object per line, the sum first
+    fprintf( fp, "{\n  \"devices\": [\n" );
+    for( int i = -1; sim_ns_get_stats( i, &stats ) == true; i++ )
+    {
+        char dev_eui[17] = "all";
+
+        if( i >= 0 )
+        {
+            pthread_mutex_lock( &lock );
+            for( uint8_t j = 0; j < 8; j++ )
+            {
+                snprintf( &dev_eui[2 * j], 3, "%02x", devices[i].dev_eui[j] );
+            }
+            pthread_mutex_unlock( &lock );
+        }
+        fprintf( fp,
+                 "%s    { \"dev_eui\": \"%s\", \"joins\": %u, \"uplinks\": %u, \"uplink_bytes\": %u, "
+                 "\"confirmed_uplinks\": %u, \"duplicates\": %u, \"lost\": %u, \"mic_errors\": %u, "
+                 "\"downlinks\": %u, \"acks\": %u, \"confirmed_downlinks\": %u, \"downlinks_acked\": %u, "
+                 "\"link_adr_req\": %u, \"link_adr_ans_ok\": %u, \"link_adr_ans_nok\": %u }",
+                 ( i < 0 ) ? "" : ",\n", dev_eui, stats.joins, stats.uplinks, stats.uplink_bytes,
+                 stats.confirmed_uplinks, stats.duplicates, stats.lost, stats.mic_errors, stats.downlinks, stats.acks,
+                 stats.confirmed_downlinks, stats.downlinks_acked, stats.link_adr_req, stats.link_adr_ans_ok,
+                 stats.link_adr_ans_nok );
+    }
+    fprintf( fp, "\n  ]\n}\n" );
+
+    const bool ok = ( ferror( fp ) == 0 );
+    return ( fclose( fp ) == 0 ) && ok;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static sim_ns_device_t* sim_ns_find_by_eui( const uint8_t* dev_eui_le )
+{
+    for( uint8_t i = 0; i < nb_devices; i++ )
+    {
+        bool match = true;
+
+        for( uint8_t j = 0; ( j < 8 ) && match; j++ )
+        {
+            match = ( devices[i].dev_eui[j] == dev_eui_le[7 - j] );
+        }
+        if( match )
+        {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+static sim_ns_device_t* sim_ns_find_by_addr( const uint32_t dev_addr )
+{
+    for( uint8_t i = 0; i < nb_devices; i++ )
+    {
+        if( devices[i].joined && ( devices[i].dev_addr == dev_addr ) )
+        {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+static bool sim_ns_on_join_request( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink )
+{
+    static const uint32_t cflist_freqs_hz[] = SIM_NS_CFLIST_FREQS_HZ;
+    const uint8_t*        msg               = uplink->payload;
+    uint8_t               mac[SIM_AES_BLOCK_SIZE];
+    uint8_t               accept[1 + 32];
+    uint8_t               size = 0;
+
+    if( uplink->size != JOIN_REQUEST_SIZE )
+    {
+        return false;
+    }
+
+    sim_ns_device_t* device = sim_ns_find_by_eui( &msg[9] );
+    if( device == NULL )
+    {
+        SMTC_HAL_TRACE_WARNING( "NS: join-request from an unknown DevEUI\n" );
+        return false;
+    }
+    device->stats.join_requests++;
+
+    sim_aes128_cmac( device->app_key, msg, JOIN_REQUEST_SIZE - MIC_SIZE, mac );
+    if( memcmp( mac, &msg[JOIN_REQUEST_SIZE - MIC_SIZE], MIC_SIZE ) != 0 )
+    {
+        device->stats.mic_errors++;
+        SMTC_HAL_TRACE_WARNING( "NS: join-request MIC error\n" );
+        return false;
+    }
+
+    const uint16_t dev_nonce = ( uint16_t ) ( msg[17] | ( msg[18] << 8 ) );
+    if( device->has_dev_nonce && ( dev_nonce <= device->last_dev_nonce ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "NS: DevNonce %u replayed (last %u)\n", dev_nonce, device->last_dev_nonce );
+        return false;
+    }
+    device->has_dev_nonce  = true;
+    device->last_dev_nonce = dev_nonce;
+
+    join_nonce = ( join_nonce + 1 ) & 0xFFFFFF;
+
+    // MHDR | JoinNonce | NetID | DevAddr | DLSettings | RxDelay | CFList | MIC
+    accept[size++] = MHDR_JOIN_ACCEPT;
+    accept[size++] = ( uint8_t ) join_nonce;
+    accept[size++] = ( uint8_t ) ( join_nonce >> 8 );
+    accept[size++] = ( uint8_t ) ( join_nonce >> 16 );
+    accept[size++] = ( uint8_t ) SIM_NS_NET_ID;
+    accept[size++] = ( uint8_t ) ( SIM_NS_NET_ID >> 8 );
+    accept[size++] = ( uint8_t ) ( SIM_NS_NET_ID >> 16 );
+    sim_ns_put_le32( &accept[size], device->dev_addr );
+    size += 4;
+    accept[size++] = 0x00;  // RX1DROffset 0, RX2 DR0
+    accept[size++] = SIM_NS_RECEIVE_DELAY1_US / 1000000;
+    for( uint8_t i = 0; i < sizeof( cflist_freqs_hz ) / sizeof( cflist_freqs_hz[0] ); i++ )
+    {
+        const uint32_t freq = cflist_freqs_hz[i] / 100;
+
+        accept[size++] = ( uint8_t ) freq;
+        accept[size++] = ( uint8_t ) ( freq >> 8 );
+        accept[size++] = ( uint8_t ) ( freq >> 16 );
+    }
+    accept[size++] = 0x00;  // CFListType: frequencies
+
+    sim_aes128_cmac( device->app_key, accept, size, mac );
+    memcpy( &accept[size], mac, MIC_SIZE );
+    size += MIC_SIZE;
+
+    // The network decrypts so the device only needs AES encrypt
+    for( uint8_t i = 1; i < size; i += SIM_AES_BLOCK_SIZE )
+    {
+        sim_aes128_decrypt( device->app_key, &accept[i], &accept[i] );
+    }
+
+    sim_ns_derive_key( device->app_key, 0x01, join_nonce, dev_nonce, device->nwk_skey );
+    sim_ns_derive_key( device->app_key, 0x02, join_nonce, dev_nonce, device->app_skey );
+    device->joined                 = true;
+    device->has_fcnt_up            = false;
+    device->fcnt_up                = 0;
+    device->fcnt_down              = 0;
+    device->tx_power_index         = 0;
+    device->nb_snr                 = 0;
+    device->mac_size               = 0;
+    device->confirmed_down_pending = false;
+    device->stats.joins++;
+
+    SMTC_HAL_TRACE_INFO( "NS: join-accept DevAddr %08x, DevNonce %u, JoinNonce %u\n", device->dev_addr, dev_nonce,
+                         join_nonce );
+
+    memcpy( downlink->payload, accept, size );
+    downlink->size = size;
+    sim_ns_schedule( uplink, true, downlink );
+    return true;
+}
+
+static bool sim_ns_on_data( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink )
+{
+    const uint8_t* msg = uplink->payload;
+
+    if( uplink->size < DATA_MIN_SIZE )
+    {
+        return false;
+    }
+
+    const uint32_t   dev_addr = sim_ns_get_le32( &msg[1] );
+    sim_ns_device_t* device   = sim_ns_find_by_addr( dev_addr );
+    if( device == NULL )
+    {
+        return false;
+    }
+
+    const bool     confirmed = ( msg[0] & MHDR_TYPE_MASK ) == MHDR_CONFIRMED_UP;
+    const uint8_t  fctrl     = msg[5];
+    const uint16_t fcnt16    = ( uint16_t ) ( msg[6] | ( msg[7] << 8 ) );
+    const uint8_t  fopts_len = fctrl & FCTRL_FOPTS_LEN_MASK;
+    const uint8_t  size      = uplink->size - MIC_SIZE;
+
+    if( 8 + fopts_len > size )
+    {
+        return false;
+    }
+
+    // Rebuild the 32-bit counter from its 16 LSBs
+    uint32_t fcnt = ( device->fcnt_up & 0xFFFF0000 ) | fcnt16;
+    if( device->has_fcnt_up && ( fcnt < device->fcnt_up ) )
+    {
+        fcnt += 0x10000;
+    }
+
+    if( sim_ns_mic( device->nwk_skey, 0, dev_addr, fcnt, msg, size ) != sim_ns_get_le32( &msg[size] ) )
+    {
+        device->stats.mic_errors++;
+        SMTC_HAL_TRACE_WARNING( "NS: uplink MIC error, DevAddr %08x FCnt %u\n", dev_addr, fcnt );
+        return false;
+    }
+
+    const bool duplicate = device->has_fcnt_up && ( fcnt == device->fcnt_up );
+    if( duplicate )
+    {
+        // Retransmission: answer again, do not process again
+        device->stats.duplicates++;
+    }
+    else
+    {
+        if( device->has_fcnt_up )
+        {
+            device->stats.lost += fcnt - device->fcnt_up - 1;
+        }
+        device->has_fcnt_up = true;
+        device->fcnt_up     = fcnt;
+        device->stats.uplinks++;
+        device->stats.confirmed_uplinks += confirmed ? 1 : 0;
+        device->uplinks_since_downlink++;
+
+        if( ( fctrl & FCTRL_ACK ) && device->confirmed_down_pending )
+        {
+            device->confirmed_down_pending = false;
+            device->stats.downlinks_acked++;
+        }
+
+        sim_ns_on_mac( device, uplink, &msg[8], fopts_len );
+
+        if( size > 8 + fopts_len )
+        {
+            const uint8_t port         = msg[8 + fopts_len];
+            uint8_t       payload_size = size - 9 - fopts_len;
+            uint8_t       payload[SIM_RADIO_MAX_PAYLOAD];
+
+            memcpy( payload, &msg[9 + fopts_len], payload_size );
+            sim_ns_crypt( ( port == 0 ) ? device->nwk_skey : device->app_skey, 0, dev_addr, fcnt, payload,
+                          payload_size );
+            device->stats.uplink_bytes += payload_size;
+            if( port == 0 )
+            {
+                sim_ns_on_mac( device, uplink, payload, payload_size );
+            }
+        }
+
+        if( adr_enabled && ( fctrl & FCTRL_ADR ) )
+        {
+            sim_ns_adr( device, uplink );
+        }
+
+        if( ( downlink_every > 0 ) && ( device->uplinks_since_downlink >= downlink_every ) &&
+            ( device->queue_size < SIM_NS_QUEUE_SIZE ) )
+        {
+            sim_ns_downlink_t* entry = &device->queue[device->queue_size++];
+
+            entry->port      = downlink_port;
+            entry->confirmed = downlink_confirmed;
+            entry->size      = downlink_size;
+            for( uint8_t i = 0; i < downlink_size; i++ )
+            {
+                entry->data[i] = ( uint8_t ) ( device->fcnt_down + i );
+            }
+        }
+    }
+
+    SMTC_HAL_TRACE_INFO( "NS: %s uplink DevAddr %08x FCnt %u SF%u %.1f dB%s\n", confirmed ? "confirmed" : "unconfirmed",
+                         dev_addr, fcnt, uplink->sf, ( double ) uplink->snr_db, duplicate ? " (duplicate)" : "" );
+
+    if( !confirmed && ( device->mac_size == 0 ) && ( device->queue_size == 0 ) &&
+        ( ( fctrl & FCTRL_ADR_ACK_REQ ) == 0 ) )
+    {
+        return false;
+    }
+
+    downlink->size = sim_ns_build_data( device, confirmed, ( fctrl & FCTRL_ADR ) != 0, downlink->payload );
+    sim_ns_schedule( uplink, false, downlink );
+    return true;
+}
+
+static void sim_ns_on_mac( sim_ns_device_t* device, const sim_radio_frame_t* uplink, const uint8_t* cmds,
+                           const uint8_t size )
+{
+    uint8_t i = 0;
+
+    while( i < size )
+    {
+        const uint8_t cid = cmds[i];
+
+        if( ( cid >= sizeof( uplink_mac_sizes ) ) || ( uplink_mac_sizes[cid] < 0 ) ||
+            ( i + 1 + uplink_mac_sizes[cid] > size ) )
+        {
+            // The rest cannot be parsed
+            SMTC_HAL_TRACE_WARNING( "NS: unknown MAC command 0x%02x\n", cid );
+            return;
+        }
+
+        switch( cid )
+        {
+        case CID_LINK_CHECK:
+        {
+            const bool    known  = ( uplink->sf >= 7 ) && ( uplink->sf <= 12 );
+            const float   margin = uplink->snr_db - ( known ? required_snr_db[12 - uplink->sf] : 0 );
+            const uint8_t ans[]  = { CID_LINK_CHECK, ( uint8_t ) ( ( margin > 0 ) ? margin : 0 ), 1 };
+            sim_ns_add_mac( device, ans, sizeof( ans ) );
+            break;
+        }
+        case CID_LINK_ADR:
+            if( ( cmds[i + 1] & LINK_ADR_ANS_OK ) == LINK_ADR_ANS_OK )
+            {
+                device->stats.link_adr_ans_ok++;
+            }
+            else
+            {
+                device->stats.link_adr_ans_nok++;
+                SMTC_HAL_TRACE_WARNING( "NS: LinkADRAns status 0x%02x\n", cmds[i + 1] );
+            }
+            break;
+        case CID_DEVICE_TIME:
+        {
+            // GPS time at the end of the uplink
+            struct timespec now;
+            clock_gettime( CLOCK_REALTIME, &now );
+            const uint64_t now_us = ( uint64_t ) now.tv_sec * 1000000 + now.tv_nsec / 1000 -
+                                    ( sim_radio_now_us( ) - uplink->end_us ) -
+                                    ( uint64_t ) ( SIM_NS_GPS_EPOCH_UNIX_S - SIM_NS_GPS_LEAP_S ) * 1000000;
+            const uint32_t seconds = ( uint32_t ) ( now_us / 1000000 );
+            const uint8_t  ans[]   = { CID_DEVICE_TIME,
+                                    ( uint8_t ) seconds,
+                                    ( uint8_t ) ( seconds >> 8 ),
+                                    ( uint8_t ) ( seconds >> 16 ),
+                                    ( uint8_t ) ( seconds >> 24 ),
+                                    ( uint8_t ) ( ( now_us % 1000000 ) * 256 / 1000000 ) };
+            sim_ns_add_mac( device, ans, sizeof( ans ) );
+            break;
+        }
+        default:
+            break;
+        }
+        i += 1 + uplink_mac_sizes[cid];
+    }
+}
+
+static void sim_ns_adr( sim_ns_device_t* device, const sim_radio_frame_t* uplink )
+{
+    const int8_t dr      = ( int8_t ) ( 12 - uplink->sf );
+    float        max_snr = -100.0f;
+
+    if( ( uplink->bw_hz != 125000 ) || ( dr < 0 ) || ( dr > SIM_NS_MAX_DR ) )
+    {
+        return;
+    }
+
+    device->snr_history[device->nb_snr++] = uplink->snr_db;
+    if( device->nb_snr < adr_history )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < device->nb_snr; i++ )
+    {
+        max_snr = ( device->snr_history[i] > max_snr ) ? device->snr_history[i] : max_snr;
+    }
+    device->nb_snr = 0;
+
+    // 3 dB per step: raise the data rate first, then lower the power
+    const float margin   = max_snr - required_snr_db[dr] - adr_margin_db;
+    int8_t      nb_steps = ( int8_t ) floorf( margin / 3.0f );
+    int8_t      new_dr   = dr;
+    int8_t      power    = ( int8_t ) device->tx_power_index;
+
+    while( ( nb_steps > 0 ) && ( new_dr < SIM_NS_MAX_DR ) )
+    {
+        new_dr++;
+        nb_steps--;
+    }
+    while( ( nb_steps > 0 ) && ( power < SIM_NS_MAX_TX_POWER_INDEX ) )
+    {
+        power++;
+        nb_steps--;
+    }
+    while( ( nb_steps < 0 ) && ( power > 0 ) )
+    {
+        power--;
+        nb_steps++;
+    }
+
+    if( ( new_dr != dr ) || ( power != device->tx_power_index ) )
+    {
+        const uint8_t req[] = { CID_LINK_ADR, ( uint8_t ) ( ( new_dr << 4 ) | power ), ( uint8_t ) SIM_NS_CH_MASK,
+                                ( uint8_t ) ( SIM_NS_CH_MASK >> 8 ), 0x01 };
+
+        sim_ns_add_mac( device, req, sizeof( req ) );
+        device->tx_power_index = ( uint8_t ) power;
+        device->stats.link_adr_req++;
+        SMTC_HAL_TRACE_INFO( "NS: LinkADRReq DR%d -> DR%d, TX power index %d (max SNR %.1f dB)\n", dr, new_dr, power,
+                             ( double ) max_snr );
+    }
+}
+
+static void sim_ns_add_mac( sim_ns_device_t* device, const uint8_t* cmd, const uint8_t size )
+{
+    if( device->mac_size + size <= SIM_NS_MAX_FOPTS )
+    {
+        memcpy( &device->mac[device->mac_size], cmd, size );
+        device->mac_size += size;
+    }
+}
+
+static uint8_t sim_ns_build_data( sim_ns_device_t* device, const bool ack, const bool adr, uint8_t* msg )
+{
+    sim_ns_downlink_t* app  = ( device->queue_size > 0 ) ? &device->queue[0] : NULL;
+    const bool         conf = ( app != NULL ) && app->confirmed;
+    uint8_t            size = 0;
+
+    msg[size++] = conf ? MHDR_CONFIRMED_DOWN : MHDR_UNCONFIRMED_DOWN;
+    sim_ns_put_le32( &msg[size], device->dev_addr );
+    size += 4;
+    msg[size++] = ( adr ? FCTRL_ADR : 0 ) | ( ack ? FCTRL_ACK : 0 ) |
+                  ( ( device->queue_size > 1 ) ? FCTRL_FPENDING : 0 ) | device->mac_size;
+    msg[size++] = ( uint8_t ) device->fcnt_down;
+    msg[size++] = ( uint8_t ) ( device->fcnt_down >> 8 );
+    memcpy( &msg[size], device->mac, device->mac_size );
+    size += device->mac_size;
+
+    if( app != NULL )
+    {
+        msg[size++] = app->port;
+        memcpy( &msg[size], app->data, app->size );
+        sim_ns_crypt( device->app_skey, 1, device->dev_addr, device->fcnt_down, &msg[size], app->size );
+        size += app->size;
+
+        device->confirmed_down_pending = conf;
+        device->stats.confirmed_downlinks += conf ? 1 : 0;
+        device->queue_size--;
+        memmove( &device->queue[0], &device->queue[1], device->queue_size * sizeof( device->queue[0] ) );
+        device->uplinks_since_downlink = 0;
+    }
+
+    sim_ns_put_le32( &msg[size], sim_ns_mic( device->nwk_skey, 1, device->dev_addr, device->fcnt_down, msg, size ) );
+    size += MIC_SIZE;
+
+    device->fcnt_down++;
+    device->mac_size = 0;
+    device->stats.downlinks++;
+    device->stats.acks += ack ? 1 : 0;
+    return size;
+}
+
+static void sim_ns_schedule( const sim_radio_frame_t* uplink, const bool join, sim_radio_frame_t* downlink )
+{
+    const uint32_t delay_us = join ? SIM_NS_JOIN_ACCEPT_DELAY1_US : SIM_NS_RECEIVE_DELAY1_US;
+
+    // RX1 is the uplink channel and data rate, RX1DROffset 0
+    downlink->freq_hz      = uplink->freq_hz;
+    downlink->sf           = uplink->sf;
+    downlink->bw_hz        = uplink->bw_hz;
+    downlink->start_us     = uplink->end_us + delay_us;
+    downlink->cr           = 1;
+    downlink->preamble_len = 8;
+    downlink->crc_on       = false;
+    downlink->iq_inverted  = true;
+    downlink->sync_word    = SIM_RADIO_SYNC_WORD_PUBLIC;
+    downlink->tx_power_dbm = SIM_NS_DOWNLINK_TX_POWER_DBM;
+    downlink->crc_error    = false;
+    downlink->from_gateway = true;
+
+    if( rx_window == 2 )
+    {
+        downlink->freq_hz = SIM_NS_RX2_FREQ_HZ;
+        downlink->sf      = SIM_NS_RX2_SF;
+        downlink->bw_hz   = 125000;
+        downlink->start_us += SIM_NS_RX2_DELAY_OFFSET_US;
+    }
+    downlink->end_us = downlink->start_us + sim_radio_time_on_air_us( downlink );
+}
+
+static void sim_ns_derive_key( const uint8_t app_key[16], const uint8_t prefix, const uint32_t nonce,
+                               const uint16_t dev_nonce, uint8_t key[16] )
+{
+    uint8_t block[SIM_AES_BLOCK_SIZE] = { 0 };
+
+    // prefix | JoinNonce | NetID | DevNonce | pad16
+    block[0] = prefix;
+    block[1] = ( uint8_t ) nonce;
+    block[2] = ( uint8_t ) ( nonce >> 8 );
+    block[3] = ( uint8_t ) ( nonce >> 16 );
+    block[4] = ( uint8_t ) SIM_NS_NET_ID;
+    block[5] = ( uint8_t ) ( SIM_NS_NET_ID >> 8 );
+    block[6] = ( uint8_t ) ( SIM_NS_NET_ID >> 16 );
+    block[7] = ( uint8_t ) dev_nonce;
+    block[8] = ( uint8_t ) ( dev_nonce >> 8 );
+    sim_aes128_encrypt( app_key, block, key );
+}
+
+static void sim_ns_b0( const uint8_t prefix, const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                       const uint8_t last, uint8_t block[SIM_AES_BLOCK_SIZE] )
+{
+    memset( block, 0, SIM_AES_BLOCK_SIZE );
+    block[0] = prefix;
+    block[5] = dir;
+    sim_ns_put_le32( &block[6], dev_addr );
+    sim_ns_put_le32( &block[10], fcnt );
+    block[15] = last;
+}
+
+static uint32_t sim_ns_mic( const uint8_t key[16], const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                            const uint8_t* msg, const uint8_t size )
+{
+    uint8_t buf[SIM_AES_BLOCK_SIZE + SIM_RADIO_MAX_PAYLOAD];
+    uint8_t mac[SIM_AES_BLOCK_SIZE];
+
+    sim_ns_b0( 0x49, dir, dev_addr, fcnt, size, buf );
+    memcpy( &buf[SIM_AES_BLOCK_SIZE], msg, size );
+    sim_aes128_cmac( key, buf, SIM_AES_BLOCK_SIZE + size, mac );
+    return sim_ns_get_le32( mac );
+}
+
+static void sim_ns_crypt( const uint8_t key[16], const uint8_t dir, const uint32_t dev_addr, const uint32_t fcnt,
+                          uint8_t* data, const uint8_t size )
+{
+    uint8_t a[SIM_AES_BLOCK_SIZE];
+    uint8_t s[SIM_AES_BLOCK_SIZE];
+
+    // AES-CTR with the A_i blocks, i from 1
+    for( uint16_t offset = 0; offset < size; offset += SIM_AES_BLOCK_SIZE )
+    {
+        sim_ns_b0( 0x01, dir, dev_addr, fcnt, ( uint8_t ) ( offset / SIM_AES_BLOCK_SIZE + 1 ), a );
+        sim_aes128_encrypt( key, a, s );
+        for( uint8_t i = 0; ( i < SIM_AES_BLOCK_SIZE ) && ( offset + i < size ); i++ )
+        {
+            data[offset + i] ^= s[i];
+        }
+    }
+}
+
+static uint32_t sim_ns_get_le32( const uint8_t* buf )
+{
+    return ( uint32_t ) buf[0] | ( ( uint32_t ) buf[1] << 8 ) | ( ( uint32_t ) buf[2] << 16 ) |
+           ( ( uint32_t ) buf[3] << 24 );
+}
+
+static void sim_ns_put_le32( uint8_t* buf, const uint32_t value )
+{
+    buf[0] = ( uint8_t ) value;
+    buf[1] = ( uint8_t ) ( value >> 8 );
+    buf[2] = ( uint8_t ) ( value >> 16 );
+    buf[3] = ( uint8_t ) ( value >> 24 );
+}
+
+static void sim_ns_stats_add( sim_ns_stats_t* sum, const sim_ns_stats_t* stats )
+{
+    sum->join_requests += stats->join_requests;
+    sum->joins += stats->joins;
+    sum->uplinks += stats->uplinks;
+    sum->uplink_bytes += stats->uplink_bytes;
+    sum->confirmed_uplinks += stats->confirmed_uplinks;
+    sum->duplicates += stats->duplicates;
+    sum->lost += stats->lost;
+    sum->mic_errors += stats->mic_errors;
+    sum->downlinks += stats->downlinks;
+    sum->acks += stats->acks;
+    sum->confirmed_downlinks += stats->confirmed_downlinks;
+    sum->downlinks_acked += stats->downlinks_acked;
+    sum->link_adr_req += stats->link_adr_req;
+    sum->link_adr_ans_ok += stats->link_adr_ans_ok;
+    sum->link_adr_ans_nok += stats->link_adr_ans_nok;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,154 @@
+/*!
+ * \file      sim_ns.h
+ *
+ * \brief     Stand-in LoRaWAN 1.0.4 network server, EU868
+ *
+ * Enough of a network server to run the modem end to end without RF:
+ *
+ *   - OTAA: join-request MIC and DevNonce checks, join-accept with a CFList
+ *     adding 867.1..867.9 MHz, session keys
+ *   - uplinks: MIC, 32-bit FCnt rebuilt from its 16 LSBs, duplicates
+ *     (retransmissions) and lost frames counted, FRMPayload decrypted
+ *   - MAC: LinkCheckAns, DeviceTimeAns, LinkADRReq from the best SNR of the
+ *     last uplinks, answers parsed
+ *   - downlinks: ACK of confirmed uplinks, queued application downlinks,
+ *     MAC answers, in RX1 or RX2
+ *
+ * Settings are read from the board profile:
+ *
+ *   sim.ns_rx_window          = 1         # 1 | 2
+ *   sim.ns_adr                = 1
+ *   sim.ns_adr_history        = 10        # uplinks before a LinkADRReq
+ *   sim.ns_adr_margin_db      = 10
+ *   sim.ns_downlink_every     = 0         # queue a downlink every N uplinks, 0 never
+ *   sim.ns_downlink_port      = 2
+ *   sim.ns_downlink_size      = 4
+ *   sim.ns_downlink_confirmed = 0
+ */
+#ifndef SIM_NS_H
+#define SIM_NS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "sim_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define SIM_NS_MAX_DEVICES 250
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Counters, per device or summed over all devices
+ */
+typedef struct sim_ns_stats_s
+{
+    uint32_t join_requests;
+    uint32_t joins;
+    uint32_t uplinks;  //!< Unique uplinks, retransmissions excluded
+    uint32_t uplink_bytes;
+    uint32_t confirmed_uplinks;
+    uint32_t duplicates;
+    uint32_t lost;  //!< FCnt gaps
+    uint32_t mic_errors;
+    uint32_t downlinks;
+    uint32_t acks;
+    uint32_t confirmed_downlinks;
+    uint32_t downlinks_acked;
+    uint32_t link_adr_req;
+    uint32_t link_adr_ans_ok;
+    uint32_t link_adr_ans_nok;
+} sim_ns_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the settings and forgets all devices
+ */
+void sim_ns_init( void );
+
+/*!
+ * Provisions a device, or updates the keys of a device already provisioned
+ *
+ * \param [in] dev_eui  DevEUI, MSB first
+ * \param [in] join_eui JoinEUI, MSB first
+ * \param [in] app_key  Root key, NwkKey in the modem API
+ *
+ * \retval false if the device table is full
+ */
+bool sim_ns_add_device( const uint8_t dev_eui[8], const uint8_t join_eui[8], const uint8_t app_key[16] );
+
+/*!
+ * Handles an uplink heard by the gateway
+ *
+ * \param [in]  uplink   Frame received, rssi_dbm and snr_db set
+ * \param [out] downlink Frame to send back, start_us and end_us set
+ *
+ * \retval true if a downlink is to be sent
+ */
+bool sim_ns_on_uplink( const sim_radio_frame_t* uplink, sim_radio_frame_t* downlink );
+
+/*!
+ * Queues an application downlink, sent after the next uplink of the device
+ *
+ * \param [in] dev_eui   DevEUI, MSB first
+ * \param [in] port      FPort, 1..223
+ * \param [in] data      Payload
+ * \param [in] size      Payload size
+ * \param [in] confirmed Confirmed downlink
+ *
+ * \retval false if the device is unknown or its queue full
+ */
+bool sim_ns_queue_downlink( const uint8_t dev_eui[8], const uint8_t port, const uint8_t* data, const uint8_t size,
+                            const bool confirmed );
+
+/*!
+ * Gets the counters
+ *
+ * \param [in]  index Device index, in order of provisioning, -1 for the sum
+ * \param [out] stats Counters
+ *
+ * \retval false if there is no such device
+ */
+bool sim_ns_get_stats( const int index, sim_ns_stats_t* stats );
+
+/*!
+ * Traces the counters summed over all devices
+ */
+void sim_ns_print_stats( void );
+
+/*!
+ * Writes the counters of each device and their sum
+ *
+ * \param [in] path JSON file
+ *
+ * \retval true if written
+ */
+bool sim_ns_write_stats( const char* path );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_NS_H
+
+/* --- EOF ------------------------------------------------------------------ */
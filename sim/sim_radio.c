@@ -0,0 +1,617 @@
+/*!
+ * \file      sim_radio.c
+ *
+ * \brief     SX1276 LoRa behavioural model implementation
+ *
+ * Register accesses and model events both run under the HAL critical section.
+ * The model thread only takes the critical section once its wait is over, so
+ * it never holds the wake lock at the same time.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "sim_radio.h"
+
+#include "smtc_hal_spi_sim.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+#include "modem_pinout.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_RADIO_AIR_SIZE 8
+
+/*!
+ * Preamble symbols the receiver needs to lock, RX has to start before the last ones
+ */
+#define SIM_RADIO_DETECT_SYMBOLS 4
+
+#define SIM_RADIO_FREQ_TOLERANCE_HZ 25000
+
+#define SIM_RADIO_CAD_SYMBOLS 2
+
+#define SIM_RADIO_XTAL_HZ 32000000ULL
+
+/*!
+ * RegPktRssiValue offsets, LoRa mode
+ */
+#define SIM_RADIO_RSSI_OFFSET_HF ( -157 )
+#define SIM_RADIO_RSSI_OFFSET_LF ( -164 )
+#define SIM_RADIO_RSSI_HF_PORT_MIN_HZ 525000000
+
+#define REG_OP_MODE 0x01
+#define REG_FRF_MSB 0x06
+#define REG_FRF_MID 0x07
+#define REG_FRF_LSB 0x08
+#define REG_PA_CONFIG 0x09
+#define REG_LR_FIFO_TX_BASE_ADDR 0x0E
+#define REG_LR_FIFO_RX_BASE_ADDR 0x0F
+#define REG_LR_FIFO_RX_CURRENT_ADDR 0x10
+#define REG_LR_IRQ_FLAGS_MASK 0x11
+#define REG_LR_IRQ_FLAGS 0x12
+#define REG_LR_RX_NB_BYTES 0x13
+#define REG_LR_PKT_SNR_VALUE 0x19
+#define REG_LR_PKT_RSSI_VALUE 0x1A
+#define REG_LR_RSSI_VALUE 0x1B
+#define REG_LR_HOP_CHANNEL 0x1C
+#define REG_LR_MODEM_CONFIG_1 0x1D
+#define REG_LR_MODEM_CONFIG_2 0x1E
+#define REG_LR_SYMB_TIMEOUT_LSB 0x1F
+#define REG_LR_PREAMBLE_MSB 0x20
+#define REG_LR_PREAMBLE_LSB 0x21
+#define REG_LR_PAYLOAD_LENGTH 0x22
+#define REG_LR_FIFO_RX_BYTE_ADDR 0x25
+#define REG_LR_MODEM_CONFIG_3 0x26
+#define REG_LR_INVERT_IQ 0x33
+#define REG_LR_SYNC_WORD 0x39
+#define REG_PA_DAC 0x4D
+
+#define OP_MODE_LONG_RANGE 0x80
+#define OP_MODE_MASK 0x07
+#define OP_MODE_STANDBY 0x01
+#define OP_MODE_TX 0x03
+#define OP_MODE_RX_CONTINUOUS 0x05
+#define OP_MODE_RX_SINGLE 0x06
+#define OP_MODE_CAD 0x07
+
+#define IRQ_RX_TIMEOUT 0x80
+#define IRQ_RX_DONE 0x40
+#define IRQ_PAYLOAD_CRC_ERROR 0x20
+#define IRQ_VALID_HEADER 0x10
+#define IRQ_TX_DONE 0x08
+#define IRQ_CAD_DONE 0x04
+
+#define HOP_CHANNEL_CRC_ON_PAYLOAD 0x40
+
+#define PA_CONFIG_PA_BOOST 0x80
+#define PA_DAC_20_DBM 0x07
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef enum sim_radio_event_type_e
+{
+    SIM_RADIO_EVENT_NONE,
+    SIM_RADIO_EVENT_TX_DONE,
+    SIM_RADIO_EVENT_RX_DONE,
+    SIM_RADIO_EVENT_RX_TIMEOUT,
+    SIM_RADIO_EVENT_CAD_DONE,
+} sim_radio_event_type_t;
+
+/*!
+ * Pending radio event, the radio does one thing at a time
+ */
+typedef struct sim_radio_event_s
+{
+    sim_radio_event_type_t type;
+    uint64_t               due_us;
+    sim_radio_frame_t      frame;  //!< Frame transmitted or received
+} sim_radio_event_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const uint32_t bandwidths_hz[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+
+static sim_radio_event_t      event;
+static sim_radio_frame_t      air[SIM_RADIO_AIR_SIZE];
+static bool                   air_used[SIM_RADIO_AIR_SIZE];
+static uint64_t               rx_start_us = 0;
+static sim_radio_tx_handler_t tx_handler  = NULL;
+static sim_radio_frame_t      tx_frame;             //!< Last frame transmitted
+static bool                   tx_started  = false;  //!< tx_frame to be passed to the TX handler
+
+static bool            started = false;
+static pthread_t       thread;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake_cond;
+static bool            wake_pending = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static uint8_t sim_radio_on_write( const uint8_t address, const uint8_t old_value, const uint8_t value );
+
+static void sim_radio_on_mode( const uint8_t op_mode );
+
+static void sim_radio_read_config( sim_radio_frame_t* frame );
+
+static uint32_t sim_radio_symbol_us( const sim_radio_frame_t* frame );
+
+static int8_t sim_radio_tx_power_dbm( void );
+
+static bool sim_radio_rx_matches( const sim_radio_frame_t* rx, const sim_radio_frame_t* frame );
+
+static void sim_radio_rx_schedule( void );
+
+static void sim_radio_rx_done( const sim_radio_frame_t* frame );
+
+static void sim_radio_set_irq( const uint8_t flags, const hal_gpio_pin_names_t dio );
+
+static void sim_radio_set_standby( void );
+
+static void sim_radio_wake( void );
+
+static void sim_radio_run_event( void );
+
+static void* sim_radio_thread( void* arg );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void sim_radio_init( void )
+{
+    pthread_condattr_t attr;
+
+    if( started )
+    {
+        return;
+    }
+
+    // Deadlines are RT_CLOCK times
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, RT_CLOCK );
+    pthread_cond_init( &wake_cond, &attr );
+    pthread_condattr_destroy( &attr );
+
+    hal_spi_sim_set_write_hook( sim_radio_on_write );
+
+    if( pthread_create( &thread, NULL, sim_radio_thread, NULL ) != 0 )
+    {
+        mcu_panic( "sim radio thread\n" );
+    }
+    pthread_detach( thread );
+    started = true;
+}
+
+void sim_radio_set_tx_handler( const sim_radio_tx_handler_t handler )
+{
+    tx_handler = handler;
+}
+
+bool sim_radio_deliver( const sim_radio_frame_t* frame )
+{
+    const uint64_t now_us = sim_radio_now_us( );
+    bool           queued = false;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    for( uint8_t i = 0; i < SIM_RADIO_AIR_SIZE; i++ )
+    {
+        if( air_used[i] && ( air[i].end_us < now_us ) )
+        {
+            air_used[i] = false;
+        }
+    }
+    for( uint8_t i = 0; ( i < SIM_RADIO_AIR_SIZE ) && !queued; i++ )
+    {
+        if( !air_used[i] )
+        {
+            air[i]      = *frame;
+            air_used[i] = true;
+            queued      = true;
+        }
+    }
+
+    // A receiver already listening may catch it
+    const uint8_t mode = hal_spi_sim_get_reg( REG_OP_MODE ) & OP_MODE_MASK;
+    if( queued && ( ( mode == OP_MODE_RX_CONTINUOUS ) || ( mode == OP_MODE_RX_SINGLE ) ) &&
+        ( event.type != SIM_RADIO_EVENT_RX_DONE ) )
+    {
+        sim_radio_rx_schedule( );
+        sim_radio_wake( );
+    }
+
+    CRITICAL_SECTION_END( );
+
+    return queued;
+}
+
+uint32_t sim_radio_time_on_air_us( const sim_radio_frame_t* frame )
+{
+    const double  tsym_us = ( double ) ( 1u << frame->sf ) * 1e6 / frame->bw_hz;
+    const int32_t de      = ( tsym_us >= 16000.0 ) ? 1 : 0;
+    const int32_t num     = 8 * frame->size - 4 * frame->sf + 28 + ( frame->crc_on ? 16 : 0 );
+    const int32_t den     = 4 * ( frame->sf - 2 * de );
+    int32_t       nb_payload_symb = 8;
+
+    if( num > 0 )
+    {
+        nb_payload_symb += ( ( num + den - 1 ) / den ) * ( frame->cr + 4 );
+    }
+    return ( uint32_t ) ( ( frame->preamble_len + 4.25 + nb_payload_symb ) * tsym_us );
+}
+
+uint64_t sim_radio_now_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( RT_CLOCK, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000 + ( uint64_t ) ts.tv_nsec / 1000;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t sim_radio_on_write( const uint8_t address, const uint8_t old_value, const uint8_t value )
+{
+    const bool is_lora = ( hal_spi_sim_get_reg( REG_OP_MODE ) & OP_MODE_LONG_RANGE ) != 0;
+
+    if( ( address == REG_LR_IRQ_FLAGS ) && is_lora )
+    {
+        // Write one to clear
+        return old_value & ~value;
+    }
+    if( address == REG_OP_MODE )
+    {
+        // Stored first, the model reads the new mode back
+        hal_spi_sim_set_reg( REG_OP_MODE, value );
+        sim_radio_on_mode( value );
+        return hal_spi_sim_get_reg( REG_OP_MODE );
+    }
+    return value;
+}
+
+static void sim_radio_on_mode( const uint8_t op_mode )
+{
+    const uint64_t now_us = sim_radio_now_us( );
+
+    CRITICAL_SECTION_BEGIN( );
+
+    event.type = SIM_RADIO_EVENT_NONE;
+    if( ( op_mode & OP_MODE_LONG_RANGE ) != 0 )
+    {
+        switch( op_mode & OP_MODE_MASK )
+        {
+        case OP_MODE_TX:
+            sim_radio_read_config( &event.frame );
+            event.frame.size = hal_spi_sim_get_reg( REG_LR_PAYLOAD_LENGTH );
+            hal_spi_sim_read_fifo( hal_spi_sim_get_reg( REG_LR_FIFO_TX_BASE_ADDR ), event.frame.payload,
+                                   event.frame.size );
+            // TX_OFF (bit 0 set) is the normal uplink polarity
+            event.frame.iq_inverted  = ( hal_spi_sim_get_reg( REG_LR_INVERT_IQ ) & 0x01 ) == 0;
+            event.frame.tx_power_dbm = sim_radio_tx_power_dbm( );
+            event.frame.from_gateway = false;
+            event.frame.start_us     = now_us;
+            event.frame.end_us       = now_us + sim_radio_time_on_air_us( &event.frame );
+            event.type               = SIM_RADIO_EVENT_TX_DONE;
+            event.due_us             = event.frame.end_us;
+            tx_frame                 = event.frame;
+            tx_started               = true;
+            break;
+        case OP_MODE_RX_CONTINUOUS:
+        case OP_MODE_RX_SINGLE:
+            rx_start_us = now_us;
+            sim_radio_rx_schedule( );
+            break;
+        case OP_MODE_CAD:
+            sim_radio_read_config( &event.frame );
+            event.type   = SIM_RADIO_EVENT_CAD_DONE;
+            event.due_us = now_us + SIM_RADIO_CAD_SYMBOLS * sim_radio_symbol_us( &event.frame );
+            break;
+        default:
+            break;
+        }
+    }
+    sim_radio_wake( );
+
+    CRITICAL_SECTION_END( );
+}
+
+static void sim_radio_read_config( sim_radio_frame_t* frame )
+{
+    const uint8_t  config_1 = hal_spi_sim_get_reg( REG_LR_MODEM_CONFIG_1 );
+    const uint8_t  config_2 = hal_spi_sim_get_reg( REG_LR_MODEM_CONFIG_2 );
+    const uint8_t  bw_index = config_1 >> 4;
+    const uint32_t frf      = ( ( uint32_t ) hal_spi_sim_get_reg( REG_FRF_MSB ) << 16 ) |
+                         ( ( uint32_t ) hal_spi_sim_get_reg( REG_FRF_MID ) << 8 ) | hal_spi_sim_get_reg( REG_FRF_LSB );
+
+    memset( frame, 0, sizeof( *frame ) );
+    frame->freq_hz = ( uint32_t ) ( ( frf * SIM_RADIO_XTAL_HZ ) >> 19 );
+    frame->bw_hz   = bandwidths_hz[( bw_index < 10 ) ? bw_index : 7];
+    frame->cr      = ( config_1 >> 1 ) & 0x07;
+    frame->sf      = config_2 >> 4;
+    frame->crc_on  = ( config_2 & 0x04 ) != 0;
+    frame->preamble_len =
+        ( ( uint16_t ) hal_spi_sim_get_reg( REG_LR_PREAMBLE_MSB ) << 8 ) | hal_spi_sim_get_reg( REG_LR_PREAMBLE_LSB );
+    frame->sync_word = hal_spi_sim_get_reg( REG_LR_SYNC_WORD );
+
+    // Out of range values, e.g. before the radio is configured
+    if( ( frame->sf < 6 ) || ( frame->sf > 12 ) )
+    {
+        frame->sf = 7;
+    }
+    if( ( frame->cr < 1 ) || ( frame->cr > 4 ) )
+    {
+        frame->cr = 1;
+    }
+}
+
+static uint32_t sim_radio_symbol_us( const sim_radio_frame_t* frame )
+{
+    return ( uint32_t ) ( ( ( uint64_t ) 1000000 << frame->sf ) / frame->bw_hz );
+}
+
+static int8_t sim_radio_tx_power_dbm( void )
+{
+    const uint8_t pa_config    = hal_spi_sim_get_reg( REG_PA_CONFIG );
+    const int8_t  output_power = pa_config & 0x0F;
+
+    if( ( pa_config & PA_CONFIG_PA_BOOST ) != 0 )
+    {
+        const bool high_power = ( hal_spi_sim_get_reg( REG_PA_DAC ) & 0x07 ) == PA_DAC_20_DBM;
+        return ( high_power ? 5 : 2 ) + output_power;
+    }
+
+    // Pmax = 10.8 + 0.6 * MaxPower
+    const int8_t max_power = ( pa_config >> 4 ) & 0x07;
+    return ( int8_t ) ( ( 108 + 6 * max_power ) / 10 - ( 15 - output_power ) );
+}
+
+static bool sim_radio_rx_matches( const sim_radio_frame_t* rx, const sim_radio_frame_t* frame )
+{
+    const int64_t  df_hz        = ( int64_t ) frame->freq_hz - rx->freq_hz;
+    const uint32_t tsym_us      = sim_radio_symbol_us( frame );
+    const uint64_t last_lock_us = frame->start_us + ( uint64_t ) ( frame->preamble_len > SIM_RADIO_DETECT_SYMBOLS
+                                                                      ? frame->preamble_len - SIM_RADIO_DETECT_SYMBOLS
+                                                                      : 0 ) *
+                                                         tsym_us;
+
+    if( ( df_hz > SIM_RADIO_FREQ_TOLERANCE_HZ ) || ( df_hz < -SIM_RADIO_FREQ_TOLERANCE_HZ ) ||
+        ( frame->sf != rx->sf ) || ( frame->bw_hz != rx->bw_hz ) || ( frame->iq_inverted != rx->iq_inverted ) ||
+        ( frame->sync_word != rx->sync_word ) )
+    {
+        return false;
+    }
+
+    // The receiver has to be on before the end of the preamble
+    return rx_start_us <= last_lock_us;
+}
+
+static void sim_radio_rx_schedule( void )
+{
+    sim_radio_frame_t rx;
+    int8_t            best = -1;
+
+    sim_radio_read_config( &rx );
+    rx.iq_inverted = ( hal_spi_sim_get_reg( REG_LR_INVERT_IQ ) & 0x40 ) != 0;
+
+    for( uint8_t i = 0; i < SIM_RADIO_AIR_SIZE; i++ )
+    {
+        if( air_used[i] && sim_radio_rx_matches( &rx, &air[i] ) &&
+            ( ( best < 0 ) || ( air[i].start_us < air[best].start_us ) ) )
+        {
+            best = ( int8_t ) i;
+        }
+    }
+
+    const bool     single     = ( hal_spi_sim_get_reg( REG_OP_MODE ) & OP_MODE_MASK ) == OP_MODE_RX_SINGLE;
+    const uint16_t nb_symb    = ( ( uint16_t ) ( hal_spi_sim_get_reg( REG_LR_MODEM_CONFIG_2 ) & 0x03 ) << 8 ) |
+                             hal_spi_sim_get_reg( REG_LR_SYMB_TIMEOUT_LSB );
+    const uint64_t timeout_us = rx_start_us + ( uint64_t ) nb_symb * sim_radio_symbol_us( &rx );
+
+    // RX single gives up if the preamble is not locked within the symbol timeout
+    if( ( best >= 0 ) && ( !single || ( air[best].start_us + SIM_RADIO_DETECT_SYMBOLS * sim_radio_symbol_us( &rx ) <=
+                                        timeout_us ) ) )
+    {
+        event.type   = SIM_RADIO_EVENT_RX_DONE;
+        event.due_us = air[best].end_us;
+        event.frame  = air[best];
+        air_used[best] = false;
+    }
+    else if( single )
+    {
+        event.type   = SIM_RADIO_EVENT_RX_TIMEOUT;
+        event.due_us = timeout_us;
+    }
+    else
+    {
+        event.type = SIM_RADIO_EVENT_NONE;
+    }
+}
+
+static void sim_radio_rx_done( const sim_radio_frame_t* frame )
+{
+    const uint8_t base   = hal_spi_sim_get_reg( REG_LR_FIFO_RX_BASE_ADDR );
+    const int16_t offset = ( frame->freq_hz >= SIM_RADIO_RSSI_HF_PORT_MIN_HZ ) ? SIM_RADIO_RSSI_OFFSET_HF
+                                                                                 : SIM_RADIO_RSSI_OFFSET_LF;
+    const int8_t  snr_q  = ( int8_t ) lroundf( frame->snr_db * 4.0f );
+    int16_t       pkt_rssi = frame->rssi_dbm - offset;
+    uint8_t       flags    = IRQ_RX_DONE | IRQ_VALID_HEADER;
+
+    // RSSI = offset + PktRssi + SNR / 4 when the SNR is negative
+    if( snr_q < 0 )
+    {
+        pkt_rssi -= snr_q / 4;
+    }
+    pkt_rssi = ( pkt_rssi < 0 ) ? 0 : ( ( pkt_rssi > 255 ) ? 255 : pkt_rssi );
+
+    hal_spi_sim_write_fifo( base, frame->payload, frame->size );
+    hal_spi_sim_set_reg( REG_LR_FIFO_RX_CURRENT_ADDR, base );
+    hal_spi_sim_set_reg( REG_LR_FIFO_RX_BYTE_ADDR, ( uint8_t ) ( base + frame->size ) );
+    hal_spi_sim_set_reg( REG_LR_RX_NB_BYTES, frame->size );
+    hal_spi_sim_set_reg( REG_LR_PKT_SNR_VALUE, ( uint8_t ) snr_q );
+    hal_spi_sim_set_reg( REG_LR_PKT_RSSI_VALUE, ( uint8_t ) pkt_rssi );
+    hal_spi_sim_set_reg( REG_LR_RSSI_VALUE, ( uint8_t ) pkt_rssi );
+    hal_spi_sim_set_reg( REG_LR_HOP_CHANNEL, frame->crc_on ? HOP_CHANNEL_CRC_ON_PAYLOAD : 0 );
+
+    if( frame->crc_error )
+    {
+        if( frame->crc_on )
+        {
+            flags |= IRQ_PAYLOAD_CRC_ERROR;
+        }
+        else if( frame->size > 0 )
+        {
+            // Nothing tells the receiver, the MIC will
+            uint8_t corrupted = frame->payload[0] ^ 0xFF;
+            hal_spi_sim_write_fifo( base, &corrupted, 1 );
+        }
+    }
+    sim_radio_set_irq( flags, RADIO_DIO_0 );
+}
+
+static void sim_radio_set_irq( const uint8_t flags, const hal_gpio_pin_names_t dio )
+{
+    hal_spi_sim_set_reg( REG_LR_IRQ_FLAGS, hal_spi_sim_get_reg( REG_LR_IRQ_FLAGS ) | flags );
+    if( ( flags & ~hal_spi_sim_get_reg( REG_LR_IRQ_FLAGS_MASK ) ) != 0 )
+    {
+        hal_gpio_inject_irq( dio );
+    }
+}
+
+static void sim_radio_set_standby( void )
+{
+    const uint8_t op_mode = hal_spi_sim_get_reg( REG_OP_MODE );
+    hal_spi_sim_set_reg( REG_OP_MODE, ( op_mode & ~OP_MODE_MASK ) | OP_MODE_STANDBY );
+}
+
+static void sim_radio_wake( void )
+{
+    pthread_mutex_lock( &wake_lock );
+    wake_pending = true;
+    pthread_cond_signal( &wake_cond );
+    pthread_mutex_unlock( &wake_lock );
+}
+
+static void sim_radio_run_event( void )
+{
+    sim_radio_frame_t started_frame;
+    bool              tx_start = false;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    if( tx_started )
+    {
+        started_frame = tx_frame;
+        tx_start      = true;
+        tx_started    = false;
+    }
+    if( ( event.type != SIM_RADIO_EVENT_NONE ) && ( event.due_us <= sim_radio_now_us( ) ) )
+    {
+        const sim_radio_event_type_t type = event.type;
+
+        event.type = SIM_RADIO_EVENT_NONE;
+        switch( type )
+        {
+        case SIM_RADIO_EVENT_TX_DONE:
+            sim_radio_set_standby( );
+            sim_radio_set_irq( IRQ_TX_DONE, RADIO_DIO_0 );
+            break;
+        case SIM_RADIO_EVENT_RX_DONE:
+            if( ( hal_spi_sim_get_reg( REG_OP_MODE ) & OP_MODE_MASK ) == OP_MODE_RX_SINGLE )
+            {
+                sim_radio_set_standby( );
+            }
+            sim_radio_rx_done( &event.frame );
+            if( ( hal_spi_sim_get_reg( REG_OP_MODE ) & OP_MODE_MASK ) == OP_MODE_RX_CONTINUOUS )
+            {
+                rx_start_us = event.frame.end_us;
+                sim_radio_rx_schedule( );
+            }
+            break;
+        case SIM_RADIO_EVENT_RX_TIMEOUT:
+            sim_radio_set_standby( );
+            sim_radio_set_irq( IRQ_RX_TIMEOUT, RADIO_DIO_1 );
+            break;
+        case SIM_RADIO_EVENT_CAD_DONE:
+            sim_radio_set_standby( );
+            sim_radio_set_irq( IRQ_CAD_DONE, RADIO_DIO_0 );
+            break;
+        default:
+            break;
+        }
+    }
+
+    CRITICAL_SECTION_END( );
+
+    // Outside of the critical section, the handler may take its time
+    if( tx_start && ( tx_handler != NULL ) )
+    {
+        tx_handler( &started_frame );
+    }
+}
+
+static void* sim_radio_thread( void* arg )
+{
+    while( 1 )
+    {
+        uint64_t due_us = UINT64_MAX;
+
+        {
+            CRITICAL_SECTION_BEGIN( );
+            if( event.type != SIM_RADIO_EVENT_NONE )
+            {
+                due_us = event.due_us;
+            }
+            CRITICAL_SECTION_END( );
+        }
+
+        pthread_mutex_lock( &wake_lock );
+        if( !wake_pending && ( due_us > sim_radio_now_us( ) ) )
+        {
+            if( due_us == UINT64_MAX )
+            {
+                pthread_cond_wait( &wake_cond, &wake_lock );
+            }
+            else
+            {
+                const struct timespec deadline = { .tv_sec  = ( time_t ) ( due_us / 1000000 ),
+                                                   .tv_nsec = ( long ) ( due_us % 1000000 ) * 1000 };
+                pthread_cond_timedwait( &wake_cond, &wake_lock, &deadline );
+            }
+        }
+        wake_pending = false;
+        pthread_mutex_unlock( &wake_lock );
+
+        sim_radio_run_event( );
+    }
+    return NULL;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
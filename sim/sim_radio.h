@@ -0,0 +1,128 @@
+/*!
+ * \file      sim_radio.h
+ *
+ * \brief     SX1276 LoRa behavioural model on top of the simulated SPI register file
+ *
+ * The model follows RegOpMode writes made through the sim SPI backend:
+ *
+ *   TX          the frame is read from the FIFO and goes to the TX handler,
+ *               TxDone is raised on DIO0 after its time on air
+ *   RX single   a frame on the air that matches frequency, SF, bandwidth, IQ
+ *               and sync word, and whose preamble is still detectable, raises
+ *               RxDone at its end, else RxTimeout after RegSymbTimeout symbols
+ *   RX continu. as RX single, without the timeout
+ *   CAD         CadDone after two symbols, nothing is ever detected
+ *
+ * Frames reach the receiver with sim_radio_deliver. Times are RT_CLOCK
+ * microseconds, as sim_radio_now_us. FSK and implicit header are not modelled.
+ */
+#ifndef SIM_RADIO_H
+#define SIM_RADIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define SIM_RADIO_MAX_PAYLOAD 255
+
+/*!
+ * LoRaWAN public network sync word
+ */
+#define SIM_RADIO_SYNC_WORD_PUBLIC 0x34
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * LoRa frame on the air
+ */
+typedef struct sim_radio_frame_s
+{
+    uint64_t start_us;  //!< First preamble symbol
+    uint64_t end_us;    //!< End of the last symbol
+    uint32_t freq_hz;
+    uint32_t bw_hz;
+    uint8_t  sf;
+    uint8_t  cr;  //!< 1..4 for 4/5..4/8
+    uint16_t preamble_len;
+    bool     crc_on;
+    bool     iq_inverted;
+    uint8_t  sync_word;
+    int8_t   tx_power_dbm;
+    int16_t  rssi_dbm;      //!< At the receiver
+    float    snr_db;        //!< At the receiver
+    bool     crc_error;     //!< Corrupted on the air
+    bool     from_gateway;  //!< Sent by the simulated gateway
+    uint8_t  size;
+    uint8_t  payload[SIM_RADIO_MAX_PAYLOAD];
+} sim_radio_frame_t;
+
+/*!
+ * Called with each frame as its transmission starts, from the model thread
+ */
+typedef void ( *sim_radio_tx_handler_t )( const sim_radio_frame_t* frame );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Plugs the model into the sim SPI backend and starts its thread
+ */
+void sim_radio_init( void );
+
+/*!
+ * Sets the handler of transmitted frames
+ *
+ * \param [in] handler TX handler, NULL to drop transmitted frames
+ */
+void sim_radio_set_tx_handler( const sim_radio_tx_handler_t handler );
+
+/*!
+ * Puts a frame on the air for this radio
+ *
+ * \param [in] frame Frame, start_us and end_us set
+ *
+ * \retval false if too many frames are already on the air
+ */
+bool sim_radio_deliver( const sim_radio_frame_t* frame );
+
+/*!
+ * Computes the time on air of a frame, explicit header
+ *
+ * \param [in] frame Frame, payload not needed
+ *
+ * \retval time on air in us
+ */
+uint32_t sim_radio_time_on_air_us( const sim_radio_frame_t* frame );
+
+/*!
+ * Gets the model time base
+ *
+ * \retval RT_CLOCK time in us
+ */
+uint64_t sim_radio_now_us( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_RADIO_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,53 @@
+/*!
+ * \file      smtc_hal_board.h
+ *
+ * \brief     Board hooks of the MCU HAL
+ *
+ * The MCU HAL (smtc_hal_mcu.c) is shared by the boards; the little that
+ * depends on the GPIO library is behind these hooks: pigpio on the Pi
+ * (smtc_hal_board_pigpio.c), nothing on the host simulation
+ * (smtc_hal_sim/smtc_hal_board_sim.c).
+ */
+#ifndef __SMTC_HAL_BOARD_H__
+#define __SMTC_HAL_BOARD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Starts the GPIO library, panics on failure
+ */
+void hal_board_gpio_lib_init( void );
+
+/*!
+ * Stops the GPIO library
+ */
+void hal_board_gpio_lib_terminate( void );
+
+/*!
+ * Busy or sleeping wait, not cut short by signals
+ *
+ * \param [in] microseconds Delay
+ */
+void hal_board_delay_us( const int32_t microseconds );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_BOARD_H__
+
+/* --- EOF ------------------------------------------------------------------ */
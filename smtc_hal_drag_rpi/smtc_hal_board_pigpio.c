@@ -0,0 +1,48 @@
+/*!
+ * \file      smtc_hal_board_pigpio.c
+ *
+ * \brief     Board hooks of the MCU HAL, Raspberry Pi with pigpio
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+
+#include "smtc_hal_board.h"
+#include "smtc_hal_mcu.h"
+
+#include <pigpio.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_board_gpio_lib_init( void )
+{
+    if (gpioCfgInterfaces(PI_DISABLE_FIFO_IF | PI_DISABLE_SOCK_IF | PI_DISABLE_ALERT) < 0)
+    {
+        mcu_panic( ); // pigpio initialisation failed.
+    }
+
+    if (gpioInitialise() < 0)
+    {
+        mcu_panic( ); // pigpio initialisation failed.
+    }
+}
+
+void hal_board_gpio_lib_terminate( void )
+{
+    gpioTerminate( );
+}
+
+void hal_board_delay_us( const int32_t microseconds )
+{
+    // non stoppable by signals
+    gpioDelay(microseconds);
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,386 @@
+/*!
+ * \file      smtc_hal_board_profile.c
+ *
+ * \brief     Runtime board profile implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define BOARD_PROFILE_MAX_ENTRIES 64
+#define BOARD_PROFILE_KEY_LEN 48
+#define BOARD_PROFILE_VALUE_LEN 256
+#define BOARD_PROFILE_LINE_LEN ( BOARD_PROFILE_KEY_LEN + BOARD_PROFILE_VALUE_LEN + 16 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct board_profile_entry_s
+{
+    char key[BOARD_PROFILE_KEY_LEN];
+    char value[BOARD_PROFILE_VALUE_LEN];
+} board_profile_entry_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static board_profile_entry_t entries[BOARD_PROFILE_MAX_ENTRIES];
+static uint8_t               entry_count = 0;
+static bool                  loaded      = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static char* board_profile_trim( char* str );
+
+static const board_profile_entry_t* board_profile_find( const char* key );
+
+static bool board_profile_set( const char* key, const char* value );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_board_profile_load( void )
+{
+    if( loaded )
+    {
+        return;
+    }
+    loaded = true;
+
+    const char* path = hal_board_profile_get_path( );
+    if( hal_board_profile_load_file( path ) )
+    {
+        SMTC_HAL_TRACE_INFO( "Board profile %s: %u keys\n", path, entry_count );
+    }
+    else
+    {
+        SMTC_HAL_TRACE_WARNING( "No board profile at %s, using built-in defaults\n", path );
+    }
+
+    path = hal_board_profile_get_overlay_path( );
+    if( hal_board_profile_load_file( path ) )
+    {
+        SMTC_HAL_TRACE_INFO( "Board profile overlay %s loaded\n", path );
+    }
+}
+
+bool hal_board_profile_load_file( const char* path )
+{
+    FILE* fp = fopen( path, "r" );
+    if( fp == NULL )
+    {
+        return false;
+    }
+
+    char     line[BOARD_PROFILE_LINE_LEN];
+    uint32_t line_nb = 0;
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        line_nb++;
+
+        char* comment = strchr( line, '#' );
+        if( comment != NULL )
+        {
+            *comment = '\0';
+        }
+
+        char* key = board_profile_trim( line );
+        if( *key == '\0' )
+        {
+            continue;
+        }
+
+        char* sep = strchr( key, '=' );
+        if( sep == NULL )
+        {
+            SMTC_HAL_TRACE_WARNING( "%s:%u: missing '='\n", path, line_nb );
+            continue;
+        }
+        *sep = '\0';
+        key  = board_profile_trim( key );
+
+        if( !board_profile_set( key, board_profile_trim( sep + 1 ) ) )
+        {
+            SMTC_HAL_TRACE_WARNING( "%s:%u: key '%s' ignored\n", path, line_nb, key );
+        }
+    }
+
+    fclose( fp );
+    return true;
+}
+
+const char* hal_board_profile_get_path( void )
+{
+    const char* path = getenv( HAL_BOARD_PROFILE_ENV );
+    return ( ( path != NULL ) && ( *path != '\0' ) ) ? path : HAL_BOARD_PROFILE_DEFAULT_PATH;
+}
+
+const char* hal_board_profile_get_overlay_path( void )
+{
+    const board_profile_entry_t* entry = board_profile_find( "profile.overlay" );
+    return ( entry != NULL ) ? entry->value : HAL_BOARD_PROFILE_OVERLAY_DEFAULT_PATH;
+}
+
+bool hal_board_profile_store( const char* key, const char* value )
+{
+    if( !board_profile_set( key, value ) )
+    {
+        return false;
+    }
+
+    const char* path = hal_board_profile_get_overlay_path( );
+    char        tmp_path[BOARD_PROFILE_VALUE_LEN + 8];
+    snprintf( tmp_path, sizeof( tmp_path ), "%s.tmp", path );
+
+    // Create the overlay directory if needed, its parent must exist
+    char dir[BOARD_PROFILE_VALUE_LEN];
+    snprintf( dir, sizeof( dir ), "%s", path );
+    char* slash = strrchr( dir, '/' );
+    if( ( slash != NULL ) && ( slash != dir ) )
+    {
+        *slash = '\0';
+        mkdir( dir, 0755 );
+    }
+
+    FILE* out = fopen( tmp_path, "w" );
+    if( out == NULL )
+    {
+        SMTC_HAL_TRACE_ERROR( "Cannot write %s: %s\n", tmp_path, strerror( errno ) );
+        return false;
+    }
+
+    // Copy the current overlay without the previous value of the key
+    FILE* in = fopen( path, "r" );
+    if( in != NULL )
+    {
+        char line[BOARD_PROFILE_LINE_LEN];
+        while( fgets( line, sizeof( line ), in ) != NULL )
+        {
+            char copy[BOARD_PROFILE_LINE_LEN];
+            strcpy( copy, line );
+
+            char* sep = strchr( copy, '=' );
+            if( sep != NULL )
+            {
+                *sep = '\0';
+                if( strcmp( board_profile_trim( copy ), key ) == 0 )
+                {
+                    continue;
+                }
+            }
+            fputs( line, out );
+        }
+        fclose( in );
+    }
+    fprintf( out, "%s = %s\n", key, value );
+
+    if( ( fclose( out ) != 0 ) || ( rename( tmp_path, path ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_ERROR( "Cannot write %s: %s\n", path, strerror( errno ) );
+        remove( tmp_path );
+        return false;
+    }
+    return true;
+}
+
+bool hal_board_profile_get_str( const char* key, const char** value )
+{
+    const board_profile_entry_t* entry = board_profile_find( key );
+    if( entry == NULL )
+    {
+        return false;
+    }
+    *value = entry->value;
+    return true;
+}
+
+bool hal_board_profile_get_int( const char* key, int32_t* value )
+{
+    const board_profile_entry_t* entry = board_profile_find( key );
+    if( entry == NULL )
+    {
+        return false;
+    }
+
+    char* end;
+    errno    = 0;
+    long tmp = strtol( entry->value, &end, 0 );
+    if( ( errno != 0 ) || ( end == entry->value ) || ( *end != '\0' ) || ( tmp < INT32_MIN ) || ( tmp > INT32_MAX ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "Board profile: '%s' is not an integer\n", key );
+        return false;
+    }
+    *value = ( int32_t ) tmp;
+    return true;
+}
+
+uint8_t hal_board_profile_get_table( const char* key, hal_board_profile_point_t* points, const uint8_t max_nb )
+{
+    const board_profile_entry_t* entry = board_profile_find( key );
+    if( entry == NULL )
+    {
+        return 0;
+    }
+
+    uint8_t     nb  = 0;
+    const char* str = entry->value;
+    while( *str != '\0' )
+    {
+        char* end;
+        long  x = strtol( str, &end, 0 );
+        if( end == str )
+        {
+            break;
+        }
+        while( isspace( ( unsigned char ) *end ) )
+        {
+            end++;
+        }
+        if( *end != ':' )
+        {
+            break;
+        }
+        str     = end + 1;
+        float y = strtof( str, &end );
+        if( end == str )
+        {
+            break;
+        }
+        str = end;
+
+        if( nb == max_nb )
+        {
+            SMTC_HAL_TRACE_WARNING( "Board profile: '%s' has more than %u points\n", key, max_nb );
+            return 0;
+        }
+        if( ( nb > 0 ) && ( x <= points[nb - 1].x ) )
+        {
+            break;
+        }
+        points[nb].x = ( int32_t ) x;
+        points[nb].y = y;
+        nb++;
+
+        while( isspace( ( unsigned char ) *str ) || ( *str == ',' ) )
+        {
+            str++;
+        }
+    }
+
+    if( *str != '\0' )
+    {
+        SMTC_HAL_TRACE_WARNING( "Board profile: '%s' is not a sorted x:y table\n", key );
+        return 0;
+    }
+    return nb;
+}
+
+float hal_board_profile_interpolate( const hal_board_profile_point_t* points, const uint8_t nb, const int32_t x )
+{
+    if( x <= points[0].x )
+    {
+        return points[0].y;
+    }
+    for( uint8_t i = 1; i < nb; i++ )
+    {
+        if( x <= points[i].x )
+        {
+            const hal_board_profile_point_t* p0 = &points[i - 1];
+            const hal_board_profile_point_t* p1 = &points[i];
+            return p0->y + ( p1->y - p0->y ) * ( float ) ( x - p0->x ) / ( float ) ( p1->x - p0->x );
+        }
+    }
+    return points[nb - 1].y;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static char* board_profile_trim( char* str )
+{
+    while( isspace( ( unsigned char ) *str ) )
+    {
+        str++;
+    }
+
+    char* end = str + strlen( str );
+    while( ( end > str ) && isspace( ( unsigned char ) end[-1] ) )
+    {
+        end--;
+    }
+    *end = '\0';
+
+    return str;
+}
+
+static const board_profile_entry_t* board_profile_find( const char* key )
+{
+    for( uint8_t i = 0; i < entry_count; i++ )
+    {
+        if( strcmp( entries[i].key, key ) == 0 )
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool board_profile_set( const char* key, const char* value )
+{
+    if( ( *key == '\0' ) || ( strlen( key ) >= BOARD_PROFILE_KEY_LEN ) ||
+        ( strlen( value ) >= BOARD_PROFILE_VALUE_LEN ) )
+    {
+        return false;
+    }
+
+    board_profile_entry_t* entry = ( board_profile_entry_t* ) board_profile_find( key );
+    if( entry == NULL )
+    {
+        if( entry_count == BOARD_PROFILE_MAX_ENTRIES )
+        {
+            return false;
+        }
+        entry = &entries[entry_count++];
+        strcpy( entry->key, key );
+    }
+    strcpy( entry->value, value );
+
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
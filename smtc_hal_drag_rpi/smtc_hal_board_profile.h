@@ -0,0 +1,159 @@
+/*!
+ * \file      smtc_hal_board_profile.h
+ *
+ * \brief     Runtime board profile
+ *
+ * A board profile is a text file of `key = value` lines, `#` starts a comment.
+ * It is read at startup from the path given by the LBM_BOARD_PROFILE
+ * environment variable, or from HAL_BOARD_PROFILE_DEFAULT_PATH. A missing file
+ * is not an error: every user of a key falls back to its compile-time default.
+ *
+ * Values measured on the unit (calibrations) are written to an overlay file,
+ * HAL_BOARD_PROFILE_OVERLAY_DEFAULT_PATH or the profile.overlay key, which is
+ * read after the profile and overrides it.
+ *
+ * Tables are written as a list of `x:y` points, e.g.
+ *
+ *   power.tx_rfo_ua = -4:11000, 7:20000, 13:29000
+ */
+#ifndef __SMTC_HAL_BOARD_PROFILE_H__
+#define __SMTC_HAL_BOARD_PROFILE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#ifndef HAL_BOARD_PROFILE_DEFAULT_PATH
+#define HAL_BOARD_PROFILE_DEFAULT_PATH "/etc/lbm_drag_rpi/board_profile.conf"
+#endif
+
+#define HAL_BOARD_PROFILE_ENV "LBM_BOARD_PROFILE"
+
+#ifndef HAL_BOARD_PROFILE_OVERLAY_DEFAULT_PATH
+#define HAL_BOARD_PROFILE_OVERLAY_DEFAULT_PATH "/var/lib/lbm_drag_rpi/board_profile.overlay"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Point of a profile table
+ */
+typedef struct hal_board_profile_point_s
+{
+    int32_t x;
+    float   y;
+} hal_board_profile_point_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Loads the board profile, only the first call reads the file
+ */
+void hal_board_profile_load( void );
+
+/*!
+ * Reads a profile file and merges its keys, existing keys are overwritten
+ *
+ * \param [in] path Profile file path
+ *
+ * \retval true if the file was read
+ */
+bool hal_board_profile_load_file( const char* path );
+
+/*!
+ * Gets the path of the board profile
+ *
+ * \retval profile path
+ */
+const char* hal_board_profile_get_path( void );
+
+/*!
+ * Gets the path of the overlay file
+ *
+ * \retval overlay path
+ */
+const char* hal_board_profile_get_overlay_path( void );
+
+/*!
+ * Sets a value and persists it in the overlay file
+ *
+ * \param [in] key   Profile key
+ * \param [in] value Value
+ *
+ * \retval true if the value was written to the overlay file
+ */
+bool hal_board_profile_store( const char* key, const char* value );
+
+/*!
+ * Gets a string value
+ *
+ * \param [in]  key   Profile key
+ * \param [out] value Value, valid until the profile is reloaded
+ *
+ * \retval true if the key exists
+ */
+bool hal_board_profile_get_str( const char* key, const char** value );
+
+/*!
+ * Gets an integer value
+ *
+ * \param [in]  key   Profile key
+ * \param [out] value Value, left untouched if the key is missing or invalid
+ *
+ * \retval true if the key exists and holds an integer
+ */
+bool hal_board_profile_get_int( const char* key, int32_t* value );
+
+/*!
+ * Gets a table value, points are sorted by increasing x
+ *
+ * \param [in]  key       Profile key
+ * \param [out] points    Table points
+ * \param [in]  max_nb    Size of the points array
+ *
+ * \retval number of points read, 0 if the key is missing or invalid
+ */
+uint8_t hal_board_profile_get_table( const char* key, hal_board_profile_point_t* points, const uint8_t max_nb );
+
+/*!
+ * Linear interpolation in a table, clamped to the first and last points
+ *
+ * \param [in] points Table points sorted by increasing x
+ * \param [in] nb     Number of points, must be > 0
+ * \param [in] x      Abscissa
+ *
+ * \retval interpolated value
+ */
+float hal_board_profile_interpolate( const hal_board_profile_point_t* points, const uint8_t nb, const int32_t x );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_BOARD_PROFILE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,168 @@
+/*!
+ * \file      smtc_hal_clock_drift.c
+ *
+ * \brief     Local clock drift estimation implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <math.h>
+
+#include "smtc_hal_clock_drift.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Smoothing factor of the drift and jitter averages
+ */
+#define CLOCK_DRIFT_EWMA_ALPHA 0.25f
+
+/*!
+ * A network time sample further than this from the local clock is a resync, not drift
+ */
+#define CLOCK_DRIFT_MAX_PPM 1000.0f
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bool     anchor_valid           = false;
+static uint64_t anchor_network_time_ms = 0;
+static uint32_t anchor_local_time_ms   = 0;
+static uint32_t anchor_resolution_ms   = 0;
+
+static hal_clock_drift_estimate_t estimate_data = {
+    .crystal_error_ppm = HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MAX_PPM,
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void clock_drift_set_anchor( const uint64_t network_time_ms, const uint32_t local_time_ms,
+                                    const uint32_t resolution_ms );
+
+static uint64_t clock_drift_min_interval_ms( const uint32_t resolution_ms );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool hal_clock_drift_add_sample( const uint64_t network_time_ms, const uint32_t local_time_ms,
+                                 const uint32_t resolution_ms )
+{
+    if( !anchor_valid || ( network_time_ms <= anchor_network_time_ms ) )
+    {
+        clock_drift_set_anchor( network_time_ms, local_time_ms, resolution_ms );
+        return false;
+    }
+
+    const uint64_t network_delta_ms = network_time_ms - anchor_network_time_ms;
+    if( network_delta_ms < clock_drift_min_interval_ms( resolution_ms + anchor_resolution_ms ) )
+    {
+        // A finer sample restarts the interval, it may complete sooner; otherwise keep the oldest anchor,
+        // a longer interval gives a better resolution
+        if( resolution_ms < anchor_resolution_ms )
+        {
+            clock_drift_set_anchor( network_time_ms, local_time_ms, resolution_ms );
+        }
+        return false;
+    }
+
+    const uint32_t local_delta_ms = local_time_ms - anchor_local_time_ms;
+    const float    ppm =
+        ( ( float ) local_delta_ms - ( float ) network_delta_ms ) * 1e6f / ( float ) network_delta_ms;
+    const float resolution_ppm =
+        ( float ) ( resolution_ms + anchor_resolution_ms ) * 1e6f / ( float ) network_delta_ms;
+
+    clock_drift_set_anchor( network_time_ms, local_time_ms, resolution_ms );
+
+    if( fabsf( ppm ) > CLOCK_DRIFT_MAX_PPM )
+    {
+        SMTC_HAL_TRACE_WARNING( "Clock drift: %.1f ppm measured, network time jumped, sample ignored\n", ppm );
+        return false;
+    }
+
+    if( estimate_data.nb_measurements == 0 )
+    {
+        estimate_data.drift_ppm  = ppm;
+        estimate_data.jitter_ppm = resolution_ppm;
+    }
+    else
+    {
+        const float deviation = fabsf( ppm - estimate_data.drift_ppm );
+        estimate_data.drift_ppm += CLOCK_DRIFT_EWMA_ALPHA * ( ppm - estimate_data.drift_ppm );
+        estimate_data.jitter_ppm += CLOCK_DRIFT_EWMA_ALPHA * ( deviation - estimate_data.jitter_ppm );
+    }
+    estimate_data.last_ppm = ppm;
+    estimate_data.nb_measurements++;
+
+    // Cover the drift, twice its observed variation and the resolution of the last measurement
+    float error = ceilf( fabsf( estimate_data.drift_ppm ) + 2 * estimate_data.jitter_ppm + resolution_ppm );
+    if( error < HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MIN_PPM )
+    {
+        error = HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MIN_PPM;
+    }
+    if( error > HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MAX_PPM )
+    {
+        error = HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MAX_PPM;
+    }
+    estimate_data.crystal_error_ppm = ( uint32_t ) error;
+
+    SMTC_HAL_TRACE_INFO( "Clock drift: %+.2f ppm over %lu s, smoothed %+.2f ppm (jitter %.2f ppm), "
+                         "crystal error %lu ppm\n",
+                         ppm, ( unsigned long ) ( network_delta_ms / 1000 ), estimate_data.drift_ppm,
+                         estimate_data.jitter_ppm, ( unsigned long ) estimate_data.crystal_error_ppm );
+    return true;
+}
+
+void hal_clock_drift_get_estimate( hal_clock_drift_estimate_t* estimate )
+{
+    *estimate = estimate_data;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void clock_drift_set_anchor( const uint64_t network_time_ms, const uint32_t local_time_ms,
+                                    const uint32_t resolution_ms )
+{
+    anchor_valid           = true;
+    anchor_network_time_ms = network_time_ms;
+    anchor_local_time_ms   = local_time_ms;
+    anchor_resolution_ms   = resolution_ms;
+}
+
+static uint64_t clock_drift_min_interval_ms( const uint32_t resolution_ms )
+{
+    const uint64_t interval_ms = ( uint64_t ) resolution_ms * 1000000ull / HAL_CLOCK_DRIFT_MAX_RESOLUTION_PPM;
+
+    return ( interval_ms > HAL_CLOCK_DRIFT_MIN_INTERVAL_S * 1000ull ) ? interval_ms
+                                                                       : HAL_CLOCK_DRIFT_MIN_INTERVAL_S * 1000ull;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,103 @@
+/*!
+ * \file      smtc_hal_clock_drift.h
+ *
+ * \brief     Local clock drift estimation against network time
+ *
+ * Each network time sample (DeviceTimeAns, ALCSync) is paired with the local
+ * modem time taken at the same instant. Once samples are far enough apart, the
+ * drift between the two clocks is computed and smoothed, and a crystal error
+ * covering the drift, its variation and the sample resolution is derived for
+ * the modem RX window computation.
+ */
+#ifndef __SMTC_HAL_CLOCK_DRIFT_H__
+#define __SMTC_HAL_CLOCK_DRIFT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Minimum time between the two samples of a drift measurement
+ */
+#ifndef HAL_CLOCK_DRIFT_MIN_INTERVAL_S
+#define HAL_CLOCK_DRIFT_MIN_INTERVAL_S 1800
+#endif
+
+/*!
+ * Largest error the sample resolution may add to a measurement: coarse samples
+ * need a longer interval, 1 s ALCSync samples about 4.6 days
+ */
+#define HAL_CLOCK_DRIFT_MAX_RESOLUTION_PPM 5
+
+/*!
+ * Bounds of the suggested crystal error
+ */
+#define HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MIN_PPM 5
+#define HAL_CLOCK_DRIFT_CRYSTAL_ERROR_MAX_PPM 200
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Drift estimate
+ */
+typedef struct hal_clock_drift_estimate_s
+{
+    float    drift_ppm;          //!< Smoothed drift, positive when the local clock runs fast
+    float    jitter_ppm;         //!< Smoothed deviation of the measurements from the drift
+    float    last_ppm;           //!< Last measurement
+    uint32_t nb_measurements;    //!< Number of measurements, 0 while no estimate is available
+    uint32_t crystal_error_ppm;  //!< Suggested crystal error
+} hal_clock_drift_estimate_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Adds a network time sample
+ *
+ * \param [in] network_time_ms Network (GPS) time in ms
+ * \param [in] local_time_ms   Modem time in ms at the same instant
+ * \param [in] resolution_ms   Resolution of the network time
+ *
+ * \retval true if the sample produced a new estimate
+ */
+bool hal_clock_drift_add_sample( const uint64_t network_time_ms, const uint32_t local_time_ms,
+                                 const uint32_t resolution_ms );
+
+/*!
+ * Gets the current estimate
+ *
+ * \param [out] estimate Drift estimate
+ */
+void hal_clock_drift_get_estimate( hal_clock_drift_estimate_t* estimate );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_CLOCK_DRIFT_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,314 @@
+/*!
+ * \file      smtc_hal_env.c
+ *
+ * \brief     Cached environment sensors implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "smtc_hal_env.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define ENV_POWER_SUPPLY_ROOT "/sys/class/power_supply"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Cached value
+ */
+typedef struct env_entry_s
+{
+    int32_t  value;
+    uint32_t time_ms;  //!< Time of the last read attempt
+    bool     polled;   //!< A read was attempted
+    bool     valid;    //!< A read succeeded
+} env_entry_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint32_t    ttl_ms          = HAL_ENV_DEFAULT_TTL_S * 1000;
+static bool        temp_from_radio = false;
+static const char* thermal_zone    = HAL_ENV_DEFAULT_THERMAL_ZONE;
+static const char* power_supply    = NULL;
+static const char* voltage_cmd     = NULL;
+static const char* battery_cmd     = NULL;
+
+static env_entry_t soc_temperature   = { .value = HAL_ENV_DEFAULT_TEMPERATURE_C };
+static env_entry_t radio_temperature = { .value = HAL_ENV_DEFAULT_TEMPERATURE_C };
+static env_entry_t voltage           = { .value = HAL_ENV_DEFAULT_VOLTAGE_MV };
+static env_entry_t battery           = { .value = HAL_ENV_BATTERY_EXTERNAL_POWER };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static bool env_is_due( const env_entry_t* entry, const uint32_t now_ms );
+
+static bool env_read_file_long( const char* path, long* value );
+
+static bool env_read_power_supply( const char* attribute, char* buf, const size_t buflen );
+
+static bool env_run_cmd_long( const char* cmd, long* value );
+
+static void env_refresh_soc_temperature( void );
+
+static void env_refresh_voltage( void );
+
+static void env_refresh_battery( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_env_init( void )
+{
+    int32_t     value;
+    const char* str;
+
+    if( ( hal_board_profile_get_int( "env.ttl_s", &value ) == true ) && ( value > 0 ) )
+    {
+        ttl_ms = ( uint32_t ) value * 1000;
+    }
+    if( hal_board_profile_get_str( "env.temperature_source", &str ) == true )
+    {
+        temp_from_radio = ( strcmp( str, "radio" ) == 0 );
+    }
+    hal_board_profile_get_str( "env.thermal_zone", &thermal_zone );
+    hal_board_profile_get_str( "env.power_supply", &power_supply );
+    hal_board_profile_get_str( "env.voltage_cmd", &voltage_cmd );
+    hal_board_profile_get_str( "env.battery_cmd", &battery_cmd );
+
+    hal_env_refresh( );
+}
+
+bool hal_env_refresh( void )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+
+    if( env_is_due( &soc_temperature, now_ms ) == true )
+    {
+        soc_temperature.time_ms = now_ms;
+        soc_temperature.polled  = true;
+        env_refresh_soc_temperature( );
+    }
+    if( env_is_due( &voltage, now_ms ) == true )
+    {
+        voltage.time_ms = now_ms;
+        voltage.polled  = true;
+        env_refresh_voltage( );
+    }
+    if( env_is_due( &battery, now_ms ) == true )
+    {
+        battery.time_ms = now_ms;
+        battery.polled  = true;
+        env_refresh_battery( );
+    }
+
+    return temp_from_radio && env_is_due( &radio_temperature, now_ms );
+}
+
+void hal_env_set_radio_temperature( const int8_t temperature_c )
+{
+    radio_temperature.value   = temperature_c;
+    radio_temperature.time_ms = hal_rtc_get_time_ms( );
+    radio_temperature.polled  = true;
+    radio_temperature.valid   = true;
+}
+
+int8_t hal_env_get_temperature( void )
+{
+    if( temp_from_radio && radio_temperature.valid )
+    {
+        return ( int8_t ) radio_temperature.value;
+    }
+    return ( int8_t ) soc_temperature.value;
+}
+
+uint16_t hal_env_get_voltage_mv( void )
+{
+    return ( uint16_t ) voltage.value;
+}
+
+uint8_t hal_env_get_battery_level( void )
+{
+    return ( uint8_t ) battery.value;
+}
+
+void hal_env_get_values( hal_env_values_t* values )
+{
+    values->temperature_c       = hal_env_get_temperature( );
+    values->soc_temperature_c   = soc_temperature.valid ? ( int8_t ) soc_temperature.value : INT8_MIN;
+    values->radio_temperature_c = radio_temperature.valid ? ( int8_t ) radio_temperature.value : INT8_MIN;
+    values->voltage_mv          = hal_env_get_voltage_mv( );
+    values->battery_level       = hal_env_get_battery_level( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool env_is_due( const env_entry_t* entry, const uint32_t now_ms )
+{
+    return ( entry->polled == false ) || ( ( now_ms - entry->time_ms ) >= ttl_ms );
+}
+
+static bool env_read_file_long( const char* path, long* value )
+{
+    FILE* fp = fopen( path, "r" );
+    if( fp == NULL )
+    {
+        return false;
+    }
+    const bool ok = ( fscanf( fp, "%ld", value ) == 1 );
+    fclose( fp );
+    return ok;
+}
+
+static bool env_read_power_supply( const char* attribute, char* buf, const size_t buflen )
+{
+    char path[256];
+
+    snprintf( path, sizeof( path ), ENV_POWER_SUPPLY_ROOT "/%s/%s", power_supply, attribute );
+    FILE* fp = fopen( path, "r" );
+    if( fp == NULL )
+    {
+        return false;
+    }
+    const bool ok = ( fgets( buf, ( int ) buflen, fp ) != NULL );
+    fclose( fp );
+    if( ok )
+    {
+        buf[strcspn( buf, "\r\n" )] = '\0';
+    }
+    return ok;
+}
+
+static bool env_run_cmd_long( const char* cmd, long* value )
+{
+    char  line[64];
+    char* end;
+
+    FILE* fp = popen( cmd, "r" );
+    if( fp == NULL )
+    {
+        return false;
+    }
+    const bool read   = ( fgets( line, sizeof( line ), fp ) != NULL );
+    const int  status = pclose( fp );
+    if( !read || ( status != 0 ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "env: '%s' failed\n", cmd );
+        return false;
+    }
+    *value = strtol( line, &end, 10 );
+    return end != line;
+}
+
+static void env_refresh_soc_temperature( void )
+{
+    long millidegrees;
+
+    if( env_read_file_long( thermal_zone, &millidegrees ) == true )
+    {
+        soc_temperature.value = ( int32_t ) ( millidegrees / 1000 );
+        soc_temperature.valid = true;
+    }
+}
+
+static void env_refresh_voltage( void )
+{
+    long value;
+    char buf[32];
+
+    if( voltage_cmd != NULL )
+    {
+        if( env_run_cmd_long( voltage_cmd, &value ) == true )
+        {
+            voltage.value = ( int32_t ) value;
+            voltage.valid = true;
+        }
+    }
+    else if( ( power_supply != NULL ) && ( env_read_power_supply( "voltage_now", buf, sizeof( buf ) ) == true ) )
+    {
+        // sysfs gives uV
+        voltage.value = ( int32_t ) ( strtol( buf, NULL, 10 ) / 1000 );
+        voltage.valid = true;
+    }
+}
+
+static void env_refresh_battery( void )
+{
+    long percent = -1;
+    char buf[32];
+
+    if( battery_cmd != NULL )
+    {
+        if( env_run_cmd_long( battery_cmd, &percent ) == false )
+        {
+            percent = -1;
+        }
+    }
+    else if( power_supply != NULL )
+    {
+        if( ( env_read_power_supply( "type", buf, sizeof( buf ) ) == true ) && ( strcmp( buf, "Battery" ) != 0 ) )
+        {
+            // Mains, USB or UPS supply
+            battery.value = HAL_ENV_BATTERY_EXTERNAL_POWER;
+            battery.valid = true;
+            return;
+        }
+        if( env_read_power_supply( "capacity", buf, sizeof( buf ) ) == true )
+        {
+            percent = strtol( buf, NULL, 10 );
+        }
+    }
+    else
+    {
+        battery.value = HAL_ENV_BATTERY_EXTERNAL_POWER;
+        battery.valid = true;
+        return;
+    }
+
+    if( ( percent < 0 ) || ( percent > 100 ) )
+    {
+        battery.value = HAL_ENV_BATTERY_UNKNOWN;
+    }
+    else
+    {
+        // 1 is the minimum and 254 the maximum
+        battery.value = 1 + ( int32_t ) ( percent * 253 / 100 );
+    }
+    battery.valid = true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
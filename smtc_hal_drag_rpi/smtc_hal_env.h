@@ -0,0 +1,134 @@
+/*!
+ * \file      smtc_hal_env.h
+ *
+ * \brief     Cached environment sensors: temperature, supply voltage, battery level
+ *
+ * The getters only return cached values, they never block, so the modem can
+ * call them from its hot path. hal_env_refresh reads the sources of the values
+ * older than the cache TTL and is meant to be called while the device is idle.
+ *
+ * Sources, from the board profile:
+ *
+ *   env.ttl_s              = 60
+ *   env.temperature_source = soc | radio
+ *   env.thermal_zone       = /sys/class/thermal/thermal_zone0/temp
+ *   env.power_supply       = <name under /sys/class/power_supply>
+ *   env.voltage_cmd        = <command printing the supply voltage in mV>
+ *   env.battery_cmd        = <command printing the battery level in %>
+ *
+ * The radio temperature is read by the radio HAL and pushed with
+ * hal_env_set_radio_temperature. Without a power supply or a command the
+ * device is reported as externally powered at HAL_ENV_DEFAULT_VOLTAGE_MV.
+ */
+#ifndef __SMTC_HAL_ENV_H__
+#define __SMTC_HAL_ENV_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+#define HAL_ENV_DEFAULT_TTL_S 60
+#define HAL_ENV_DEFAULT_TEMPERATURE_C 25
+#define HAL_ENV_DEFAULT_VOLTAGE_MV 3300
+#define HAL_ENV_DEFAULT_THERMAL_ZONE "/sys/class/thermal/thermal_zone0/temp"
+
+/*!
+ * LoRaWAN DevStatusAns battery levels
+ */
+#define HAL_ENV_BATTERY_EXTERNAL_POWER 0
+#define HAL_ENV_BATTERY_UNKNOWN 255
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Cached values
+ */
+typedef struct hal_env_values_s
+{
+    int8_t   temperature_c;        //!< From env.temperature_source
+    int8_t   soc_temperature_c;    //!< INT8_MIN if never read
+    int8_t   radio_temperature_c;  //!< INT8_MIN if never read
+    uint16_t voltage_mv;
+    uint8_t  battery_level;  //!< DevStatusAns encoding, 0 external power, 1..254, 255 unknown
+} hal_env_values_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Reads the settings and fills the cache, called by hal_mcu_init
+ */
+void hal_env_init( void );
+
+/*!
+ * Refreshes the cached values older than the TTL
+ *
+ * \retval true if the radio temperature is due, see hal_env_set_radio_temperature
+ */
+bool hal_env_refresh( void );
+
+/*!
+ * Stores a radio temperature reading
+ *
+ * \param [in] temperature_c Radio temperature
+ */
+void hal_env_set_radio_temperature( const int8_t temperature_c );
+
+/*!
+ * Gets the cached temperature
+ *
+ * \retval temperature in degrees Celsius
+ */
+int8_t hal_env_get_temperature( void );
+
+/*!
+ * Gets the cached supply voltage
+ *
+ * \retval voltage in mV
+ */
+uint16_t hal_env_get_voltage_mv( void );
+
+/*!
+ * Gets the cached battery level
+ *
+ * \retval battery level, DevStatusAns encoding
+ */
+uint8_t hal_env_get_battery_level( void );
+
+/*!
+ * Gets all cached values
+ *
+ * \param [out] values Cached values
+ */
+void hal_env_get_values( hal_env_values_t* values );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_ENV_H__
+
+/* --- EOF ------------------------------------------------------------------ */
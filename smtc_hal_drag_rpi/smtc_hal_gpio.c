@@ -43,6 +43,8 @@
 #include "smtc_hal_gpio.h"
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_latency.h"
+#include "smtc_hal_irq_queue.h"
 #include <pigpio.h>
 
 /*
@@ -67,6 +69,7 @@ typedef struct hal_gpio_s
     hal_gpio_irq_mode_t  irq_mode;
     bool                 blocked;
     bool                 pending;
+    bool                 injected;  //!< Reads high until the injected IRQ is dispatched
 } gpio_t;
 
 /*
@@ -103,6 +106,11 @@ void gpio_init( const hal_gpio_pin_names_t pin, const uint32_t value,
  */
 void gpio_irq_callback( int gpio, int level, uint32_t tick );
 
+/*!
+ * GPIO IRQ work item, runs in the IRQ dispatcher context
+ */
+static void gpio_irq_dispatch( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -183,23 +191,28 @@ void hal_gpio_irq_detach( const hal_gpio_irq_t* irq )
 
 void hal_gpio_irq_enable( void )
 {
+    hal_irq_queue_lock();
     for (size_t i = 0; i < P_NUM; i++)
     {
         gpio[i].blocked = false;
-        if (gpio[i].pending && (gpio[i].irq != NULL) && (gpio[i].irq->callback != NULL))
+        if (gpio[i].pending)
         {
-            gpio[i].irq->callback(gpio[i].irq->context);
             gpio[i].pending = false;
+            hal_irq_queue_post(gpio_irq_dispatch, (void*) (uintptr_t) i);
         }
     }
+    hal_irq_queue_unlock();
 }
 
 void hal_gpio_irq_disable( void )
 {
+    // waits for a running callback to return
+    hal_irq_queue_lock();
     for (size_t i = 0; i < P_NUM; i++)
     {
         gpio[i].blocked = true;
     }
+    hal_irq_queue_unlock();
 }
 
 //
@@ -216,6 +229,12 @@ void hal_gpio_set_value( const hal_gpio_pin_names_t pin, const uint32_t value )
 
 uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin )
 {
+    if (gpio[pin - 0x2u].injected)
+    {
+        // the simulated radio drives no real line
+        return 1;
+    }
+
     int value = gpioRead(pin);
     if (value == PI_BAD_GPIO)
     {
@@ -226,10 +245,21 @@ uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin )
 
 void hal_gpio_clear_pending_irq( const hal_gpio_pin_names_t pin )
 {
+    hal_irq_queue_lock();
     for (size_t i = 0; i < P_NUM; i++)
     {
-        gpio[i].pending = false;
+        // a dropped injected IRQ must not keep its pin reading high
+        gpio[i].pending  = false;
+        gpio[i].injected = false;
     }
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_inject_irq( const hal_gpio_pin_names_t pin )
+{
+    // same path as a pigpio edge, minus the latency probe
+    gpio[pin - 0x2u].injected = true;
+    hal_irq_queue_post(gpio_irq_dispatch, (void*) (uintptr_t) (pin - 0x2u));
 }
 
 /*
@@ -255,6 +285,20 @@ void gpio_irq_callback( int pin, int level, uint32_t tick )
 {
     uint8_t index = pin - 0x2u;
 
+    if (level == 1)
+    {
+        // tick is the pigpio sample time of the edge, both are in us
+        hal_latency_start(pin, gpioTick() - tick);
+    }
+
+    // pigpio alert thread: only defer the interrupt
+    hal_irq_queue_post(gpio_irq_dispatch, (void*) (uintptr_t) index);
+}
+
+static void gpio_irq_dispatch( void* context )
+{
+    uint8_t index = (uintptr_t) context;
+
     if (gpio[index].blocked)
     {
         gpio[index].pending = true;
@@ -265,6 +309,7 @@ void gpio_irq_callback( int pin, int level, uint32_t tick )
     {
         gpio[index].irq->callback(gpio[index].irq->context);
     }
+    gpio[index].injected = false;
 }
 
 /* --- EOF ------------------------------------------------------------------ */
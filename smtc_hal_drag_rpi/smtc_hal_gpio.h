@@ -177,6 +177,13 @@ uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin );
  */
 void hal_gpio_clear_pending_irq( const hal_gpio_pin_names_t pin );
 
+/*!
+ * Raises the IRQ of an input as if its edge had been seen, for simulated peripherals
+ *
+ * \param [in] pin   pin whose IRQ callback is to be run
+ */
+void hal_gpio_inject_irq( const hal_gpio_pin_names_t pin );
+
 #ifdef __cplusplus
 }
 #endif
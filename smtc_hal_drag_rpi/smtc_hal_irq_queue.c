@@ -0,0 +1,269 @@
+/*!
+ * \file      smtc_hal_irq_queue.c
+ *
+ * \brief     Deferred interrupt work queue implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdatomic.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "smtc_hal_irq_queue.h"
+#include "smtc_hal_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Number of slots in the queue, must be a power of 2
+ */
+#define HAL_IRQ_QUEUE_SIZE 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Queue slot, the sequence number tells whether the slot is free or filled
+ * for the current lap (bounded MPMC queue from D. Vyukov)
+ */
+typedef struct irq_queue_slot_s
+{
+    atomic_size_t           sequence;
+    hal_irq_queue_handler_t handler;
+    void*                   context;
+} irq_queue_slot_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static irq_queue_slot_t slots[HAL_IRQ_QUEUE_SIZE];
+static atomic_size_t    enqueue_pos;
+static atomic_size_t    dequeue_pos;
+static atomic_uint      overflow_count;
+
+static int             event_fd = -1;
+static pthread_t       dispatcher;
+static pthread_mutex_t irq_lock;
+static atomic_bool     running = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static bool  irq_queue_pop( hal_irq_queue_handler_t* handler, void** context );
+static void* irq_queue_dispatcher( void* arg );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_irq_queue_init( void )
+{
+    for( size_t i = 0; i < HAL_IRQ_QUEUE_SIZE; i++ )
+    {
+        atomic_init( &slots[i].sequence, i );
+    }
+    atomic_init( &enqueue_pos, 0 );
+    atomic_init( &dequeue_pos, 0 );
+    atomic_init( &overflow_count, 0 );
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init( &attr );
+    pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+    if( pthread_mutex_init( &irq_lock, &attr ) != 0 )
+    {
+        mcu_panic( );
+    }
+    pthread_mutexattr_destroy( &attr );
+
+    event_fd = eventfd( 0, EFD_CLOEXEC );
+    if( event_fd == -1 )
+    {
+        mcu_panic( );
+    }
+
+    atomic_store( &running, true );
+    if( pthread_create( &dispatcher, NULL, irq_queue_dispatcher, NULL ) != 0 )
+    {
+        mcu_panic( );
+    }
+}
+
+void hal_irq_queue_deinit( void )
+{
+    if( !atomic_exchange( &running, false ) )
+    {
+        return;
+    }
+
+    // Only wake the dispatcher up: hal_mcu_reset can be reached from a work item or from a critical section, so
+    // joining could deadlock. The process exits right after.
+    uint64_t one = 1;
+    if( write( event_fd, &one, sizeof( one ) ) != sizeof( one ) )
+    {
+        // no reset to avoid error-looping
+        mcu_panic_trace( );
+    }
+}
+
+bool hal_irq_queue_post( hal_irq_queue_handler_t handler, void* context )
+{
+    irq_queue_slot_t* slot;
+    size_t            pos = atomic_load_explicit( &enqueue_pos, memory_order_relaxed );
+
+    for( ;; )
+    {
+        slot         = &slots[pos & ( HAL_IRQ_QUEUE_SIZE - 1 )];
+        size_t   seq = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+        intptr_t dif = ( intptr_t ) seq - ( intptr_t ) pos;
+
+        if( dif == 0 )
+        {
+            if( atomic_compare_exchange_weak_explicit( &enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                       memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if( dif < 0 )
+        {
+            atomic_fetch_add_explicit( &overflow_count, 1, memory_order_relaxed );
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit( &enqueue_pos, memory_order_relaxed );
+        }
+    }
+
+    slot->handler = handler;
+    slot->context = context;
+    atomic_store_explicit( &slot->sequence, pos + 1, memory_order_release );
+
+    // write() is async-signal-safe, errno must be preserved for the interrupted code
+    int      saved_errno = errno;
+    uint64_t one         = 1;
+    ssize_t  ret         = write( event_fd, &one, sizeof( one ) );
+    ( void ) ret;
+    errno = saved_errno;
+
+    return true;
+}
+
+void hal_irq_queue_lock( void )
+{
+    pthread_mutex_lock( &irq_lock );
+}
+
+void hal_irq_queue_unlock( void )
+{
+    pthread_mutex_unlock( &irq_lock );
+}
+
+uint32_t hal_irq_queue_get_overflow_count( void )
+{
+    return atomic_load( &overflow_count );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool irq_queue_pop( hal_irq_queue_handler_t* handler, void** context )
+{
+    irq_queue_slot_t* slot;
+    size_t            pos = atomic_load_explicit( &dequeue_pos, memory_order_relaxed );
+
+    for( ;; )
+    {
+        slot         = &slots[pos & ( HAL_IRQ_QUEUE_SIZE - 1 )];
+        size_t   seq = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+        intptr_t dif = ( intptr_t ) seq - ( intptr_t ) ( pos + 1 );
+
+        if( dif == 0 )
+        {
+            if( atomic_compare_exchange_weak_explicit( &dequeue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                       memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if( dif < 0 )
+        {
+            // empty, or the producer of this slot has not published it yet and will signal again
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit( &dequeue_pos, memory_order_relaxed );
+        }
+    }
+
+    *handler = slot->handler;
+    *context = slot->context;
+    atomic_store_explicit( &slot->sequence, pos + HAL_IRQ_QUEUE_SIZE, memory_order_release );
+
+    return true;
+}
+
+static void* irq_queue_dispatcher( void* arg )
+{
+    // Timer signals are delivered to the other threads, their handlers only post work anyway
+    sigset_t set;
+    sigfillset( &set );
+    pthread_sigmask( SIG_BLOCK, &set, NULL );
+
+    while( atomic_load( &running ) )
+    {
+        uint64_t count;
+        if( read( event_fd, &count, sizeof( count ) ) != sizeof( count ) )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            if( atomic_load( &running ) )
+            {
+                mcu_panic_trace( );
+            }
+            break;
+        }
+
+        hal_irq_queue_handler_t handler;
+        void*                   context;
+        while( atomic_load( &running ) && irq_queue_pop( &handler, &context ) )
+        {
+            hal_irq_queue_lock( );
+            handler( context );
+            hal_irq_queue_unlock( );
+        }
+    }
+
+    return NULL;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,102 @@
+/*!
+ * \file      smtc_hal_irq_queue.h
+ *
+ * \brief     Deferred interrupt work queue
+ *
+ * Interrupt sources (timer signal handlers, pigpio alert thread) do not run
+ * modem callbacks themselves: they post a work item and signal an eventfd.
+ * A single dispatcher thread drains the queue and runs the items, which gives
+ * the modem one well-defined interrupt context where normal locks and I/O can
+ * be used.
+ *
+ * The dispatcher holds the IRQ lock while it runs an item, so the MCU critical
+ * sections map onto that lock.
+ */
+#ifndef __SMTC_HAL_IRQ_QUEUE_H__
+#define __SMTC_HAL_IRQ_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Work item handler
+ */
+typedef void ( *hal_irq_queue_handler_t )( void* context );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Creates the eventfd and starts the dispatcher thread
+ */
+void hal_irq_queue_init( void );
+
+/*!
+ * Stops dispatching work items, to be called before the process exits
+ */
+void hal_irq_queue_deinit( void );
+
+/*!
+ * Posts a work item to the dispatcher
+ *
+ * \remark Lock-free and async-signal-safe, can be called from a signal handler
+ *
+ * \param [in] handler Function to run in the dispatcher context
+ * \param [in] context Argument given to the handler
+ *
+ * \retval true if the item was queued, false if the queue is full
+ */
+bool hal_irq_queue_post( hal_irq_queue_handler_t handler, void* context );
+
+/*!
+ * Takes the IRQ lock, work items are not dispatched while it is held
+ *
+ * \remark The lock is recursive
+ */
+void hal_irq_queue_lock( void );
+
+/*!
+ * Releases the IRQ lock
+ */
+void hal_irq_queue_unlock( void );
+
+/*!
+ * Gets the number of work items dropped because the queue was full
+ *
+ * \retval dropped item count
+ */
+uint32_t hal_irq_queue_get_overflow_count( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_IRQ_QUEUE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,202 @@
+/*!
+ * \file      smtc_hal_latency.c
+ *
+ * \brief     Radio IRQ to application event latency tracing implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+#include <time.h>
+#include <pthread.h>
+
+#include "smtc_hal_latency.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Number of trace records kept in history
+ */
+#define HAL_LATENCY_RECORD_NB 8
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const char* stage_names[HAL_LATENCY_STAGE_NB] = {
+    "edge", "gpio_isr", "radio_irq", "engine", "event",
+};
+
+/*!
+ * Record history, the ISR (pigpio thread) and the main loop both write to it
+ */
+static pthread_mutex_t      latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hal_latency_record_t records[HAL_LATENCY_RECORD_NB];
+static uint32_t             record_count = 0;
+static hal_latency_stats_t  stats        = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static uint64_t latency_now_us( void );
+
+static void latency_stats_update( const hal_latency_record_t* record, const hal_latency_stage_t stage );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_latency_start( const uint8_t pin, const uint32_t age_us )
+{
+    uint64_t now = latency_now_us( );
+
+    pthread_mutex_lock( &latency_mutex );
+
+    hal_latency_record_t* record = &records[record_count % HAL_LATENCY_RECORD_NB];
+    memset( record, 0, sizeof( *record ) );
+    record->id                                       = record_count++;
+    record->pin                                      = pin;
+    record->timestamp_us[HAL_LATENCY_STAGE_EDGE]     = now - age_us;
+    record->timestamp_us[HAL_LATENCY_STAGE_GPIO_ISR] = now;
+    latency_stats_update( record, HAL_LATENCY_STAGE_GPIO_ISR );
+
+    pthread_mutex_unlock( &latency_mutex );
+}
+
+void hal_latency_mark( const hal_latency_stage_t stage )
+{
+    if( ( stage <= HAL_LATENCY_STAGE_EDGE ) || ( stage >= HAL_LATENCY_STAGE_NB ) )
+    {
+        return;
+    }
+
+    uint64_t now = latency_now_us( );
+
+    pthread_mutex_lock( &latency_mutex );
+
+    if( record_count > 0 )
+    {
+        hal_latency_record_t* record = &records[( record_count - 1 ) % HAL_LATENCY_RECORD_NB];
+        if( ( record->timestamp_us[stage - 1] != 0 ) && ( record->timestamp_us[stage] == 0 ) )
+        {
+            record->timestamp_us[stage] = now;
+            latency_stats_update( record, stage );
+        }
+    }
+
+    pthread_mutex_unlock( &latency_mutex );
+}
+
+bool hal_latency_get_last( hal_latency_record_t* record )
+{
+    bool found = false;
+
+    pthread_mutex_lock( &latency_mutex );
+    if( record_count > 0 )
+    {
+        *record = records[( record_count - 1 ) % HAL_LATENCY_RECORD_NB];
+        found   = true;
+    }
+    pthread_mutex_unlock( &latency_mutex );
+
+    return found;
+}
+
+int32_t hal_latency_get_stage_us( const hal_latency_record_t* record, const hal_latency_stage_t stage )
+{
+    if( ( stage <= HAL_LATENCY_STAGE_EDGE ) || ( stage >= HAL_LATENCY_STAGE_NB ) ||
+        ( record->timestamp_us[stage - 1] == 0 ) || ( record->timestamp_us[stage] == 0 ) )
+    {
+        return -1;
+    }
+    return ( int32_t ) ( record->timestamp_us[stage] - record->timestamp_us[stage - 1] );
+}
+
+void hal_latency_get_stats( hal_latency_stats_t* out )
+{
+    pthread_mutex_lock( &latency_mutex );
+    *out = stats;
+    pthread_mutex_unlock( &latency_mutex );
+}
+
+const char* hal_latency_stage_name( const hal_latency_stage_t stage )
+{
+    return ( stage < HAL_LATENCY_STAGE_NB ) ? stage_names[stage] : "?";
+}
+
+void hal_latency_print_stats( void )
+{
+    hal_latency_stats_t snapshot;
+    hal_latency_get_stats( &snapshot );
+
+    SMTC_HAL_TRACE_PRINTF( "Radio IRQ latency (us)          count      min     mean      max\n" );
+    for( int i = HAL_LATENCY_STAGE_GPIO_ISR; i < HAL_LATENCY_STAGE_NB; i++ )
+    {
+        if( snapshot.count[i] == 0 )
+        {
+            continue;
+        }
+        SMTC_HAL_TRACE_PRINTF( "  %-9s -> %-9s        %8u %8u %8u %8u\n", stage_names[i - 1], stage_names[i],
+                               snapshot.count[i], snapshot.min_us[i],
+                               ( uint32_t ) ( snapshot.sum_us[i] / snapshot.count[i] ), snapshot.max_us[i] );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint64_t latency_now_us( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+static void latency_stats_update( const hal_latency_record_t* record, const hal_latency_stage_t stage )
+{
+    int32_t delta = hal_latency_get_stage_us( record, stage );
+    if( delta < 0 )
+    {
+        return;
+    }
+
+    if( ( stats.count[stage] == 0 ) || ( ( uint32_t ) delta < stats.min_us[stage] ) )
+    {
+        stats.min_us[stage] = delta;
+    }
+    if( ( uint32_t ) delta > stats.max_us[stage] )
+    {
+        stats.max_us[stage] = delta;
+    }
+    stats.sum_us[stage] += delta;
+    stats.count[stage]++;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,148 @@
+/*!
+ * \file      smtc_hal_latency.h
+ *
+ * \brief     Radio IRQ to application event latency tracing
+ *
+ * Every rising edge on a radio DIO line opens a new trace record. The record
+ * is then stamped as the interrupt travels through the stack:
+ *
+ *   EDGE      -> edge sampled by pigpio
+ *   GPIO_ISR  -> pigpio alert callback entered
+ *   RADIO_IRQ -> modem HAL radio IRQ callback entered
+ *   ENGINE    -> modem engine started processing the IRQ
+ *   EVENT     -> event handed to the application
+ *
+ * A stage is only stamped once per record and only when the previous stage
+ * has been reached, so a record always describes a single radio event.
+ */
+#ifndef __SMTC_HAL_LATENCY_H__
+#define __SMTC_HAL_LATENCY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Trace points crossed by a radio interrupt
+ */
+typedef enum hal_latency_stage_e
+{
+    HAL_LATENCY_STAGE_EDGE = 0,
+    HAL_LATENCY_STAGE_GPIO_ISR,
+    HAL_LATENCY_STAGE_RADIO_IRQ,
+    HAL_LATENCY_STAGE_ENGINE,
+    HAL_LATENCY_STAGE_EVENT,
+    HAL_LATENCY_STAGE_NB,
+} hal_latency_stage_t;
+
+/*!
+ * Trace record of one radio event
+ */
+typedef struct hal_latency_record_s
+{
+    uint32_t id;                                  //!< Radio event sequence number
+    uint8_t  pin;                                 //!< DIO pin that raised the event
+    uint64_t timestamp_us[HAL_LATENCY_STAGE_NB];  //!< Monotonic time, 0 if stage not reached
+} hal_latency_record_t;
+
+/*!
+ * Per-stage latency statistics, stage i is the delay between stage i-1 and i
+ */
+typedef struct hal_latency_stats_s
+{
+    uint32_t count[HAL_LATENCY_STAGE_NB];
+    uint32_t min_us[HAL_LATENCY_STAGE_NB];
+    uint32_t max_us[HAL_LATENCY_STAGE_NB];
+    uint64_t sum_us[HAL_LATENCY_STAGE_NB];
+} hal_latency_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Opens a new trace record, to be called from the GPIO ISR
+ *
+ * \param [in] pin    DIO pin that raised the interrupt
+ * \param [in] age_us Time elapsed since the edge was sampled
+ */
+void hal_latency_start( const uint8_t pin, const uint32_t age_us );
+
+/*!
+ * Stamps the given stage of the current record
+ *
+ * \param [in] stage Trace point reached
+ */
+void hal_latency_mark( const hal_latency_stage_t stage );
+
+/*!
+ * Gets a copy of the most recent trace record
+ *
+ * \param [out] record Copy of the record
+ *
+ * \retval true if a record exists
+ */
+bool hal_latency_get_last( hal_latency_record_t* record );
+
+/*!
+ * Gets the delay between a stage and its predecessor
+ *
+ * \param [in] record Trace record
+ * \param [in] stage  Stage, must be > HAL_LATENCY_STAGE_EDGE
+ *
+ * \retval delay in microseconds, -1 if one of the stages was not reached
+ */
+int32_t hal_latency_get_stage_us( const hal_latency_record_t* record, const hal_latency_stage_t stage );
+
+/*!
+ * Gets the per-stage statistics of all completed records
+ *
+ * \param [out] stats Copy of the statistics
+ */
+void hal_latency_get_stats( hal_latency_stats_t* stats );
+
+/*!
+ * Gets the name of a stage
+ *
+ * \param [in] stage Trace point
+ *
+ * \retval stage name
+ */
+const char* hal_latency_stage_name( const hal_latency_stage_t stage );
+
+/*!
+ * Prints the per-stage statistics on the trace output
+ */
+void hal_latency_print_stats( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_LATENCY_H__
+
+/* --- EOF ------------------------------------------------------------------ */
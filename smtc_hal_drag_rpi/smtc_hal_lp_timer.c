@@ -43,7 +43,9 @@
 #include "smtc_hal_lp_timer.h"
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_rtc.h"
+#include "smtc_hal_irq_queue.h"
 
+#include <stdint.h>
 #include <time.h>
 #include <signal.h>
 
@@ -59,6 +61,8 @@
 
 #define HAL_LP_TIMER_NB 2  //!< Number of supported low power timers
 
+#define HAL_LP_TIMER_ID_BITS 4  //!< Bits of the work item context holding the timer id
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -69,6 +73,7 @@ typedef struct hal_lp_timer_s
     int signo;
     timer_t handle;
     hal_lp_timer_irq_t tmr_irq;
+    uint32_t generation; // incremented on start/stop/expiry, drops expiries of a previous run
     bool blocked;
     bool pending;
 } lp_timer_t;
@@ -87,6 +92,21 @@ static lp_timer_t lptim[HAL_LP_TIMER_NB];
 
 void pl_timer_handler( int sig, siginfo_t *si, void *uc );
 
+/*!
+ * Timer expiry work item, runs in the IRQ dispatcher context
+ */
+static void lp_timer_dispatch( void* context );
+
+/*!
+ * Builds the work item context for the current run of a timer
+ */
+static void* lp_timer_work_context( hal_lp_timer_id_t id );
+
+/*!
+ * Tells whether a timer is armed, i.e. an expiry seen now belongs to a previous run
+ */
+static bool lp_timer_is_armed( hal_lp_timer_id_t id );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -142,45 +162,63 @@ void hal_lp_timer_deinit( hal_lp_timer_id_t id )
 
 void hal_lp_timer_start( hal_lp_timer_id_t id, const uint32_t milliseconds, const hal_lp_timer_irq_t* tmr_irq )
 {
-    lptim[id].tmr_irq = *tmr_irq; // callback assignment
-
     struct itimerspec its;
     its.it_value.tv_sec = milliseconds / 1000;
     its.it_value.tv_nsec = milliseconds % 1000 * 1000000;
     its.it_interval = ZERO;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+    {
+        its.it_value.tv_nsec = 1; // zero would disarm the timer
+    }
+
+    // armed under the lock, the dispatcher sees either the old run or the new one, armed
+    hal_irq_queue_lock();
+    lptim[id].tmr_irq = *tmr_irq; // callback assignment
+    lptim[id].generation++;
+    lptim[id].pending = false;
     if (timer_settime(lptim[id].handle, 0, &its, NULL) == -1)
     {
         mcu_panic();
     }
+    hal_irq_queue_unlock();
 }
 
 void hal_lp_timer_stop( hal_lp_timer_id_t id )
 {
-    lptim[id].tmr_irq = (hal_lp_timer_irq_t){.context = NULL, .callback = NULL};
-
     struct itimerspec its;
     its.it_value = ZERO;
     its.it_interval = ZERO;
+
+    hal_irq_queue_lock();
+    lptim[id].tmr_irq = (hal_lp_timer_irq_t){.context = NULL, .callback = NULL};
+    lptim[id].generation++;
+    lptim[id].pending = false;
     if (timer_settime(lptim[id].handle, 0, &its, NULL) == -1)
     {
         mcu_panic();
     }
+    hal_irq_queue_unlock();
 }
 
 void hal_lp_timer_irq_enable( hal_lp_timer_id_t id )
 {
+    hal_irq_queue_lock();
     lptim[id].blocked = false;
 
-    if (lptim[id].pending && (lptim[id].tmr_irq.callback != NULL))
+    if (lptim[id].pending)
     {
-        lptim[id].tmr_irq.callback(lptim[id].tmr_irq.context);
         lptim[id].pending = false;
+        hal_irq_queue_post(lp_timer_dispatch, lp_timer_work_context(id));
     }
+    hal_irq_queue_unlock();
 }
 
 void hal_lp_timer_irq_disable( hal_lp_timer_id_t id )
 {
+    // waits for a running callback to return
+    hal_irq_queue_lock();
     lptim[id].blocked = true;
+    hal_irq_queue_unlock();
 }
 
 /*
@@ -192,16 +230,64 @@ void pl_timer_handler( int sig, siginfo_t *si, void *uc )
 {
     int id = si->si_value.sival_int;
 
+    // one-shot timer armed again since this expiry: it belongs to the previous run
+    if (lp_timer_is_armed(id))
+    {
+        return;
+    }
+
+    // signal context: only defer the expiry
+    hal_irq_queue_post(lp_timer_dispatch, lp_timer_work_context(id));
+}
+
+static void lp_timer_dispatch( void* context )
+{
+    uintptr_t value = (uintptr_t) context;
+    hal_lp_timer_id_t id = value & ((1u << HAL_LP_TIMER_ID_BITS) - 1);
+    uint32_t generation = value >> HAL_LP_TIMER_ID_BITS;
+
+    if (generation != (uint32_t) (lptim[id].generation & (UINTPTR_MAX >> HAL_LP_TIMER_ID_BITS)))
+    {
+        // timer was stopped or restarted after this expiry
+        return;
+    }
+
+    // checked again under the lock: the handler may have run between the generation
+    // update and timer_settime of a restart, the restarted timer is armed by now
+    if (lp_timer_is_armed(id))
+    {
+        return;
+    }
+
     if (lptim[id].blocked)
     {
         lptim[id].pending = true;
         return;
     }
 
+    // one expiry per run, a duplicate delivery is dropped
+    lptim[id].generation++;
     if (lptim[id].tmr_irq.callback != NULL)
     {
         lptim[id].tmr_irq.callback(lptim[id].tmr_irq.context);
     }
 }
 
+static void* lp_timer_work_context( hal_lp_timer_id_t id )
+{
+    return (void*) (((uintptr_t) lptim[id].generation << HAL_LP_TIMER_ID_BITS) | id);
+}
+
+static bool lp_timer_is_armed( hal_lp_timer_id_t id )
+{
+    struct itimerspec its;
+
+    // async-signal-safe
+    if (timer_gettime(lptim[id].handle, &its) == -1)
+    {
+        return false;
+    }
+    return (its.it_value.tv_sec != 0) || (its.it_value.tv_nsec != 0);
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -39,6 +39,8 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <stdatomic.h>
+#include <stdlib.h>   // exit
 
 #include "smtc_hal_mcu.h"
 #include "modem_pinout.h"
@@ -46,7 +48,12 @@
 #include "smtc_hal_rtc.h"
 #include "smtc_hal_spi.h"
 #include "smtc_hal_lp_timer.h"
-#include <pigpio.h>
+#include "smtc_hal_irq_queue.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_env.h"
+#include "smtc_hal_startup.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_board.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -68,7 +75,19 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-bool sleeping = false;
+// written by the IRQ dispatcher and signal handlers, polled by the main loop
+static atomic_bool sleeping = false;
+
+static modem_pinout_t pinout = {
+    .nrst     = RADIO_NRST_DEFAULT,
+    .spi_mosi = RADIO_SPI_MOSI_DEFAULT,
+    .spi_miso = RADIO_SPI_MISO_DEFAULT,
+    .spi_sclk = RADIO_SPI_SCLK_DEFAULT,
+    .nss      = RADIO_NSS_DEFAULT,
+    .dio_0    = RADIO_DIO_0_DEFAULT,
+    .dio_1    = RADIO_DIO_1_DEFAULT,
+    .dio_2    = RADIO_DIO_2_DEFAULT,
+};
 
 /*
  * -----------------------------------------------------------------------------
@@ -76,6 +95,8 @@ bool sleeping = false;
  */
 static void mcu_gpio_init( void );
 static void sleep_handler( void );
+static void mcu_pinout_load_pin( const char* key, hal_gpio_pin_names_t* pin );
+static void mcu_pinout_reject_pin( const char* key );
 
 /*
  * -----------------------------------------------------------------------------
@@ -84,17 +105,29 @@ static void sleep_handler( void );
 
 void hal_mcu_critical_section_begin( uint32_t* mask )
 {
-    // nothing meaningful to be done here
+    // interrupts are work items run by the IRQ dispatcher under this lock
+    hal_irq_queue_lock( );
 }
 
 void hal_mcu_critical_section_end( uint32_t* mask )
 {
+    hal_irq_queue_unlock( );
 }
 
 void hal_mcu_init( void )
 {
+    // Load board specific settings
+    hal_board_profile_load( );
+    modem_pinout_load( );
+    hal_startup_mark( HAL_STARTUP_PHASE_PROFILE );
+
+    // Start IRQ dispatcher before any interrupt source
+    hal_irq_queue_init( );
+    hal_startup_mark( HAL_STARTUP_PHASE_IRQ_QUEUE );
+
     // Initialize GPIOs
     mcu_gpio_init( );
+    hal_startup_mark( HAL_STARTUP_PHASE_GPIO );
 
     // Initialize Low Power Timer
     hal_lp_timer_init( HAL_LP_TIMER_ID_1 );
@@ -102,12 +135,19 @@ void hal_mcu_init( void )
 #if( SX127X )
     hal_lp_timer_init( HAL_LP_TIMER_ID_2 );
 #endif
+    hal_startup_mark( HAL_STARTUP_PHASE_LP_TIMER );
 
     // Initialize SPI for radio
     hal_spi_init( RADIO_SPI_ID, RADIO_SPI_MOSI, RADIO_SPI_MISO, RADIO_SPI_SCLK );
+    hal_startup_mark( HAL_STARTUP_PHASE_SPI );
 
     // Initialize RTC (for real time and wut)
     hal_rtc_init( );
+    hal_startup_mark( HAL_STARTUP_PHASE_RTC );
+
+    // Fill the environment sensors cache
+    hal_env_init( );
+    hal_startup_mark( HAL_STARTUP_PHASE_ENV );
 }
 
 void hal_mcu_reset( void )
@@ -130,7 +170,10 @@ void hal_mcu_reset( void )
     hal_gpio_irq_deinit( );
 
     // Terminate GPIO control
-    gpioTerminate( );
+    hal_board_gpio_lib_terminate( );
+
+    // Stop IRQ dispatcher
+    hal_irq_queue_deinit( );
 
     exit( 3 );
 }
@@ -138,7 +181,7 @@ void hal_mcu_reset( void )
 void hal_mcu_wait_us( const int32_t microseconds )
 {
     // non stoppable by signals
-    gpioDelay(microseconds);
+    hal_board_delay_us( microseconds );
 }
 
 void hal_mcu_set_sleep_for_ms( const int32_t milliseconds )
@@ -156,7 +199,24 @@ void hal_mcu_set_sleep_for_ms( const int32_t milliseconds )
 
 void hal_mcu_wakeup( void )
 {
-    sleeping = false;
+    atomic_store( &sleeping, false );
+}
+
+void modem_pinout_load( void )
+{
+    mcu_pinout_load_pin( "pin.nrst", &pinout.nrst );
+    mcu_pinout_reject_pin( "pin.spi_mosi" );
+    mcu_pinout_reject_pin( "pin.spi_miso" );
+    mcu_pinout_reject_pin( "pin.spi_sclk" );
+    mcu_pinout_load_pin( "pin.nss", &pinout.nss );
+    mcu_pinout_load_pin( "pin.dio0", &pinout.dio_0 );
+    mcu_pinout_load_pin( "pin.dio1", &pinout.dio_1 );
+    mcu_pinout_load_pin( "pin.dio2", &pinout.dio_2 );
+}
+
+const modem_pinout_t* modem_pinout_get( void )
+{
+    return &pinout;
 }
 
 /*
@@ -164,17 +224,37 @@ void hal_mcu_wakeup( void )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
-static void mcu_gpio_init( void )
+static void mcu_pinout_load_pin( const char* key, hal_gpio_pin_names_t* pin )
 {
-    if (gpioCfgInterfaces(PI_DISABLE_FIFO_IF | PI_DISABLE_SOCK_IF | PI_DISABLE_ALERT) < 0)
+    int32_t value;
+    if( !hal_board_profile_get_int( key, &value ) )
     {
-        mcu_panic( ); // pigpio initialisation failed.
+        return;
     }
 
-    if (gpioInitialise() < 0)
+    if( ( value < P_2 ) || ( value > P_27 ) )
     {
-        mcu_panic( ); // pigpio initialisation failed.
+        SMTC_HAL_TRACE_WARNING( "Board profile: %s = %d is not a usable GPIO, keeping %d\n", key, ( int ) value,
+                                ( int ) *pin );
+        return;
     }
+    *pin = ( hal_gpio_pin_names_t ) value;
+}
+
+static void mcu_pinout_reject_pin( const char* key )
+{
+    int32_t value;
+    if( hal_board_profile_get_int( key, &value ) )
+    {
+        // The SPI pins are those of the SPI controller, chosen with the device node
+        SMTC_HAL_TRACE_WARNING( "Board profile: %s is ignored, select the SPI controller with spi.device\n", key );
+    }
+}
+
+static void mcu_gpio_init( void )
+{
+    hal_board_gpio_lib_init( );
+    hal_startup_mark( HAL_STARTUP_PHASE_GPIO_LIB );
 
     hal_gpio_init_out( RADIO_NSS, 1 );
 #if defined( SX1276 )
@@ -187,8 +267,8 @@ static void mcu_gpio_init( void )
 
 static void sleep_handler( void )
 {
-    sleeping = true;
-    while (sleeping)
+    atomic_store( &sleeping, true );
+    while (atomic_load( &sleeping ))
     {
         // Check every 500 us, no need to be more accurate
         hal_mcu_wait_us(500);
@@ -49,6 +49,7 @@ extern "C" {
 #include <stdio.h>
 
 #include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_reset_cause.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -58,18 +59,19 @@ extern "C" {
 /*!
  * Panic function for mcu issues
  */
-#define mcu_panic( ... )                                    \
-    do                                                      \
-    {                                                       \
-        mcu_panic_trace( );                                 \
-        hal_mcu_reset( );                                   \
+#define mcu_panic( ... )                                       \
+    do                                                         \
+    {                                                          \
+        mcu_panic_trace( );                                    \
+        hal_reset_cause_set( false, "panic in %s", __func__ ); \
+        hal_mcu_reset( );                                      \
     } while( 0 );
 
-#define mcu_panic_trace( ... )                              \
-    do                                                      \
-    {                                                       \
-        SMTC_HAL_TRACE_ERROR( "mcu_panic:%s\n", __func__ ); \
-        SMTC_HAL_TRACE_ERROR( "-> "__VA_ARGS__ );           \
+#define mcu_panic_trace( ... )                                 \
+    do                                                         \
+    {                                                          \
+        SMTC_HAL_TRACE_ERROR( "mcu_panic:%s\n", __func__ );    \
+        SMTC_HAL_TRACE_ERROR( "-> "__VA_ARGS__ );              \
     } while( 0 );
 
 /*!
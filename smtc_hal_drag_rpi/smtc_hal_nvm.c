@@ -38,6 +38,7 @@
 
 #include "smtc_hal_nvm.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_board_profile.h"
 
 #include <string.h> // memcpy
 #include <assert.h> // assert
@@ -62,7 +63,8 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-static const char *restrict pathname = "/tmp/lorawan-dragino-nvm";
+// /tmp does not survive a reboot, nvm.path in the board profile moves the file
+static const char *restrict default_pathname = "/tmp/lorawan-dragino-nvm";
 
 int f;
 
@@ -71,6 +73,8 @@ int f;
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+static const char* nvm_pathname( void );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -78,7 +82,7 @@ int f;
 
 void hal_nvm_write_buffer(uint32_t addr, const uint8_t *buffer, uint32_t size)
 {
-    if ((f = open(pathname, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR)) < 0)
+    if ((f = open(nvm_pathname(), O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR)) < 0)
     {
         mcu_panic();
     }
@@ -98,7 +102,7 @@ void hal_nvm_write_buffer(uint32_t addr, const uint8_t *buffer, uint32_t size)
 
 void hal_nvm_read_buffer(uint32_t addr, uint8_t *buffer, uint32_t size)
 {
-    if ((f = open(pathname, O_RDONLY | O_CREAT, S_IRUSR | S_IWUSR)) < 0)
+    if ((f = open(nvm_pathname(), O_RDONLY | O_CREAT, S_IRUSR | S_IWUSR)) < 0)
     {
         mcu_panic();
     }
@@ -121,4 +125,15 @@ void hal_nvm_read_buffer(uint32_t addr, uint8_t *buffer, uint32_t size)
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static const char* nvm_pathname( void )
+{
+    const char* pathname;
+
+    if (hal_board_profile_get_str("nvm.path", &pathname) == false)
+    {
+        pathname = default_pathname;
+    }
+    return pathname;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
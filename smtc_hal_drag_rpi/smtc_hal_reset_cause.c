@@ -0,0 +1,110 @@
+/*!
+ * \file      smtc_hal_reset_cause.c
+ *
+ * \brief     Reset cause handed from the application process to its supervisor, implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "smtc_hal_reset_cause.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static hal_reset_cause_t  local_cause = { 0 };
+static hal_reset_cause_t* cause       = &local_cause;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool hal_reset_cause_share( void )
+{
+    if( cause != &local_cause )
+    {
+        return true;
+    }
+
+    // A shared mapping of /dev/zero is anonymous memory kept shared across fork
+    const int fd   = open( "/dev/zero", O_RDWR );
+    void*     page = MAP_FAILED;
+    if( fd >= 0 )
+    {
+        page = mmap( NULL, sizeof( hal_reset_cause_t ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+    }
+    if( page == MAP_FAILED )
+    {
+        SMTC_HAL_TRACE_WARNING( "Reset cause cannot be shared, restarts will have no cause\n" );
+        return false;
+    }
+
+    memset( page, 0, sizeof( hal_reset_cause_t ) );
+    cause = ( hal_reset_cause_t* ) page;
+    return true;
+}
+
+void hal_reset_cause_set( const bool planned, const char* format, ... )
+{
+    va_list args;
+
+    // The first cause is the root one, e.g. a panic followed by the reset it triggers
+    if( cause->text[0] != '\0' )
+    {
+        return;
+    }
+
+    va_start( args, format );
+    vsnprintf( cause->text, sizeof( cause->text ), format, args );
+    va_end( args );
+    cause->planned = planned;
+}
+
+void hal_reset_cause_take( hal_reset_cause_t* out )
+{
+    *out = *cause;
+    memset( cause, 0, sizeof( *cause ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,89 @@
+/*!
+ * \file      smtc_hal_reset_cause.h
+ *
+ * \brief     Reset cause handed from the application process to its supervisor
+ *
+ * The supervisor shares a page with the application processes it forks. Before
+ * exiting for a reset, the application writes why in that page; the supervisor
+ * reads it once the process is gone. Without a supervisor the cause is only
+ * kept in the process.
+ */
+#ifndef __SMTC_HAL_RESET_CAUSE_H__
+#define __SMTC_HAL_RESET_CAUSE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // size_t
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Maximum cause length, terminating zero included
+ */
+#define HAL_RESET_CAUSE_LEN 96
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Reset cause
+ */
+typedef struct hal_reset_cause_s
+{
+    bool planned;                     //!< Requested reset (e.g. firmware update), not a fault
+    char text[HAL_RESET_CAUSE_LEN];  //!< Empty if no cause was set
+} hal_reset_cause_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Shares the cause with the processes forked afterwards, to be called by the supervisor
+ *
+ * \retval true if the shared page was mapped
+ */
+bool hal_reset_cause_share( void );
+
+/*!
+ * Sets the reset cause, only the first cause is kept until hal_reset_cause_take
+ *
+ * \param [in] planned true for a requested reset
+ * \param [in] format  printf-like cause text
+ */
+void hal_reset_cause_set( const bool planned, const char* format, ... );
+
+/*!
+ * Gets the reset cause and clears it, to be called by the supervisor after the process exited
+ *
+ * \param [out] cause Copy of the cause
+ */
+void hal_reset_cause_take( hal_reset_cause_t* cause );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_RESET_CAUSE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
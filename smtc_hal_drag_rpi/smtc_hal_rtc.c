@@ -42,6 +42,7 @@
 #include "smtc_hal_rtc.h"
 
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_irq_queue.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -74,6 +75,11 @@ static timer_t         rtc_tid;
 
 void rtc_wakeup_timer_handler( int sig, siginfo_t *si, void *uc );
 
+/*!
+ * Wakeup work item, runs in the IRQ dispatcher context
+ */
+static void rtc_wakeup_dispatch( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -155,6 +161,11 @@ void hal_rtc_wakeup_timer_stop( void )
  */
 
 void rtc_wakeup_timer_handler( int sig, siginfo_t *si, void *uc )
+{
+    hal_irq_queue_post( rtc_wakeup_dispatch, NULL );
+}
+
+static void rtc_wakeup_dispatch( void* context )
 {
     hal_mcu_wakeup( );
 }
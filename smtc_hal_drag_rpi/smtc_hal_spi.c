@@ -38,9 +38,18 @@
  */
 
 #include <stdbool.h>  // bool type
+#include <stdint.h>   // C99 types
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
 
 #include "smtc_hal_spi.h"
+#include "smtc_hal_spi_sim.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
 #include <pigpio.h>
 
 /*
@@ -53,6 +62,9 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+#define SPI_PIGPIO_CHANNEL 0
+#define SPI_DEFAULT_DEVICE "/dev/spidev0.0"
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -63,13 +75,24 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-static int handle;
+static int               handle   = -1;
+static hal_spi_backend_t backend  = HAL_SPI_BACKEND_PIGPIO;
+static uint32_t          speed_hz = HAL_SPI_DEFAULT_SPEED_HZ;
+static const char*       device   = SPI_DEFAULT_DEVICE;
+
+static const char* const backend_names[HAL_SPI_BACKEND_NB] = { "pigpio", "spidev", "sim" };
 
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+static int spi_open( const hal_spi_backend_t new_backend, const uint32_t new_speed_hz );
+
+static int spi_close( void );
+
+static int spi_transfer( const uint8_t* out_data, uint8_t* in_data, const uint16_t size, const bool frame_start );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -78,16 +101,34 @@ static int handle;
 void hal_spi_init( const uint32_t id, const hal_gpio_pin_names_t mosi, const hal_gpio_pin_names_t miso,
                    const hal_gpio_pin_names_t sclk )
 {
-    handle = spiOpen(0, 500000, 0);
-    if (handle < 0)
+    const char* name;
+    int32_t     value;
+
+    if( hal_board_profile_get_str( "spi.backend", &name ) == true )
+    {
+        for( uint8_t i = 0; i < HAL_SPI_BACKEND_NB; i++ )
+        {
+            if( strcmp( name, backend_names[i] ) == 0 )
+            {
+                backend = ( hal_spi_backend_t ) i;
+            }
+        }
+    }
+    if( ( hal_board_profile_get_int( "spi.speed_hz", &value ) == true ) && ( value > 0 ) )
     {
-        mcu_panic();
+        speed_hz = ( uint32_t ) value;
+    }
+    hal_board_profile_get_str( "spi.device", &device );
+
+    if( spi_open( backend, speed_hz ) != 0 )
+    {
+        mcu_panic( );
     }
 }
 
 void hal_spi_deinit( const uint32_t id )
 {
-    if (spiClose(handle) != 0)
+    if( spi_close( ) != 0 )
     {
         // no reset to avoid error-looping
         mcu_panic_trace( );
@@ -96,13 +137,171 @@ void hal_spi_deinit( const uint32_t id )
 
 uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data )
 {
-    char in_buf;
-    char out_buf = (char)(out_data & 0xFF);
-    if (spiXfer(handle, &out_buf, &in_buf, 1) != 1)
+    uint8_t in_buf;
+    uint8_t out_buf = ( uint8_t ) ( out_data & 0xFF );
+    if( spi_transfer( &out_buf, &in_buf, 1, true ) != 1 )
     {
         mcu_panic( );
     }
     return in_buf;
 }
 
+void hal_spi_in_out_buffer( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size )
+{
+    if( size == 0 )
+    {
+        return;
+    }
+
+    if( spi_transfer( out_data, in_data, size, false ) != size )
+    {
+        mcu_panic( );
+    }
+}
+
+bool hal_spi_configure( const uint32_t id, const hal_spi_backend_t new_backend, const uint32_t new_speed_hz )
+{
+    const hal_spi_backend_t old_backend  = backend;
+    const uint32_t          old_speed_hz = speed_hz;
+
+    if( new_backend >= HAL_SPI_BACKEND_NB )
+    {
+        return false;
+    }
+
+    spi_close( );
+    if( spi_open( new_backend, new_speed_hz ) == 0 )
+    {
+        return true;
+    }
+
+    SMTC_HAL_TRACE_WARNING( "SPI backend %s at %lu Hz cannot be opened\n", backend_names[new_backend],
+                            ( unsigned long ) new_speed_hz );
+    if( spi_open( old_backend, old_speed_hz ) != 0 )
+    {
+        mcu_panic( );
+    }
+    return false;
+}
+
+hal_spi_backend_t hal_spi_get_backend( const uint32_t id )
+{
+    return backend;
+}
+
+uint32_t hal_spi_get_speed_hz( const uint32_t id )
+{
+    return speed_hz;
+}
+
+const char* hal_spi_backend_name( const hal_spi_backend_t spi_backend )
+{
+    return ( spi_backend < HAL_SPI_BACKEND_NB ) ? backend_names[spi_backend] : "unknown";
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static int spi_open( const hal_spi_backend_t new_backend, const uint32_t new_speed_hz )
+{
+    switch( new_backend )
+    {
+    case HAL_SPI_BACKEND_SPIDEV:
+    {
+        const uint8_t  mode = SPI_MODE_0;
+        const uint8_t  bits = 8;
+        const uint32_t hz   = new_speed_hz;
+
+        handle = open( device, O_RDWR );
+        if( handle < 0 )
+        {
+            return -1;
+        }
+        if( ( ioctl( handle, SPI_IOC_WR_MODE, &mode ) < 0 ) ||
+            ( ioctl( handle, SPI_IOC_WR_BITS_PER_WORD, &bits ) < 0 ) ||
+            ( ioctl( handle, SPI_IOC_WR_MAX_SPEED_HZ, &hz ) < 0 ) )
+        {
+            close( handle );
+            handle = -1;
+            return -1;
+        }
+        break;
+    }
+    case HAL_SPI_BACKEND_SIM:
+        hal_spi_sim_reset( );
+        handle = 0;  // Marks the backend open
+        break;
+    default:
+        handle = spiOpen( SPI_PIGPIO_CHANNEL, new_speed_hz, 0 );
+        if( handle < 0 )
+        {
+            return -1;
+        }
+        break;
+    }
+
+    backend  = new_backend;
+    speed_hz = new_speed_hz;
+    return 0;
+}
+
+static int spi_close( void )
+{
+    int ret = 0;
+
+    if( handle < 0 )
+    {
+        return 0;
+    }
+
+    switch( backend )
+    {
+    case HAL_SPI_BACKEND_SPIDEV:
+        ret = close( handle );
+        break;
+    case HAL_SPI_BACKEND_SIM:
+        break;
+    default:
+        ret = spiClose( handle );
+        break;
+    }
+
+    handle = -1;
+    return ret;
+}
+
+static int spi_transfer( const uint8_t* out_data, uint8_t* in_data, const uint16_t size, const bool frame_start )
+{
+    switch( backend )
+    {
+    case HAL_SPI_BACKEND_SPIDEV:
+    {
+        // A NULL tx_buf shifts out zeros, a NULL rx_buf discards the input
+        struct spi_ioc_transfer xfer = {
+            .tx_buf        = ( uintptr_t ) out_data,
+            .rx_buf        = ( uintptr_t ) in_data,
+            .len           = size,
+            .speed_hz      = speed_hz,
+            .bits_per_word = 8,
+        };
+        return ioctl( handle, SPI_IOC_MESSAGE( 1 ), &xfer );
+    }
+    case HAL_SPI_BACKEND_SIM:
+        hal_spi_sim_xfer( out_data, in_data, size, frame_start );
+        return size;
+    default:
+        if( out_data == NULL )
+        {
+            return spiRead( handle, ( char* ) in_data, size );
+        }
+        if( in_data == NULL )
+        {
+            return spiWrite( handle, ( char* ) out_data, size );
+        }
+        return spiXfer( handle, ( char* ) out_data, ( char* ) in_data, size );
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -43,7 +43,8 @@ extern "C" {
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
-#include <stdint.h>  // C99 types
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
 
 #include "smtc_hal_gpio.h"
 
@@ -57,11 +58,32 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+#define HAL_SPI_DEFAULT_SPEED_HZ 500000
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * SPI backends, selected with the spi.backend board profile key
+ *
+ *   spi.backend  = pigpio | spidev | sim
+ *   spi.speed_hz = 500000
+ *   spi.device   = /dev/spidev0.0
+ *
+ * spidev needs the kernel driver enabled (dtparam=spi=on). sim is an
+ * in-memory SX127x register file and FIFO, it takes each hal_spi_in_out call
+ * as the address byte of a new frame, as sx127x_hal does.
+ */
+typedef enum hal_spi_backend_e
+{
+    HAL_SPI_BACKEND_PIGPIO,
+    HAL_SPI_BACKEND_SPIDEV,
+    HAL_SPI_BACKEND_SIM,
+    HAL_SPI_BACKEND_NB,
+} hal_spi_backend_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -95,6 +117,54 @@ void hal_spi_deinit( const uint32_t id );
  */
 uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data );
 
+/*!
+ * Sends and receives a buffer in a single transfer
+ *
+ * \param [IN]  id       SPI interface id [1:N]
+ * \param [IN]  out_data Bytes to be sent, zeros are sent if NULL
+ * \param [OUT] in_data  Received bytes, discarded if NULL
+ * \param [IN]  size     Number of bytes to transfer
+ */
+void hal_spi_in_out_buffer( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size );
+
+/*!
+ * Reopens the SPI peripheral with another backend or clock
+ *
+ * \param [IN] id       SPI interface id [1:N]
+ * \param [IN] backend  SPI backend
+ * \param [IN] speed_hz SPI clock requested, the actual clock is a divider of the core clock
+ *
+ * \retval true if reopened, false if the backend cannot be opened and the previous one is kept
+ */
+bool hal_spi_configure( const uint32_t id, const hal_spi_backend_t backend, const uint32_t speed_hz );
+
+/*!
+ * Gets the current backend
+ *
+ * \param [IN] id SPI interface id [1:N]
+ *
+ * \retval backend
+ */
+hal_spi_backend_t hal_spi_get_backend( const uint32_t id );
+
+/*!
+ * Gets the requested SPI clock
+ *
+ * \param [IN] id SPI interface id [1:N]
+ *
+ * \retval clock in Hz
+ */
+uint32_t hal_spi_get_speed_hz( const uint32_t id );
+
+/*!
+ * Gets a backend name
+ *
+ * \param [IN] backend SPI backend
+ *
+ * \retval name, as used by the spi.backend key
+ */
+const char* hal_spi_backend_name( const hal_spi_backend_t backend );
+
 #ifdef __cplusplus
 }
 #endif
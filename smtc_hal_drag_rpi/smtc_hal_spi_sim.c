@@ -0,0 +1,134 @@
+/*!
+ * \file      smtc_hal_spi_sim.c
+ *
+ * \brief     Simulated SX127x SPI slave implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+
+#include "smtc_hal_spi_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SIM_NB_REGS 0x80
+#define SIM_FIFO_SIZE 256
+
+#define SIM_REG_FIFO 0x00
+#define SIM_REG_OP_MODE 0x01
+#define SIM_REG_FIFO_ADDR_PTR 0x0D
+#define SIM_REG_VERSION 0x42
+
+#define SIM_OP_MODE_RESET 0x09
+#define SIM_VERSION 0x12
+
+#define SIM_WRITE_BIT 0x80
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t regs[SIM_NB_REGS] = { [SIM_REG_OP_MODE] = SIM_OP_MODE_RESET, [SIM_REG_VERSION] = SIM_VERSION };
+static uint8_t fifo[SIM_FIFO_SIZE];
+
+static uint8_t address  = 0;
+static bool    is_write = false;
+
+static hal_spi_sim_write_hook_t write_hook = NULL;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_spi_sim_reset( void )
+{
+    memset( regs, 0, sizeof( regs ) );
+    memset( fifo, 0, sizeof( fifo ) );
+    regs[SIM_REG_OP_MODE] = SIM_OP_MODE_RESET;
+    regs[SIM_REG_VERSION] = SIM_VERSION;
+}
+
+void hal_spi_sim_xfer( const uint8_t* out, uint8_t* in, const uint16_t size, const bool frame_start )
+{
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        const uint8_t mosi = ( out != NULL ) ? out[i] : 0;
+        uint8_t       miso = 0;
+
+        if( frame_start && ( i == 0 ) )
+        {
+            address  = mosi & ~SIM_WRITE_BIT;
+            is_write = ( mosi & SIM_WRITE_BIT ) != 0;
+        }
+        else if( address == SIM_REG_FIFO )
+        {
+            // The FIFO pointer wraps, the address stays on RegFifo
+            uint8_t* ptr = &regs[SIM_REG_FIFO_ADDR_PTR];
+            miso         = fifo[*ptr];
+            if( is_write )
+            {
+                fifo[*ptr] = mosi;
+            }
+            ( *ptr )++;
+        }
+        else
+        {
+            // MISO carries the previous value during a write
+            miso = regs[address];
+            if( is_write && ( address != SIM_REG_VERSION ) )
+            {
+                regs[address] = ( write_hook != NULL ) ? write_hook( address, miso, mosi ) : mosi;
+            }
+            address = ( address + 1 ) % SIM_NB_REGS;
+        }
+
+        if( in != NULL )
+        {
+            in[i] = miso;
+        }
+    }
+}
+
+void hal_spi_sim_set_write_hook( const hal_spi_sim_write_hook_t hook )
+{
+    write_hook = hook;
+}
+
+uint8_t hal_spi_sim_get_reg( const uint8_t address )
+{
+    return regs[address % SIM_NB_REGS];
+}
+
+void hal_spi_sim_set_reg( const uint8_t address, const uint8_t value )
+{
+    regs[address % SIM_NB_REGS] = value;
+}
+
+void hal_spi_sim_read_fifo( const uint8_t offset, uint8_t* data, const uint16_t size )
+{
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        data[i] = fifo[( uint8_t ) ( offset + i )];
+    }
+}
+
+void hal_spi_sim_write_fifo( const uint8_t offset, const uint8_t* data, const uint16_t size )
+{
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        fifo[( uint8_t ) ( offset + i )] = data[i];
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
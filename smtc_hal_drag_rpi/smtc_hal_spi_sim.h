@@ -0,0 +1,111 @@
+/*!
+ * \file      smtc_hal_spi_sim.h
+ *
+ * \brief     Simulated SX127x SPI slave: register file and FIFO
+ *
+ * Frames follow the SX127x protocol: an address byte, bit 7 set for a write,
+ * then data with the address auto-incremented, except for RegFifo which reads
+ * or writes the FIFO at RegFifoAddrPtr. Only RegVersion and RegOpMode have
+ * their reset values. The register file does not run the radio by itself, a
+ * radio model follows the register writes with hal_spi_sim_set_write_hook.
+ */
+#ifndef __SMTC_HAL_SPI_SIM_H__
+#define __SMTC_HAL_SPI_SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Register write hook, called for each byte written over SPI
+ *
+ * \param [in] address   Register address
+ * \param [in] old_value Register value before the write
+ * \param [in] value     Byte written
+ *
+ * \retval value to store in the register
+ */
+typedef uint8_t ( *hal_spi_sim_write_hook_t )( const uint8_t address, const uint8_t old_value, const uint8_t value );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Restores the reset values and clears the FIFO
+ */
+void hal_spi_sim_reset( void );
+
+/*!
+ * Transfers bytes with the simulated radio
+ *
+ * \param [in]  out         Bytes sent, zeros if NULL
+ * \param [out] in          Bytes received, discarded if NULL
+ * \param [in]  size        Number of bytes
+ * \param [in]  frame_start The first byte is the address byte of a new frame
+ */
+void hal_spi_sim_xfer( const uint8_t* out, uint8_t* in, const uint16_t size, const bool frame_start );
+
+/*!
+ * Sets the register write hook, NULL to store bytes as written
+ *
+ * \param [in] hook Write hook
+ */
+void hal_spi_sim_set_write_hook( const hal_spi_sim_write_hook_t hook );
+
+/*!
+ * Gets a register without going through SPI
+ *
+ * \param [in] address Register address
+ *
+ * \retval register value
+ */
+uint8_t hal_spi_sim_get_reg( const uint8_t address );
+
+/*!
+ * Sets a register without going through SPI or the write hook
+ *
+ * \param [in] address Register address
+ * \param [in] value   Register value
+ */
+void hal_spi_sim_set_reg( const uint8_t address, const uint8_t value );
+
+/*!
+ * Reads the FIFO without moving RegFifoAddrPtr
+ *
+ * \param [in]  offset FIFO address of the first byte, wraps at 256
+ * \param [out] data   Bytes read
+ * \param [in]  size   Number of bytes
+ */
+void hal_spi_sim_read_fifo( const uint8_t offset, uint8_t* data, const uint16_t size );
+
+/*!
+ * Writes the FIFO without moving RegFifoAddrPtr
+ *
+ * \param [in] offset FIFO address of the first byte, wraps at 256
+ * \param [in] data   Bytes to write
+ * \param [in] size   Number of bytes
+ */
+void hal_spi_sim_write_fifo( const uint8_t offset, const uint8_t* data, const uint16_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_SPI_SIM_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,304 @@
+/*!
+ * \file      smtc_hal_startup.c
+ *
+ * \brief     Startup phases timing implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>   // sysconf
+#include <pthread.h>
+
+#include "smtc_hal_startup.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Index of the start time after the ")" closing the command name in /proc/self/stat
+ */
+#define STARTUP_STAT_STARTTIME_FIELD 20
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const char* phase_names[HAL_STARTUP_PHASE_NB] = {
+    [HAL_STARTUP_PHASE_PROCESS] = "process",         [HAL_STARTUP_PHASE_MAIN] = "main",
+    [HAL_STARTUP_PHASE_PROFILE] = "profile",         [HAL_STARTUP_PHASE_IRQ_QUEUE] = "irq_queue",
+    [HAL_STARTUP_PHASE_GPIO_LIB] = "gpio_lib",       [HAL_STARTUP_PHASE_GPIO] = "gpio",
+    [HAL_STARTUP_PHASE_LP_TIMER] = "lp_timer",       [HAL_STARTUP_PHASE_SPI] = "spi",
+    [HAL_STARTUP_PHASE_RTC] = "rtc",                 [HAL_STARTUP_PHASE_ENV] = "env",
+    [HAL_STARTUP_PHASE_RADIO_RESET] = "radio_reset", [HAL_STARTUP_PHASE_MODEM_INIT] = "modem_init",
+    [HAL_STARTUP_PHASE_CSV_INIT] = "csv_init",       [HAL_STARTUP_PHASE_RESET_EVENT] = "reset_event",
+    [HAL_STARTUP_PHASE_JOIN_REQUEST] = "join_req",   [HAL_STARTUP_PHASE_JOIN_TX] = "join_tx",
+    [HAL_STARTUP_PHASE_JOINED] = "joined",           [HAL_STARTUP_PHASE_RESUMED] = "resumed",
+    [HAL_STARTUP_PHASE_FIRST_TX] = "first_tx",       [HAL_STARTUP_PHASE_FIRST_TXDONE] = "first_txdone",
+};
+
+/*!
+ * Phase times, stamped from the main loop and the radio HAL
+ */
+static pthread_mutex_t startup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        timestamp_us[HAL_STARTUP_PHASE_NB];  //!< Monotonic time, 0 if phase not reached
+
+/*!
+ * Set once FIRST_TX is stamped, so the radio hook costs a single test afterwards
+ */
+static volatile bool radio_tx_done = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static uint64_t startup_now_us( void );
+
+static uint64_t startup_process_start_us( const uint64_t now_us );
+
+static size_t startup_append( char* buf, const size_t size, const size_t len, const char* format, ... );
+
+static int startup_sort_phases( hal_startup_phase_t order[HAL_STARTUP_PHASE_NB], int64_t at_us[HAL_STARTUP_PHASE_NB] );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_startup_mark( const hal_startup_phase_t phase )
+{
+    if( ( phase <= HAL_STARTUP_PHASE_PROCESS ) || ( phase >= HAL_STARTUP_PHASE_NB ) )
+    {
+        return;
+    }
+
+    const uint64_t now = startup_now_us( );
+
+    pthread_mutex_lock( &startup_mutex );
+    if( timestamp_us[HAL_STARTUP_PHASE_PROCESS] == 0 )
+    {
+        timestamp_us[HAL_STARTUP_PHASE_PROCESS] = startup_process_start_us( now );
+    }
+    if( timestamp_us[phase] == 0 )
+    {
+        timestamp_us[phase] = now;
+    }
+    pthread_mutex_unlock( &startup_mutex );
+}
+
+void hal_startup_on_radio_tx( void )
+{
+    if( radio_tx_done )
+    {
+        return;
+    }
+
+    pthread_mutex_lock( &startup_mutex );
+    const bool in_session =
+        ( timestamp_us[HAL_STARTUP_PHASE_JOINED] != 0 ) || ( timestamp_us[HAL_STARTUP_PHASE_RESUMED] != 0 );
+    pthread_mutex_unlock( &startup_mutex );
+
+    if( in_session )
+    {
+        hal_startup_mark( HAL_STARTUP_PHASE_FIRST_TX );
+        radio_tx_done = true;
+    }
+    else
+    {
+        hal_startup_mark( HAL_STARTUP_PHASE_JOIN_TX );
+    }
+}
+
+int64_t hal_startup_get_us( const hal_startup_phase_t phase )
+{
+    int64_t elapsed = -1;
+
+    if( phase >= HAL_STARTUP_PHASE_NB )
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock( &startup_mutex );
+    if( timestamp_us[phase] != 0 )
+    {
+        elapsed = ( int64_t ) ( timestamp_us[phase] - timestamp_us[HAL_STARTUP_PHASE_PROCESS] );
+    }
+    pthread_mutex_unlock( &startup_mutex );
+
+    return elapsed;
+}
+
+const char* hal_startup_phase_name( const hal_startup_phase_t phase )
+{
+    return ( phase < HAL_STARTUP_PHASE_NB ) ? phase_names[phase] : "?";
+}
+
+int hal_startup_format_json( char* buf, const size_t size )
+{
+    hal_startup_phase_t order[HAL_STARTUP_PHASE_NB];
+    int64_t             at_us[HAL_STARTUP_PHASE_NB];
+    const int           nb_phases = startup_sort_phases( order, at_us );
+    const char*         separator = "";
+    size_t              len       = startup_append( buf, size, 0, "{" );
+
+    for( int i = 0; i < nb_phases; i++ )
+    {
+        len += startup_append( buf, size, len, "%s\"%s_ms\" : \"%.1f\"", separator, phase_names[order[i]],
+                               at_us[i] / 1000.0 );
+        separator = ", ";
+    }
+    len += startup_append( buf, size, len, "}" );
+
+    return ( int ) len;
+}
+
+void hal_startup_print( void )
+{
+    hal_startup_phase_t order[HAL_STARTUP_PHASE_NB];
+    int64_t             at_us[HAL_STARTUP_PHASE_NB];
+    const int           nb_phases   = startup_sort_phases( order, at_us );
+    int64_t             previous_us = 0;
+
+    SMTC_HAL_TRACE_PRINTF( "Startup phases (ms)        at    spent\n" );
+    for( int i = 0; i < nb_phases; i++ )
+    {
+        SMTC_HAL_TRACE_PRINTF( "  %-14s    %9.1f %8.1f\n", phase_names[order[i]], at_us[i] / 1000.0,
+                               ( at_us[i] - previous_us ) / 1000.0 );
+        previous_us = at_us[i];
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint64_t startup_now_us( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec * 1000000u + now.tv_nsec / 1000u;
+}
+
+/*!
+ * Converts the process start time, in clock ticks since boot, to the monotonic clock
+ *
+ * \param [in] now_us Current monotonic time
+ *
+ * \retval process start in monotonic time, now_us if it cannot be read
+ */
+static uint64_t startup_process_start_us( const uint64_t now_us )
+{
+#ifdef CLOCK_BOOTTIME
+    char               line[512];
+    unsigned long long start_ticks = 0;
+    struct timespec    boot;
+    FILE*              fp = fopen( "/proc/self/stat", "r" );
+
+    if( fp == NULL )
+    {
+        return now_us;
+    }
+    const bool read_ok = fgets( line, sizeof( line ), fp ) != NULL;
+    fclose( fp );
+
+    // The command name may hold spaces, fields are counted after it
+    char* field = read_ok ? strrchr( line, ')' ) : NULL;
+    for( int i = 0; ( field != NULL ) && ( i < STARTUP_STAT_STARTTIME_FIELD ); i++ )
+    {
+        field = strchr( field + 1, ' ' );
+    }
+    const long ticks_per_s = sysconf( _SC_CLK_TCK );
+    if( ( field == NULL ) || ( sscanf( field, " %llu", &start_ticks ) != 1 ) || ( ticks_per_s <= 0 ) ||
+        ( clock_gettime( CLOCK_BOOTTIME, &boot ) != 0 ) )
+    {
+        return now_us;
+    }
+
+    const uint64_t boot_us  = ( uint64_t ) boot.tv_sec * 1000000u + boot.tv_nsec / 1000u;
+    const uint64_t start_us = ( uint64_t ) start_ticks * 1000000u / ( uint64_t ) ticks_per_s;
+    const uint64_t age_us   = ( boot_us > start_us ) ? boot_us - start_us : 0;
+
+    return ( now_us > age_us ) ? now_us - age_us : now_us;
+#else
+    return now_us;
+#endif
+}
+
+/*!
+ * Appends formatted text at len, keeps counting once the buffer is full
+ *
+ * \retval length of the appended text
+ */
+static size_t startup_append( char* buf, const size_t size, const size_t len, const char* format, ... )
+{
+    va_list args;
+
+    va_start( args, format );
+    const int n = vsnprintf( ( len < size ) ? buf + len : NULL, ( len < size ) ? size - len : 0, format, args );
+    va_end( args );
+
+    return ( n > 0 ) ? ( size_t ) n : 0;
+}
+
+/*!
+ * Lists the reached phases from MAIN on, by time; phases stamped at the same time keep the enum order
+ *
+ * \param [out] order Phases
+ * \param [out] at_us Their times since the process start
+ *
+ * \retval number of phases
+ */
+static int startup_sort_phases( hal_startup_phase_t order[HAL_STARTUP_PHASE_NB], int64_t at_us[HAL_STARTUP_PHASE_NB] )
+{
+    int nb_phases = 0;
+
+    for( int i = HAL_STARTUP_PHASE_MAIN; i < HAL_STARTUP_PHASE_NB; i++ )
+    {
+        const int64_t phase_us = hal_startup_get_us( ( hal_startup_phase_t ) i );
+        if( phase_us < 0 )
+        {
+            continue;
+        }
+
+        // Insertion sort, a couple of dozen phases at most
+        int j = nb_phases++;
+        while( ( j > 0 ) && ( at_us[j - 1] > phase_us ) )
+        {
+            order[j] = order[j - 1];
+            at_us[j] = at_us[j - 1];
+            j--;
+        }
+        order[j] = ( hal_startup_phase_t ) i;
+        at_us[j] = phase_us;
+    }
+
+    return nb_phases;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
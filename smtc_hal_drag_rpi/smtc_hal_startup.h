@@ -0,0 +1,142 @@
+/*!
+ * \file      smtc_hal_startup.h
+ *
+ * \brief     Startup phases timing, from process start to the first uplink
+ *
+ * Each phase is stamped the first time it is reached, in monotonic time:
+ *
+ *   PROCESS      -> process created (fork of the restart loop), from /proc
+ *   MAIN         -> application entry
+ *   PROFILE ..   -> hal_mcu_init steps, stamped at the end of each step;
+ *                   GPIO_LIB is the GPIO library ready (gpioInitialise on the Pi)
+ *   RADIO_RESET  -> radio answering after its first reset
+ *   MODEM_INIT   -> smtc_modem_init returned
+ *   CSV_INIT     -> CSV log opened
+ *   RESET_EVENT  -> modem RESET event handled
+ *   JOIN_REQUEST -> join requested to the modem
+ *   JOIN_TX      -> radio in TX for the Join-Request
+ *   JOINED       -> JOINED event, or RESUMED for a stored session
+ *   FIRST_TX     -> radio in TX for the first uplink of the session
+ *   FIRST_TXDONE -> TXDONE event of that uplink
+ *
+ * Phases that are not reached, e.g. the join ones on a resumed session, are skipped.
+ * Reports list the phases in the order they were reached.
+ */
+#ifndef __SMTC_HAL_STARTUP_H__
+#define __SMTC_HAL_STARTUP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // size_t
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Startup phases, in their usual order
+ */
+typedef enum hal_startup_phase_e
+{
+    HAL_STARTUP_PHASE_PROCESS = 0,
+    HAL_STARTUP_PHASE_MAIN,
+    HAL_STARTUP_PHASE_PROFILE,
+    HAL_STARTUP_PHASE_IRQ_QUEUE,
+    HAL_STARTUP_PHASE_GPIO_LIB,
+    HAL_STARTUP_PHASE_GPIO,
+    HAL_STARTUP_PHASE_LP_TIMER,
+    HAL_STARTUP_PHASE_SPI,
+    HAL_STARTUP_PHASE_RTC,
+    HAL_STARTUP_PHASE_ENV,
+    HAL_STARTUP_PHASE_RADIO_RESET,
+    HAL_STARTUP_PHASE_MODEM_INIT,
+    HAL_STARTUP_PHASE_CSV_INIT,
+    HAL_STARTUP_PHASE_RESET_EVENT,
+    HAL_STARTUP_PHASE_JOIN_REQUEST,
+    HAL_STARTUP_PHASE_JOIN_TX,
+    HAL_STARTUP_PHASE_JOINED,
+    HAL_STARTUP_PHASE_RESUMED,
+    HAL_STARTUP_PHASE_FIRST_TX,
+    HAL_STARTUP_PHASE_FIRST_TXDONE,
+    HAL_STARTUP_PHASE_NB,
+} hal_startup_phase_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Stamps a phase, only the first call for a given phase is kept
+ *
+ * \remark The first stamp also reads the process start time
+ *
+ * \param [in] phase Phase reached
+ */
+void hal_startup_mark( const hal_startup_phase_t phase );
+
+/*!
+ * Stamps JOIN_TX or FIRST_TX, to be called when the radio enters TX
+ */
+void hal_startup_on_radio_tx( void );
+
+/*!
+ * Gets the time of a phase since the process start
+ *
+ * \param [in] phase Phase
+ *
+ * \retval time in microseconds, -1 if the phase was not reached
+ */
+int64_t hal_startup_get_us( const hal_startup_phase_t phase );
+
+/*!
+ * Gets the name of a phase
+ *
+ * \param [in] phase Phase
+ *
+ * \retval phase name
+ */
+const char* hal_startup_phase_name( const hal_startup_phase_t phase );
+
+/*!
+ * Formats the reached phases, in time order, as a JSON object of times in ms since the process start
+ *
+ * \param [out] buf  Output buffer
+ * \param [in]  size Buffer size
+ *
+ * \retval length of the text, truncated if >= size
+ */
+int hal_startup_format_json( char* buf, const size_t size );
+
+/*!
+ * Prints the phases breakdown on the trace output, in time order, with the time spent in each phase
+ */
+void hal_startup_print( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_STARTUP_H__
+
+/* --- EOF ------------------------------------------------------------------ */
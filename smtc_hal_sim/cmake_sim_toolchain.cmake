@@ -0,0 +1,20 @@
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+
+# This CMake toolchain file describes how to build for the host, with the simulated radio
+
+set(CMAKE_SYSTEM_NAME Linux)
+
+
+set(CMAKE_C_COMPILER gcc)
+set(CMAKE_SIZE       size)
+
+
+set(SMTC_HAL_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+set(CMAKE_C_FLAGS_INIT "\
+-fno-builtin \
+-fno-unroll-loops -ffast-math -ftree-vectorize -fomit-frame-pointer \
+-fdata-sections -ffunction-sections -falign-functions=4 \
+-D_POSIX_C_SOURCE=199309L -D_XOPEN_SOURCE=600 \
+"
+)
@@ -0,0 +1,54 @@
+/*!
+ * \file      smtc_hal_board_sim.c
+ *
+ * \brief     Board hooks of the MCU HAL, host simulation: no GPIO library
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <errno.h>
+#include <time.h>
+
+#include "smtc_hal_board.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_board_gpio_lib_init( void )
+{
+}
+
+void hal_board_gpio_lib_terminate( void )
+{
+}
+
+void hal_board_delay_us( const int32_t microseconds )
+{
+    struct timespec wake;
+
+    if( microseconds <= 0 )
+    {
+        return;
+    }
+
+    clock_gettime( RT_CLOCK, &wake );
+    wake.tv_sec += microseconds / 1000000;
+    wake.tv_nsec += ( long ) ( microseconds % 1000000 ) * 1000;
+    if( wake.tv_nsec >= 1000000000 )
+    {
+        wake.tv_sec += 1;
+        wake.tv_nsec -= 1000000000;
+    }
+    while( clock_nanosleep( RT_CLOCK, TIMER_ABSTIME, &wake, NULL ) == EINTR )
+    {
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,270 @@
+/*!
+ * \file      smtc_hal_gpio.c
+ *
+ * \brief     GPIO Hardware Abstraction Layer implementation, host simulation
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2021. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // size_t
+
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_irq_queue.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct hal_gpio_s
+{
+    const hal_gpio_irq_t *irq;
+    hal_gpio_irq_mode_t  irq_mode;
+    bool                 blocked;
+    bool                 pending;
+    bool                 injected;  //!< Reads high until the injected IRQ is dispatched
+    uint8_t              level;
+} gpio_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * Array holding attached IRQ gpio data context
+ *
+ * Pins have no electrical side: a level is what was last written, or the pull of an input
+ */
+static gpio_t gpio[P_NUM];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Checks a pin name, panics if it is not a GPIO of the board
+ */
+static uint8_t gpio_index( const hal_gpio_pin_names_t pin );
+
+/*!
+ * Runs the IRQ callback of a pin from the IRQ dispatcher thread
+ */
+static void gpio_irq_dispatch( void* context );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+//
+// MCU input pin Handling
+//
+
+void hal_gpio_init_in( const hal_gpio_pin_names_t pin, const hal_gpio_pull_mode_t pull_mode,
+                       const hal_gpio_irq_mode_t irq_mode, hal_gpio_irq_t* irq )
+{
+    uint8_t index = gpio_index( pin );
+
+    if( irq != NULL )
+    {
+        irq->pin = pin;
+    }
+
+    hal_irq_queue_lock();
+    gpio[index].level    = (pull_mode == BSP_GPIO_PULL_MODE_UP) ? 1 : 0;
+    gpio[index].irq_mode = irq_mode;
+    gpio[index].injected = false;
+    hal_irq_queue_unlock();
+
+    hal_gpio_irq_attach(irq);
+}
+
+void hal_gpio_init_out( const hal_gpio_pin_names_t pin, const uint32_t value )
+{
+    hal_gpio_set_value(pin, value);
+}
+
+void hal_gpio_irq_deinit(void)
+{
+    hal_irq_queue_lock();
+    for (size_t i = 0; i < P_NUM; i++)
+    {
+        gpio[i].irq      = NULL;
+        gpio[i].pending  = false;
+        gpio[i].injected = false;
+    }
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_irq_attach( const hal_gpio_irq_t* irq )
+{
+    if ((irq == NULL) || (irq->callback == NULL))
+    {
+        return;
+    }
+
+    uint8_t index = gpio_index(irq->pin);
+    if (gpio[index].irq_mode == BSP_GPIO_IRQ_MODE_OFF)
+    {
+        return;
+    }
+
+    hal_irq_queue_lock();
+    gpio[index].irq = irq;
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_irq_detach( const hal_gpio_irq_t* irq )
+{
+    if (irq == NULL)
+    {
+        return;
+    }
+
+    hal_irq_queue_lock();
+    gpio[gpio_index(irq->pin)].irq = NULL;
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_irq_enable( void )
+{
+    hal_irq_queue_lock();
+    for (size_t i = 0; i < P_NUM; i++)
+    {
+        gpio[i].blocked = false;
+        if (gpio[i].pending)
+        {
+            gpio[i].pending = false;
+            hal_irq_queue_post(gpio_irq_dispatch, (void*) (uintptr_t) i);
+        }
+    }
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_irq_disable( void )
+{
+    // waits for a running callback to return
+    hal_irq_queue_lock();
+    for (size_t i = 0; i < P_NUM; i++)
+    {
+        gpio[i].blocked = true;
+    }
+    hal_irq_queue_unlock();
+}
+
+//
+// MCU pin state control
+//
+
+void hal_gpio_set_value( const hal_gpio_pin_names_t pin, const uint32_t value )
+{
+    gpio[gpio_index(pin)].level = (value != 0) ? 1 : 0;
+}
+
+uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin )
+{
+    uint8_t index = gpio_index(pin);
+
+    return gpio[index].injected ? 1 : gpio[index].level;
+}
+
+void hal_gpio_clear_pending_irq( const hal_gpio_pin_names_t pin )
+{
+    hal_irq_queue_lock();
+    for (size_t i = 0; i < P_NUM; i++)
+    {
+        // a dropped injected IRQ must not keep its pin reading high
+        gpio[i].pending  = false;
+        gpio[i].injected = false;
+    }
+    hal_irq_queue_unlock();
+}
+
+void hal_gpio_inject_irq( const hal_gpio_pin_names_t pin )
+{
+    uint8_t index = gpio_index(pin);
+
+    // the only edges of this board, the line reads high until the callback ran
+    gpio[index].injected = true;
+    hal_irq_queue_post(gpio_irq_dispatch, (void*) (uintptr_t) index);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t gpio_index( const hal_gpio_pin_names_t pin )
+{
+    if ((pin < P_2) || (pin > P_27))
+    {
+        SMTC_HAL_TRACE_ERROR("GPIO %d does not exist\n", (int) pin);
+        mcu_panic();
+    }
+    return pin - 0x2u;
+}
+
+static void gpio_irq_dispatch( void* context )
+{
+    uint8_t index = (uintptr_t) context;
+
+    if (gpio[index].blocked)
+    {
+        gpio[index].pending = true;
+        return;
+    }
+
+    if ((gpio[index].irq != NULL) && (gpio[index].irq->callback != NULL))
+    {
+        gpio[index].irq->callback(gpio[index].irq->context);
+    }
+    gpio[index].injected = false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
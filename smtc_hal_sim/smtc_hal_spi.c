@@ -0,0 +1,173 @@
+/*!
+ * \file      smtc_hal_spi.c
+ *
+ * \brief     SPI Hardware Abstraction Layer implementation, host simulation
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2021. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdbool.h>  // bool type
+#include <stdint.h>   // C99 types
+#include <string.h>
+
+#include "smtc_hal_spi.h"
+#include "smtc_hal_spi_sim.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bool     opened   = false;
+static uint32_t speed_hz = HAL_SPI_DEFAULT_SPEED_HZ;
+
+static const char* const backend_names[HAL_SPI_BACKEND_NB] = { "pigpio", "spidev", "sim" };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_spi_init( const uint32_t id, const hal_gpio_pin_names_t mosi, const hal_gpio_pin_names_t miso,
+                   const hal_gpio_pin_names_t sclk )
+{
+    const char* name;
+    int32_t     value;
+
+    // There is no bus on the host, the register file of the simulated radio is the only backend
+    if( ( hal_board_profile_get_str( "spi.backend", &name ) == true ) &&
+        ( strcmp( name, backend_names[HAL_SPI_BACKEND_SIM] ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "SPI backend %s is not available on this board, using sim\n", name );
+    }
+    if( ( hal_board_profile_get_int( "spi.speed_hz", &value ) == true ) && ( value > 0 ) )
+    {
+        speed_hz = ( uint32_t ) value;
+    }
+
+    hal_spi_sim_reset( );
+    opened = true;
+}
+
+void hal_spi_deinit( const uint32_t id )
+{
+    opened = false;
+}
+
+uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data )
+{
+    uint8_t in_buf;
+    uint8_t out_buf = ( uint8_t ) ( out_data & 0xFF );
+
+    if( !opened )
+    {
+        mcu_panic( );
+    }
+    hal_spi_sim_xfer( &out_buf, &in_buf, 1, true );
+    return in_buf;
+}
+
+void hal_spi_in_out_buffer( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size )
+{
+    if( size == 0 )
+    {
+        return;
+    }
+
+    if( !opened )
+    {
+        mcu_panic( );
+    }
+    hal_spi_sim_xfer( out_data, in_data, size, false );
+}
+
+bool hal_spi_configure( const uint32_t id, const hal_spi_backend_t new_backend, const uint32_t new_speed_hz )
+{
+    if( new_backend != HAL_SPI_BACKEND_SIM )
+    {
+        SMTC_HAL_TRACE_WARNING( "SPI backend %s is not available on this board\n",
+                                hal_spi_backend_name( new_backend ) );
+        return false;
+    }
+
+    hal_spi_sim_reset( );
+    speed_hz = new_speed_hz;
+    opened   = true;
+    return true;
+}
+
+hal_spi_backend_t hal_spi_get_backend( const uint32_t id )
+{
+    return HAL_SPI_BACKEND_SIM;
+}
+
+uint32_t hal_spi_get_speed_hz( const uint32_t id )
+{
+    return speed_hz;
+}
+
+const char* hal_spi_backend_name( const hal_spi_backend_t spi_backend )
+{
+    return ( spi_backend < HAL_SPI_BACKEND_NB ) ? backend_names[spi_backend] : "unknown";
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
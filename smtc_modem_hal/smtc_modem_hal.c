@@ -49,6 +49,9 @@
 #include "smtc_hal_rng.h"
 #include "smtc_hal_rtc.h"
 #include "smtc_hal_trace.h"
+#include "smtc_hal_latency.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_env.h"
 
 #include "smtc_hal_nvm.h"
 
@@ -93,11 +96,21 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+/*!
+ * Radio IRQ callback registered by the modem, called through radio_irq_trampoline
+ */
+static void ( *radio_irq_callback )( void* context ) = NULL;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Stamps the radio IRQ latency trace point and forwards the IRQ to the modem
+ */
+static void radio_irq_trampoline( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -106,6 +119,7 @@
 /* ------------ Reset management ------------*/
 void smtc_modem_hal_reset_mcu( void )
 {
+    hal_reset_cause_set( false, "modem reset" );
     hal_mcu_reset( );
 }
 
@@ -247,6 +261,7 @@ void smtc_modem_hal_on_panic( uint8_t* func, uint32_t line, const char* fmt, ...
     // smtc_modem_hal_crashlog_store( out_buff, out_len );
 
     SMTC_HAL_TRACE_ERROR( "Modem panic: %s\n", out_buff );
+    hal_reset_cause_set( false, "modem panic in %s:%u", ( const char* ) func, ( unsigned ) line );
     smtc_modem_hal_reset_mcu( );
 }
 
@@ -264,7 +279,8 @@ void smtc_modem_hal_irq_config_radio_irq( void ( *callback )( void* context ), v
 #if defined( SX1276 )
     sx127x_t* radio = ( sx127x_t* ) smtc_modem_get_radio_context( );
 
-    sx127x_irq_attach( radio, callback, context );
+    radio_irq_callback = callback;
+    sx127x_irq_attach( radio, radio_irq_trampoline, context );
 #endif
 }
 
@@ -286,6 +302,7 @@ void smtc_modem_hal_stop_radio_tcxo( void )
 
 uint32_t smtc_modem_hal_get_radio_tcxo_startup_delay_ms( void )
 {
+    // The Dragino HAT uses a crystal, there is no TCXO to wait for
     return 0;
 }
 
@@ -298,17 +315,20 @@ void smtc_modem_hal_set_ant_switch( bool is_tx_on )
 
 uint8_t smtc_modem_hal_get_battery_level( void )
 {
-    // Please implement according to used board
     // According to LoRaWan 1.0.4 spec:
     // 0: The end-device is connected to an external power source.
     // 1..254: Battery level, where 1 is the minimum and 254 is the maximum.
     // 255: The end-device was not able to measure the battery level.
-    return 0;
+    return hal_env_get_battery_level( );
 }
 
 int8_t smtc_modem_hal_get_board_delay_ms( void )
 {
-    return 0;
+    // Delay between RX window timer expiry and the radio in RX, measured by the porting tests
+    int32_t delay_ms = 0;
+    hal_board_profile_get_int( "radio.board_delay_ms", &delay_ms );
+
+    return ( delay_ms < 0 ) ? 0 : ( delay_ms > INT8_MAX ) ? INT8_MAX : ( int8_t ) delay_ms;
 }
 
 /* ------------ Trace management ------------*/
@@ -325,13 +345,12 @@ void smtc_modem_hal_print_trace( const char* fmt, ... )
 
 int8_t smtc_modem_hal_get_temperature( void )
 {
-    // Please implement according to used board
-    return 25;
+    return hal_env_get_temperature( );
 }
 
 uint16_t smtc_modem_hal_get_voltage_mv( void )
 {
-    return 3300;
+    return hal_env_get_voltage_mv( );
 }
 
 /* ------------ For Real Time OS compatibility  ------------*/
@@ -346,4 +365,13 @@ void smtc_modem_hal_user_lbm_irq( void )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void radio_irq_trampoline( void* context )
+{
+    hal_latency_mark( HAL_LATENCY_STAGE_RADIO_IRQ );
+    if( radio_irq_callback != NULL )
+    {
+        radio_irq_callback( context );
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,418 @@
+/*!
+ * \file      supervisor.c
+ *
+ * \brief     Restart supervisor of the application process, implementation
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>    // fork
+#include <sys/wait.h>  // waitpid
+
+#include "supervisor.h"
+#include "smtc_hal_board_profile.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define SUPERVISOR_DEFAULT_STATE_PATH "/tmp/lorawan-dragino-supervisor"
+
+/*!
+ * Exit code of hal_mcu_reset
+ */
+#define SUPERVISOR_RESET_EXIT_CODE 3
+
+/*!
+ * Fault times kept to count the faults within the window, bounds supervisor.max_restarts
+ */
+#define SUPERVISOR_FAULTS_MAX 64
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct supervisor_policy_s
+{
+    uint32_t    backoff_min_ms;
+    uint32_t    backoff_max_ms;
+    uint32_t    healthy_s;
+    uint32_t    max_restarts;
+    uint32_t    window_s;
+    bool        exit_on_limit;
+    const char* state_path;
+} supervisor_policy_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static supervisor_policy_t policy;
+static supervisor_stats_t  stats = { 0 };
+
+/*!
+ * Monotonic times of the last faults, oldest first
+ */
+static uint64_t fault_times_s[SUPERVISOR_FAULTS_MAX];
+static uint32_t fault_count = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+static void supervisor_policy_load( void );
+
+static void supervisor_load_uint( const char* key, uint32_t* value );
+
+static void supervisor_state_load( void );
+
+static void supervisor_state_save( void );
+
+static bool supervisor_restart_cause( const int wstatus, hal_reset_cause_t* cause );
+
+static uint32_t supervisor_count_fault( const uint64_t now_s );
+
+static uint64_t supervisor_now_s( void );
+
+static void supervisor_sleep_ms( const uint32_t delay_ms );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int supervisor_run( void ( *app )( void ) )
+{
+    uint32_t consecutive = 0;
+
+    hal_board_profile_load( );
+    supervisor_policy_load( );
+    supervisor_state_load( );
+    hal_reset_cause_share( );
+
+    while( true )
+    {
+        // Unflushed output would be written again by each child
+        fflush( NULL );
+
+        const uint64_t start_s = supervisor_now_s( );
+        int            wstatus = 0;
+        const pid_t    cpid    = fork( );
+
+        if( cpid == 0 )
+        {
+            app( );
+            exit( EXIT_SUCCESS );
+        }
+        if( cpid < 0 )
+        {
+            SMTC_HAL_TRACE_ERROR( "Supervisor: fork failed: %s\n", strerror( errno ) );
+            return EXIT_FAILURE;
+        }
+        while( ( waitpid( cpid, &wstatus, 0 ) < 0 ) && ( errno == EINTR ) )
+        {
+        }
+
+        hal_reset_cause_t cause;
+        if( supervisor_restart_cause( wstatus, &cause ) == false )
+        {
+            // Normal end, or stopped on purpose: forward the application verdict
+            return WIFEXITED( wstatus ) ? WEXITSTATUS( wstatus ) : EXIT_FAILURE;
+        }
+
+        const uint64_t now_s = supervisor_now_s( );
+        stats.restarts++;
+        stats.restarts_total++;
+        if( WIFSIGNALED( wstatus ) )
+        {
+            stats.crashes_total++;
+        }
+        snprintf( stats.last_cause, sizeof( stats.last_cause ), "%s", cause.text );
+
+        if( cause.planned == true )
+        {
+            supervisor_state_save( );
+            SMTC_HAL_TRACE_INFO( "Supervisor: restart %u (%s)\n", stats.restarts, cause.text );
+            continue;
+        }
+
+        stats.faults_total++;
+        supervisor_state_save( );
+
+        // A long enough run means the fault was not persistent
+        if( ( now_s - start_s ) >= policy.healthy_s )
+        {
+            consecutive     = 0;
+            stats.safe_mode = false;
+        }
+        consecutive++;
+
+        const uint32_t in_window = supervisor_count_fault( now_s );
+        stats.faults_per_h       = ( float ) in_window * 3600.0f / ( float ) policy.window_s;
+
+        if( in_window > policy.max_restarts )
+        {
+            if( policy.exit_on_limit == true )
+            {
+                SMTC_HAL_TRACE_ERROR( "Supervisor: %u faults in %u s, giving up (last: %s)\n", in_window,
+                                      policy.window_s, cause.text );
+                return EXIT_FAILURE;
+            }
+            if( stats.safe_mode == false )
+            {
+                SMTC_HAL_TRACE_ERROR( "Supervisor: %u faults in %u s, safe mode\n", in_window, policy.window_s );
+            }
+            stats.safe_mode = true;
+        }
+
+        uint32_t delay_ms = policy.backoff_max_ms;
+        if( ( stats.safe_mode == false ) && ( consecutive <= 31 ) &&
+            ( ( policy.backoff_max_ms >> ( consecutive - 1 ) ) > policy.backoff_min_ms ) )
+        {
+            delay_ms = policy.backoff_min_ms << ( consecutive - 1 );
+        }
+
+        SMTC_HAL_TRACE_WARNING( "Supervisor: restart %u (%s), %u faults in %u s, next start in %u ms\n",
+                                stats.restarts, cause.text, in_window, policy.window_s, delay_ms );
+        supervisor_sleep_ms( delay_ms );
+    }
+}
+
+void supervisor_get_stats( supervisor_stats_t* out )
+{
+    // The application process got a copy when it was forked
+    *out = stats;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void supervisor_policy_load( void )
+{
+    const char* on_limit = NULL;
+
+    policy.backoff_min_ms = 1000;
+    policy.backoff_max_ms = 300000;
+    policy.healthy_s      = 600;
+    policy.max_restarts   = 10;
+    policy.window_s       = 3600;
+    policy.exit_on_limit  = false;
+    policy.state_path     = SUPERVISOR_DEFAULT_STATE_PATH;
+
+    supervisor_load_uint( "supervisor.backoff_min_ms", &policy.backoff_min_ms );
+    supervisor_load_uint( "supervisor.backoff_max_ms", &policy.backoff_max_ms );
+    supervisor_load_uint( "supervisor.healthy_s", &policy.healthy_s );
+    supervisor_load_uint( "supervisor.max_restarts", &policy.max_restarts );
+    supervisor_load_uint( "supervisor.window_s", &policy.window_s );
+    hal_board_profile_get_str( "supervisor.state_path", &policy.state_path );
+
+    if( hal_board_profile_get_str( "supervisor.on_limit", &on_limit ) )
+    {
+        if( strcmp( on_limit, "exit" ) == 0 )
+        {
+            policy.exit_on_limit = true;
+        }
+        else if( strcmp( on_limit, "slow" ) != 0 )
+        {
+            SMTC_HAL_TRACE_WARNING( "Board profile: supervisor.on_limit = %s is unknown, using slow\n", on_limit );
+        }
+    }
+
+    if( policy.backoff_min_ms == 0 )
+    {
+        policy.backoff_min_ms = 1;
+    }
+    if( policy.backoff_max_ms < policy.backoff_min_ms )
+    {
+        policy.backoff_max_ms = policy.backoff_min_ms;
+    }
+    if( policy.max_restarts >= SUPERVISOR_FAULTS_MAX )
+    {
+        policy.max_restarts = SUPERVISOR_FAULTS_MAX - 1;
+    }
+    if( policy.window_s == 0 )
+    {
+        policy.window_s = 1;
+    }
+}
+
+static void supervisor_load_uint( const char* key, uint32_t* value )
+{
+    int32_t read;
+
+    if( hal_board_profile_get_int( key, &read ) )
+    {
+        if( read < 0 )
+        {
+            SMTC_HAL_TRACE_WARNING( "Board profile: %s = %d is negative, keeping %u\n", key, ( int ) read, *value );
+            return;
+        }
+        *value = ( uint32_t ) read;
+    }
+}
+
+static void supervisor_state_load( void )
+{
+    char  line[160];
+    FILE* fp = fopen( policy.state_path, "r" );
+
+    if( fp == NULL )
+    {
+        return;
+    }
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        unsigned long value;
+
+        if( sscanf( line, "restarts = %lu", &value ) == 1 )
+        {
+            stats.restarts_total = ( uint32_t ) value;
+        }
+        else if( sscanf( line, "faults = %lu", &value ) == 1 )
+        {
+            stats.faults_total = ( uint32_t ) value;
+        }
+        else if( sscanf( line, "crashes = %lu", &value ) == 1 )
+        {
+            stats.crashes_total = ( uint32_t ) value;
+        }
+        else if( strncmp( line, "last_cause = ", 13 ) == 0 )
+        {
+            line[strcspn( line, "\r\n" )] = '\0';
+            snprintf( stats.last_cause, sizeof( stats.last_cause ), "%s", line + 13 );
+        }
+    }
+    fclose( fp );
+
+    SMTC_HAL_TRACE_INFO( "Supervisor: %u restarts so far, %u faults, %u crashes, last: %s\n", stats.restarts_total,
+                         stats.faults_total, stats.crashes_total,
+                         ( stats.last_cause[0] != '\0' ) ? stats.last_cause : "none" );
+}
+
+static void supervisor_state_save( void )
+{
+    char  tmp_path[256];
+    FILE* fp;
+
+    // Written aside then renamed, so a power cut leaves the old or the new state
+    snprintf( tmp_path, sizeof( tmp_path ), "%s.tmp", policy.state_path );
+    fp = fopen( tmp_path, "w" );
+    if( fp == NULL )
+    {
+        SMTC_HAL_TRACE_WARNING( "Supervisor: cannot write %s: %s\n", tmp_path, strerror( errno ) );
+        return;
+    }
+    fprintf( fp, "restarts = %u\nfaults = %u\ncrashes = %u\nlast_cause = %s\nlast_restart = %lld\n",
+             stats.restarts_total, stats.faults_total, stats.crashes_total, stats.last_cause,
+             ( long long ) time( NULL ) );
+    if( ( fclose( fp ) != 0 ) || ( rename( tmp_path, policy.state_path ) != 0 ) )
+    {
+        SMTC_HAL_TRACE_WARNING( "Supervisor: cannot write %s: %s\n", policy.state_path, strerror( errno ) );
+    }
+}
+
+/*!
+ * Tells whether an ended application process must be restarted, and why
+ *
+ * \param [in]  wstatus Status from waitpid
+ * \param [out] cause   Restart cause
+ *
+ * \retval true if the process must be restarted
+ */
+static bool supervisor_restart_cause( const int wstatus, hal_reset_cause_t* cause )
+{
+    hal_reset_cause_take( cause );
+
+    if( WIFEXITED( wstatus ) && ( WEXITSTATUS( wstatus ) == SUPERVISOR_RESET_EXIT_CODE ) )
+    {
+        if( cause->text[0] == '\0' )
+        {
+            snprintf( cause->text, sizeof( cause->text ), "reset" );
+        }
+        return true;
+    }
+
+    if( WIFSIGNALED( wstatus ) )
+    {
+        switch( WTERMSIG( wstatus ) )
+        {
+        case SIGSEGV:
+        case SIGBUS:
+        case SIGILL:
+        case SIGFPE:
+        case SIGABRT:
+            cause->planned = false;
+            snprintf( cause->text, sizeof( cause->text ), "crash, signal %d", WTERMSIG( wstatus ) );
+            return true;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+/*!
+ * Records a fault time
+ *
+ * \param [in] now_s Fault time
+ *
+ * \retval number of faults within the window, this one included
+ */
+static uint32_t supervisor_count_fault( const uint64_t now_s )
+{
+    uint32_t in_window = 0;
+
+    if( fault_count == SUPERVISOR_FAULTS_MAX )
+    {
+        memmove( fault_times_s, fault_times_s + 1, ( SUPERVISOR_FAULTS_MAX - 1 ) * sizeof( fault_times_s[0] ) );
+        fault_count--;
+    }
+    fault_times_s[fault_count++] = now_s;
+
+    for( uint32_t i = 0; i < fault_count; i++ )
+    {
+        if( ( now_s - fault_times_s[i] ) < policy.window_s )
+        {
+            in_window++;
+        }
+    }
+    return in_window;
+}
+
+static uint64_t supervisor_now_s( void )
+{
+    struct timespec now;
+    clock_gettime( RT_CLOCK, &now );
+
+    return ( uint64_t ) now.tv_sec;
+}
+
+static void supervisor_sleep_ms( const uint32_t delay_ms )
+{
+    struct timespec delay = { .tv_sec = delay_ms / 1000, .tv_nsec = ( long ) ( delay_ms % 1000 ) * 1000000 };
+
+    while( ( nanosleep( &delay, &delay ) < 0 ) && ( errno == EINTR ) )
+    {
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,87 @@
+/*!
+ * \file      supervisor.h
+ *
+ * \brief     Restart supervisor of the application process
+ *
+ * The application runs in a child process, restarted when it resets (exit
+ * code 3) or crashes (SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT). Fault
+ * restarts are delayed with an exponential backoff, reset once a run lasts
+ * supervisor.healthy_s. Past supervisor.max_restarts faults within
+ * supervisor.window_s, the supervisor gives up (on_limit = exit) or goes on
+ * in safe mode, restarting at the longest delay only (on_limit = slow).
+ * Planned resets, e.g. for a firmware update, restart at once.
+ *
+ * Counters and the last cause are kept in supervisor.state_path across runs:
+ *
+ *   supervisor.backoff_min_ms = 1000
+ *   supervisor.backoff_max_ms = 300000
+ *   supervisor.healthy_s      = 600
+ *   supervisor.max_restarts   = 10
+ *   supervisor.window_s       = 3600
+ *   supervisor.on_limit       = slow      # slow | exit
+ *   supervisor.state_path     = /tmp/lorawan-dragino-supervisor
+ */
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_hal_reset_cause.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Restart counters, as of the start of the application process
+ */
+typedef struct supervisor_stats_s
+{
+    uint32_t restarts;        //!< Restarts since the supervisor started
+    uint32_t restarts_total;  //!< Restarts, all runs of the supervisor
+    uint32_t faults_total;    //!< Resets and crashes that were not planned, all runs
+    uint32_t crashes_total;   //!< Processes killed by a signal, all runs
+    float    faults_per_h;    //!< Fault rate over supervisor.window_s
+    bool     safe_mode;       //!< Restart limit reached, restarts at the longest delay
+    char     last_cause[HAL_RESET_CAUSE_LEN];  //!< Cause of the last restart, empty if none
+} supervisor_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Runs the application in a child process and restarts it on reset or crash
+ *
+ * \param [in] app Application entry, run in the child
+ *
+ * \retval exit code of the last run, EXIT_FAILURE if the supervisor gave up
+ */
+int supervisor_run( void ( *app )( void ) );
+
+/*!
+ * Gets the restart counters, to be called by the application
+ *
+ * \param [out] stats Counters, zero if the application is not supervised
+ */
+void supervisor_get_stats( supervisor_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUPERVISOR_H */
+
+/* --- EOF ------------------------------------------------------------------ */